@@ -0,0 +1,383 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * 'gcc -DTEST -O2 -o test decimate.c -lm' prints the response of each
+ * decimation factor, using C versions of the Cortex-M4 SIMD instructions.
+ */
+
+#include <string.h>
+
+#include "decimate.h"
+
+/* Cortex-M4 DSP instructions, C versions elsewhere (TEST builds) */
+#if defined(__ARM_ARCH_7EM__)
+
+static inline uint32_t sxtb16(const uint32_t x) {
+	uint32_t r;
+	__asm__("sxtb16 %0, %1" : "=r" (r) : "r" (x));
+	return r;
+}
+
+static inline uint32_t sxtb16_ror8(const uint32_t x) {
+	uint32_t r;
+	__asm__("sxtb16 %0, %1, ror #8" : "=r" (r) : "r" (x));
+	return r;
+}
+
+static inline uint32_t pkhbt16(const uint32_t bottom, const uint32_t top) {
+	uint32_t r;
+	__asm__("pkhbt %0, %1, %2, lsl #16" : "=r" (r) : "r" (bottom), "r" (top));
+	return r;
+}
+
+static inline uint32_t pkhtb16(const uint32_t top, const uint32_t bottom) {
+	uint32_t r;
+	__asm__("pkhtb %0, %1, %2, asr #16" : "=r" (r) : "r" (top), "r" (bottom));
+	return r;
+}
+
+static inline uint32_t sadd16(const uint32_t a, const uint32_t b) {
+	uint32_t r;
+	__asm__("sadd16 %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+static inline uint32_t ssub16(const uint32_t a, const uint32_t b) {
+	uint32_t r;
+	__asm__("ssub16 %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+static inline uint32_t shadd16(const uint32_t a, const uint32_t b) {
+	uint32_t r;
+	__asm__("shadd16 %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+}
+
+static inline int32_t smlad(const uint32_t a, const uint32_t b, const int32_t acc) {
+	int32_t r;
+	__asm__("smlad %0, %1, %2, %3" : "=r" (r) : "r" (a), "r" (b), "r" (acc));
+	return r;
+}
+
+static inline int32_t smlabb(const uint32_t a, const uint32_t b, const int32_t acc) {
+	int32_t r;
+	__asm__("smlabb %0, %1, %2, %3" : "=r" (r) : "r" (a), "r" (b), "r" (acc));
+	return r;
+}
+
+static inline int32_t smlatb(const uint32_t a, const uint32_t b, const int32_t acc) {
+	int32_t r;
+	__asm__("smlatb %0, %1, %2, %3" : "=r" (r) : "r" (a), "r" (b), "r" (acc));
+	return r;
+}
+
+static inline int32_t ssat8(const int32_t x) {
+	int32_t r;
+	__asm__("ssat %0, #8, %1" : "=r" (r) : "r" (x));
+	return r;
+}
+
+#else
+
+#define LANE_LO(x) ((int32_t)(int16_t)((x) & 0xffff))
+#define LANE_HI(x) ((int32_t)(int16_t)((x) >> 16))
+#define LANES(lo, hi) (((uint32_t)(lo) & 0xffff) | ((uint32_t)(hi) << 16))
+
+static inline uint32_t sxtb16(const uint32_t x) {
+	return LANES((int8_t)(x & 0xff), (int8_t)((x >> 16) & 0xff));
+}
+
+static inline uint32_t sxtb16_ror8(const uint32_t x) {
+	return sxtb16((x >> 8) | (x << 24));
+}
+
+static inline uint32_t pkhbt16(const uint32_t bottom, const uint32_t top) {
+	return (bottom & 0xffff) | (top << 16);
+}
+
+static inline uint32_t pkhtb16(const uint32_t top, const uint32_t bottom) {
+	return (top & 0xffff0000) | (bottom >> 16);
+}
+
+static inline uint32_t sadd16(const uint32_t a, const uint32_t b) {
+	return LANES(LANE_LO(a) + LANE_LO(b), LANE_HI(a) + LANE_HI(b));
+}
+
+static inline uint32_t ssub16(const uint32_t a, const uint32_t b) {
+	return LANES(LANE_LO(a) - LANE_LO(b), LANE_HI(a) - LANE_HI(b));
+}
+
+static inline uint32_t shadd16(const uint32_t a, const uint32_t b) {
+	return LANES((LANE_LO(a) + LANE_LO(b)) >> 1, (LANE_HI(a) + LANE_HI(b)) >> 1);
+}
+
+static inline int32_t smlad(const uint32_t a, const uint32_t b, const int32_t acc) {
+	return acc + (LANE_LO(a) * LANE_LO(b)) + (LANE_HI(a) * LANE_HI(b));
+}
+
+static inline int32_t smlabb(const uint32_t a, const uint32_t b, const int32_t acc) {
+	return acc + (LANE_LO(a) * LANE_LO(b));
+}
+
+static inline int32_t smlatb(const uint32_t a, const uint32_t b, const int32_t acc) {
+	return acc + (LANE_HI(a) * LANE_LO(b));
+}
+
+static inline int32_t ssat8(const int32_t x) {
+	return (x < -128) ? -128 : ((x > 127) ? 127 : x);
+}
+
+#endif
+
+/*
+ * Half-band, Kaiser window (beta 5), Q15. Only the center and odd offsets
+ * from it are non-zero: h[11] = 16384, h[11 +- 1] = 10237, h[11 +- 3] = -2936,
+ * h[11 +- 5] = 1285, h[11 +- 7] = -547, h[11 +- 9] = 188, h[11 +- 11] = -35.
+ * Symmetric pairs are summed with a halving add, so coefficients are doubled.
+ * Packed two per word for SMLAD.
+ */
+#define HB_PAIR(a, b) (((uint32_t)(a) & 0xffff) | ((uint32_t)(b) << 16))
+static const uint32_t hb_taps_13 = HB_PAIR(2 * 10237, 2 * -2936);
+static const uint32_t hb_taps_57 = HB_PAIR(2 * 1285, 2 * -547);
+static const uint32_t hb_taps_911 = HB_PAIR(2 * 188, 2 * -35);
+static const uint32_t hb_tap_center = 16384;
+
+bool decimate_init(decimate_t* const decimate, const uint32_t factor) {
+	uint32_t log2_ratio = 0;
+
+	if( (factor == 0) || (factor > DECIMATE_FACTOR_MAX) || (factor & (factor - 1)) ) {
+		return false;
+	}
+
+	memset(decimate, 0, sizeof(*decimate));
+	decimate->factor = factor;
+	decimate->cic_ratio = (factor > 1) ? (factor / 2) : 1;
+	while( (1U << log2_ratio) < decimate->cic_ratio ) {
+		log2_ratio++;
+	}
+
+	/* Half-band input is int8 << 8 without CIC, int8 * ratio^2 after it */
+	if( decimate->cic_ratio == 1 ) {
+		decimate->hb_shift = 15 + 8;
+	} else {
+		decimate->hb_shift = 15 + (2 * log2_ratio);
+	}
+
+	return true;
+}
+
+/* Unpack int8 IQ into hb_buffer until it holds DECIMATE_CHUNK samples */
+static uint32_t decimate_fill(
+	decimate_t* const decimate,
+	const uint32_t* src,
+	uint32_t words
+) {
+	uint32_t* dst = &decimate->hb_buffer[DECIMATE_HB_TAPS - 1 + decimate->hb_count];
+	uint32_t room = DECIMATE_CHUNK - decimate->hb_count;
+	const uint32_t* const start = src;
+
+	if( decimate->cic_ratio == 1 ) {
+		/* Bytes I0 Q0 I1 Q1 to lanes (I0 << 8, Q0 << 8), (I1 << 8, Q1 << 8) */
+		while( words && (room >= 2) ) {
+			const uint32_t w = *(src++);
+			const uint32_t i = (w << 8) & 0xff00ff00;
+			const uint32_t q = w & 0xff00ff00;
+			*(dst++) = pkhbt16(i, q);
+			*(dst++) = pkhtb16(q, i);
+			room -= 2;
+			words--;
+		}
+	} else {
+		uint32_t integrator0 = decimate->cic_integrator[0];
+		uint32_t integrator1 = decimate->cic_integrator[1];
+		uint32_t phase = decimate->cic_phase;
+		const uint32_t ratio = decimate->cic_ratio;
+
+		/* ratio is even, a word ends a CIC output period on its second sample */
+		while( words && room ) {
+			const uint32_t w = *(src++);
+			const uint32_t i = sxtb16(w);
+			const uint32_t q = sxtb16_ror8(w);
+			words--;
+
+			integrator0 = sadd16(integrator0, pkhbt16(i, q));
+			integrator1 = sadd16(integrator1, integrator0);
+			integrator0 = sadd16(integrator0, pkhtb16(q, i));
+			integrator1 = sadd16(integrator1, integrator0);
+
+			phase += 2;
+			if( phase == ratio ) {
+				const uint32_t comb0 = ssub16(integrator1, decimate->cic_comb[0]);
+				const uint32_t comb1 = ssub16(comb0, decimate->cic_comb[1]);
+				decimate->cic_comb[0] = integrator1;
+				decimate->cic_comb[1] = comb0;
+				*(dst++) = comb1;
+				room--;
+				phase = 0;
+			}
+		}
+
+		decimate->cic_integrator[0] = integrator0;
+		decimate->cic_integrator[1] = integrator1;
+		decimate->cic_phase = phase;
+	}
+
+	decimate->hb_count = DECIMATE_CHUNK - room;
+	return src - start;
+}
+
+/* Half-band over hb_buffer, keeps the history and an odd sample */
+static uint32_t decimate_half_band(decimate_t* const decimate, uint8_t* out) {
+	const uint32_t count = decimate->hb_count / 2;
+	const int32_t round = 1 << (decimate->hb_shift - 1);
+	const uint32_t shift = decimate->hb_shift;
+	uint32_t n;
+
+	for(n=0; n<count; n++) {
+		const uint32_t* const w = &decimate->hb_buffer[n * 2];
+		const uint32_t s1 = shadd16(w[10], w[12]);
+		const uint32_t s3 = shadd16(w[8], w[14]);
+		const uint32_t s5 = shadd16(w[6], w[16]);
+		const uint32_t s7 = shadd16(w[4], w[18]);
+		const uint32_t s9 = shadd16(w[2], w[20]);
+		const uint32_t s11 = shadd16(w[0], w[22]);
+		int32_t acc_i = round;
+		int32_t acc_q = round;
+
+		acc_i = smlad(pkhbt16(s1, s3), hb_taps_13, acc_i);
+		acc_q = smlad(pkhtb16(s3, s1), hb_taps_13, acc_q);
+		acc_i = smlad(pkhbt16(s5, s7), hb_taps_57, acc_i);
+		acc_q = smlad(pkhtb16(s7, s5), hb_taps_57, acc_q);
+		acc_i = smlad(pkhbt16(s9, s11), hb_taps_911, acc_i);
+		acc_q = smlad(pkhtb16(s11, s9), hb_taps_911, acc_q);
+		acc_i = smlabb(w[11], hb_tap_center, acc_i);
+		acc_q = smlatb(w[11], hb_tap_center, acc_q);
+
+		*(out++) = (uint8_t)ssat8(acc_i >> shift);
+		*(out++) = (uint8_t)ssat8(acc_q >> shift);
+	}
+
+	memmove(
+		&decimate->hb_buffer[0],
+		&decimate->hb_buffer[count * 2],
+		(DECIMATE_HB_TAPS - 1 + decimate->hb_count - (count * 2)) * sizeof(uint32_t)
+	);
+	decimate->hb_count -= count * 2;
+
+	return count;
+}
+
+uint32_t decimate_iq8(
+	decimate_t* const decimate,
+	const uint8_t* const in,
+	const uint32_t count,
+	uint8_t* const out
+) {
+	const uint32_t* src = (const uint32_t*)in;
+	uint32_t words = count / 2;
+	uint32_t produced = 0;
+
+	if( decimate->factor == 1 ) {
+		memmove(out, in, count * 2);
+		return count;
+	}
+
+	/* out trails src, in place is fine */
+	while( words ) {
+		const uint32_t used = decimate_fill(decimate, src, words);
+		src += used;
+		words -= used;
+		produced += decimate_half_band(decimate, &out[produced * 2]);
+	}
+
+	return produced;
+}
+
+#ifdef TEST
+#include <stdio.h>
+#include <math.h>
+
+/* Output/input power of a full scale complex tone, in dB */
+static double tone_gain_db(const uint32_t factor, const double frequency) {
+	static decimate_t decimate;
+	static uint8_t in[65536];
+	static uint8_t out[65536];
+	const uint32_t count = sizeof(in) / 2;
+	double power_in = 0;
+	double power_out = 0;
+	uint32_t produced;
+	uint32_t n;
+
+	decimate_init(&decimate, factor);
+	for(n=0; n<count; n++) {
+		const int8_t i = (int8_t)lrint(100.0 * cos(2 * M_PI * frequency * n));
+		const int8_t q = (int8_t)lrint(100.0 * sin(2 * M_PI * frequency * n));
+		in[n * 2] = (uint8_t)i;
+		in[n * 2 + 1] = (uint8_t)q;
+		power_in += (double)(i * i + q * q);
+	}
+	power_in /= count;
+
+	produced = decimate_iq8(&decimate, in, count, out);
+	/* Skip the filter settling */
+	for(n=64; n<produced; n++) {
+		const int8_t i = (int8_t)out[n * 2];
+		const int8_t q = (int8_t)out[n * 2 + 1];
+		power_out += (double)(i * i + q * q);
+	}
+	power_out /= (produced - 64);
+
+	return 10 * log10((power_out + 1e-3) / power_in);
+}
+
+int main(int ac, char **av)
+{
+	/* 1.63 and 2.37 alias to the passband edge after the CIC */
+	static const double fraction[] = { 0.0, 0.1, 0.25, 0.37, 0.5, 0.65, 0.8, 1.0, 1.37, 1.5, 1.63, 2.37 };
+	uint32_t factor;
+	uint32_t i;
+
+	(void)ac;
+	(void)av;
+
+	/* Tone frequencies as a fraction of the output rate */
+	printf("factor");
+	for(i=0; i<sizeof(fraction)/sizeof(fraction[0]); i++) {
+		printf(" %7.2f", fraction[i]);
+	}
+	printf("\n");
+	for(factor=2; factor<=DECIMATE_FACTOR_MAX; factor*=2) {
+		printf("%6u", factor);
+		for(i=0; i<sizeof(fraction)/sizeof(fraction[0]); i++) {
+			/* Past the input Nyquist rate */
+			if( fraction[i] > factor / 2 ) {
+				printf(" %7s", "-");
+				continue;
+			}
+			printf(" %7.1f", tone_gain_db(factor, fraction[i] / factor));
+		}
+		printf("\n");
+	}
+	return 0;
+}
+#endif //TEST
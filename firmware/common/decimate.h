@@ -0,0 +1,67 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DECIMATE_H__
+#define __DECIMATE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Complex int8 IQ decimation by a power of two: second order CIC by
+ * factor/2 followed by a 23 tap half-band FIR by 2. Factor 2 is the
+ * half-band alone. Output is flat (0.1dB) to 0.37 of the output rate, the
+ * CIC adds up to 1dB of droop there. The half-band takes 0.65 to 1 times
+ * the output rate 60dB down. Tones within 0.37 of twice the output rate
+ * (and its multiples) alias into the passband past the CIC alone, which
+ * has them only 22dB (factor 4) to 27dB (factor 32) down. Set the baseband
+ * filter below 1.63 times the output rate where that matters.
+ */
+#define DECIMATE_FACTOR_MAX (32)
+#define DECIMATE_HB_TAPS (23)
+/* Samples after the CIC handled per half-band pass, bounds the state size */
+#define DECIMATE_CHUNK (256)
+
+typedef struct {
+	uint32_t factor;
+	uint32_t cic_ratio; /* factor / 2, 1 = no CIC */
+	uint32_t cic_phase;
+	/* Samples are packed I (bits 15..0) and Q (bits 31..16) in int16 lanes */
+	uint32_t cic_integrator[2];
+	uint32_t cic_comb[2];
+	uint32_t hb_shift; /* Accumulator to int8, depends on the CIC gain */
+	uint32_t hb_count; /* Samples in hb_buffer after the history */
+	uint32_t hb_buffer[DECIMATE_HB_TAPS - 1 + DECIMATE_CHUNK];
+} decimate_t;
+
+/* False if factor is not a power of two from 1 to DECIMATE_FACTOR_MAX */
+bool decimate_init(decimate_t* const decimate, const uint32_t factor);
+/* in and out are interleaved int8 IQ, in 4 byte aligned, count complex
+ * samples a multiple of 2. Returns complex samples written to out, which
+ * must have room for count / factor + 1. out may be in. */
+uint32_t decimate_iq8(
+	decimate_t* const decimate,
+	const uint8_t* const in,
+	const uint32_t count,
+	uint8_t* const out
+);
+
+#endif//__DECIMATE_H__
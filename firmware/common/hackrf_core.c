@@ -86,44 +86,34 @@ bool sample_rate_set(const uint32_t sample_rate_hz) {
 #endif
 	
 #ifdef JAWBREAKER
-	uint32_t p1 = 4608;
-	
-	switch(sample_rate_hz) {
-	case 5000000:
-		p1 = 9728;	// 800MHz / 80 = 10 MHz (SGPIO), 5 MHz (codec)
-		break;
-	
-	case 10000000:
-		p1 = 4608;	// 800MHz / 40 = 20 MHz (SGPIO), 10 MHz (codec)
-		break;
+	si5351c_ms_divider_t divider;
+	uint32_t p1, p2, p3;
 
-	case 12500000:
-		p1 = 3584;	// 800MHz / 32 = 25 MHz (SGPIO), 12.5 MHz (codec)
-		break;
+	if( (sample_rate_hz < SAMPLE_RATE_MIN_HZ) || (sample_rate_hz > SAMPLE_RATE_MAX_HZ) ) {
+		return false;
+	}
 
-	case 16000000:
-		p1 = 2688;	// 800MHz / 25 = 32 MHz (SGPIO), 16 MHz (codec)
-		break;
-	
-	case 20000000:
-		p1 = 2048;	// 800MHz / 20 = 40 MHz (SGPIO), 20 MHz (codec)
-		break;
-	
-	default:
+	/* MS0 runs at twice the sample rate: 800MHz / 40 = 20 MHz (SGPIO),
+	 * 10 MHz (codec). Fractional dividers are the closest a + b / c. */
+	if( !si5351c_ms_divider_compute(SI5351C_PLLA_HZ, sample_rate_hz * 2, &divider) ) {
 		return false;
 	}
-	
+	si5351c_ms_divider_params(&divider, &p1, &p2, &p3);
+
 	/* MS0/CLK0 is the source for the MAX5864/CPLD (CODEC_CLK). */
-	si5351c_configure_multisynth(0, p1, 0, 1, 1);
+	si5351c_configure_multisynth(0, p1, p2, p3, 1);
 
 	/* MS0/CLK1 is the source for the CPLD (CODEC_X2_CLK). */
-	si5351c_configure_multisynth(1, p1, 0, 1, 0);
+	si5351c_configure_multisynth(1, p1, p2, p3, 0);
 
 	/* MS0/CLK2 is the source for SGPIO (CODEC_X2_CLK) */
-	si5351c_configure_multisynth(2, p1, 0, 1, 0);
+	si5351c_configure_multisynth(2, p1, p2, p3, 0);
 
 	/* MS0/CLK3 is the source for the external clock output. */
-	si5351c_configure_multisynth(3, p1, 0, 1, 0);
+	si5351c_configure_multisynth(3, p1, p2, p3, 0);
+
+	/* CLK1-3 take MS0 too, only MS0 mode matters */
+	si5351c_set_int_mode(0, (divider.b == 0) && ((divider.a & 1) == 0));
 
 	return true;
 #endif
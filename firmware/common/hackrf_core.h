@@ -259,6 +259,10 @@ void pin_setup(void);
 
 void enable_1v8_power(void);
 
+/* Jawbreaker takes any rate in this range, Jellybean only 5, 10 and 20MHz */
+#define SAMPLE_RATE_MIN_HZ (2000000)
+#define SAMPLE_RATE_MAX_HZ (20000000)
+
 bool sample_rate_set(const uint32_t sampling_rate_hz);
 bool baseband_filter_bandwidth_set(const uint32_t bandwidth_hz);
 
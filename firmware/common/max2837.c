@@ -264,68 +264,75 @@ void max2837_stop(void)
 #endif
 }
 
-void max2837_set_frequency(uint32_t freq)
+void max2837_synth_compute(uint32_t freq, max2837_synth_t* const synth)
 {
-	uint8_t band;
-	uint8_t lna_band;
-	uint32_t div_frac;
-	uint32_t div_int;
 	uint32_t div_rem;
 	uint32_t div_cmp;
 	int i;
 
 	/* Select band. Allow tuning outside specified bands. */
 	if (freq < 2400000000U) {
-		band = MAX2837_LOGEN_BSW_2_3;
-		lna_band = MAX2837_LNAband_2_4;
+		synth->band = MAX2837_LOGEN_BSW_2_3;
+		synth->lna_band = MAX2837_LNAband_2_4;
 	}
 	else if (freq < 2500000000U) {
-		band = MAX2837_LOGEN_BSW_2_4;
-		lna_band = MAX2837_LNAband_2_4;
+		synth->band = MAX2837_LOGEN_BSW_2_4;
+		synth->lna_band = MAX2837_LNAband_2_4;
 	}
 	else if (freq < 2600000000U) {
-		band = MAX2837_LOGEN_BSW_2_5;
-		lna_band = MAX2837_LNAband_2_6;
+		synth->band = MAX2837_LOGEN_BSW_2_5;
+		synth->lna_band = MAX2837_LNAband_2_6;
 	}
 	else {
-		band = MAX2837_LOGEN_BSW_2_6;
-		lna_band = MAX2837_LNAband_2_6;
+		synth->band = MAX2837_LOGEN_BSW_2_6;
+		synth->lna_band = MAX2837_LNAband_2_6;
 	}
 
 	LOG("# max2837_set_frequency %ld, band %d, lna band %d\n",
-	    freq, band, lna_band);
+	    freq, synth->band, synth->lna_band);
 
 	/* ASSUME 40MHz PLL. Ratio = F*(4/3)/40,000,000 = F/30,000,000 */
-	div_int = freq / 30000000;
+	synth->div_int = freq / 30000000;
 	div_rem = freq % 30000000;
-	div_frac = 0;
+	synth->div_frac = 0;
 	div_cmp = 30000000;
 	for( i = 0; i < 20; i++) {
-		div_frac <<= 1;
+		synth->div_frac <<= 1;
 		div_cmp >>= 1;
 		if (div_rem > div_cmp) {
-			div_frac |= 0x1;
+			synth->div_frac |= 0x1;
 			div_rem -= div_cmp;
 		}
 	}
-	LOG("# int %ld, frac %ld\n", div_int, div_frac);
+	LOG("# int %ld, frac %ld\n", synth->div_int, synth->div_frac);
+}
 
+void max2837_synth_apply(const max2837_synth_t* const synth)
+{
 	/* Band settings */
-	set_MAX2837_LOGEN_BSW(band);
-	set_MAX2837_LNAband(lna_band);
+	set_MAX2837_LOGEN_BSW(synth->band);
+	set_MAX2837_LNAband(synth->lna_band);
 
 	/* Write order matters here, so commit INT and FRAC_HI before
 	 * committing FRAC_LO, which is the trigger for VCO
 	 * auto-select. TODO - it's cleaner this way, but it would be
 	 * faster to explicitly commit the registers explicitly so the
 	 * dirty bits aren't scanned twice. */
-	set_MAX2837_SYN_INT(div_int);
-	set_MAX2837_SYN_FRAC_HI((div_frac >> 10) & 0x3ff);
+	set_MAX2837_SYN_INT(synth->div_int);
+	set_MAX2837_SYN_FRAC_HI((synth->div_frac >> 10) & 0x3ff);
 	max2837_regs_commit();
-	set_MAX2837_SYN_FRAC_LO(div_frac & 0x3ff);
+	set_MAX2837_SYN_FRAC_LO(synth->div_frac & 0x3ff);
 	max2837_regs_commit();
 }
 
+void max2837_set_frequency(uint32_t freq)
+{
+	max2837_synth_t synth;
+
+	max2837_synth_compute(freq, &synth);
+	max2837_synth_apply(&synth);
+}
+
 typedef struct {
 	uint32_t bandwidth_hz;
 	uint32_t ft;
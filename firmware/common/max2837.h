@@ -44,6 +44,18 @@ extern void max2837_stop(void);
 /* Set frequency in Hz. Frequency setting is a multi-step function
  * where order of register writes matters. */
 extern void max2837_set_frequency(uint32_t freq);
+
+/* Synthesizer settings for a frequency, computed ahead of time so a
+ * retune is only the register writes. */
+typedef struct {
+	uint8_t band;
+	uint8_t lna_band;
+	uint16_t div_int;
+	uint32_t div_frac;
+} max2837_synth_t;
+
+extern void max2837_synth_compute(uint32_t freq, max2837_synth_t* const synth);
+extern void max2837_synth_apply(const max2837_synth_t* const synth);
 bool max2837_set_lpf_bandwidth(const uint32_t bandwidth_hz);
 
 extern void max2837_tx(void);
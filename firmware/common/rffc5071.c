@@ -446,80 +446,94 @@ void rffc5071_enable(void)  {
 
 #define LO_MAX 5400
 #define REF_FREQ 50
-
-/* configure frequency synthesizer in integer mode (lo in MHz) */
-uint16_t rffc5071_config_synth_int(uint16_t lo) {
+#define REF_FREQ_HZ (REF_FREQ * 1000000ULL)
+/* N = n + frac / 2^24, frac split over NMSB (16 bits) and NLSB (8 bits) */
+#define FRAC_BITS 24
+
+/* Fractional-N divider for lo_hz, actual LO in tune_freq_hz (at most half a
+ * fractional step away, up to about 6Hz) */
+void rffc5071_synth_compute(const uint64_t lo_hz, rffc5071_synth_t* const synth) {
+	uint16_t lo_mhz = lo_hz / 1000000;
+	uint16_t x;
 	uint8_t lodiv;
-	uint16_t fvco;
-	uint8_t fbkdiv;
-	uint16_t n;
-	uint16_t tune_freq;
-
-	LOG("# config_synth_int\n");
+	uint64_t fvco_hz;
+	uint64_t ref_hz;
+	uint64_t n_fixed;
+	uint64_t lo_den;
 
 	/* Calculate n_lo */
-	uint8_t n_lo = 0;
-	uint16_t x = LO_MAX / lo;
+	synth->n_lo = 0;
+	if (lo_mhz == 0)
+		lo_mhz = 1;
+	x = LO_MAX / lo_mhz;
 	while (x > 1) {
-		n_lo++;
+		synth->n_lo++;
 		x >>= 1;
 	}
 
-	lodiv = 1 << n_lo;
-	fvco = lodiv * lo;
+	lodiv = 1 << synth->n_lo;
+	fvco_hz = lodiv * lo_hz;
+
+	/* higher divider required above 3.2GHz */
+	synth->fbkdiv = (fvco_hz > 3200000000ULL) ? 4 : 2;
+
+	/* N in 24 bit fixed point, rounded to nearest */
+	ref_hz = synth->fbkdiv * REF_FREQ_HZ;
+	n_fixed = ((fvco_hz << FRAC_BITS) + (ref_hz / 2)) / ref_hz;
+	synth->n = n_fixed >> FRAC_BITS;
+	synth->frac = n_fixed & ((1UL << FRAC_BITS) - 1);
+
+	lo_den = (uint64_t)lodiv << FRAC_BITS;
+	synth->tune_freq_hz = ((n_fixed * ref_hz) + (lo_den / 2)) / lo_den;
+}
+
+/* configure frequency synthesizer in fractional-N mode */
+void rffc5071_synth_apply(const rffc5071_synth_t* const synth) {
+	LOG("# synth_apply\n");
 
 	/* higher divider and charge pump current required above
 	 * 3.2GHz. Programming guide says these values (fbkdiv, n,
 	 * maybe pump?) can be changed back after enable in order to
 	 * improve phase noise, since the VCO will already be stable
 	 * and will be unaffected. */
-	if (fvco > 3200) {
-		fbkdiv = 4;
+	if (synth->fbkdiv == 4) {
 		set_RFFC5071_PLLCPL(3);
 	} else {
-		fbkdiv = 2;
 		set_RFFC5071_PLLCPL(2);
 	}
 
-	n = (fvco / fbkdiv) / REF_FREQ;
-	tune_freq = 50*n*fbkdiv/lodiv;
-	LOG("# lo=%d n_lo=%d lodiv=%d fvco=%d fbkdiv=%d n=%d tune_freq=%d\n",
-	    lo, n_lo, lodiv, fvco, fbkdiv, n, tune_freq);
+	LOG("# n_lo=%d fbkdiv=%d n=%d frac=%lu tune_freq=%llu\n",
+	    synth->n_lo, synth->fbkdiv, synth->n,
+	    (unsigned long)synth->frac, (unsigned long long)synth->tune_freq_hz);
 
 	/* Path 1 */
-	set_RFFC5071_P1LODIV(n_lo);
-	set_RFFC5071_P1N(n);
-	set_RFFC5071_P1PRESC(fbkdiv >> 1);
-	set_RFFC5071_P1NMSB(0);
-	set_RFFC5071_P1NLSB(0);
+	set_RFFC5071_P1LODIV(synth->n_lo);
+	set_RFFC5071_P1N(synth->n);
+	set_RFFC5071_P1PRESC(synth->fbkdiv >> 1);
+	set_RFFC5071_P1NMSB(synth->frac >> 8);
+	set_RFFC5071_P1NLSB(synth->frac & 0xff);
 
 	/* Path 2 */
-	set_RFFC5071_P2LODIV(n_lo);
-	set_RFFC5071_P2N(n);
-	set_RFFC5071_P2PRESC(fbkdiv >> 1);
-	set_RFFC5071_P2NMSB(0);
-	set_RFFC5071_P2NLSB(0);
+	set_RFFC5071_P2LODIV(synth->n_lo);
+	set_RFFC5071_P2N(synth->n);
+	set_RFFC5071_P2PRESC(synth->fbkdiv >> 1);
+	set_RFFC5071_P2NMSB(synth->frac >> 8);
+	set_RFFC5071_P2NLSB(synth->frac & 0xff);
 
 	rffc5071_regs_commit();
-
-	return tune_freq;
 }
 
-/* !!!!!!!!!!! hz is currently ignored !!!!!!!!!!!
- *
- * Tuning is rounded down to the nearest 25MHz or 50MHz depending on
- * frequency requsted. Actual tuned value in MHz is returned. */
-uint16_t rffc5071_set_frequency(uint16_t mhz, uint32_t hz) {
-	uint16_t tune_freq;
-
-	// Fractional tuning unimplemented, 'hz' ignored
-	hz=hz;
+/* Tune to mhz MHz + hz Hz. The fractional-N step is 6Hz / LO divider or
+ * less, actual tuned value in Hz is returned. */
+uint64_t rffc5071_set_frequency(uint16_t mhz, uint32_t hz) {
+	rffc5071_synth_t synth;
 
+	rffc5071_synth_compute(((uint64_t)mhz * 1000000) + hz, &synth);
 	rffc5071_disable();
-	tune_freq = rffc5071_config_synth_int(mhz);
+	rffc5071_synth_apply(&synth);
 	rffc5071_enable();
 
-	return tune_freq;
+	return synth.tune_freq_hz;
 }
 
 void rffc5071_set_gpo(uint8_t gpo)
@@ -532,8 +546,62 @@ void rffc5071_set_gpo(uint8_t gpo)
 }
 
 #ifdef TEST
+typedef struct {
+	uint64_t lo_hz;
+	uint8_t n_lo;
+	uint8_t fbkdiv;
+	uint16_t n;
+	uint32_t frac;
+} rffc5071_synth_test_t;
+
+/* LO frequencies set_freq() asks for, expected dividers */
+static const rffc5071_synth_test_t rffc5071_synth_tests[] = {
+	{  500000000ULL, 3, 4, 20,        0 }, /* fvco 4000MHz, was integer */
+	{ 1525000000ULL, 1, 2, 30,  8388608 }, /* 3050MHz / 100MHz = 30.5 */
+	{ 1700000000ULL, 1, 4, 17,        0 }, /* 3400MHz / 200MHz */
+	{ 1699000000ULL, 1, 4, 16, 16609444 }, /* 16.99 */
+	{ 2500000001ULL, 1, 4, 25,        0 }, /* Below half a 6Hz step */
+	{ 2600000000ULL - 915000000ULL, 1, 4, 16, 14260634 }, /* 915MHz RF */
+	{   85000000ULL, 5, 2, 27,  3355443 }, /* 2720MHz / 100MHz = 27.2 */
+	{ 3500000005ULL, 0, 4, 17,  8388608 }, /* lodiv=1, 11.9Hz step, -5Hz */
+	{ 3500000006ULL, 0, 4, 17,  8388609 }, /* lodiv=1, +6Hz, worst case */
+};
+
+/* Documented bound: half of 200MHz / 2^24, rounded */
+#define TUNE_ERROR_MAX_HZ 6
+
 int main(int ac, char **av)
 {
+	rffc5071_synth_t synth;
+	unsigned int failures = 0;
+	size_t i;
+
+	(void)ac;
+	(void)av;
+
+	for(i=0; i<sizeof(rffc5071_synth_tests)/sizeof(rffc5071_synth_tests[0]); i++) {
+		const rffc5071_synth_test_t* const t = &rffc5071_synth_tests[i];
+		/* Half a step, plus rounding of tune_freq_hz */
+		const uint64_t step_hz = ((t->fbkdiv * REF_FREQ_HZ) >> (t->n_lo + FRAC_BITS + 1)) + 1;
+		int64_t error;
+		int ok;
+
+		rffc5071_synth_compute(t->lo_hz, &synth);
+		error = (int64_t)synth.tune_freq_hz - (int64_t)t->lo_hz;
+		ok = (synth.n_lo == t->n_lo) && (synth.fbkdiv == t->fbkdiv) &&
+		     (synth.n == t->n) && (synth.frac == t->frac) &&
+		     (error <= (int64_t)step_hz) && (error >= -(int64_t)step_hz) &&
+		     (error <= TUNE_ERROR_MAX_HZ) && (error >= -TUNE_ERROR_MAX_HZ);
+		printf("%11llu: n_lo=%d fbkdiv=%d n=%d frac=%lu tune=%llu error=%lld %s\n",
+			(unsigned long long)t->lo_hz, synth.n_lo, synth.fbkdiv, synth.n,
+			(unsigned long)synth.frac, (unsigned long long)synth.tune_freq_hz,
+			(long long)error, ok ? "ok" : "FAIL");
+		if( !ok ) {
+			failures++;
+		}
+	}
+	printf("%u failures\n", failures);
+
 	rffc5071_setup();
 	rffc5071_tx(0);
 	rffc5071_set_frequency(500, 0);
@@ -542,10 +610,13 @@ int main(int ac, char **av)
 	rffc5071_set_frequency(1500, 0);
 	rffc5071_set_frequency(1525, 0);
 	rffc5071_set_frequency(1550, 0);
+	rffc5071_set_frequency(1699, 999999);
 	rffc5071_disable();
 	rffc5071_rx(0);
 	rffc5071_disable();
 	rffc5071_rxtx();
 	rffc5071_disable();
+
+	return (failures == 0) ? 0 : 1;
 }
 #endif //TEST
@@ -67,11 +67,24 @@ extern void rffc5071_reg_write(uint8_t r, uint16_t v);
  * provided routines for those operations. */
 extern void rffc5071_regs_commit(void);
 
-/* Set frequency (MHz). The 'hz' field is currently ignored. Actual
- * tune frequency (MHz) is returned. Expect requested freq to be
- * rounded down to the nearest multiple of 25MHz or 50MHz, depending
- * internal calculations. */
-extern uint16_t rffc5071_set_frequency(uint16_t mhz, uint32_t hz);
+/* Fractional-N divider settings for one LO frequency */
+typedef struct {
+	uint8_t n_lo; /* LO divider 2^n_lo */
+	uint8_t fbkdiv;
+	uint16_t n;
+	uint32_t frac; /* N = n + frac / 2^24 */
+	uint64_t tune_freq_hz; /* Actual LO */
+} rffc5071_synth_t;
+
+/* Compute settings for lo_hz without touching the chip, apply them later
+ * with the chip disabled (fast retune, see rffc5071_set_frequency). */
+extern void rffc5071_synth_compute(const uint64_t lo_hz, rffc5071_synth_t* const synth);
+extern void rffc5071_synth_apply(const rffc5071_synth_t* const synth);
+
+/* Set frequency (mhz MHz + hz Hz) with the fractional-N synthesizer.
+ * Actual tune frequency (Hz) is returned, at most half a fractional step
+ * from the request: up to about 6Hz (200MHz / 2^24 / 2 with fbkdiv=4, lodiv=1). */
+extern uint64_t rffc5071_set_frequency(uint16_t mhz, uint32_t hz);
 
 /* Set up rx only, tx only, or full duplex. Chip should be disabled
  * before _tx, _rx, or _rxtx are called. */
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <libopencm3/lpc43xx/creg.h>
+#include <libopencm3/lpc43xx/gpdma.h>
+#include <libopencm3/lpc43xx/sgpio.h>
+
+#include <sgpio_dma.h>
+
+/*
+ * Single slice mode: slice A exchanges one 32-bit word (2 IQ samples) every
+ * 4 sample clocks. There is no SGPIO DMA request as such, so slice H shifts
+ * a 1-bit pattern out on SGPIO14 (1-bit mode output of slice H) with a
+ * pulse every 4 clocks, and SGPIO14 is routed to GPDMA request line 0.
+ * The pulse comes one clock after slice A exchange: RX reads the word just
+ * captured, TX writes the shadow register 3 clocks before it is needed.
+ */
+#define SGPIO_DMA_REQUEST_PIN (14)
+#define SGPIO_DMA_REQUEST_PATTERN (0x11111111)
+
+static void sgpio_dma_request_enable() {
+	const uint32_t slice_enable_mask = SGPIO_CTRL_ENABLE;
+
+	// Stop slice A so both start on the same clock
+	SGPIO_CTRL_ENABLE = 0;
+
+	SGPIO_MUX_CFG(SGPIO_SLICE_H) =
+		  SGPIO_MUX_CFG_CONCAT_ORDER(0) /* 0x0=Self-loop */
+		| SGPIO_MUX_CFG_CONCAT_ENABLE(1) /* 0x1=Concatenate data */
+		| SGPIO_MUX_CFG_QUALIFIER_SLICE_MODE(0)
+		| SGPIO_MUX_CFG_QUALIFIER_PIN_MODE(1) /* Same qualifier as slice A, SGPIO9 */
+		| SGPIO_MUX_CFG_QUALIFIER_MODE(3)
+		| SGPIO_MUX_CFG_CLK_SOURCE_SLICE_MODE(0)
+		| SGPIO_MUX_CFG_CLK_SOURCE_PIN_MODE(0) /* Same clock as slice A, SGPIO8 */
+		| SGPIO_MUX_CFG_EXT_CLK_ENABLE(1)
+		;
+
+	SGPIO_SLICE_MUX_CFG(SGPIO_SLICE_H) =
+		  SGPIO_SLICE_MUX_CFG_INV_QUALIFIER(0)
+		| SGPIO_SLICE_MUX_CFG_PARALLEL_MODE(0) /* 0x0=Shift 1 bit per clock. */
+		| SGPIO_SLICE_MUX_CFG_DATA_CAPTURE_MODE(0)
+		| SGPIO_SLICE_MUX_CFG_INV_OUT_CLK(0)
+		| SGPIO_SLICE_MUX_CFG_CLKGEN_MODE(1)
+		| SGPIO_SLICE_MUX_CFG_CLK_CAPTURE_MODE(0)
+		| SGPIO_SLICE_MUX_CFG_MATCH_MODE(0)
+		;
+
+	SGPIO_PRESET(SGPIO_SLICE_H) = 0;
+	SGPIO_COUNT(SGPIO_SLICE_H) = 0;
+	SGPIO_POS(SGPIO_SLICE_H) =
+		  SGPIO_POS_POS_RESET(0x1f)
+		| SGPIO_POS_POS(0x1f)
+		;
+	SGPIO_REG(SGPIO_SLICE_H) = SGPIO_DMA_REQUEST_PATTERN;
+	SGPIO_REG_SS(SGPIO_SLICE_H) = SGPIO_DMA_REQUEST_PATTERN;
+
+	SGPIO_POS(SGPIO_SLICE_A) =
+		  SGPIO_POS_POS_RESET(0x03)
+		| SGPIO_POS_POS(0x03)
+		;
+
+	SGPIO_OUT_MUX_CFG(SGPIO_DMA_REQUEST_PIN) =
+		  SGPIO_OUT_MUX_CFG_P_OE_CFG(0) /* 0x0 gpio_oe (state set by GPIO_OEREG) */
+		| SGPIO_OUT_MUX_CFG_P_OUT_CFG(0) /* 0x0 dout_doutm1 (1-bit mode) */
+		;
+	SGPIO_GPIO_OENREG |= (1L << SGPIO_DMA_REQUEST_PIN);
+
+	SGPIO_CTRL_ENABLE = slice_enable_mask | (1 << SGPIO_SLICE_H);
+}
+
+static void sgpio_dma_request_disable() {
+	SGPIO_CTRL_ENABLE &= ~(1 << SGPIO_SLICE_H);
+	SGPIO_GPIO_OENREG &= ~(1L << SGPIO_DMA_REQUEST_PIN);
+}
+
+void sgpio_dma_init() {
+	/* DMA peripheral 0, option 0x2 = SGPIO14 */
+	CREG_DMAMUX = (CREG_DMAMUX & ~CREG_DMAMUX_DMAMUXPER0_MASK)
+		| CREG_DMAMUX_DMAMUXPER0(0x2);
+
+	/* Controller on, both AHB masters little endian */
+	GPDMA_CONFIG = GPDMA_CONFIG_E(1)
+		| GPDMA_CONFIG_M0(0)
+		| GPDMA_CONFIG_M1(0)
+		;
+	while( (GPDMA_CONFIG & GPDMA_CONFIG_E_MASK) == 0 );
+}
+
+void sgpio_dma_configure_lli(
+	sgpio_dma_lli_t* const lli,
+	const size_t lli_count,
+	const transceiver_mode_t transceiver_mode,
+	uint8_t* const buffer,
+	const size_t block_size,
+	const size_t skip,
+	const bool irq_per_block
+) {
+	const bool transmit = (transceiver_mode == TRANSCEIVER_MODE_TX);
+	const size_t lli_per_block = block_size / SGPIO_DMA_LLI_BYTES;
+	const uint32_t peripheral_address = (uint32_t)&SGPIO_REG_SS(SGPIO_SLICE_A);
+	/* Peripheral on AHB master 0, memory and LLIs on master 1 */
+	const uint_fast8_t memory_master = 1;
+
+	for(size_t i=0; i<lli_count; i++) {
+		const bool block_first = (i % lli_per_block) == 0;
+		const bool block_last = (i % lli_per_block) == (lli_per_block - 1);
+		const size_t offset = (i * SGPIO_DMA_LLI_BYTES) + (block_first ? skip : 0);
+		const size_t bytes = SGPIO_DMA_LLI_BYTES - (block_first ? skip : 0);
+		const uint32_t memory_address = (uint32_t)&buffer[offset];
+		const sgpio_dma_lli_t* const next = &lli[(i + 1) % lli_count];
+
+		lli[i].csrcaddr = transmit ? memory_address : peripheral_address;
+		lli[i].cdestaddr = transmit ? peripheral_address : memory_address;
+		lli[i].clli = ((uint32_t)next & ~0x3) | memory_master;
+		lli[i].ccontrol =
+			  GPDMA_CCONTROL_TRANSFERSIZE(bytes / 4)
+			| GPDMA_CCONTROL_SBSIZE(0) /* 1 transfer per request */
+			| GPDMA_CCONTROL_DBSIZE(0)
+			| GPDMA_CCONTROL_SWIDTH(2) /* 32 bits */
+			| GPDMA_CCONTROL_DWIDTH(2)
+			| GPDMA_CCONTROL_S(transmit ? memory_master : 0)
+			| GPDMA_CCONTROL_D(transmit ? 0 : memory_master)
+			| GPDMA_CCONTROL_SI(transmit ? 1 : 0)
+			| GPDMA_CCONTROL_DI(transmit ? 0 : 1)
+			| GPDMA_CCONTROL_PROT1(0)
+			| GPDMA_CCONTROL_PROT2(0)
+			| GPDMA_CCONTROL_PROT3(0)
+			| GPDMA_CCONTROL_I((irq_per_block && block_last) ? 1 : 0)
+			;
+	}
+}
+
+void sgpio_dma_start(
+	const sgpio_dma_lli_t* const lli,
+	const transceiver_mode_t transceiver_mode
+) {
+	const bool transmit = (transceiver_mode == TRANSCEIVER_MODE_TX);
+
+	sgpio_dma_stop();
+
+	GPDMA_CSRCADDR(SGPIO_DMA_CHANNEL) = lli->csrcaddr;
+	GPDMA_CDESTADDR(SGPIO_DMA_CHANNEL) = lli->cdestaddr;
+	GPDMA_CLLI(SGPIO_DMA_CHANNEL) = lli->clli;
+	GPDMA_CCONTROL(SGPIO_DMA_CHANNEL) = lli->ccontrol;
+
+	GPDMA_CCONFIG(SGPIO_DMA_CHANNEL) =
+		  GPDMA_CCONFIG_SRCPERIPHERAL(0)
+		| GPDMA_CCONFIG_DESTPERIPHERAL(0)
+		| GPDMA_CCONFIG_FLOWCNTRL(transmit ? 1 : 2) /* 1=Memory to peripheral, 2=Peripheral to memory */
+		| GPDMA_CCONFIG_IE(1)
+		| GPDMA_CCONFIG_ITC(1)
+		| GPDMA_CCONFIG_L(0)
+		| GPDMA_CCONFIG_H(0)
+		| GPDMA_CCONFIG_E(1)
+		;
+
+	sgpio_dma_request_enable();
+}
+
+void sgpio_dma_stop() {
+	sgpio_dma_request_disable();
+
+	GPDMA_CCONFIG(SGPIO_DMA_CHANNEL) &= ~GPDMA_CCONFIG_E_MASK;
+	while( GPDMA_ENBLDCHNS & (1 << SGPIO_DMA_CHANNEL) );
+
+	GPDMA_INTTCCLEAR = (1 << SGPIO_DMA_CHANNEL);
+	GPDMA_INTERRCLR = (1 << SGPIO_DMA_CHANNEL);
+}
+
+void sgpio_dma_irq_tc_acknowledge() {
+	GPDMA_INTTCCLEAR = (1 << SGPIO_DMA_CHANNEL);
+}
+
+uint32_t sgpio_dma_current_address(const transceiver_mode_t transceiver_mode) {
+	if( transceiver_mode == TRANSCEIVER_MODE_TX ) {
+		return GPDMA_CSRCADDR(SGPIO_DMA_CHANNEL);
+	} else {
+		return GPDMA_CDESTADDR(SGPIO_DMA_CHANNEL);
+	}
+}
+
+void sgpio_dma_swap_iq(uint8_t* const buffer, const size_t length) {
+	uint32_t* p = (uint32_t*)buffer;
+	uint32_t* const end = (uint32_t*)&buffer[length];
+
+	while( p < end ) {
+		__asm__(
+			"ldr r0, [%[p], #0]\n\t"
+			"rev16 r0, r0\n\t" /* Swap QI -> IQ */
+			"str r0, [%[p], #0]\n\t"
+			"ldr r0, [%[p], #4]\n\t"
+			"rev16 r0, r0\n\t"
+			"str r0, [%[p], #4]\n\t"
+			"ldr r0, [%[p], #8]\n\t"
+			"rev16 r0, r0\n\t"
+			"str r0, [%[p], #8]\n\t"
+			"ldr r0, [%[p], #12]\n\t"
+			"rev16 r0, r0\n\t"
+			"str r0, [%[p], #12]\n\t"
+			:
+			: [p] "l" (p)
+			: "r0", "memory"
+		);
+		p += 4;
+	}
+}
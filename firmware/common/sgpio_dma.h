@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SGPIO_DMA_H__
+#define __SGPIO_DMA_H__
+
+#include <stddef.h>
+
+#include <hackrf_core.h>
+
+/* GPDMA channel moving samples between SGPIO slice A and memory */
+#define SGPIO_DMA_CHANNEL (0)
+
+/* Bytes per linked list item, GPDMA transfer size field is 12 bits of words */
+#define SGPIO_DMA_LLI_BYTES (4096)
+
+/* GPDMA linked list item, layout fixed by the hardware */
+typedef struct {
+	uint32_t csrcaddr;
+	uint32_t cdestaddr;
+	uint32_t clli;
+	uint32_t ccontrol;
+} sgpio_dma_lli_t;
+
+void sgpio_dma_init();
+/* Loop of lli_count items over buffer, block_size bytes per item group.
+ * The first skip bytes of each block are left to the CPU (frame headers),
+ * the last item of each block raises the DMA interrupt if irq_per_block. */
+void sgpio_dma_configure_lli(
+	sgpio_dma_lli_t* const lli,
+	const size_t lli_count,
+	const transceiver_mode_t transceiver_mode,
+	uint8_t* const buffer,
+	const size_t block_size,
+	const size_t skip,
+	const bool irq_per_block
+);
+/* SGPIO must be configured single slice (sgpio_configure(mode, false)) */
+void sgpio_dma_start(
+	const sgpio_dma_lli_t* const lli,
+	const transceiver_mode_t transceiver_mode
+);
+void sgpio_dma_stop();
+void sgpio_dma_irq_tc_acknowledge();
+/* Memory address the channel will access next */
+uint32_t sgpio_dma_current_address(const transceiver_mode_t transceiver_mode);
+/* Swap QI -> IQ in place, the interrupt path does it with rev16 on the fly */
+void sgpio_dma_swap_iq(uint8_t* const buffer, const size_t length);
+
+#endif//__SGPIO_DMA_H__
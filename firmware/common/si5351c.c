@@ -20,8 +20,25 @@
  * Boston, MA 02110-1301, USA.
  */
 
+/*
+ * 'gcc -DTEST -O2 -o test si5351c.c' checks the MultiSynth divider math
+ * against a table of sample rates.
+ */
+
 #include "si5351c.h"
+
+#ifdef TEST
+#include <stdio.h>
+/* No I2C on the host, register access goes nowhere */
+#define I2C_WRITE 0
+#define I2C_READ 1
+static void i2c0_tx_start(void) {}
+static void i2c0_tx_byte(uint8_t byte) { (void)byte; }
+static uint8_t i2c0_rx_byte(void) { return 0; }
+static void i2c0_stop(void) {}
+#else
 #include <libopencm3/lpc43xx/i2c.h>
+#endif
 
 /* FIXME return i2c0 status from each function */
 
@@ -161,6 +178,50 @@ void si5351c_configure_multisynth(const uint_fast8_t ms_number,
 	si5351c_write(data, sizeof(data));
 }
 
+bool si5351c_ms_divider_compute(const uint32_t f_in_hz, const uint32_t f_out_hz,
+		si5351c_ms_divider_t* const divider)
+{
+	if( f_out_hz == 0 ) {
+		return false;
+	}
+
+	si5351c_ms_fraction(f_in_hz, f_out_hz,
+		&divider->a, &divider->b, &divider->c);
+
+	if( divider->a < SI5351C_MS_DIVIDER_MIN ) {
+		return false;
+	}
+	if( (divider->a > SI5351C_MS_DIVIDER_MAX) ||
+	    ((divider->a == SI5351C_MS_DIVIDER_MAX) && (divider->b != 0)) ) {
+		return false;
+	}
+	return true;
+}
+
+/* Register encoding of a + b / c, see si5351c_configure_multisynth() */
+void si5351c_ms_divider_params(const si5351c_ms_divider_t* const divider,
+		uint32_t* const p1, uint32_t* const p2, uint32_t* const p3)
+{
+	const uint32_t floor_128b_c = (128 * divider->b) / divider->c;
+
+	*p1 = (128 * divider->a) + floor_128b_c - 512;
+	*p2 = (128 * divider->b) - (divider->c * floor_128b_c);
+	*p3 = divider->c;
+}
+
+/* Registers 16 through 23 bit 6: MSx_INT */
+void si5351c_set_int_mode(const uint_fast8_t ms_number, const bool int_mode)
+{
+	const uint8_t reg = 16 + ms_number;
+	const uint8_t value = si5351c_read_single(reg);
+
+	if( int_mode ) {
+		si5351c_write_single(reg, value | 0x40);
+	} else {
+		si5351c_write_single(reg, value & ~0x40);
+	}
+}
+
 #ifdef JELLYBEAN
 /*
  * Registers 16 through 23: CLKx Control
@@ -279,3 +340,63 @@ void si5351c_enable_clock_outputs()
 	uint8_t data[] = { 3, 0xC0 };
 	si5351c_write(data, sizeof(data));
 }
+
+#ifdef TEST
+typedef struct {
+	uint32_t f_out_hz;
+	uint32_t p1;
+	uint32_t p2;
+	uint32_t p3;
+} si5351c_test_t;
+
+/* Sample rate * 2 out of PLLA, as sample_rate_set() on Jawbreaker */
+static const si5351c_test_t si5351c_tests[] = {
+	{  5000000 * 2,  9728,      0,       1 }, /* 80 */
+	{ 10000000 * 2,  4608,      0,       1 }, /* 40 */
+	{ 12500000 * 2,  3584,      0,       1 }, /* 32 */
+	{ 16000000 * 2,  2688,      0,       1 }, /* 25 */
+	{ 20000000 * 2,  2048,      0,       1 }, /* 20 */
+	{  2000000 * 2, 25088,      0,       1 }, /* 200 */
+	{  8000000 * 2,  5888,      0,       1 }, /* 50 */
+	{  3000000 * 2, 16554,      2,       3 }, /* 133 + 1/3 */
+	{  7000000 * 2,  6802,      2,       7 }, /* 57 + 1/7 */
+	{ 15360000 * 2,  2821,      8,      24 }, /* 26 + 1/24 */
+	{ 19999999 * 2,  2048,    128, 1000000 }, /* 20 + 20/19999999 ~ 1/1000000 */
+	{ 19000013 * 2,  2182, 515630,  701539 }, /* 21 + 36913/701539, semiconvergent tie */
+};
+
+int main(int ac, char **av)
+{
+	si5351c_ms_divider_t divider;
+	uint32_t p1, p2, p3;
+	unsigned int failures = 0;
+	size_t i;
+
+	(void)ac;
+	(void)av;
+
+	for(i=0; i<sizeof(si5351c_tests)/sizeof(si5351c_tests[0]); i++) {
+		const si5351c_test_t* const t = &si5351c_tests[i];
+		double rate;
+		bool ok;
+
+		if( !si5351c_ms_divider_compute(SI5351C_PLLA_HZ, t->f_out_hz, &divider) ) {
+			printf("%u: out of range\n", t->f_out_hz);
+			failures++;
+			continue;
+		}
+		si5351c_ms_divider_params(&divider, &p1, &p2, &p3);
+		rate = (double)SI5351C_PLLA_HZ * divider.c / ((double)divider.a * divider.c + divider.b);
+		ok = (p1 == t->p1) && (p2 == t->p2) && (p3 == t->p3);
+		printf("%9u: %u + %u/%u p1=%u p2=%u p3=%u rate %.6f %s\n",
+			t->f_out_hz, divider.a, divider.b, divider.c, p1, p2, p3, rate,
+			ok ? "ok" : "FAIL");
+		if( !ok ) {
+			failures++;
+		}
+	}
+
+	printf("%u failures\n", failures);
+	return (failures == 0) ? 0 : 1;
+}
+#endif //TEST
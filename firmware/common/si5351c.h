@@ -29,9 +29,23 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "si5351c_fraction.h"
 
 #define SI5351C_I2C_ADDR (0x60 << 1)
 
+/* MultiSynth fractional divider a + b / c, PLLA and denominator limit
+ * in si5351c_fraction.h */
+#define SI5351C_MS_DIVIDER_MIN (8)
+#define SI5351C_MS_DIVIDER_MAX (2048)
+
+typedef struct {
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+} si5351c_ms_divider_t;
+
 void si5351c_disable_all_outputs();
 void si5351c_disable_oeb_pin_control();
 void si5351c_power_down_all_clocks();
@@ -42,6 +56,13 @@ void si5351c_configure_pll1_multisynth();
 void si5351c_configure_multisynth(const uint_fast8_t ms_number,
     	const uint32_t p1, const uint32_t p2, const uint32_t p3,
     	const uint_fast8_t r_div);
+/* Closest a + b / c to f_in_hz / f_out_hz, false if out of range */
+bool si5351c_ms_divider_compute(const uint32_t f_in_hz, const uint32_t f_out_hz,
+		si5351c_ms_divider_t* const divider);
+void si5351c_ms_divider_params(const si5351c_ms_divider_t* const divider,
+		uint32_t* const p1, uint32_t* const p2, uint32_t* const p3);
+/* MSx_INT, only for even integer dividers */
+void si5351c_set_int_mode(const uint_fast8_t ms_number, const bool int_mode);
 void si5351c_configure_clock_control();
 void si5351c_enable_clock_outputs();
 
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2012 Michael Ossmann <mike@ossmann.com>
+ * Copyright 2012 Jared Boone <jared@sharebrained.com>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * MultiSynth divider search, shared by the firmware (si5351c.c) and
+ * libhackrf (hackrf_compute_sample_rate) so the host reports the exact rate
+ * the firmware programs. Plain C99 / C++98, no firmware dependencies.
+ */
+
+#ifndef __SI5351C_FRACTION_H
+#define __SI5351C_FRACTION_H
+
+#include <stdint.h>
+
+/* PLLA, 25MHz crystal * 32 (see si5351c_configure_pll1_multisynth) */
+#define SI5351C_PLLA_HZ (800000000)
+
+/* MultiSynth fractional divider a + b / c */
+#define SI5351C_MS_DENOMINATOR_MAX ((1 << 20) - 1)
+
+/*
+ * Best rational approximation of num / den (num < den) with a denominator up
+ * to max: continued fraction convergents, then the last semiconvergent that
+ * fits if it is closer.
+ */
+static inline void si5351c_best_fraction(const uint32_t num, const uint32_t den,
+		const uint32_t max, uint32_t* const b, uint32_t* const c)
+{
+	uint64_t p0 = 0, q0 = 1;
+	uint64_t p1 = 1, q1 = 0;
+	uint32_t n = num;
+	uint32_t d = den;
+
+	while( d != 0 ) {
+		const uint32_t a = n / d;
+		const uint32_t r = n - (a * d);
+		const uint64_t p2 = p0 + (a * p1);
+		const uint64_t q2 = q0 + (a * q1);
+
+		if( q2 > max ) {
+			const uint64_t k = (max - q0) / q1;
+			const uint64_t ps = p0 + (k * p1);
+			const uint64_t qs = q0 + (k * q1);
+			/* |num / den - p / q| * den * q, both below 2^45 */
+			const int64_t error_s = (int64_t)(num * qs) - (int64_t)(ps * den);
+			const int64_t error_1 = (int64_t)(num * q1) - (int64_t)(p1 * den);
+			const uint64_t e_s = (uint64_t)((error_s < 0) ? -error_s : error_s);
+			const uint64_t e_1 = (uint64_t)((error_1 < 0) ? -error_1 : error_1);
+			if( (k > 0) && ((e_s * q1) < (e_1 * qs)) ) {
+				p1 = ps;
+				q1 = qs;
+			}
+			break;
+		}
+
+		p0 = p1;
+		q0 = q1;
+		p1 = p2;
+		q1 = q2;
+		n = d;
+		d = r;
+	}
+
+	*b = (uint32_t)p1;
+	*c = (uint32_t)q1;
+}
+
+/* Closest a + b / c to f_in_hz / f_out_hz (f_out_hz != 0), no range check */
+static inline void si5351c_ms_fraction(const uint32_t f_in_hz, const uint32_t f_out_hz,
+		uint32_t* const a, uint32_t* const b, uint32_t* const c)
+{
+	*a = f_in_hz / f_out_hz;
+	si5351c_best_fraction(f_in_hz % f_out_hz, f_out_hz,
+		SI5351C_MS_DENOMINATOR_MAX, b, c);
+
+	/* Rounded up to the next integer */
+	if( *b == *c ) {
+		(*a)++;
+		*b = 0;
+	}
+	if( *b == 0 ) {
+		*c = 1;
+	}
+}
+
+#endif /* __SI5351C_FRACTION_H */
@@ -195,7 +195,7 @@ void usb_endpoint_prime(
 		USB0_ENDPTPRIME = USB0_ENDPTPRIME_PERB(1 << endpoint_number);
 	}
 }
-/*
+
 static bool usb_endpoint_is_priming(
 	const usb_endpoint_t* const endpoint
 ) {
@@ -206,7 +206,35 @@ static bool usb_endpoint_is_priming(
 		return USB0_ENDPTPRIME & USB0_ENDPTPRIME_PERB(1 << endpoint_number);
 	}
 }
-*/
+
+// Add new_td behind tail_td, which may or may not have been retired yet.
+// See UM10503 "Executing a transfer descriptor", case of a non-empty list,
+// for the ATDTW tripwire dance.
+void usb_endpoint_schedule_append(
+	const usb_endpoint_t* const endpoint,
+	usb_transfer_descriptor_t* const tail_td,
+	usb_transfer_descriptor_t* const new_td
+) {
+	bool done;
+
+	tail_td->next_dtd_pointer = new_td;
+
+	if( usb_endpoint_is_priming(endpoint) ) {
+		return;
+	}
+
+	do {
+		USB0_USBCMD_D |= USB0_USBCMD_D_ATDTW;
+		done = usb_endpoint_is_ready(endpoint);
+	} while( !(USB0_USBCMD_D & USB0_USBCMD_D_ATDTW) );
+
+	USB0_USBCMD_D &= ~USB0_USBCMD_D_ATDTW;
+
+	// Controller reached the end of the list before it saw new_td.
+	if( !done ) {
+		usb_endpoint_prime(endpoint, new_td);
+	}
+}
 void usb_endpoint_flush(
 	const usb_endpoint_t* const endpoint
 ) {
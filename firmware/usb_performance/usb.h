@@ -99,4 +99,10 @@ void usb_endpoint_prime(
 	usb_transfer_descriptor_t* const first_td
 );
 
+void usb_endpoint_schedule_append(
+	const usb_endpoint_t* const endpoint,
+	usb_transfer_descriptor_t* const tail_td,
+	usb_transfer_descriptor_t* const new_td
+);
+
 #endif//__USB_H__
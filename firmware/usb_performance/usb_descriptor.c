@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include "usb_type.h"
+#include "usb_descriptor.h"
 
 #define USB_VENDOR_ID			(0x1D50)
 #define USB_PRODUCT_ID			(0x604B)
@@ -50,7 +51,7 @@ uint8_t usb_descriptor_device[] = {
     USB_WORD(0x0100),                  // bcdDevice
     0x01,                              // iManufacturer
     0x02,                              // iProduct
-    0x00,                              // iSerialNumber
+    0x03,                              // iSerialNumber
     0x01                               // bNumConfigurations
 };
 
@@ -181,10 +182,25 @@ uint8_t usb_descriptor_string_product[] = {
 	'F', 0x00,
 };
 
+/* Filled from the IAP serial number at startup, see usb_set_descriptor_serial_number() */
+uint8_t usb_descriptor_string_serial_number[] = {
+    USB_DESCRIPTOR_STRING_SERIAL_BUF_LEN, // bLength
+    USB_DESCRIPTOR_TYPE_STRING,		// bDescriptorType
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+	'0', 0x00, '0', 0x00, '0', 0x00, '0', 0x00,
+};
+
 uint8_t* const usb_descriptor_strings[] = {
 	usb_descriptor_string_languages,
 	usb_descriptor_string_manufacturer,
 	usb_descriptor_string_product,
+	usb_descriptor_string_serial_number,
 	
 	0,		// TERMINATOR
 };
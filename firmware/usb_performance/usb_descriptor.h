@@ -28,6 +28,9 @@ extern uint8_t usb_descriptor_configuration_high_speed[];
 extern uint8_t usb_descriptor_string_languages[];
 extern uint8_t usb_descriptor_string_manufacturer[];
 extern uint8_t usb_descriptor_string_product[];
+/* 32 hex digits (4 IAP serial number words), UTF-16LE */
+#define USB_DESCRIPTOR_STRING_SERIAL_LEN (32)
+#define USB_DESCRIPTOR_STRING_SERIAL_BUF_LEN (2 + (USB_DESCRIPTOR_STRING_SERIAL_LEN * 2))
 extern uint8_t usb_descriptor_string_serial_number[];
 
-extern uint8_t* usb_descriptor_strings[];
+extern uint8_t* const usb_descriptor_strings[];
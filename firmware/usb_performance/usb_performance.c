@@ -35,6 +35,10 @@
 #include <cpld_jtag.h>
 #include <sgpio.h>
 #include <rom_iap.h>
+#include <decimate.h>
+#ifdef SGPIO_DMA
+#include <sgpio_dma.h>
+#endif
 
 #include "usb.h"
 #include "usb_type.h"
@@ -44,12 +48,94 @@
 
 static volatile transceiver_mode_t transceiver_mode = TRANSCEIVER_MODE_OFF;
 
-uint8_t* const usb_bulk_buffer = (uint8_t*)0x20004000;
+/*
+ * Bulk ring: USB_BULK_BLOCK_COUNT blocks of 16KiB, one dTD each. Filled (RX)
+ * or drained (TX) blocks are appended to the endpoint dTD list through
+ * next_dtd_pointer, so the controller can have several queued while the
+ * host is slow to poll. The linker script reserves AHB SRAM for the ring.
+ */
+#ifndef USB_BULK_BLOCK_COUNT
+#define USB_BULK_BLOCK_COUNT (4)
+#endif
+#if (USB_BULK_BLOCK_COUNT != 2) && (USB_BULK_BLOCK_COUNT != 4)
+#error "USB_BULK_BLOCK_COUNT must be 2 or 4 (64KiB of AHB SRAM)"
+#endif
+#define USB_BULK_BLOCK_SIZE (16384)
+#define USB_BULK_BLOCK_MASK (USB_BULK_BLOCK_SIZE - 1)
+#define USB_BULK_BUFFER_SIZE (USB_BULK_BLOCK_COUNT * USB_BULK_BLOCK_SIZE)
+
+extern uint8_t usb_bulk_buffer[USB_BULK_BUFFER_SIZE];
+/* Blocks in use this run, fewer than USB_BULK_BLOCK_COUNT when decimating */
+static uint_fast8_t usb_bulk_block_count = USB_BULK_BLOCK_COUNT;
+static uint32_t usb_bulk_buffer_mask = USB_BULK_BUFFER_SIZE - 1;
+
+/* Memory SGPIO fills or drains, the bulk ring unless decimating. The
+ * interrupt path keeps its position in usb_bulk_buffer_offset. */
+static uint8_t* sgpio_buffer = usb_bulk_buffer;
+static uint32_t sgpio_buffer_mask = USB_BULK_BUFFER_SIZE - 1;
+static uint32_t sgpio_block_mask = USB_BULK_BLOCK_MASK;
 static volatile uint32_t usb_bulk_buffer_offset = 0;
-static const uint32_t usb_bulk_buffer_mask = 32768 - 1;
 
-usb_transfer_descriptor_t usb_td_bulk[2] ATTR_ALIGNED(64);
+usb_transfer_descriptor_t usb_td_bulk[USB_BULK_BLOCK_COUNT] ATTR_ALIGNED(64);
 const uint_fast8_t usb_td_bulk_count = sizeof(usb_td_bulk) / sizeof(usb_td_bulk[0]);
+
+/* Next block the main loop hands to USB, last dTD appended to the list */
+static volatile uint_fast8_t usb_bulk_block_next = 0;
+static usb_transfer_descriptor_t* usb_bulk_td_tail = NULL;
+
+/* Ring usage since streaming started, see usb_vendor_request_read_bulk_ring */
+static uint8_t usb_bulk_in_flight_max = 0;
+static uint32_t usb_bulk_ring_full = 0;
+static bool usb_bulk_ring_full_counted = false; /* For usb_bulk_block_next */
+
+/* Set by interrupts that may give the main loop work: SGPIO or DMA done with
+ * a block, bulk dTD retired. The main loop sleeps while it is clear. */
+static volatile bool usb_bulk_event = false;
+
+/* Framed RX stream: each 16KiB block starts with a header, the host strips it */
+#define USB_BULK_FRAME_MAGIC (0x31465248) /* "HRF1" */
+#define USB_BULK_FRAME_FLAG_OVERRUN (1 << 0)
+#define USB_BULK_FRAME_FLAG_SWEEP_STEP (1 << 1) /* First block sent at freq_hz */
+#define USB_BULK_FRAME_SAMPLES_PER_BLOCK ((USB_BULK_BLOCK_SIZE - sizeof(usb_bulk_frame_header_t)) / 2)
+
+typedef struct {
+	uint32_t magic;
+	uint32_t flags;
+	uint64_t sample_count; /* First sample of the block, counted from RX start */
+	uint64_t freq_hz; /* Sweep only, 0 otherwise */
+	uint32_t reserved[2];
+} usb_bulk_frame_header_t;
+
+static volatile bool usb_bulk_framed = false;
+static bool sgpio_framed = false; /* SGPIO side writes the headers this run */
+static uint32_t usb_bulk_frame_block_count = 0;
+/* Block filled but not scheduled yet, one flag per usb_td_bulk */
+static volatile bool usb_bulk_block_pending[USB_BULK_BLOCK_COUNT];
+
+#ifdef SGPIO_DMA
+/* GPDMA moves samples, SGPIO interrupt is not used */
+#define SGPIO_DMA_LLI_COUNT (USB_BULK_BUFFER_SIZE / SGPIO_DMA_LLI_BYTES)
+static sgpio_dma_lli_t sgpio_dma_lli[SGPIO_DMA_LLI_COUNT] ATTR_ALIGNED(16);
+static volatile uint_fast8_t sgpio_dma_block = 0; /* Block being filled */
+static uint32_t usb_bulk_frame_flags[USB_BULK_BLOCK_COUNT]; /* Taken when the block was started */
+#endif
+
+/*
+ * Decimated RX: SGPIO fills a capture ring in the upper half of the AHB
+ * buffer, the main loop decimates each capture block in place and appends
+ * the result to the lower half, which is a 2 block bulk ring. At the lower
+ * output rate 2 blocks give USB more time than 4 at the full rate.
+ */
+#define DECIMATE_CAPTURE_BLOCK_SIZE (8192)
+#define DECIMATE_CAPTURE_BUFFER_SIZE (USB_BULK_BUFFER_SIZE / 2)
+#define DECIMATE_CAPTURE_BLOCK_COUNT (DECIMATE_CAPTURE_BUFFER_SIZE / DECIMATE_CAPTURE_BLOCK_SIZE)
+#define DECIMATE_USB_BLOCK_COUNT (2)
+
+static decimate_t decimate;
+static uint32_t decimate_factor = 1; /* SET_DECIMATION, 1 = off */
+static bool decimating = false; /* This run */
+static uint_fast8_t decimate_capture_next = 0; /* Capture block to decimate */
+static uint32_t decimate_output_offset = 0; /* Append position in the bulk ring */
  
 /* TODO remove this big buffer and use streaming for CPLD */ 
 #define CPLD_XSVF_MAX_LEN (65536)
@@ -89,20 +175,38 @@ void update_switches(void)
 #define MAX_HP_FREQ_MHZ (6000)
 
 #define MAX2837_FREQ_NOMINAL_HZ (2600000000)
-#define MAX2837_FREQ_NOMINAL_MHZ (MAX2837_FREQ_NOMINAL_HZ / FREQ_ONE_MHZ)
+
+/* Everything set_freq() writes for one frequency, worked out ahead of time.
+ * Applying a plan is only register writes, no divider arithmetic. */
+typedef struct {
+	rffc5071_synth_t rffc5071;
+	max2837_synth_t max2837;
+	uint8_t switchctrl_clear;
+	uint8_t switchctrl_set;
+	bool mixer;
+} freq_plan_t;
+
+/* Up to 32 set_freq_params_t per FREQ_TABLE_WRITE, so 256 bytes */
+#define FREQ_TABLE_MAX (256)
+#define FREQ_TABLE_WRITE_MAX (32)
+
+static freq_plan_t freq_table[FREQ_TABLE_MAX];
+static uint32_t freq_table_count = 0;
+static set_freq_params_t freq_table_upload[FREQ_TABLE_WRITE_MAX];
 
 /*
- * Set freq/tuning between 30MHz to 6000 MHz (less than 16bits really used)
+ * Plan freq/tuning between 30MHz to 6000 MHz (less than 16bits really used)
  * hz between 0 to 999999 Hz (not checked)
  * return false on error or true if success.
+ * The RFFC5071 LO is fractional-N, the MAX2837 takes up what is left of
+ * its few Hz of error so the IF stays at the nominal 2600MHz.
  */
-bool set_freq(uint32_t freq_mhz, uint32_t freq_hz)
+static bool set_freq_plan(uint32_t freq_mhz, uint32_t freq_hz, freq_plan_t* const plan)
 {
 	bool success;
-	uint32_t RFFC5071_freq_mhz;
+	const uint64_t freq = ((uint64_t)freq_mhz * FREQ_ONE_MHZ) + freq_hz;
+	uint64_t RFFC5071_freq;
 	uint32_t MAX2837_freq_hz;
-	uint32_t real_RFFC5071_freq_mhz;
-	uint32_t tmp_hz;
 
 	success = true;
 
@@ -110,47 +214,37 @@ bool set_freq(uint32_t freq_mhz, uint32_t freq_hz)
 	{
 		if(freq_mhz < MAX_LP_FREQ_MHZ)
 		{
-			switchctrl &= ~(SWITCHCTRL_HP | SWITCHCTRL_MIX_BYPASS);
-
-			RFFC5071_freq_mhz = MAX2837_FREQ_NOMINAL_MHZ - freq_mhz;
-			/* Set Freq and read real freq */
-			real_RFFC5071_freq_mhz = rffc5071_set_frequency(RFFC5071_freq_mhz, 0);
-			if(real_RFFC5071_freq_mhz < RFFC5071_freq_mhz)
-			{
-				tmp_hz = -((RFFC5071_freq_mhz - real_RFFC5071_freq_mhz) * FREQ_ONE_MHZ);
-			}else
-			{
-				tmp_hz = ((real_RFFC5071_freq_mhz - RFFC5071_freq_mhz) * FREQ_ONE_MHZ);
-			}
-			MAX2837_freq_hz = MAX2837_FREQ_NOMINAL_HZ + tmp_hz + freq_hz;
-			max2837_set_frequency(MAX2837_freq_hz);
-			update_switches();
+			plan->switchctrl_clear = SWITCHCTRL_HP | SWITCHCTRL_MIX_BYPASS;
+			plan->switchctrl_set = 0;
+			plan->mixer = true;
+
+			/* RF = IF - LO */
+			RFFC5071_freq = MAX2837_FREQ_NOMINAL_HZ - freq;
+			/* Plan LO and use its real freq */
+			rffc5071_synth_compute(RFFC5071_freq, &plan->rffc5071);
+			MAX2837_freq_hz = freq + plan->rffc5071.tune_freq_hz;
+			max2837_synth_compute(MAX2837_freq_hz, &plan->max2837);
 		}else if( (freq_mhz >= MIN_BYPASS_FREQ_MHZ) && (freq_mhz < MAX_BYPASS_FREQ_MHZ) )
 		{
-			switchctrl |= SWITCHCTRL_MIX_BYPASS;
+			plan->switchctrl_clear = 0;
+			plan->switchctrl_set = SWITCHCTRL_MIX_BYPASS;
+			plan->mixer = false;
 
-			MAX2837_freq_hz = (freq_mhz * FREQ_ONE_MHZ) + freq_hz;
-			/* RFFC5071_freq_mhz <= not used in Bypass mode */
-			max2837_set_frequency(MAX2837_freq_hz);
-			update_switches();
+			MAX2837_freq_hz = freq;
+			/* RFFC5071 not used in Bypass mode */
+			max2837_synth_compute(MAX2837_freq_hz, &plan->max2837);
 		}else if(  (freq_mhz >= MIN_HP_FREQ_MHZ) && (freq_mhz < MAX_HP_FREQ_MHZ) )
 		{
-			switchctrl &= ~SWITCHCTRL_MIX_BYPASS;
-			switchctrl |= SWITCHCTRL_HP;
-
-			RFFC5071_freq_mhz = freq_mhz - MAX2837_FREQ_NOMINAL_MHZ;
-			/* Set Freq and read real freq */
-			real_RFFC5071_freq_mhz = rffc5071_set_frequency(RFFC5071_freq_mhz, 0);
-			if(real_RFFC5071_freq_mhz < RFFC5071_freq_mhz)
-			{
-				tmp_hz = ((RFFC5071_freq_mhz - real_RFFC5071_freq_mhz) * FREQ_ONE_MHZ);
-			}else
-			{
-				tmp_hz = -((real_RFFC5071_freq_mhz - RFFC5071_freq_mhz) * FREQ_ONE_MHZ);
-			}
-			MAX2837_freq_hz = MAX2837_FREQ_NOMINAL_HZ + tmp_hz + freq_hz;
-			max2837_set_frequency(MAX2837_freq_hz);
-			update_switches();
+			plan->switchctrl_clear = SWITCHCTRL_MIX_BYPASS;
+			plan->switchctrl_set = SWITCHCTRL_HP;
+			plan->mixer = true;
+
+			/* RF = LO + IF */
+			RFFC5071_freq = freq - MAX2837_FREQ_NOMINAL_HZ;
+			/* Plan LO and use its real freq */
+			rffc5071_synth_compute(RFFC5071_freq, &plan->rffc5071);
+			MAX2837_freq_hz = freq - plan->rffc5071.tune_freq_hz;
+			max2837_synth_compute(MAX2837_freq_hz, &plan->max2837);
 		}else
 		{
 			/* Error freq_mhz too high */
@@ -164,48 +258,137 @@ bool set_freq(uint32_t freq_mhz, uint32_t freq_hz)
 	return success;
 }
 
+static void set_freq_apply(const freq_plan_t* const plan)
+{
+	switchctrl &= ~plan->switchctrl_clear;
+	switchctrl |= plan->switchctrl_set;
+
+	if( plan->mixer ) {
+		rffc5071_disable();
+		rffc5071_synth_apply(&plan->rffc5071);
+		rffc5071_enable();
+	}
+	max2837_synth_apply(&plan->max2837);
+	update_switches();
+}
+
+bool set_freq(uint32_t freq_mhz, uint32_t freq_hz)
+{
+	freq_plan_t plan;
+
+	if( set_freq_plan(freq_mhz, freq_hz, &plan) ) {
+		set_freq_apply(&plan);
+		return true;
+	} else {
+		return false;
+	}
+}
+
+/*
+ * Sweep: framed RX where the main loop retunes by itself after every
+ * dwell_blocks blocks sent. Blocks that saw the retune, and settle_blocks
+ * after them, are dropped. The others carry the frequency in their header.
+ */
+typedef struct {
+	uint32_t start_mhz;
+	uint32_t stop_mhz;
+	uint32_t step_hz;
+	uint16_t dwell_blocks; /* 0 = off */
+	uint16_t settle_blocks;
+} set_sweep_params_t;
+
+static set_sweep_params_t set_sweep_params;
+static set_sweep_params_t sweep = { 0, 0, 0, 0, 0 };
+static bool sweeping = false; /* This run */
+static uint32_t sweep_step = 0; /* Frequency index from start_mhz */
+static uint64_t sweep_freq_hz = 0;
+static uint32_t sweep_dwell_count = 0; /* Blocks sent at sweep_freq_hz */
+static uint32_t sweep_discard = 0; /* Blocks still to drop */
+static bool sweep_step_start = false; /* Next block sent gets FLAG_SWEEP_STEP */
+/* Worked out while the current step streams, retuning is then quick */
+static freq_plan_t sweep_next_plan;
+static uint32_t sweep_next_step = 0;
+static uint64_t sweep_next_freq_hz = 0;
+
+static uint64_t sweep_freq(const uint32_t step) {
+	return ((uint64_t)sweep.start_mhz * FREQ_ONE_MHZ) + ((uint64_t)step * sweep.step_hz);
+}
+
+/* Plan the step after sweep_step, back to start_mhz past stop_mhz */
+static void sweep_plan_next(void) {
+	uint32_t step = sweep_step + 1;
+	uint64_t freq = sweep_freq(step);
+
+	if( freq > ((uint64_t)sweep.stop_mhz * FREQ_ONE_MHZ) ) {
+		step = 0;
+		freq = sweep_freq(step);
+	}
+	/* Range checked by SET_SWEEP, cannot fail */
+	set_freq_plan(freq / FREQ_ONE_MHZ, freq % FREQ_ONE_MHZ, &sweep_next_plan);
+	sweep_next_step = step;
+	sweep_next_freq_hz = freq;
+}
+
+static void sweep_start(void) {
+	freq_plan_t plan;
+
+	sweep_step = 0;
+	sweep_freq_hz = sweep_freq(sweep_step);
+	set_freq_plan(sweep_freq_hz / FREQ_ONE_MHZ, sweep_freq_hz % FREQ_ONE_MHZ, &plan);
+	set_freq_apply(&plan);
+	sweep_plan_next();
+
+	sweep_dwell_count = 0;
+	sweep_discard = sweep.settle_blocks;
+	sweep_step_start = true;
+}
+
 static void usb_init_buffers_bulk() {
-	usb_td_bulk[0].next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
-	usb_td_bulk[0].total_bytes
-		= USB_TD_DTD_TOKEN_TOTAL_BYTES(16384)
-		| USB_TD_DTD_TOKEN_MULTO(0)
-		;
-	usb_td_bulk[0].buffer_pointer_page[0] = (uint32_t)&usb_bulk_buffer[0x0000];
-	usb_td_bulk[0].buffer_pointer_page[1] = (uint32_t)&usb_bulk_buffer[0x1000];
-	usb_td_bulk[0].buffer_pointer_page[2] = (uint32_t)&usb_bulk_buffer[0x2000];
-	usb_td_bulk[0].buffer_pointer_page[3] = (uint32_t)&usb_bulk_buffer[0x3000];
-	usb_td_bulk[0].buffer_pointer_page[4] = (uint32_t)&usb_bulk_buffer[0x4000];
-
-	usb_td_bulk[1].next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
-	usb_td_bulk[1].total_bytes
-		= USB_TD_DTD_TOKEN_TOTAL_BYTES(16384)
-		| USB_TD_DTD_TOKEN_MULTO(0)
-		;
-	usb_td_bulk[1].buffer_pointer_page[0] = (uint32_t)&usb_bulk_buffer[0x4000];
-	usb_td_bulk[1].buffer_pointer_page[1] = (uint32_t)&usb_bulk_buffer[0x5000];
-	usb_td_bulk[1].buffer_pointer_page[2] = (uint32_t)&usb_bulk_buffer[0x6000];
-	usb_td_bulk[1].buffer_pointer_page[3] = (uint32_t)&usb_bulk_buffer[0x7000];
-	usb_td_bulk[1].buffer_pointer_page[4] = (uint32_t)&usb_bulk_buffer[0x8000];
+	for(uint_fast8_t i=0; i<usb_td_bulk_count; i++) {
+		const uint32_t block = (uint32_t)&usb_bulk_buffer[i * USB_BULK_BLOCK_SIZE];
+
+		usb_td_bulk[i].next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
+		usb_td_bulk[i].total_bytes
+			= USB_TD_DTD_TOKEN_TOTAL_BYTES(USB_BULK_BLOCK_SIZE)
+			| USB_TD_DTD_TOKEN_MULTO(0)
+			;
+		usb_td_bulk[i].buffer_pointer_page[0] = block + 0x0000;
+		usb_td_bulk[i].buffer_pointer_page[1] = block + 0x1000;
+		usb_td_bulk[i].buffer_pointer_page[2] = block + 0x2000;
+		usb_td_bulk[i].buffer_pointer_page[3] = block + 0x3000;
+		usb_td_bulk[i].buffer_pointer_page[4] = block + 0x4000;
+	}
+
+	usb_bulk_block_next = 0;
+	usb_bulk_td_tail = NULL;
+	usb_bulk_ring_full_counted = false;
 }
 
-void usb_endpoint_schedule_no_int(
+/* Appends td to the bulk ring, every block interrupts on completion */
+static void usb_bulk_schedule(
 	const usb_endpoint_t* const endpoint,
 	usb_transfer_descriptor_t* const td
 ) {
-	// Ensure that endpoint is ready to be primed.
-	// It may have been flushed due to an aborted transaction.
-	// TODO: This should be preceded by a flush?
-	while( usb_endpoint_is_ready(endpoint) );
-
 	// Configure a transfer.
+	td->next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
 	td->total_bytes =
-		  USB_TD_DTD_TOKEN_TOTAL_BYTES(16384)
-		/*| USB_TD_DTD_TOKEN_IOC*/
+		  USB_TD_DTD_TOKEN_TOTAL_BYTES(USB_BULK_BLOCK_SIZE)
+		| USB_TD_DTD_TOKEN_IOC /* Wakes the main loop, see usb_bulk_transfer_complete */
 		| USB_TD_DTD_TOKEN_MULTO(0)
 		| USB_TD_DTD_TOKEN_STATUS_ACTIVE
 		;
-	
-	usb_endpoint_prime(endpoint, td);
+
+	if( usb_bulk_td_tail ) {
+		usb_endpoint_schedule_append(endpoint, usb_bulk_td_tail, td);
+	} else {
+		// First block since set_transceiver_mode(), which already
+		// flushed the endpoint in usb_endpoint_disable() and
+		// usb_endpoint_init(). Wait out a prime still settling.
+		while( usb_endpoint_is_ready(endpoint) );
+
+		usb_endpoint_prime(endpoint, td);
+	}
+	usb_bulk_td_tail = td;
 }
 
 usb_configuration_t usb_configuration_high_speed = {
@@ -253,6 +436,11 @@ usb_endpoint_t usb_endpoint_control_in = {
 	.transfer_complete = usb_control_in_complete,
 };
 
+static void usb_bulk_transfer_complete(usb_endpoint_t* const endpoint) {
+	(void)endpoint;
+	usb_bulk_event = true;
+}
+
 // NOTE: Endpoint number for IN and OUT are different. I wish I had some
 // evidence that having BULK IN and OUT on separate endpoint numbers was
 // actually a good idea. Seems like everybody does it that way, but why?
@@ -263,7 +451,7 @@ usb_endpoint_t usb_endpoint_bulk_in = {
 	.in = &usb_endpoint_bulk_in,
 	.out = 0,
 	.setup_complete = 0,
-	.transfer_complete = 0,
+	.transfer_complete = usb_bulk_transfer_complete,
 };
 
 usb_endpoint_t usb_endpoint_bulk_out = {
@@ -272,24 +460,90 @@ usb_endpoint_t usb_endpoint_bulk_out = {
 	.in = 0,
 	.out = &usb_endpoint_bulk_out,
 	.setup_complete = 0,
-	.transfer_complete = 0,
+	.transfer_complete = usb_bulk_transfer_complete,
 };
 
 void baseband_streaming_disable() {
 	sgpio_cpld_stream_disable();
 
+#ifdef SGPIO_DMA
+	nvic_disable_irq(NVIC_M4_DMA_IRQ);
+	sgpio_dma_stop();
+#else
 	nvic_disable_irq(NVIC_M4_SGPIO_IRQ);
+#endif
 	
 	usb_endpoint_disable(&usb_endpoint_bulk_in);
 	usb_endpoint_disable(&usb_endpoint_bulk_out);
 }
 
+/* Framed RX: SGPIO side starts filling block, returns its header flags */
+static uint32_t usb_bulk_block_start(const uint_fast8_t block) {
+	uint32_t flags = 0;
+
+	/* Previous block in this memory never scheduled, or not sent yet */
+	if( usb_bulk_block_pending[block] ||
+	    (usb_td_bulk[block].total_bytes & USB_TD_DTD_TOKEN_STATUS_ACTIVE) ) {
+		flags |= USB_BULK_FRAME_FLAG_OVERRUN;
+	}
+	usb_bulk_block_pending[block] = true;
+	return flags;
+}
+
+static void usb_bulk_frame_header(const uint_fast8_t block, const uint32_t flags) {
+	usb_bulk_frame_header_t* const header =
+		(usb_bulk_frame_header_t*)&usb_bulk_buffer[block * USB_BULK_BLOCK_SIZE];
+
+	header->magic = USB_BULK_FRAME_MAGIC;
+	header->flags = flags;
+	header->sample_count = (uint64_t)usb_bulk_frame_block_count * USB_BULK_FRAME_SAMPLES_PER_BLOCK;
+	header->freq_hz = 0;
+	header->reserved[0] = 0;
+	header->reserved[1] = 0;
+	usb_bulk_frame_block_count++;
+}
+
+static void usb_bulk_frame_reset(void) {
+	usb_bulk_buffer_offset = 0;
+	usb_bulk_frame_block_count = 0;
+
+	for(uint_fast8_t i=0; i<USB_BULK_BLOCK_COUNT; i++) {
+		usb_bulk_block_pending[i] = false;
+		/* Blocks sent before the first new header must not look valid */
+		((usb_bulk_frame_header_t*)&usb_bulk_buffer[i * USB_BULK_BLOCK_SIZE])->magic = 0;
+	}
+}
+
+/* Split the AHB buffer for this run, see DECIMATE_CAPTURE_BLOCK_SIZE */
+static void decimate_configure(void) {
+	decimating = (decimate_factor > 1) && (transceiver_mode == TRANSCEIVER_MODE_RX);
+
+	if( decimating ) {
+		decimate_init(&decimate, decimate_factor);
+		decimate_capture_next = 0;
+		decimate_output_offset = 0;
+		usb_bulk_block_count = DECIMATE_USB_BLOCK_COUNT;
+		sgpio_buffer = &usb_bulk_buffer[USB_BULK_BUFFER_SIZE - DECIMATE_CAPTURE_BUFFER_SIZE];
+		sgpio_buffer_mask = DECIMATE_CAPTURE_BUFFER_SIZE - 1;
+		sgpio_block_mask = DECIMATE_CAPTURE_BLOCK_SIZE - 1;
+	} else {
+		usb_bulk_block_count = USB_BULK_BLOCK_COUNT;
+		sgpio_buffer = usb_bulk_buffer;
+		sgpio_buffer_mask = USB_BULK_BUFFER_SIZE - 1;
+		sgpio_block_mask = USB_BULK_BLOCK_MASK;
+	}
+	usb_bulk_buffer_mask = (usb_bulk_block_count * USB_BULK_BLOCK_SIZE) - 1;
+}
+
 void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode) {
 	baseband_streaming_disable();
 	
 	transceiver_mode = new_transceiver_mode;
 	
 	usb_init_buffers_bulk();
+	usb_bulk_frame_reset();
+	decimate_configure();
+	sweeping = false;
 
 	if( transceiver_mode == TRANSCEIVER_MODE_RX ) {
 		gpio_clear(PORT_LED1_3, PIN_LED3);
@@ -316,11 +570,41 @@ void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode) {
 		return;
 	}
 
+	/* Kept through OFF, so the host can read them after it stops streaming */
+	usb_bulk_in_flight_max = 0;
+	usb_bulk_ring_full = 0;
+
+	sgpio_framed = usb_bulk_framed && (transceiver_mode == TRANSCEIVER_MODE_RX) && !decimating;
+
+	sweeping = (sweep.dwell_blocks != 0) && sgpio_framed;
+	if( sweeping ) {
+		sweep_start();
+	}
+
+#ifdef SGPIO_DMA
+	sgpio_configure(transceiver_mode, false);
+
+	/* Terminal count at the end of each block wakes the main loop, and
+	 * writes the frame header when framed */
+	sgpio_dma_block = 0;
+	sgpio_dma_configure_lli(sgpio_dma_lli,
+		(sgpio_buffer_mask + 1) / SGPIO_DMA_LLI_BYTES, transceiver_mode,
+		sgpio_buffer, sgpio_block_mask + 1,
+		sgpio_framed ? sizeof(usb_bulk_frame_header_t) : 0,
+		true);
+	if( sgpio_framed ) {
+		usb_bulk_frame_flags[0] = usb_bulk_block_start(0);
+	}
+	nvic_set_priority(NVIC_M4_DMA_IRQ, 0);
+	nvic_enable_irq(NVIC_M4_DMA_IRQ);
+	sgpio_dma_start(sgpio_dma_lli, transceiver_mode);
+#else
 	sgpio_configure(transceiver_mode, true);
 
 	nvic_set_priority(NVIC_M4_SGPIO_IRQ, 0);
 	nvic_enable_irq(NVIC_M4_SGPIO_IRQ);
 	SGPIO_SET_EN_1 = (1 << SGPIO_SLICE_A);
+#endif
 
     sgpio_cpld_stream_enable();
 }
@@ -418,6 +702,118 @@ usb_request_status_t usb_vendor_request_read_si5351c(
 	}
 }
 
+/*
+ * Batched register access, setup.value selects the chip. REGS_WRITE takes
+ * up to REGS_BATCH_MAX (register, value) pairs of little endian u16 and
+ * writes them in order, REGS_READ returns setup.length / 2 registers from
+ * setup.index on as little endian u16.
+ */
+#define REGS_CHIP_MAX2837 (0)
+#define REGS_CHIP_SI5351C (1)
+#define REGS_CHIP_RFFC5071 (2)
+
+#define REGS_BATCH_MAX (128)
+#define SI5351C_NUM_REGS (256)
+
+static uint16_t regs_buffer[REGS_BATCH_MAX * 2];
+
+static bool regs_valid(const uint_fast8_t chip, const uint32_t r, const uint32_t v) {
+	switch( chip ) {
+	case REGS_CHIP_MAX2837:
+		return (r < MAX2837_NUM_REGS) && (v < MAX2837_DATA_REGS_MAX_VALUE);
+	case REGS_CHIP_SI5351C:
+		return (r < SI5351C_NUM_REGS) && (v < 256);
+	case REGS_CHIP_RFFC5071:
+		return (r < RFFC5071_NUM_REGS);
+	default:
+		return false;
+	}
+}
+
+static uint16_t regs_read(const uint_fast8_t chip, const uint_fast8_t r) {
+	switch( chip ) {
+	case REGS_CHIP_MAX2837:
+		return max2837_reg_read(r);
+	case REGS_CHIP_SI5351C:
+		return si5351c_read_single(r);
+	default:
+		return rffc5071_reg_read(r);
+	}
+}
+
+static void regs_write(const uint_fast8_t chip, const uint_fast8_t r, const uint16_t v) {
+	switch( chip ) {
+	case REGS_CHIP_MAX2837:
+		max2837_reg_write(r, v);
+		break;
+	case REGS_CHIP_SI5351C:
+		si5351c_write_single(r, v);
+		break;
+	default:
+		rffc5071_reg_write(r, v);
+		break;
+	}
+}
+
+usb_request_status_t usb_vendor_request_regs_write(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage
+) {
+	const uint_fast8_t chip = endpoint->setup.value;
+	const uint32_t count = endpoint->setup.length / 4;
+	uint32_t i;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		if( (count == 0) || (count > REGS_BATCH_MAX)
+				|| ((endpoint->setup.length % 4) != 0)
+				|| !regs_valid(chip, 0, 0) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_endpoint_schedule(endpoint->out, &regs_buffer[0], endpoint->setup.length);
+		return USB_REQUEST_STATUS_OK;
+	} else if( stage == USB_TRANSFER_STAGE_DATA ) {
+		/* All or nothing */
+		for(i=0; i<count; i++) {
+			if( !regs_valid(chip, regs_buffer[i * 2], regs_buffer[i * 2 + 1]) ) {
+				return USB_REQUEST_STATUS_STALL;
+			}
+		}
+		for(i=0; i<count; i++) {
+			regs_write(chip, regs_buffer[i * 2], regs_buffer[i * 2 + 1]);
+		}
+		usb_endpoint_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+usb_request_status_t usb_vendor_request_regs_read(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage
+) {
+	const uint_fast8_t chip = endpoint->setup.value;
+	const uint32_t first = endpoint->setup.index;
+	const uint32_t count = endpoint->setup.length / 2;
+	uint32_t i;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		if( (count == 0) || (count > (REGS_BATCH_MAX * 2))
+				|| ((endpoint->setup.length % 2) != 0)
+				|| !regs_valid(chip, first + count - 1, 0) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		for(i=0; i<count; i++) {
+			regs_buffer[i] = regs_read(chip, first + i);
+		}
+		usb_endpoint_schedule(endpoint->in, &regs_buffer[0], endpoint->setup.length);
+		usb_endpoint_schedule_ack(endpoint->out);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
 usb_request_status_t usb_vendor_request_set_sample_rate(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage
@@ -759,6 +1155,154 @@ usb_request_status_t usb_vendor_request_read_partid_serialno(
 	return USB_REQUEST_STATUS_OK;
 }
 
+usb_request_status_t usb_vendor_request_set_framed_mode(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		if( transceiver_mode != TRANSCEIVER_MODE_OFF ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		switch (endpoint->setup.value) {
+		case 0:
+		case 1:
+			usb_bulk_framed = (endpoint->setup.value == 1);
+			usb_endpoint_schedule_ack(endpoint->in);
+			return USB_REQUEST_STATUS_OK;
+		default:
+			return USB_REQUEST_STATUS_STALL;
+		}
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+/* Bulk ring depth and usage since streaming started, little endian:
+ * u8 depth (blocks), u8 most blocks in flight, u16 reserved,
+ * u32 blocks that found the ring full (overrun/underrun). */
+usb_request_status_t usb_vendor_request_read_bulk_ring(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		const uint32_t ring_full = usb_bulk_ring_full;
+		endpoint->buffer[0] = usb_bulk_block_count;
+		endpoint->buffer[1] = usb_bulk_in_flight_max;
+		endpoint->buffer[2] = 0;
+		endpoint->buffer[3] = 0;
+		endpoint->buffer[4] = ring_full & 0xff;
+		endpoint->buffer[5] = (ring_full >> 8) & 0xff;
+		endpoint->buffer[6] = (ring_full >> 16) & 0xff;
+		endpoint->buffer[7] = (ring_full >> 24) & 0xff;
+		usb_endpoint_schedule(endpoint->in, &endpoint->buffer, 8);
+		usb_endpoint_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+/* Power of two from 1 (off) to DECIMATE_FACTOR_MAX, applied from the next
+ * RX start. Needs the 4 block ring, see DECIMATE_CAPTURE_BLOCK_SIZE. */
+usb_request_status_t usb_vendor_request_set_decimation(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		const uint32_t factor = endpoint->setup.value;
+		if( transceiver_mode != TRANSCEIVER_MODE_OFF ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( (factor > 1) && (USB_BULK_BLOCK_COUNT < 4) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( !decimate_init(&decimate, factor) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		decimate_factor = factor;
+		usb_endpoint_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+/* Plans setup.length / 8 set_freq_params_t into the frequency table from
+ * entry setup.index on. The table ends after the last entry written, so
+ * start from 0 to replace it. Stalls on a frequency set_freq() would
+ * refuse, the table then ends before that entry. */
+usb_request_status_t usb_vendor_request_freq_table_write(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	const uint32_t first = endpoint->setup.index;
+	const uint32_t count = endpoint->setup.length / sizeof(set_freq_params_t);
+	uint32_t i;
+
+	if( (count == 0) || (count > FREQ_TABLE_WRITE_MAX)
+			|| ((endpoint->setup.length % sizeof(set_freq_params_t)) != 0)
+			|| (first > freq_table_count)
+			|| ((first + count) > FREQ_TABLE_MAX) ) {
+		return USB_REQUEST_STATUS_STALL;
+	}
+
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		usb_endpoint_schedule(endpoint->out, &freq_table_upload[0], endpoint->setup.length);
+		return USB_REQUEST_STATUS_OK;
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		freq_table_count = first;
+		for(i=0; i<count; i++) {
+			if( !set_freq_plan(freq_table_upload[i].freq_mhz,
+					freq_table_upload[i].freq_hz, &freq_table[first + i]) ) {
+				return USB_REQUEST_STATUS_STALL;
+			}
+			freq_table_count++;
+		}
+		usb_endpoint_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+/* Tune to frequency table entry setup.index. Allowed while streaming. */
+usb_request_status_t usb_vendor_request_freq_table_select(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		if( endpoint->setup.index >= freq_table_count ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		set_freq_apply(&freq_table[endpoint->setup.index]);
+		usb_endpoint_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+/* Sweep settings for the next RX start, see set_sweep_params_t. Only used
+ * in framed mode without decimation. Stalls on a range set_freq() would
+ * refuse. */
+usb_request_status_t usb_vendor_request_set_sweep(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		if( transceiver_mode != TRANSCEIVER_MODE_OFF ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_endpoint_schedule(endpoint->out, &set_sweep_params, sizeof(set_sweep_params_t));
+		return USB_REQUEST_STATUS_OK;
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		if( (set_sweep_params.dwell_blocks != 0) &&
+		    ((set_sweep_params.start_mhz < MIN_LP_FREQ_MHZ)
+		     || (set_sweep_params.stop_mhz >= MAX_HP_FREQ_MHZ)
+		     || (set_sweep_params.start_mhz > set_sweep_params.stop_mhz)
+		     || (set_sweep_params.step_hz == 0)) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		sweep = set_sweep_params;
+		usb_endpoint_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
 static const usb_request_handler_fn vendor_request_handler[] = {
 	NULL,
 	usb_vendor_request_set_transceiver_mode,
@@ -778,7 +1322,15 @@ static const usb_request_handler_fn vendor_request_handler[] = {
 	usb_vendor_request_read_version_string,
 	usb_vendor_request_set_freq,
 	usb_vendor_request_set_amp_enable,
-	usb_vendor_request_read_partid_serialno
+	usb_vendor_request_read_partid_serialno,
+	usb_vendor_request_set_framed_mode,
+	usb_vendor_request_read_bulk_ring,
+	usb_vendor_request_set_decimation,
+	usb_vendor_request_freq_table_write,
+	usb_vendor_request_freq_table_select,
+	usb_vendor_request_set_sweep,
+	usb_vendor_request_regs_write,
+	usb_vendor_request_regs_read
 };
 
 static const uint32_t vendor_request_handler_count =
@@ -854,7 +1406,14 @@ bool usb_set_configuration(
 void sgpio_irqhandler() {
 	SGPIO_CLR_STATUS_1 = (1 << SGPIO_SLICE_A);
 
-	uint32_t* const p = (uint32_t*)&usb_bulk_buffer[usb_bulk_buffer_offset];
+	if( sgpio_framed &&
+	    ((usb_bulk_buffer_offset & USB_BULK_BLOCK_MASK) == 0) ) {
+		const uint_fast8_t block = usb_bulk_buffer_offset / USB_BULK_BLOCK_SIZE;
+		usb_bulk_frame_header(block, usb_bulk_block_start(block));
+		usb_bulk_buffer_offset += sizeof(usb_bulk_frame_header_t);
+	}
+
+	uint32_t* const p = (uint32_t*)&sgpio_buffer[usb_bulk_buffer_offset];
 	if( transceiver_mode == TRANSCEIVER_MODE_RX ) {
 		__asm__(
 			"ldr r0, [%[SGPIO_REG_SS], #44]\n\t"
@@ -911,7 +1470,219 @@ void sgpio_irqhandler() {
 		);
 	}
 	
-	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & sgpio_buffer_mask;
+	if( (usb_bulk_buffer_offset & sgpio_block_mask) == 0 ) {
+		usb_bulk_event = true;
+	}
+}
+
+#ifdef SGPIO_DMA
+/* Terminal count at the end of each block */
+void dma_irqhandler() {
+	sgpio_dma_irq_tc_acknowledge();
+
+	const uint_fast8_t block = sgpio_dma_block;
+	const uint_fast8_t next = (block + 1) & (USB_BULK_BLOCK_COUNT - 1);
+	sgpio_dma_block = next;
+
+	if( sgpio_framed ) {
+		usb_bulk_frame_header(block, usb_bulk_frame_flags[block]);
+		usb_bulk_frame_flags[next] = usb_bulk_block_start(next);
+	}
+	usb_bulk_event = true;
+}
+#endif
+
+/* Offset in sgpio_buffer SGPIO will access next */
+static uint32_t sgpio_position(void) {
+#ifdef SGPIO_DMA
+	return (sgpio_dma_current_address(transceiver_mode) - (uint32_t)sgpio_buffer)
+		& sgpio_buffer_mask;
+#else
+	return usb_bulk_buffer_offset;
+#endif
+}
+
+/* True once the SGPIO side (or the decimator) moved on from block */
+static bool usb_bulk_block_ready(const uint_fast8_t block) {
+	const uint32_t position = decimating ? decimate_output_offset : sgpio_position();
+	return (position / USB_BULK_BLOCK_SIZE) != block;
+}
+
+/* Blocks the controller has not finished with yet */
+static uint_fast8_t usb_bulk_in_flight(void) {
+	uint_fast8_t count = 0;
+	for(uint_fast8_t i=0; i<usb_td_bulk_count; i++) {
+		if( usb_td_bulk[i].total_bytes & USB_TD_DTD_TOKEN_STATUS_ACTIVE ) {
+			count++;
+		}
+	}
+	return count;
+}
+
+static void usb_bulk_block_schedule(const uint_fast8_t block) {
+	usb_transfer_descriptor_t* const td = &usb_td_bulk[block];
+	const bool rx = (transceiver_mode == TRANSCEIVER_MODE_RX);
+	uint_fast8_t in_flight;
+
+#ifdef SGPIO_DMA
+	/* TX goes out as the host sent it, same as the interrupt path.
+	 * Decimated blocks were swapped before decimation. */
+	if( rx && !decimating ) {
+		uint8_t* const data = &usb_bulk_buffer[block * USB_BULK_BLOCK_SIZE];
+		const size_t skip = sgpio_framed ? sizeof(usb_bulk_frame_header_t) : 0;
+		sgpio_dma_swap_iq(&data[skip], USB_BULK_BLOCK_SIZE - skip);
+	}
+#endif
+
+	usb_bulk_schedule(
+		rx ? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
+		td
+	);
+	usb_bulk_block_pending[block] = false;
+	usb_bulk_block_next = (block + 1) & (usb_bulk_block_count - 1);
+
+	in_flight = usb_bulk_in_flight();
+	if( in_flight > usb_bulk_in_flight_max ) {
+		usb_bulk_in_flight_max = in_flight;
+	}
+}
+
+/* Decimated data to the bulk ring, with a frame header at each block start */
+static void usb_bulk_append(const uint8_t* data, uint32_t length) {
+	while( length ) {
+		const uint32_t block_offset = decimate_output_offset & USB_BULK_BLOCK_MASK;
+		uint32_t n = USB_BULK_BLOCK_SIZE - block_offset;
+
+		if( usb_bulk_framed && (block_offset == 0) ) {
+			const uint_fast8_t block = decimate_output_offset / USB_BULK_BLOCK_SIZE;
+			usb_bulk_frame_header(block, usb_bulk_block_start(block));
+			decimate_output_offset += sizeof(usb_bulk_frame_header_t);
+			continue;
+		}
+
+		if( n > length ) {
+			n = length;
+		}
+		memcpy(&usb_bulk_buffer[decimate_output_offset], data, n);
+		data += n;
+		length -= n;
+		decimate_output_offset = (decimate_output_offset + n) & usb_bulk_buffer_mask;
+	}
+}
+
+/* Main loop side of decimated RX. Returns true if it consumed a capture
+ * block, there may be another one ready. */
+static bool decimate_service(void) {
+	const uint_fast8_t block = decimate_capture_next;
+	uint8_t* const data = &sgpio_buffer[block * DECIMATE_CAPTURE_BLOCK_SIZE];
+	uint32_t count;
+
+	if( !decimating ||
+	    ((sgpio_position() / DECIMATE_CAPTURE_BLOCK_SIZE) == block) ) {
+		return false;
+	}
+
+#ifdef SGPIO_DMA
+	sgpio_dma_swap_iq(data, DECIMATE_CAPTURE_BLOCK_SIZE);
+#endif
+	count = decimate_iq8(&decimate, data, DECIMATE_CAPTURE_BLOCK_SIZE / 2, data);
+	usb_bulk_append(data, count * 2);
+	decimate_capture_next = (block + 1) & (DECIMATE_CAPTURE_BLOCK_COUNT - 1);
+	return true;
+}
+
+static void sweep_tag(const uint_fast8_t block) {
+	usb_bulk_frame_header_t* const header =
+		(usb_bulk_frame_header_t*)&usb_bulk_buffer[block * USB_BULK_BLOCK_SIZE];
+
+	header->freq_hz = sweep_freq_hz;
+	if( sweep_step_start ) {
+		header->flags |= USB_BULK_FRAME_FLAG_SWEEP_STEP;
+		sweep_step_start = false;
+	}
+}
+
+/* After the last block of a step was queued */
+static void sweep_retune(void) {
+	uint_fast8_t filling;
+
+	/* Vendor requests write the same chips from the USB interrupt */
+	nvic_disable_irq(NVIC_M4_USB0_IRQ);
+	set_freq_apply(&sweep_next_plan);
+	nvic_enable_irq(NVIC_M4_USB0_IRQ);
+
+	sweep_step = sweep_next_step;
+	sweep_freq_hz = sweep_next_freq_hz;
+	sweep_dwell_count = 0;
+	sweep_step_start = true;
+
+	/* Blocks up to the one SGPIO is filling saw the old frequency or the
+	 * retune itself */
+	filling = sgpio_position() / USB_BULK_BLOCK_SIZE;
+	sweep_discard = ((filling - usb_bulk_block_next) & (usb_bulk_block_count - 1))
+		+ 1 + sweep.settle_blocks;
+
+	sweep_plan_next();
+}
+
+/* Main loop side of streaming, after each event. Returns true if it queued
+ * (or, sweeping, dropped) a block, there may be another one ready. */
+static bool usb_bulk_service(void) {
+	const uint_fast8_t block = usb_bulk_block_next;
+	bool queued = false;
+
+	if( usb_bulk_block_ready(block) ) {
+		if( sweeping && (sweep_discard > 0) ) {
+			usb_bulk_block_pending[block] = false;
+			usb_bulk_block_next = (block + 1) & (usb_bulk_block_count - 1);
+			sweep_discard--;
+			queued = true;
+		} else if( usb_td_bulk[block].total_bytes & USB_TD_DTD_TOKEN_STATUS_ACTIVE ) {
+			/* Ring full: SGPIO lapped USB, this dTD is still at the head of
+			 * the list. Retry when it retires. */
+			if( !usb_bulk_ring_full_counted ) {
+				usb_bulk_ring_full++;
+				usb_bulk_ring_full_counted = true;
+			}
+		} else {
+			if( sweeping ) {
+				sweep_tag(block);
+			}
+			usb_bulk_block_schedule(block);
+			usb_bulk_ring_full_counted = false;
+			queued = true;
+			if( sweeping && (++sweep_dwell_count >= sweep.dwell_blocks) ) {
+				sweep_retune();
+			}
+		}
+	}
+
+	return queued;
+}
+
+/* Report the chip serial number as USB iSerialNumber, so the host can pick a
+ * board while enumerating without a vendor request. */
+void usb_set_descriptor_serial_number(void)
+{
+	static const char hex[] = "0123456789abcdef";
+	iap_cmd_res_t iap_cmd_res;
+	uint_fast8_t word;
+	uint_fast8_t digit;
+	uint8_t* p = &usb_descriptor_string_serial_number[2];
+
+	iap_cmd_res.cmd_param.command_code = IAP_CMD_READ_SERIAL_NO;
+	iap_cmd_call(&iap_cmd_res);
+	if(iap_cmd_res.status_res.status_ret != CMD_SUCCESS)
+		return;
+
+	/* Same order as hackrf_info prints it */
+	for(word=0; word<4; word++) {
+		for(digit=0; digit<8; digit++) {
+			*p = hex[(iap_cmd_res.status_res.iap_result[word] >> (28 - (digit * 4))) & 0xf];
+			p += 2;
+		}
+	}
 }
 
 int main(void) {
@@ -921,6 +1692,8 @@ int main(void) {
 	enable_1v8_power();
 	cpu_clock_init();
 
+	usb_set_descriptor_serial_number();
+
 	usb_peripheral_reset();
 	
 	usb_device_init(0, &usb_device);
@@ -946,26 +1719,22 @@ int main(void) {
 	switchctrl = SWITCHCTRL_AMP_BYPASS;
 #endif
 
+#ifdef SGPIO_DMA
+	sgpio_dma_init();
+#endif
+
 	while(true) {
-		// Wait until buffer 0 is transmitted/received.
-		while( usb_bulk_buffer_offset < 16384 );
-
-		// Set up IN transfer of buffer 0.
-		usb_endpoint_schedule_no_int(
-			(transceiver_mode == TRANSCEIVER_MODE_RX)
-			? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
-			&usb_td_bulk[0]
-		);
-	
-		// Wait until buffer 1 is transmitted/received.
-		while( usb_bulk_buffer_offset >= 16384 );
-
-		// Set up IN transfer of buffer 1.
-		usb_endpoint_schedule_no_int(
-			(transceiver_mode == TRANSCEIVER_MODE_RX)
-			? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
-			&usb_td_bulk[1]
-		);
+		// Sleep until an interrupt flags a streaming event. With PRIMASK
+		// set there is no window between the test and WFI, the pending
+		// interrupt still wakes the core and runs after cpsie.
+		__asm__("cpsid i");
+		if( !usb_bulk_event ) {
+			__asm__("wfi");
+		}
+		usb_bulk_event = false;
+		__asm__("cpsie i");
+
+		while( decimate_service() || usb_bulk_service() );
 	}
 	
 	return 0;
@@ -0,0 +1,36 @@
+# - Try to find the single precision FFTW library
+# Once done this defines
+#
+#  FFTW3F_FOUND - system has fftw3f
+#  FFTW3F_INCLUDE_DIR - the fftw3 include directory
+#  FFTW3F_LIBRARIES - Link these to use fftw3f
+
+# Redistribution and use is allowed according to the terms of the BSD license.
+# For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+
+
+if (FFTW3F_INCLUDE_DIR AND FFTW3F_LIBRARIES)
+
+  # in cache already
+  set(FFTW3F_FOUND TRUE)
+
+else (FFTW3F_INCLUDE_DIR AND FFTW3F_LIBRARIES)
+  IF (NOT WIN32)
+    # use pkg-config to get the directories and then use these values
+    # in the FIND_PATH() and FIND_LIBRARY() calls
+    find_package(PkgConfig)
+    pkg_check_modules(PC_FFTW3F fftw3f)
+  ENDIF(NOT WIN32)
+
+  FIND_PATH(FFTW3F_INCLUDE_DIR fftw3.h
+    PATHS ${PC_FFTW3F_INCLUDEDIR} ${PC_FFTW3F_INCLUDE_DIRS})
+
+  FIND_LIBRARY(FFTW3F_LIBRARIES NAMES fftw3f libfftw3f-3
+    PATHS ${PC_FFTW3F_LIBDIR} ${PC_FFTW3F_LIBRARY_DIRS})
+
+  include(FindPackageHandleStandardArgs)
+  FIND_PACKAGE_HANDLE_STANDARD_ARGS(FFTW3F DEFAULT_MSG FFTW3F_LIBRARIES FFTW3F_INCLUDE_DIR)
+
+  MARK_AS_ADVANCED(FFTW3F_INCLUDE_DIR FFTW3F_LIBRARIES)
+
+endif (FFTW3F_INCLUDE_DIR AND FFTW3F_LIBRARIES)
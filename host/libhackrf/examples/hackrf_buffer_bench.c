@@ -0,0 +1,220 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Receive for a few seconds with each transfer buffer allocation mode and
+ * report process CPU time per MiB received. The callback reads every byte
+ * so buffer placement (TLB, page faults) shows up in the figures.
+ */
+
+#include <hackrf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define FREQ_ONE_MHZ (1000000ull)
+
+#define DEFAULT_SAMPLE_RATE_HZ (20000000) /* 20MHz */
+#define DEFAULT_DURATION_S (5)
+
+static volatile uint64_t byte_count = 0;
+static volatile uint32_t checksum = 0;
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static double rusage_cpu_s(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+		+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+int rx_callback(hackrf_transfer* transfer) {
+	uint32_t sum = 0;
+	int i;
+
+	for(i=0; i<transfer->valid_length; i++)
+	{
+		sum += transfer->buffer[i];
+	}
+	checksum += sum;
+	byte_count += transfer->valid_length;
+	return 0;
+}
+
+static int bench_mode(const enum hackrf_buffer_alloc buffer_alloc,
+					const uint32_t sample_rate_hz,
+					const uint32_t duration_s,
+					const uint32_t cpu_mhz)
+{
+	hackrf_device* device = NULL;
+	enum hackrf_buffer_alloc buffer_alloc_used;
+	double cpu_start_s;
+	double cpu_s;
+	double mib;
+	int result;
+
+	/* Reopen for each mode, streaming state is per open */
+	result = hackrf_open(&device);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return result;
+	}
+
+	result = hackrf_sample_rate_set(device, sample_rate_hz);
+	if( result == HACKRF_SUCCESS ) {
+		result = hackrf_set_buffer_alloc(device, buffer_alloc);
+	}
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf setup failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_close(device);
+		return result;
+	}
+
+	byte_count = 0;
+	cpu_start_s = rusage_cpu_s();
+	result = hackrf_start_rx(device, rx_callback, NULL);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_start_rx() failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_close(device);
+		return result;
+	}
+
+	sleep(duration_s);
+
+	hackrf_stop_rx(device);
+	cpu_s = rusage_cpu_s() - cpu_start_s;
+	mib = byte_count / (1024.0 * 1024.0);
+
+	if( hackrf_get_buffer_alloc(device, &buffer_alloc_used) != HACKRF_SUCCESS ) {
+		buffer_alloc_used = buffer_alloc;
+	}
+
+	printf("%-22s %-22s %10.1f %10.1f %12.1f",
+		hackrf_buffer_alloc_name(buffer_alloc),
+		hackrf_buffer_alloc_name(buffer_alloc_used),
+		mib, cpu_s * 1e3,
+		(mib > 0.0) ? (cpu_s * 1e6 / mib) : 0.0);
+	if( cpu_mhz != 0 ) {
+		printf(" %14.0f", (mib > 0.0) ? (cpu_s * cpu_mhz * 1e6 / mib) : 0.0);
+	}
+	printf("\n");
+
+	hackrf_close(device);
+	return HACKRF_SUCCESS;
+}
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\t[-s sample_rate_hz] # Sample rate in Hz (default %lluMHz).\n", DEFAULT_SAMPLE_RATE_HZ/FREQ_ONE_MHZ);
+	printf("\t[-d duration_s] # Seconds per mode (default %d).\n", DEFAULT_DURATION_S);
+	printf("\t[-a buffer_alloc] # Only this mode, 0=malloc 1=aligned 2=locked 3=hugepage 4=usbfs.\n");
+	printf("\t[-m cpu_mhz] # Nominal CPU clock to report cycles per MiB.\n");
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	int result;
+	uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+	uint32_t duration_s = DEFAULT_DURATION_S;
+	uint32_t cpu_mhz = 0;
+	uint32_t buffer_alloc;
+	bool single_mode = false;
+	int mode;
+
+	while( (opt = getopt(argc, argv, "s:d:a:m:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'd':
+			result = parse_u32(optarg, &duration_s);
+			break;
+
+		case 'a':
+			single_mode = true;
+			result = parse_u32(optarg, &buffer_alloc);
+			if( (result == HACKRF_SUCCESS) && (buffer_alloc > HACKRF_BUFFER_ALLOC_DEV_MEM) ) {
+				result = HACKRF_ERROR_INVALID_PARAM;
+			}
+			break;
+
+		case 'm':
+			result = parse_u32(optarg, &cpu_mhz);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	result = hackrf_init();
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-22s %-22s %10s %10s %12s", "requested", "used", "MiB", "cpu_ms", "cpu_us/MiB");
+	if( cpu_mhz != 0 ) {
+		printf(" %14s", "cycles/MiB");
+	}
+	printf("\n");
+
+	for(mode=HACKRF_BUFFER_ALLOC_MALLOC; mode<=HACKRF_BUFFER_ALLOC_DEV_MEM; mode++)
+	{
+		if( single_mode && (mode != (int)buffer_alloc) ) {
+			continue;
+		}
+		result = bench_mode((enum hackrf_buffer_alloc)mode, sample_rate_hz, duration_s, cpu_mhz);
+		if( result != HACKRF_SUCCESS ) {
+			break;
+		}
+	}
+
+	hackrf_exit();
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
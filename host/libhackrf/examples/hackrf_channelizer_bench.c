@@ -0,0 +1,363 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Split random cs8 samples into all channels with the polyphase channelizer
+ * and with the naive approach, one mixer, low pass filter and decimator per
+ * channel using the same prototype filter. Checks that both give the same
+ * channels, then reports input million samples per second of wall time for
+ * the naive approach and for the channelizer with 1, 2, 4 ... threads. No
+ * device needed. 20Msps real time needs 20 here.
+ */
+
+#include <hackrf.h>
+#include <hackrf_channelizer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define DEFAULT_CHANNELS (64)
+#define DEFAULT_COUNT (131072) /* I/Q samples, one default transfer */
+#define DEFAULT_DURATION_S (2)
+#define CHECK_BLOCKS (4)
+
+typedef struct {
+	float* samples; /* Captured output of one channel */
+	uint32_t count;
+	uint32_t capacity;
+} capture_t;
+
+static uint32_t channels = DEFAULT_CHANNELS;
+static uint32_t decimation = 0;
+static uint32_t taps_per_channel = HACKRF_CHANNELIZER_TAPS_PER_CHANNEL_DEFAULT;
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static double wall_s(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec * 1e-6;
+}
+
+static int capture_cb(const hackrf_channel_block* block)
+{
+	capture_t* capture = (capture_t*)block->ctx;
+	if( capture->count + block->count > capture->capacity ) {
+		return -1;
+	}
+	memcpy(&capture->samples[capture->count * 2], block->samples, block->count * 2 * sizeof(float));
+	capture->count += block->count;
+	return 0;
+}
+
+/* Stands in for a demodulator: reads every sample */
+static int power_cb(const hackrf_channel_block* block)
+{
+	float* power = (float*)block->ctx;
+	float sum = 0.0f;
+	uint32_t i;
+	for(i=0; i<block->count*2; i++) {
+		sum += block->samples[i] * block->samples[i];
+	}
+	*power += sum;
+	return 0;
+}
+
+/* Channel c of x[0 .. count), zero before. Outputs at n = D - 1, 2D - 1, ...
+ * like the channelizer. Returns the output count. */
+static uint32_t naive_channel(const float* x, const uint32_t count, const float* h,
+							const uint32_t channel, float* lo, float* mixed, float* out)
+{
+	const uint32_t taps = channels * taps_per_channel;
+	const double pi = 3.14159265358979323846;
+	uint32_t steps = 0;
+	uint32_t n;
+	uint32_t j;
+	uint32_t phase;
+	double angle;
+	float re;
+	float im;
+
+	/* e^(-j2pi channel n / M) repeats every M samples */
+	for(n=0; n<channels; n++) {
+		angle = -2.0 * pi * (((uint64_t)channel * n) % channels) / channels;
+		lo[n*2] = (float)cos(angle);
+		lo[n*2+1] = (float)sin(angle);
+	}
+	for(n=0, phase=0; n<count; n++) {
+		mixed[n*2] = x[n*2] * lo[phase*2] - x[n*2+1] * lo[phase*2+1];
+		mixed[n*2+1] = x[n*2] * lo[phase*2+1] + x[n*2+1] * lo[phase*2];
+		if( ++phase == channels ) {
+			phase = 0;
+		}
+	}
+
+	for(n=decimation-1; n<count; n+=decimation) {
+		re = 0.0f;
+		im = 0.0f;
+		for(j=0; (j<taps) && (j<=n); j++) {
+			re += h[j] * mixed[(n-j)*2];
+			im += h[j] * mixed[(n-j)*2+1];
+		}
+		out[steps*2] = re;
+		out[steps*2+1] = im;
+		steps++;
+	}
+	return steps;
+}
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\t[-m channels] # FFT size (default %d).\n", DEFAULT_CHANNELS);
+	printf("\t[-D decimation] # Divides channels, default channels (critically sampled).\n");
+	printf("\t[-P taps_per_channel] # Prototype filter length / channels (default %d).\n",
+		HACKRF_CHANNELIZER_TAPS_PER_CHANNEL_DEFAULT);
+	printf("\t[-t threads] # Most threads to try (default online CPUs).\n");
+	printf("\t[-n count] # I/Q samples per block (default %d).\n", DEFAULT_COUNT);
+	printf("\t[-d duration_s] # Seconds per measurement (default %d).\n", DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	int result;
+	uint32_t max_threads = 0;
+	uint32_t count = DEFAULT_COUNT;
+	uint32_t duration_s = DEFAULT_DURATION_S;
+	hackrf_channelizer_params params;
+	hackrf_channelizer* channelizer;
+	hackrf_transfer transfer;
+	capture_t* capture;
+	float* power;
+	int8_t* in_cs8;
+	float* in_cf32;
+	float* h;
+	float* lo;
+	float* mixed;
+	float* naive_out;
+	double start_s;
+	double elapsed_s;
+	double naive_msps;
+	double msps;
+	double error;
+	double max_error;
+	uint64_t samples;
+	uint32_t total;
+	uint32_t steps;
+	uint32_t threads;
+	uint32_t c;
+	uint32_t i;
+
+	while( (opt = getopt(argc, argv, "m:D:P:t:n:d:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'm':
+			result = parse_u32(optarg, &channels);
+			break;
+
+		case 'D':
+			result = parse_u32(optarg, &decimation);
+			break;
+
+		case 'P':
+			result = parse_u32(optarg, &taps_per_channel);
+			if( (result == HACKRF_SUCCESS) && (taps_per_channel == 0) ) {
+				result = HACKRF_ERROR_INVALID_PARAM;
+			}
+			break;
+
+		case 't':
+			result = parse_u32(optarg, &max_threads);
+			break;
+
+		case 'n':
+			result = parse_u32(optarg, &count);
+			if( (result == HACKRF_SUCCESS) && (count == 0) ) {
+				result = HACKRF_ERROR_INVALID_PARAM;
+			}
+			break;
+
+		case 'd':
+			result = parse_u32(optarg, &duration_s);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( decimation == 0 ) {
+		decimation = channels;
+	}
+	if( max_threads == 0 ) {
+		max_threads = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if( max_threads > HACKRF_CHANNELIZER_THREADS_MAX ) {
+		max_threads = HACKRF_CHANNELIZER_THREADS_MAX;
+	}
+
+	params.channels = channels;
+	params.decimation = decimation;
+	params.taps_per_channel = taps_per_channel;
+	params.threads = max_threads;
+	result = hackrf_channelizer_create(&params, &channelizer);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_channelizer_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	total = count * CHECK_BLOCKS;
+	in_cs8 = (int8_t*)malloc(total * 2);
+	in_cf32 = (float*)malloc(total * 2 * sizeof(float));
+	h = (float*)malloc(channels * taps_per_channel * sizeof(float));
+	lo = (float*)malloc(channels * 2 * sizeof(float));
+	mixed = (float*)malloc(total * 2 * sizeof(float));
+	naive_out = (float*)malloc((total / decimation + 1) * 2 * sizeof(float));
+	capture = (capture_t*)calloc(channels, sizeof(capture_t));
+	power = (float*)calloc(channels, sizeof(float));
+	if( (in_cs8 == NULL) || (in_cf32 == NULL) || (h == NULL) || (lo == NULL) || (mixed == NULL) ||
+		(naive_out == NULL) || (capture == NULL) || (power == NULL) ) {
+		printf("malloc() failed\n");
+		return EXIT_FAILURE;
+	}
+
+	srand(1);
+	for(i=0; i<total*2; i++) {
+		in_cs8[i] = (int8_t)rand();
+		in_cf32[i] = in_cs8[i] / 128.0f;
+	}
+	hackrf_channelizer_prototype(channels, taps_per_channel, h);
+
+	memset(&transfer, 0, sizeof(transfer));
+	transfer.buffer_length = count * 2;
+	transfer.valid_length = count * 2;
+
+	/* Check: same input in CHECK_BLOCKS blocks, all channels, most threads */
+	for(c=0; c<channels; c++) {
+		capture[c].capacity = total / decimation + 1;
+		capture[c].samples = (float*)malloc(capture[c].capacity * 2 * sizeof(float));
+		if( capture[c].samples == NULL ) {
+			printf("malloc() failed\n");
+			return EXIT_FAILURE;
+		}
+		hackrf_channelizer_set_callback(channelizer, c, capture_cb, &capture[c]);
+	}
+	for(i=0; i<CHECK_BLOCKS; i++) {
+		transfer.buffer = (uint8_t*)&in_cs8[i * count * 2];
+		result = hackrf_channelizer_process(channelizer, &transfer);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_channelizer_process() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	}
+
+	max_error = 0.0;
+	start_s = wall_s();
+	for(c=0; c<channels; c++) {
+		steps = naive_channel(in_cf32, total, h, c, lo, mixed, naive_out);
+		if( steps != capture[c].count ) {
+			printf("channel %u: %u samples, naive %u\n", c, capture[c].count, steps);
+			return EXIT_FAILURE;
+		}
+		for(i=0; i<steps*2; i++) {
+			error = fabs(capture[c].samples[i] - naive_out[i]);
+			if( error > max_error ) {
+				max_error = error;
+			}
+		}
+	}
+	elapsed_s = wall_s() - start_s;
+	naive_msps = total / elapsed_s / 1e6;
+	hackrf_channelizer_destroy(channelizer);
+
+	printf("%u channels, decimation %u, %u taps, %u samples per block\n",
+		channels, decimation, channels * taps_per_channel, count);
+	printf("max difference from naive %.3g (full scale 1), %s\n", max_error,
+		(max_error < 1e-4) ? "ok" : "MISMATCH");
+	printf("%-16s %12s %10s\n", "method", "input Msps", "vs naive");
+	printf("%-16s %12.2f %10.1f\n", "naive", naive_msps, 1.0);
+
+	for(threads=1; threads<=max_threads; threads*=2)
+	{
+		params.threads = threads;
+		result = hackrf_channelizer_create(&params, &channelizer);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_channelizer_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+		for(c=0; c<channels; c++) {
+			hackrf_channelizer_set_callback(channelizer, c, power_cb, &power[c]);
+		}
+
+		samples = 0;
+		start_s = wall_s();
+		do {
+			for(i=0; i<CHECK_BLOCKS; i++) {
+				transfer.buffer = (uint8_t*)&in_cs8[i * count * 2];
+				hackrf_channelizer_process(channelizer, &transfer);
+			}
+			samples += total;
+			elapsed_s = wall_s() - start_s;
+		} while( elapsed_s < duration_s );
+		hackrf_channelizer_destroy(channelizer);
+
+		msps = samples / elapsed_s / 1e6;
+		printf("pfb %2u thread%s  %12.2f %10.1f\n", threads, (threads == 1) ? " " : "s",
+			msps, msps / naive_msps);
+	}
+
+	for(c=0; c<channels; c++) {
+		free(capture[c].samples);
+	}
+	free(capture);
+	free(power);
+	free(in_cs8);
+	free(in_cf32);
+	free(h);
+	free(lo);
+	free(mixed);
+	free(naive_out);
+	return EXIT_SUCCESS;
+}
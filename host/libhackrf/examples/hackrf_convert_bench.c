@@ -0,0 +1,254 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Run each sample format conversion with each kernel this CPU supports and
+ * report million samples per second of CPU time, i.e. per core. No device
+ * needed. Outputs are also checked against the scalar kernel.
+ */
+
+#include <hackrf.h>
+#include <hackrf_convert.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define DEFAULT_COUNT (131072) /* I/Q samples, one default transfer */
+#define DEFAULT_DURATION_S (1)
+
+/* Conversions, in table order */
+enum {
+	CONV_CS8_TO_CF32 = 0,
+	CONV_CS8_TO_PLANAR_F32,
+	CONV_CS8_TO_CS16,
+	CONV_CF32_TO_CS8,
+	CONV_CS16_TO_CS8,
+	CONV_CS8_IQ_CORRECT,
+	CONV_CS8_MOMENTS,
+	CONV_COUNT,
+};
+
+static const char* const conv_names[CONV_COUNT] = {
+	"cs8 -> cf32",
+	"cs8 -> planar f32",
+	"cs8 -> cs16",
+	"cf32 -> cs8",
+	"cs16 -> cs8",
+	"cs8 IQ correct",
+	"cs8 moments",
+};
+
+static int8_t* in_cs8;
+static float* in_cf32;
+static int16_t* in_cs16;
+static void* out;
+static void* out_ref;
+static float* out_q; /* Planar Q */
+static float* out_q_ref;
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static double rusage_cpu_s(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+		+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+/* Returns output size in bytes */
+static size_t convert(const int conv, const uint32_t count, void* dst, float* dst_q)
+{
+	const float dc_f32[2] = { 0.25f, -0.5f };
+	const int16_t dc_s16[2] = { 64, -128 };
+	const hackrf_iq_matrix matrix = { 1.0f, 0.0f, -0.07f, 1.09f, -0.6f, 2.4f };
+	hackrf_iq_moments moments;
+
+	switch( conv )
+	{
+	case CONV_CS8_TO_CF32:
+		hackrf_convert_cs8_to_cf32(in_cs8, (float*)dst, count, 1.0f / 128, dc_f32);
+		return count * 2 * sizeof(float);
+
+	case CONV_CS8_TO_PLANAR_F32:
+		hackrf_convert_cs8_to_planar_f32(in_cs8, (float*)dst, dst_q, count, 1.0f / 128, dc_f32);
+		return count * sizeof(float);
+
+	case CONV_CS8_TO_CS16:
+		hackrf_convert_cs8_to_cs16(in_cs8, (int16_t*)dst, count, dc_s16);
+		return count * 2 * sizeof(int16_t);
+
+	case CONV_CF32_TO_CS8:
+		hackrf_convert_cf32_to_cs8(in_cf32, (int8_t*)dst, count, 127.0f);
+		return count * 2;
+
+	case CONV_CS16_TO_CS8:
+		hackrf_convert_cs16_to_cs8(in_cs16, (int8_t*)dst, count);
+		return count * 2;
+
+	case CONV_CS8_IQ_CORRECT:
+		hackrf_convert_cs8_iq_correct(in_cs8, (int8_t*)dst, count, &matrix);
+		return count * 2;
+
+	default:
+		memset(&moments, 0, sizeof(moments));
+		hackrf_convert_cs8_moments(in_cs8, count, &moments);
+		memcpy(dst, &moments, sizeof(moments));
+		return sizeof(moments);
+	}
+}
+
+static void bench(const int conv, const enum hackrf_convert_kernel kernel,
+				const uint32_t count, const uint32_t duration_s)
+{
+	uint64_t samples = 0;
+	double cpu_start_s;
+	double cpu_s;
+	size_t length;
+	bool match;
+	int i;
+
+	hackrf_convert_set_kernel(HACKRF_CONVERT_SCALAR);
+	convert(conv, count, out_ref, out_q_ref);
+	hackrf_convert_set_kernel(kernel);
+	length = convert(conv, count, out, out_q);
+	match = (memcmp(out, out_ref, length) == 0);
+	if( conv == CONV_CS8_TO_PLANAR_F32 ) {
+		match = match && (memcmp(out_q, out_q_ref, length) == 0);
+	}
+
+	cpu_start_s = rusage_cpu_s();
+	do {
+		for(i=0; i<16; i++) {
+			convert(conv, count, out, out_q);
+		}
+		samples += 16 * (uint64_t)count;
+		cpu_s = rusage_cpu_s() - cpu_start_s;
+	} while( cpu_s < duration_s );
+
+	printf("%-18s %-8s %12.1f %8s\n",
+		conv_names[conv], hackrf_convert_kernel_name(kernel),
+		samples / cpu_s / 1e6, match ? "ok" : "MISMATCH");
+}
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\t[-n count] # I/Q samples per call (default %d).\n", DEFAULT_COUNT);
+	printf("\t[-d duration_s] # CPU seconds per conversion and kernel (default %d).\n", DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	int result;
+	uint32_t count = DEFAULT_COUNT;
+	uint32_t duration_s = DEFAULT_DURATION_S;
+	enum hackrf_convert_kernel best;
+	int kernel;
+	int conv;
+	uint32_t i;
+
+	while( (opt = getopt(argc, argv, "n:d:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'n':
+			result = parse_u32(optarg, &count);
+			if( (result == HACKRF_SUCCESS) && (count == 0) ) {
+				result = HACKRF_ERROR_INVALID_PARAM;
+			}
+			break;
+
+		case 'd':
+			result = parse_u32(optarg, &duration_s);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	in_cs8 = (int8_t*)malloc(count * 2);
+	in_cf32 = (float*)malloc(count * 2 * sizeof(float));
+	in_cs16 = (int16_t*)malloc(count * 2 * sizeof(int16_t));
+	out = malloc(count * 2 * sizeof(float));
+	out_ref = malloc(count * 2 * sizeof(float));
+	out_q = (float*)malloc(count * sizeof(float));
+	out_q_ref = (float*)malloc(count * sizeof(float));
+	if( (in_cs8 == NULL) || (in_cf32 == NULL) || (in_cs16 == NULL) || (out == NULL) ||
+		(out_ref == NULL) || (out_q == NULL) || (out_q_ref == NULL) ) {
+		printf("malloc() failed\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Full range, including values that saturate */
+	srand(1);
+	for(i=0; i<count*2; i++) {
+		in_cs8[i] = (int8_t)rand();
+		in_cf32[i] = (rand() / (float)RAND_MAX) * 2.5f - 1.25f;
+		in_cs16[i] = (int16_t)rand();
+	}
+
+	best = hackrf_convert_get_kernel();
+	printf("%u samples per call, default kernel %s\n", count, hackrf_convert_kernel_name(best));
+	printf("%-18s %-8s %12s %8s\n", "conversion", "kernel", "Msps/core", "check");
+
+	for(conv=0; conv<CONV_COUNT; conv++)
+	{
+		for(kernel=HACKRF_CONVERT_SCALAR; kernel<=HACKRF_CONVERT_NEON; kernel++)
+		{
+			if( hackrf_convert_set_kernel((enum hackrf_convert_kernel)kernel) != HACKRF_SUCCESS ) {
+				continue;
+			}
+			bench(conv, (enum hackrf_convert_kernel)kernel, count, duration_s);
+		}
+	}
+
+	hackrf_convert_set_kernel(best);
+	free(in_cs8);
+	free(in_cf32);
+	free(in_cs16);
+	free(out);
+	free(out_ref);
+	free(out_q);
+	free(out_q_ref);
+	return EXIT_SUCCESS;
+}
@@ -83,13 +83,15 @@ int dump_register(hackrf_device* device, const uint16_t register_number) {
 
 int dump_registers(hackrf_device* device) {
 	uint16_t register_number;
-	int result = HACKRF_SUCCESS;
+	uint16_t register_values[HACKRF_MAX2837_NUM_REGS];
+	int result = hackrf_max2837_read_regs(device, 0, HACKRF_MAX2837_NUM_REGS, register_values);
 	
-	for(register_number=0; register_number<32; register_number++) {
-		result = dump_register(device, register_number);
-		if( result != HACKRF_SUCCESS ) {
-			break;
+	if( result == HACKRF_SUCCESS ) {
+		for(register_number=0; register_number<HACKRF_MAX2837_NUM_REGS; register_number++) {
+			printf("[%2d] -> 0x%03x\n", register_number, register_values[register_number]);
 		}
+	} else {
+		printf("hackrf_max2837_read_regs() failed: %s (%d)\n", hackrf_error_name(result), result);
 	}
 	
 	return result;
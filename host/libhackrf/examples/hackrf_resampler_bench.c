@@ -0,0 +1,211 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Run rate conversions from the HackRF sample rates to common ones with
+ * each kernel this CPU supports: cs8 to float conversion, optional
+ * half-band stages and the rational resampler, all in place in one buffer
+ * like an RX callback would. Reports input million samples per second of
+ * CPU time, i.e. per core, and how many times real time that is. No device
+ * needed.
+ */
+
+#include <hackrf.h>
+#include <hackrf_convert.h>
+#include <hackrf_resampler.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define DEFAULT_COUNT (131072) /* I/Q samples, one default transfer */
+#define DEFAULT_DURATION_S (1)
+
+typedef struct {
+	const char* name;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t halfband_stages;
+} conversion_t;
+
+static const conversion_t conversions[] = {
+	{ "20M -> 2.4M direct", 20000000, 2400000, 0 },
+	{ "20M -> 2.4M hb2", 20000000, 2400000, 2 },
+	{ "10M -> 2.4M hb1", 10000000, 2400000, 1 },
+	{ "10M -> 48k direct", 10000000, 48000, 0 },
+	{ "10M -> 48k hb5", 10000000, 48000, 5 },
+	{ "20M -> 48k hb6", 20000000, 48000, 6 },
+};
+
+#define CONVERSION_COUNT (sizeof(conversions) / sizeof(conversions[0]))
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static double rusage_cpu_s(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+		+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+static int bench(const conversion_t* conversion, const enum hackrf_convert_kernel kernel,
+				const int8_t* in, float* buffer, const uint32_t count, const uint32_t duration_s)
+{
+	hackrf_halfband* halfband = NULL;
+	hackrf_resampler* resampler;
+	uint32_t resampler_in_rate = conversion->in_rate >> conversion->halfband_stages;
+	uint64_t samples = 0;
+	uint64_t out_samples = 0;
+	double cpu_start_s;
+	double cpu_s;
+	double msps;
+	uint32_t n;
+	int result;
+
+	if( conversion->halfband_stages > 0 ) {
+		result = hackrf_halfband_create(conversion->halfband_stages, &halfband);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_halfband_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return result;
+		}
+	}
+	result = hackrf_resampler_create(conversion->out_rate, resampler_in_rate, 0, &resampler);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_resampler_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_halfband_destroy(halfband);
+		return result;
+	}
+
+	cpu_start_s = rusage_cpu_s();
+	do {
+		hackrf_convert_cs8_to_cf32(in, buffer, count, 1.0f / 128, NULL);
+		n = count;
+		if( halfband != NULL ) {
+			hackrf_halfband_process(halfband, buffer, n, buffer, &n);
+		}
+		hackrf_resampler_process(resampler, buffer, n, buffer, &n);
+		samples += count;
+		out_samples += n;
+		cpu_s = rusage_cpu_s() - cpu_start_s;
+	} while( cpu_s < duration_s );
+
+	msps = samples / cpu_s / 1e6;
+	printf("%-20s %-8s %9u %12.1f %10.1f %10.4f\n",
+		conversion->name, hackrf_convert_kernel_name(kernel), hackrf_resampler_taps_per_phase(resampler),
+		msps, msps * 1e6 / conversion->in_rate, (double)out_samples / samples);
+
+	hackrf_resampler_destroy(resampler);
+	hackrf_halfband_destroy(halfband);
+	return HACKRF_SUCCESS;
+}
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\t[-n count] # I/Q samples per block (default %d).\n", DEFAULT_COUNT);
+	printf("\t[-d duration_s] # CPU seconds per conversion and kernel (default %d).\n", DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	int result;
+	uint32_t count = DEFAULT_COUNT;
+	uint32_t duration_s = DEFAULT_DURATION_S;
+	enum hackrf_convert_kernel best;
+	int8_t* in;
+	float* buffer;
+	int kernel;
+	uint32_t conv;
+	uint32_t i;
+
+	while( (opt = getopt(argc, argv, "n:d:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'n':
+			result = parse_u32(optarg, &count);
+			if( (result == HACKRF_SUCCESS) && (count == 0) ) {
+				result = HACKRF_ERROR_INVALID_PARAM;
+			}
+			break;
+
+		case 'd':
+			result = parse_u32(optarg, &duration_s);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	in = (int8_t*)malloc(count * 2);
+	buffer = (float*)malloc(count * 2 * sizeof(float));
+	if( (in == NULL) || (buffer == NULL) ) {
+		printf("malloc() failed\n");
+		return EXIT_FAILURE;
+	}
+	srand(1);
+	for(i=0; i<count*2; i++) {
+		in[i] = (int8_t)rand();
+	}
+
+	best = hackrf_convert_get_kernel();
+	printf("%u samples per block, default kernel %s\n", count, hackrf_convert_kernel_name(best));
+	printf("%-20s %-8s %9s %12s %10s %10s\n", "conversion", "kernel", "taps", "Msps/core", "realtime", "out/in");
+
+	for(conv=0; conv<CONVERSION_COUNT; conv++)
+	{
+		for(kernel=HACKRF_CONVERT_SCALAR; kernel<=HACKRF_CONVERT_NEON; kernel++)
+		{
+			if( hackrf_convert_set_kernel((enum hackrf_convert_kernel)kernel) != HACKRF_SUCCESS ) {
+				continue;
+			}
+			if( bench(&conversions[conv], (enum hackrf_convert_kernel)kernel, in, buffer, count, duration_s) != HACKRF_SUCCESS ) {
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	hackrf_convert_set_kernel(best);
+	free(in);
+	free(buffer);
+	return EXIT_SUCCESS;
+}
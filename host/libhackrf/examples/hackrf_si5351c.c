@@ -71,13 +71,15 @@ int dump_register(hackrf_device* device, const uint16_t register_number) {
 
 int dump_registers(hackrf_device* device) {
 	uint16_t register_number;
-	int result = HACKRF_SUCCESS;
+	uint16_t register_values[HACKRF_SI5351C_NUM_REGS];
+	int result = hackrf_si5351c_read_regs(device, 0, HACKRF_SI5351C_NUM_REGS, register_values);
 	
-	for(register_number=0; register_number<256; register_number++) {
-		result = dump_register(device, register_number);
-		if( result != HACKRF_SUCCESS ) {
-			break;
+	if( result == HACKRF_SUCCESS ) {
+		for(register_number=0; register_number<HACKRF_SI5351C_NUM_REGS; register_number++) {
+			printf("[%3d] -> 0x%02x\n", register_number, register_values[register_number]);
 		}
+	} else {
+		printf("hackrf_si5351c_read_regs() failed: %s (%d)\n", hackrf_error_name(result), result);
 	}
 	
 	return result;
@@ -103,17 +105,13 @@ int write_register(
 #define REGISTER_INVALID 32767
 
 int dump_multisynth_config(hackrf_device* device, const uint_fast8_t ms_number) {
-	uint_fast8_t i;
 	uint_fast8_t reg_base;
 	uint16_t parameters[8];
 	
 	reg_base = 42 + (ms_number * 8);
-	for(i=0; i<8; i++) {
-		uint_fast8_t reg_number = reg_base + i;
-		int result = hackrf_si5351c_read(device, reg_number, &parameters[i]);
-		if( result != HACKRF_SUCCESS ) {
-			return result;
-		}
+	int result = hackrf_si5351c_read_regs(device, reg_base, 8, parameters);
+	if( result != HACKRF_SUCCESS ) {
+		return result;
 	}
 	
 	const uint32_t p1 =
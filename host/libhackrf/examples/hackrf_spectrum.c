@@ -0,0 +1,437 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Averaged power spectrum of the whole RX band at one frequency.
+ *
+ * Every block from the RX callback goes to hackrf_spectrum, which averages
+ * overlapping windowed transforms into frames at about the requested rate.
+ * Each frame is a CSV line like hackrf_sweep:
+ *
+ *   date, time, hz_low, hz_high, hz_bin_width, num_samples, dB, dB, ...
+ *
+ * or with -B a 40 byte header in native byte order followed by fft_size
+ * float dB values:
+ *
+ *   uint32 magic "HRSP", uint32 fft_size, uint64 freq_hz,
+ *   uint32 sample_rate_hz, uint32 averages, uint64 frame_index,
+ *   uint64 sample_count
+ *
+ * Power is in dB relative to a full scale tone, lowest frequency first.
+ */
+
+#include <hackrf.h>
+#include <hackrf_fft.h>
+#include <hackrf_spectrum.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <sys/time.h>
+#include <signal.h>
+
+#if defined _WIN32
+	#define sleep(a) Sleep( (a*1000) )
+#endif
+
+#define FREQ_ONE_MHZ (1000000ull)
+
+#define DEFAULT_FREQ_HZ (900000000ull) /* 900MHz */
+#define FREQ_MIN_HZ	(30000000ull) /* 30MHz */
+#define FREQ_MAX_HZ	(6000000000ull) /* 6000MHz */
+
+#define DEFAULT_SAMPLE_RATE_HZ (10000000) /* 10MHz */
+#define DEFAULT_FFT_SIZE (1024)
+#define DEFAULT_WINDOW (HACKRF_SPECTRUM_WINDOW_HANN)
+#define DEFAULT_FRAME_RATE (10)
+#define DEFAULT_THREADS (2)
+
+#define BINARY_MAGIC (0x50535248) /* "HRSP" little endian */
+
+typedef struct {
+	uint32_t magic;
+	uint32_t fft_size;
+	uint64_t freq_hz;
+	uint32_t sample_rate_hz;
+	uint32_t averages;
+	uint64_t frame_index;
+	uint64_t sample_count;
+} binary_header_t;
+
+volatile bool do_exit = false;
+
+FILE* fd = NULL;
+
+uint64_t freq_hz = DEFAULT_FREQ_HZ;
+uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+uint32_t fft_size = DEFAULT_FFT_SIZE;
+uint32_t window = DEFAULT_WINDOW;
+bool overlap_set = false;
+uint32_t overlap;
+uint32_t frame_rate = DEFAULT_FRAME_RATE;
+uint32_t threads = DEFAULT_THREADS;
+bool binary = false;
+uint32_t num_frames = 0; /* 0 = until Ctrl-C */
+
+bool amp = false;
+uint32_t amp_enable;
+
+const char* serial_number = NULL;
+
+hackrf_spectrum* spectrum = NULL;
+uint32_t averages;
+uint64_t frames_written = 0;
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_u64(char* s, uint64_t* const value) {
+	char* s_end = s;
+	const unsigned long long ull_value = strtoull(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = (uint64_t)ull_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static void frame_write_csv(const hackrf_spectrum_frame* frame) {
+	const double bin_width_hz = (double)sample_rate_hz / frame->bins;
+	const uint64_t hz_low = freq_hz - (sample_rate_hz / 2);
+	struct timeval time_now;
+	time_t seconds;
+	char date_time[32];
+	uint32_t i;
+
+	gettimeofday(&time_now, NULL);
+	seconds = time_now.tv_sec;
+	strftime(date_time, sizeof(date_time), "%Y-%m-%d, %H:%M:%S", localtime(&seconds));
+
+	fprintf(fd, "%s, %llu, %llu, %.2f, %u", date_time,
+		(unsigned long long)hz_low,
+		(unsigned long long)(hz_low + sample_rate_hz),
+		bin_width_hz, averages * frame->bins);
+	for(i=0; i<frame->bins; i++) {
+		fprintf(fd, ", %.2f", frame->power_db[i]);
+	}
+	fprintf(fd, "\n");
+}
+
+static void frame_write_binary(const hackrf_spectrum_frame* frame) {
+	binary_header_t header;
+
+	header.magic = BINARY_MAGIC;
+	header.fft_size = frame->bins;
+	header.freq_hz = freq_hz;
+	header.sample_rate_hz = sample_rate_hz;
+	header.averages = averages;
+	header.frame_index = frame->frame_index;
+	header.sample_count = frame->sample_count;
+	fwrite(&header, sizeof(header), 1, fd);
+	fwrite(frame->power_db, sizeof(float), frame->bins, fd);
+}
+
+int frame_callback(const hackrf_spectrum_frame* frame) {
+	if( binary ) {
+		frame_write_binary(frame);
+	} else {
+		frame_write_csv(frame);
+	}
+	frames_written++;
+
+	if( (num_frames != 0) && (frames_written >= num_frames) ) {
+		do_exit = true;
+		return -1;
+	}
+	return 0;
+}
+
+int rx_callback(hackrf_transfer* transfer) {
+	if( (fd == NULL) || (spectrum == NULL) ) {
+		return -1;
+	}
+	if( hackrf_spectrum_process(spectrum, transfer) != HACKRF_SUCCESS ) {
+		return -1;
+	}
+	return 0;
+}
+
+static void usage() {
+	uint32_t i;
+
+	printf("Usage:\n");
+	printf("\t[-d serial_number] # Serial number (or its last digits) of the board to use.\n");
+	printf("\t[-f freq_hz] # Center frequency in Hz between [%lluMHz, %lluMHz[ (default %lluMHz).\n",
+		FREQ_MIN_HZ/FREQ_ONE_MHZ, FREQ_MAX_HZ/FREQ_ONE_MHZ, DEFAULT_FREQ_HZ/FREQ_ONE_MHZ);
+	printf("\t[-s sample_rate_hz] # Set sample rate in Hz (default %uMHz).\n", DEFAULT_SAMPLE_RATE_HZ / 1000000);
+	printf("\t[-n fft_size] # Bins from %u to %u (default %u).\n",
+		HACKRF_SPECTRUM_FFT_SIZE_MIN, HACKRF_SPECTRUM_FFT_SIZE_MAX, DEFAULT_FFT_SIZE);
+	printf("\t[-w window] # Window (default %u):", DEFAULT_WINDOW);
+	for(i=HACKRF_SPECTRUM_WINDOW_RECTANGULAR; i<=HACKRF_SPECTRUM_WINDOW_FLAT_TOP; i++) {
+		printf(" %u %s%s", i, hackrf_spectrum_window_name((enum hackrf_spectrum_window)i),
+			(i < HACKRF_SPECTRUM_WINDOW_FLAT_TOP) ? "," : ".\n");
+	}
+	printf("\t[-O overlap] # Samples shared by consecutive transforms (default fft_size / 2).\n");
+	printf("\t[-F frame_rate] # Frames per second (default %u).\n", DEFAULT_FRAME_RATE);
+	printf("\t[-t threads] # Worker threads, 1 to %u (default %u).\n", HACKRF_SPECTRUM_THREADS_MAX, DEFAULT_THREADS);
+	printf("\t[-N num_frames] # Stop after this many frames (default is unlimited).\n");
+	printf("\t[-a set_amp] # Set Amp 1=Enable, 0=Disable.\n");
+	printf("\t[-B] # Write binary frames instead of CSV.\n");
+	printf("\t[-r filename] # Write to file (default stdout).\n");
+}
+
+static hackrf_device* device = NULL;
+
+void sigint_callback_handler(int signum)
+{
+	fprintf(stderr, "Caught signal %d\n", signum);
+	do_exit = true;
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	const char* path = NULL;
+	int result;
+	uint32_t baseband_filter_bw_hz;
+	hackrf_spectrum_params params;
+	uint32_t hop;
+
+	while( (opt = getopt(argc, argv, "d:f:s:n:w:O:F:t:N:a:Br:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'd':
+			serial_number = optarg;
+			break;
+
+		case 'f':
+			result = parse_u64(optarg, &freq_hz);
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'n':
+			result = parse_u32(optarg, &fft_size);
+			break;
+
+		case 'w':
+			result = parse_u32(optarg, &window);
+			break;
+
+		case 'O':
+			overlap_set = true;
+			result = parse_u32(optarg, &overlap);
+			break;
+
+		case 'F':
+			result = parse_u32(optarg, &frame_rate);
+			break;
+
+		case 't':
+			result = parse_u32(optarg, &threads);
+			break;
+
+		case 'N':
+			result = parse_u32(optarg, &num_frames);
+			break;
+
+		case 'a':
+			amp = true;
+			result = parse_u32(optarg, &amp_enable);
+			break;
+
+		case 'B':
+			binary = true;
+			break;
+
+		case 'r':
+			path = optarg;
+			break;
+
+		default:
+			printf("unknown argument '-%c %s'\n", opt, optarg);
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( (freq_hz >= FREQ_MAX_HZ) || (freq_hz < FREQ_MIN_HZ) ) {
+		printf("argument error: freq_hz shall be between [%llu, %llu[.\n", FREQ_MIN_HZ, FREQ_MAX_HZ);
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( (sample_rate_hz < HACKRF_SAMPLE_RATE_MIN_HZ) || (sample_rate_hz > HACKRF_SAMPLE_RATE_MAX_HZ) ) {
+		printf("argument error: sample_rate_hz must be within [%u, %u]\n",
+			HACKRF_SAMPLE_RATE_MIN_HZ, HACKRF_SAMPLE_RATE_MAX_HZ);
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( overlap_set == false ) {
+		overlap = fft_size / 2;
+	}
+	if( (frame_rate == 0) || (threads == 0) ) {
+		printf("argument error: frame_rate and threads must be at least 1\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	/* Whole transforms per frame, the rate is approximate */
+	hop = fft_size - overlap;
+	averages = 1;
+	if( (overlap < fft_size) && ((uint64_t)hop * frame_rate < sample_rate_hz) ) {
+		averages = (uint32_t)(((double)sample_rate_hz / ((double)hop * frame_rate)) + 0.5);
+	}
+
+	params.fft_size = fft_size;
+	params.window = (enum hackrf_spectrum_window)window;
+	params.overlap = overlap;
+	params.averages = averages;
+	params.threads = threads;
+	result = hackrf_spectrum_create(&params, frame_callback, NULL, &spectrum);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_spectrum_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+		printf("fft_size within [%u, %u], overlap below fft_size, window at most %u, threads at most %u\n",
+			HACKRF_SPECTRUM_FFT_SIZE_MIN, HACKRF_SPECTRUM_FFT_SIZE_MAX,
+			HACKRF_SPECTRUM_WINDOW_FLAT_TOP, HACKRF_SPECTRUM_THREADS_MAX);
+		usage();
+		return EXIT_FAILURE;
+	}
+	fprintf(stderr, "%u bins of %.2f Hz, %s window, ENBW %.3f bins, %u averages, %.2f frames/s, %s FFT\n",
+		fft_size, (double)sample_rate_hz / fft_size,
+		hackrf_spectrum_window_name(params.window), hackrf_spectrum_enbw(spectrum), averages,
+		(double)sample_rate_hz / ((double)averages * hop + overlap), hackrf_fft_backend_name());
+
+	if( path == NULL ) {
+		fd = stdout;
+	} else {
+		fd = fopen(path, binary ? "wb" : "w");
+		if( fd == NULL ) {
+			printf("Failed to open file: %s\n", path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	result = hackrf_init();
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_open_by_serial(serial_number, &device);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_open_by_serial() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGILL, &sigint_callback_handler);
+	signal(SIGFPE, &sigint_callback_handler);
+	signal(SIGSEGV, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+	signal(SIGABRT, &sigint_callback_handler);
+
+	result = hackrf_sample_rate_set(device, sample_rate_hz);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_sample_rate_set() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	baseband_filter_bw_hz = hackrf_compute_baseband_filter_bw((sample_rate_hz / 4) * 3);
+	result = hackrf_baseband_filter_bandwidth_set(device, baseband_filter_bw_hz);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_baseband_filter_bandwidth_set() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_set_freq(device, freq_hz);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_set_freq() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	if( amp ) {
+		result = hackrf_set_amp_enable(device, (uint8_t)amp_enable);
+		if( result != HACKRF_SUCCESS ) {
+			fprintf(stderr, "hackrf_set_amp_enable() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	}
+
+	result = hackrf_start_rx(device, rx_callback, NULL);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_start_rx() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stderr, "Stop with Ctrl-C\n");
+	while( (hackrf_is_streaming(device) == HACKRF_TRUE) &&
+			(do_exit == false) )
+	{
+		sleep(1);
+		fprintf(stderr, "%llu frames\n", (unsigned long long)frames_written);
+	}
+
+	result = hackrf_stop_rx(device);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_stop_rx() failed: %s (%d)\n", hackrf_error_name(result), result);
+	}
+
+	hackrf_close(device);
+	hackrf_exit();
+
+	hackrf_spectrum_destroy(spectrum);
+	spectrum = NULL;
+
+	if( (fd != NULL) && (fd != stdout) ) {
+		fclose(fd);
+	}
+	fd = NULL;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,497 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Wideband survey with the firmware sweep mode.
+ *
+ * The board tunes through the range by itself, each 16KiB block comes with
+ * the frequency it was captured at. Blocks of a step are averaged into one
+ * power spectrum, of which the middle step_hz is written as a CSV line:
+ *
+ *   date, time, hz_low, hz_high, hz_bin_width, num_samples, dB, dB, ...
+ *
+ * Power is in dB relative to a full scale tone. The DC bin is replaced by
+ * the mean of its neighbours.
+ */
+
+#include <hackrf.h>
+#include <hackrf_fft.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <sys/time.h>
+#include <signal.h>
+
+#if defined _WIN32
+	#define sleep(a) Sleep( (a*1000) )
+#endif
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846)
+#endif
+
+#define FREQ_ONE_MHZ (1000000ull)
+
+#define FREQ_MIN_MHZ (30)
+#define FREQ_MAX_MHZ (6000)
+
+#define DEFAULT_START_MHZ (2400)
+#define DEFAULT_STOP_MHZ (2500)
+#define DEFAULT_SAMPLE_RATE_HZ (20000000) /* 20MHz */
+#define DEFAULT_FFT_SIZE (256)
+#define DEFAULT_DWELL_BLOCKS (1)
+#define DEFAULT_SETTLE_BLOCKS (1)
+
+#define FFT_SIZE_MIN (16)
+/* At least one transform per block */
+#define FFT_SIZE_MAX (4096)
+
+/* Blocks in the largest transfer */
+#define SWEEP_BLOCKS_MAX (HACKRF_TRANSFER_BUFFER_SIZE_MAX / HACKRF_FRAME_BLOCK_SIZE)
+
+volatile bool do_exit = false;
+
+FILE* fd = NULL;
+
+uint32_t start_mhz = DEFAULT_START_MHZ;
+uint32_t stop_mhz = DEFAULT_STOP_MHZ;
+uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+uint32_t step_hz = 0; /* 0 = 3/4 of the sample rate */
+uint32_t fft_size = DEFAULT_FFT_SIZE;
+uint32_t dwell_blocks = DEFAULT_DWELL_BLOCKS;
+uint32_t settle_blocks = DEFAULT_SETTLE_BLOCKS;
+uint32_t num_sweeps = 0; /* 0 = until Ctrl-C */
+
+bool amp = false;
+uint32_t amp_enable;
+
+const char* serial_number = NULL;
+
+/* Bins written per step, centred on the tuned frequency */
+uint32_t out_bins;
+double bin_width_hz;
+
+hackrf_fft_plan* fft_plan = NULL;
+float* fft_in = NULL; /* Interleaved I/Q */
+float* fft_out = NULL;
+float* fft_window = NULL;
+float fft_window_power = 0.0f; /* (sum of the window)^2, full scale tone */
+double* power_sum = NULL;
+
+/* Step being accumulated */
+bool step_valid = false;
+uint64_t step_freq_hz = 0;
+uint32_t step_frames = 0;
+
+uint32_t sweep_count = 0;
+uint64_t steps_written = 0;
+
+static hackrf_sweep_block sweep_blocks[SWEEP_BLOCKS_MAX];
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_u32_range(char* s, uint32_t* const value_min, uint32_t* const value_max) {
+	char* sep = strchr(s, ':');
+	int result;
+
+	if( sep == NULL ) {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	*sep = 0;
+	result = parse_u32(s, value_min);
+	if( result == HACKRF_SUCCESS ) {
+		result = parse_u32(sep + 1, value_max);
+	}
+	*sep = ':';
+	return result;
+}
+
+static bool fft_init(const uint32_t n) {
+	uint32_t i;
+	float window_sum = 0.0f;
+
+	if( hackrf_fft_create(n, 0, &fft_plan) != HACKRF_SUCCESS ) {
+		return false;
+	}
+	fft_in = (float*)malloc(n * 2 * sizeof(float));
+	fft_out = (float*)malloc(n * 2 * sizeof(float));
+	fft_window = (float*)malloc(n * sizeof(float));
+	power_sum = (double*)calloc(n, sizeof(double));
+	if( (fft_in == NULL) || (fft_out == NULL) || (fft_window == NULL) || (power_sum == NULL) ) {
+		return false;
+	}
+
+	/* Hann */
+	for(i=0; i<n; i++) {
+		fft_window[i] = (float)(0.5 - (0.5 * cos(2.0 * M_PI * i / n)));
+		window_sum += fft_window[i];
+	}
+	fft_window_power = window_sum * window_sum;
+	return true;
+}
+
+/* Adds the power spectrum of every whole transform in the block */
+static void step_accumulate(const hackrf_sweep_block* const block) {
+	const int8_t* const samples = (const int8_t*)block->samples;
+	const uint32_t count = (uint32_t)block->sample_bytes / 2;
+	uint32_t first;
+	uint32_t i;
+
+	for(first=0; (first + fft_size) <= count; first+=fft_size) {
+		for(i=0; i<fft_size; i++) {
+			fft_in[i * 2] = samples[(first + i) * 2] * fft_window[i] * (1.0f / 128.0f);
+			fft_in[i * 2 + 1] = samples[(first + i) * 2 + 1] * fft_window[i] * (1.0f / 128.0f);
+		}
+		hackrf_fft_execute(fft_plan, fft_in, fft_out);
+		for(i=0; i<fft_size; i++) {
+			power_sum[i] += (fft_out[i * 2] * fft_out[i * 2]) + (fft_out[i * 2 + 1] * fft_out[i * 2 + 1]);
+		}
+		step_frames++;
+	}
+}
+
+static double step_bin_db(const int32_t bin) {
+	const double power = power_sum[(uint32_t)(bin + (int32_t)fft_size) % fft_size];
+	return 10.0 * log10((power / step_frames / fft_window_power) + 1e-20);
+}
+
+static void step_write(void) {
+	const int32_t half = (int32_t)(out_bins / 2);
+	const uint64_t hz_low = step_freq_hz - (uint64_t)(half * bin_width_hz);
+	struct timeval time_now;
+	time_t seconds;
+	char date_time[32];
+	int32_t bin;
+
+	if( step_frames == 0 ) {
+		return;
+	}
+
+	gettimeofday(&time_now, NULL);
+	seconds = time_now.tv_sec;
+	strftime(date_time, sizeof(date_time), "%Y-%m-%d, %H:%M:%S", localtime(&seconds));
+
+	fprintf(fd, "%s, %llu, %llu, %.2f, %u", date_time,
+		(unsigned long long)hz_low,
+		(unsigned long long)(hz_low + (uint64_t)(out_bins * bin_width_hz)),
+		bin_width_hz, step_frames * fft_size);
+	for(bin=-half; bin<(int32_t)(out_bins - half); bin++) {
+		double db;
+		if( bin == 0 ) {
+			db = 10.0 * log10((pow(10.0, step_bin_db(-1) / 10.0) + pow(10.0, step_bin_db(1) / 10.0)) / 2.0);
+		} else {
+			db = step_bin_db(bin);
+		}
+		fprintf(fd, ", %.2f", db);
+	}
+	fprintf(fd, "\n");
+	steps_written++;
+}
+
+int rx_callback(hackrf_transfer* transfer) {
+	int count;
+	int i;
+
+	if( fd == NULL ) {
+		return -1;
+	}
+
+	count = hackrf_sweep_demux(transfer, sweep_blocks, SWEEP_BLOCKS_MAX);
+	for(i=0; i<count; i++) {
+		const hackrf_sweep_block* const block = &sweep_blocks[i];
+
+		if( step_valid && ((block->freq_hz != step_freq_hz) ||
+				(block->flags & HACKRF_FRAME_FLAG_SWEEP_STEP)) ) {
+			step_write();
+			step_valid = false;
+			/* Back at the start, one more sweep done */
+			if( block->freq_hz <= step_freq_hz ) {
+				sweep_count++;
+				if( (num_sweeps != 0) && (sweep_count >= num_sweeps) ) {
+					do_exit = true;
+					return -1;
+				}
+			}
+		}
+		if( step_valid == false ) {
+			step_valid = true;
+			step_freq_hz = block->freq_hz;
+			step_frames = 0;
+			memset(power_sum, 0, fft_size * sizeof(double));
+		}
+		step_accumulate(block);
+	}
+	return 0;
+}
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\t[-d serial_number] # Serial number (or its last digits) of the board to use.\n");
+	printf("\t[-f start_mhz:stop_mhz] # Range to sweep in MHz within [%u, %u[, default %u:%u.\n",
+		FREQ_MIN_MHZ, FREQ_MAX_MHZ, DEFAULT_START_MHZ, DEFAULT_STOP_MHZ);
+	printf("\t[-s sample_rate_hz] # Set sample rate in Hz (default %uMHz).\n", DEFAULT_SAMPLE_RATE_HZ / 1000000);
+	printf("\t[-S step_hz] # Tuning step, at most the sample rate (default 3/4 of it).\n");
+	printf("\t[-n fft_size] # Power of two from %u to %u (default %u).\n", FFT_SIZE_MIN, FFT_SIZE_MAX, DEFAULT_FFT_SIZE);
+	printf("\t[-w dwell_blocks] # 16KiB blocks averaged per step (default %u).\n", DEFAULT_DWELL_BLOCKS);
+	printf("\t[-e settle_blocks] # Blocks dropped after each retune (default %u).\n", DEFAULT_SETTLE_BLOCKS);
+	printf("\t[-N num_sweeps] # Stop after this many sweeps (default is unlimited).\n");
+	printf("\t[-a set_amp] # Set Amp 1=Enable, 0=Disable.\n");
+	printf("\t[-r filename] # Write CSV to file (default stdout).\n");
+}
+
+static hackrf_device* device = NULL;
+
+void sigint_callback_handler(int signum)
+{
+	fprintf(stderr, "Caught signal %d\n", signum);
+	do_exit = true;
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	const char* path = NULL;
+	int result;
+	uint32_t baseband_filter_bw_hz;
+
+	while( (opt = getopt(argc, argv, "d:f:s:S:n:w:e:N:a:r:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'd':
+			serial_number = optarg;
+			break;
+
+		case 'f':
+			result = parse_u32_range(optarg, &start_mhz, &stop_mhz);
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'S':
+			result = parse_u32(optarg, &step_hz);
+			break;
+
+		case 'n':
+			result = parse_u32(optarg, &fft_size);
+			break;
+
+		case 'w':
+			result = parse_u32(optarg, &dwell_blocks);
+			break;
+
+		case 'e':
+			result = parse_u32(optarg, &settle_blocks);
+			break;
+
+		case 'N':
+			result = parse_u32(optarg, &num_sweeps);
+			break;
+
+		case 'a':
+			amp = true;
+			result = parse_u32(optarg, &amp_enable);
+			break;
+
+		case 'r':
+			path = optarg;
+			break;
+
+		default:
+			printf("unknown argument '-%c %s'\n", opt, optarg);
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( (start_mhz < FREQ_MIN_MHZ) || (stop_mhz >= FREQ_MAX_MHZ) || (start_mhz > stop_mhz) ) {
+		printf("argument error: range must be within [%u, %u[ MHz\n", FREQ_MIN_MHZ, FREQ_MAX_MHZ);
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( (sample_rate_hz < HACKRF_SAMPLE_RATE_MIN_HZ) || (sample_rate_hz > HACKRF_SAMPLE_RATE_MAX_HZ) ) {
+		printf("argument error: sample_rate_hz must be within [%u, %u]\n",
+			HACKRF_SAMPLE_RATE_MIN_HZ, HACKRF_SAMPLE_RATE_MAX_HZ);
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( (fft_size < FFT_SIZE_MIN) || (fft_size > FFT_SIZE_MAX) || ((fft_size & (fft_size - 1)) != 0) ) {
+		printf("argument error: fft_size must be a power of two within [%u, %u]\n", FFT_SIZE_MIN, FFT_SIZE_MAX);
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( (dwell_blocks == 0) || (dwell_blocks > 0xffff) || (settle_blocks > 0xffff) ) {
+		printf("argument error: dwell_blocks must be within [1, 65535], settle_blocks at most 65535\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	/* Whole bins, so consecutive steps line up */
+	bin_width_hz = (double)sample_rate_hz / fft_size;
+	if( step_hz == 0 ) {
+		step_hz = (sample_rate_hz / 4) * 3;
+	}
+	if( step_hz > sample_rate_hz ) {
+		printf("argument error: step_hz must be at most the sample rate\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	out_bins = (uint32_t)((step_hz / bin_width_hz) + 0.5);
+	if( out_bins < 2 ) {
+		out_bins = 2;
+	}
+	step_hz = (uint32_t)((out_bins * bin_width_hz) + 0.5);
+
+	if( fft_init(fft_size) == false ) {
+		printf("out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	if( path == NULL ) {
+		fd = stdout;
+	} else {
+		fd = fopen(path, "w");
+		if( fd == NULL ) {
+			printf("Failed to open file: %s\n", path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	result = hackrf_init();
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_open_by_serial(serial_number, &device);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_open_by_serial() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGILL, &sigint_callback_handler);
+	signal(SIGFPE, &sigint_callback_handler);
+	signal(SIGSEGV, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+	signal(SIGABRT, &sigint_callback_handler);
+
+	result = hackrf_sample_rate_set(device, sample_rate_hz);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_sample_rate_set() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	baseband_filter_bw_hz = hackrf_compute_baseband_filter_bw((sample_rate_hz / 4) * 3);
+	result = hackrf_baseband_filter_bandwidth_set(device, baseband_filter_bw_hz);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_baseband_filter_bandwidth_set() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stderr, "call hackrf_set_sweep(%u MHz, %u MHz, %u Hz, %u, %u)\n",
+		start_mhz, stop_mhz, step_hz, dwell_blocks, settle_blocks);
+	result = hackrf_set_sweep(device, start_mhz, stop_mhz, step_hz,
+		(uint16_t)dwell_blocks, (uint16_t)settle_blocks);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_set_sweep() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	if( amp ) {
+		result = hackrf_set_amp_enable(device, (uint8_t)amp_enable);
+		if( result != HACKRF_SUCCESS ) {
+			fprintf(stderr, "hackrf_set_amp_enable() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	}
+
+	result = hackrf_start_rx(device, rx_callback, NULL);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_start_rx() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stderr, "Stop with Ctrl-C\n");
+	while( (hackrf_is_streaming(device) == HACKRF_TRUE) &&
+			(do_exit == false) )
+	{
+		sleep(1);
+		fprintf(stderr, "%llu steps, %u sweeps\n", (unsigned long long)steps_written, sweep_count);
+	}
+
+	result = hackrf_stop_rx(device);
+	if( result != HACKRF_SUCCESS ) {
+		fprintf(stderr, "hackrf_stop_rx() failed: %s (%d)\n", hackrf_error_name(result), result);
+	}
+
+	hackrf_frame_stats frame_stats;
+	if( hackrf_get_frame_stats(device, &frame_stats) == HACKRF_SUCCESS )
+	{
+		fprintf(stderr, "Frames %llu, %llu overruns, %llu samples dropped, %llu bad headers\n",
+				(unsigned long long)frame_stats.blocks,
+				(unsigned long long)frame_stats.overruns,
+				(unsigned long long)frame_stats.dropped_samples,
+				(unsigned long long)frame_stats.bad_headers);
+	}
+
+	/* Turn sweeping off for the next user of the board */
+	hackrf_set_sweep(device, 0, 0, 0, 0, 0);
+	hackrf_set_framed_mode(device, 0);
+
+	hackrf_close(device);
+	hackrf_exit();
+
+	if( (fd != NULL) && (fd != stdout) ) {
+		fclose(fd);
+	}
+	fd = NULL;
+	return EXIT_SUCCESS;
+}
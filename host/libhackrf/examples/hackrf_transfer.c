@@ -207,6 +207,7 @@ uint32_t amp_enable;
 
 bool sample_rate = false;
 uint32_t sample_rate_hz;
+uint32_t output_sample_rate_hz; /* After onboard decimation */
 
 bool limit_num_samples = false;
 uint64_t samples_to_xfer = 0;
@@ -215,6 +216,16 @@ uint64_t bytes_to_xfer = 0;
 bool baseband_filter_bw = false;
 uint32_t baseband_filter_bw_hz = 0;
 
+const char* serial_number = NULL;
+
+bool ring_mode = false;
+uint32_t ring_depth = 0;
+
+bool framed = false;
+
+bool decimation = false;
+uint32_t decimation_factor = 1;
+
 int rx_callback(hackrf_transfer* transfer) {
 	int bytes_to_write;
 
@@ -276,13 +287,18 @@ int tx_callback(hackrf_transfer* transfer) {
 static void usage() {
 	printf("Usage:\n");
 	printf("\t-w # Receive data into file with WAV header and automatic name.\n");
+	printf("\t[-d serial_number] # Serial number (or its last digits) of the board to use.\n");
 	printf("\t-r <filename> # Receive data into file.\n");
 	printf("\t-t <filename> # Transmit data from file.\n");
 	printf("\t[-f set_freq_hz] # Set Freq in Hz between [%lluMHz, %lluMHz[.\n", FREQ_MIN_HZ/FREQ_ONE_MHZ, FREQ_MAX_HZ/FREQ_ONE_MHZ);
 	printf("\t[-a set_amp] # Set Amp 1=Enable, 0=Disable.\n");
-	printf("\t[-s sample_rate_hz] # Set sample rate in Hz (5/10/12.5/16/20MHz, default %lldMHz).\n", DEFAULT_SAMPLE_RATE_HZ/FREQ_ONE_MHZ);
+	printf("\t[-s sample_rate_hz] # Set sample rate in Hz (%lld-%lldMHz, Jellybean 5/10/20MHz, default %lldMHz).\n",
+		HACKRF_SAMPLE_RATE_MIN_HZ/FREQ_ONE_MHZ, HACKRF_SAMPLE_RATE_MAX_HZ/FREQ_ONE_MHZ, DEFAULT_SAMPLE_RATE_HZ/FREQ_ONE_MHZ);
 	printf("\t[-n num_samples] # Number of samples to transfer (default is unlimited).\n");
 	printf("\t[-b baseband_filter_bw_hz] # Set baseband filter bandwidth in MHz.\n\tPossible values: 1.75/2.5/3.5/5/5.5/6/7/8/9/10/12/14/15/20/24/28MHz, default < sample_rate_hz.\n" );
+	printf("\t[-R ring_depth] # Read/write file on its own thread with ring_depth spare buffers (max %d).\n", HACKRF_RING_DEPTH_MAX);
+	printf("\t[-F] # Receive with firmware sample counters, report dropped samples.\n");
+	printf("\t[-D decimation] # Decimate received samples onboard by 2/4/8/16/32.\n");
 }
 
 static hackrf_device* device = NULL;
@@ -306,8 +322,10 @@ int main(int argc, char** argv) {
 	struct tm * timeinfo;
 	long int file_pos;
 	int exit_code = EXIT_SUCCESS;
+	uint64_t rate_numerator;
+	uint32_t rate_denominator;
   
-	while( (opt = getopt(argc, argv, "wr:t:f:a:s:n:b:")) != EOF )
+	while( (opt = getopt(argc, argv, "wr:t:f:a:s:n:b:R:d:FD:")) != EOF )
 	{
 		result = HACKRF_SUCCESS;
 		switch( opt ) 
@@ -352,6 +370,24 @@ int main(int argc, char** argv) {
 			result = parse_u32(optarg, &baseband_filter_bw_hz);
 			break;
 
+		case 'd':
+			serial_number = optarg;
+			break;
+
+		case 'R':
+			ring_mode = true;
+			result = parse_u32(optarg, &ring_depth);
+			break;
+
+		case 'F':
+			framed = true;
+			break;
+
+		case 'D':
+			decimation = true;
+			result = parse_u32(optarg, &decimation_factor);
+			break;
+
 		default:
 			printf("unknown argument '-%c %s'\n", opt, optarg);
 			usage();
@@ -398,6 +434,16 @@ int main(int argc, char** argv) {
 	{
 		sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
 	}
+	output_sample_rate_hz = sample_rate_hz;
+
+	if( ring_mode ) {
+		if( ring_depth > HACKRF_RING_DEPTH_MAX )
+		{
+			printf("argument error: ring_depth shall be less or equal to %d.\n", HACKRF_RING_DEPTH_MAX);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
 
 	if( baseband_filter_bw )
 	{
@@ -479,9 +525,9 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 	
-	result = hackrf_open(&device);
+	result = hackrf_open_by_serial(serial_number, &device);
 	if( result != HACKRF_SUCCESS ) {
-		printf("hackrf_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		printf("hackrf_open_by_serial() failed: %s (%d)\n", hackrf_error_name(result), result);
 		usage();
 		return EXIT_FAILURE;
 	}
@@ -525,6 +571,11 @@ int main(int argc, char** argv) {
 		usage();
 		return EXIT_FAILURE;
 	}
+	if( hackrf_compute_sample_rate(sample_rate_hz, &rate_numerator, &rate_denominator) == HACKRF_SUCCESS ) {
+		printf("exact sample rate %.6f Hz (%llu/%u)\n",
+			(double)rate_numerator / rate_denominator,
+			(unsigned long long)rate_numerator, rate_denominator);
+	}
 
 	printf("call hackrf_baseband_filter_bandwidth_set(%d Hz/%.03f MHz)\n",
 			baseband_filter_bw_hz, ((float)baseband_filter_bw_hz/(float)FREQ_ONE_MHZ));
@@ -535,6 +586,38 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 
+	if( framed && (transceiver_mode == TRANSCEIVER_MODE_RX) ) {
+		printf("call hackrf_set_framed_mode(1)\n");
+		result = hackrf_set_framed_mode(device, 1);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_set_framed_mode() failed: %s (%d)\n", hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( decimation && (transceiver_mode == TRANSCEIVER_MODE_RX) ) {
+		printf("call hackrf_set_decimation(%u)\n", decimation_factor);
+		result = hackrf_set_decimation(device, decimation_factor);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_set_decimation() failed: %s (%d)\n", hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+		hackrf_get_output_sample_rate(device, &output_sample_rate_hz);
+		printf("output sample rate %u Hz\n", output_sample_rate_hz);
+	}
+
+	if( ring_mode ) {
+		printf("call hackrf_set_ring_mode(%u)\n", ring_depth);
+		result = hackrf_set_ring_mode(device, ring_depth);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_set_ring_mode() failed: %s (%d)\n", hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
 	if( transceiver_mode == TRANSCEIVER_MODE_RX ) {
 		result = hackrf_start_rx(device, rx_callback, NULL);
 	} else {
@@ -612,6 +695,43 @@ int main(int argc, char** argv) {
 	
 	if(device != NULL)
 	{
+		if( ring_mode )
+		{
+			hackrf_ring_stats ring_stats;
+			if( hackrf_get_ring_stats(device, &ring_stats) == HACKRF_SUCCESS )
+			{
+				printf("Ring depth %u, high water %u, %llu buffers, %llu dropped\n",
+						ring_stats.depth, ring_stats.high_water,
+						(unsigned long long)ring_stats.delivered,
+						(unsigned long long)ring_stats.dropped);
+			}
+		}
+
+		if( framed )
+		{
+			hackrf_frame_stats frame_stats;
+			if( hackrf_get_frame_stats(device, &frame_stats) == HACKRF_SUCCESS )
+			{
+				printf("Frames %llu, %llu overruns, %llu samples dropped, %llu bad headers\n",
+						(unsigned long long)frame_stats.blocks,
+						(unsigned long long)frame_stats.overruns,
+						(unsigned long long)frame_stats.dropped_samples,
+						(unsigned long long)frame_stats.bad_headers);
+			}
+		}
+
+		hackrf_stream_stats stream_stats;
+		if( hackrf_get_stream_stats(device, &stream_stats) == HACKRF_SUCCESS )
+		{
+			printf("Transfers %llu (%llu short), callback max %llu us, resubmit avg %llu us max %llu us, %llu failed\n",
+					(unsigned long long)stream_stats.transfers,
+					(unsigned long long)stream_stats.short_transfers,
+					(unsigned long long)stream_stats.callback_us_max,
+					(unsigned long long)((stream_stats.resubmits > 0) ? (stream_stats.resubmit_us_total / stream_stats.resubmits) : 0),
+					(unsigned long long)stream_stats.resubmit_us_max,
+					(unsigned long long)stream_stats.resubmit_failures);
+		}
+
 		if( receive ) 
 		{
 			result = hackrf_stop_rx(device);
@@ -631,6 +751,13 @@ int main(int argc, char** argv) {
 				printf("hackrf_stop_tx() done\n");
 			}
 		}
+
+		hackrf_bulk_ring bulk_ring;
+		if( hackrf_bulk_ring_read(device, &bulk_ring) == HACKRF_SUCCESS )
+		{
+			printf("Firmware ring depth %u, max in flight %u, %u times full\n",
+					bulk_ring.depth, bulk_ring.in_flight_max, bulk_ring.ring_full);
+		}
 		
 		result = hackrf_close(device);
 		if( result != HACKRF_SUCCESS ) 
@@ -652,7 +779,7 @@ int main(int argc, char** argv) {
 			file_pos = ftell(fd);
 			/* Update Wav Header */
 			wave_file_hdr.hdr.size = file_pos+8;
-			wave_file_hdr.fmt_chunk.dwSamplesPerSec = sample_rate_hz;
+			wave_file_hdr.fmt_chunk.dwSamplesPerSec = output_sample_rate_hz;
 			wave_file_hdr.fmt_chunk.dwAvgBytesPerSec = wave_file_hdr.fmt_chunk.dwSamplesPerSec*2;
 			wave_file_hdr.data_chunk.chunkSize = file_pos - sizeof(t_wav_file_hdr);
 			/* Overwrite header with updated data */
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Transfer pool benchmark. Runs on the HACKRF_OPEN_LOOPBACK stand-in by
+ * default, so no board is needed, or with -H on a board running
+ * usb_performance firmware.
+ *
+ * For each (transfer_count, buffer_size) the device is opened, the pool is
+ * set with hackrf_set_transfer_params() and framed RX runs for duration_s.
+ * The callback burns cost_ns per byte plus an occasional stall, like an
+ * application writing to disk. Samples lost are taken from the gaps in the
+ * sample counter, callback and resubmit times from hackrf_get_stream_stats().
+ * -r runs the callback through ring mode instead of the libusb thread.
+ */
+
+#include <hackrf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FREQ_ONE_MHZ (1000000ull)
+
+#define DEFAULT_SAMPLE_RATE_HZ (20000000) /* 20MHz */
+#define DEFAULT_DURATION_S (5)
+#define DEFAULT_COST_NS_PER_BYTE (2.0) /* ~fwrite() to page cache */
+#define DEFAULT_STALL_PROBABILITY (0.01)
+#define DEFAULT_STALL_MS (10.0)
+
+static const uint32_t bench_transfer_counts[] = { 1, 2, 4, 8, 16, 32, 64, 0 };
+static const uint32_t bench_buffer_sizes[] = { 16384, 65536, 262144, 1048576, 0 };
+
+static double cost_ns_per_byte = DEFAULT_COST_NS_PER_BYTE;
+static double stall_probability = DEFAULT_STALL_PROBABILITY;
+static double stall_ms = DEFAULT_STALL_MS;
+static uint32_t open_flags = HACKRF_OPEN_LOOPBACK;
+static uint32_t ring_depth = 0;
+
+static uint32_t rng_state = 0x1234567;
+
+static double rng_uniform(void)
+{
+	/* xorshift32 */
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return (double)rng_state / 4294967296.0;
+}
+
+int parse_u32(char* s, uint32_t* const value) {
+	char* s_end = s;
+	const unsigned long ulong_value = strtoul(s, &s_end, 10);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_double(char* s, double* const value) {
+	char* s_end = s;
+	const double d_value = strtod(s, &s_end);
+	if( (s != s_end) && (*s_end == 0) && (d_value >= 0.0) ) {
+		*value = d_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+int rx_callback(hackrf_transfer* transfer) {
+	const uint64_t end_ns = monotonic_ns() + (uint64_t)(transfer->valid_length * cost_ns_per_byte);
+
+	while( monotonic_ns() < end_ns );
+	if( rng_uniform() < stall_probability ) {
+		usleep((useconds_t)(stall_ms * 1e3));
+	}
+	return 0;
+}
+
+static int bench_run(const uint32_t transfer_count,
+					const uint32_t buffer_size,
+					const uint32_t sample_rate_hz,
+					const uint32_t duration_s)
+{
+	hackrf_device* device = NULL;
+	hackrf_frame_stats frame_stats;
+	hackrf_stream_stats stream_stats;
+	int result;
+
+	/* Reopen for each setting, streaming state is per open */
+	result = hackrf_open_ex(&device, open_flags);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_open_ex() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return result;
+	}
+
+	result = hackrf_sample_rate_set(device, sample_rate_hz);
+	if( result == HACKRF_SUCCESS ) {
+		result = hackrf_set_transfer_params(device, transfer_count, buffer_size);
+	}
+	if( result == HACKRF_SUCCESS ) {
+		result = hackrf_set_ring_mode(device, ring_depth);
+	}
+	if( result == HACKRF_SUCCESS ) {
+		result = hackrf_set_framed_mode(device, 1);
+	}
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf setup failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_close(device);
+		return result;
+	}
+
+	rng_state = 0x1234567;
+	result = hackrf_start_rx(device, rx_callback, NULL);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_start_rx() failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_close(device);
+		return result;
+	}
+
+	sleep(duration_s);
+
+	hackrf_stop_rx(device);
+	hackrf_get_frame_stats(device, &frame_stats);
+	hackrf_get_stream_stats(device, &stream_stats);
+
+	printf("%8u %10u %10u %12.4f %10llu %16llu %16.1f %16llu\n",
+		transfer_count, buffer_size,
+		(transfer_count * buffer_size) / 1024,
+		(frame_stats.next_sample_count > 0)
+			? (100.0 * frame_stats.dropped_samples / frame_stats.next_sample_count) : 0.0,
+		(unsigned long long)frame_stats.overruns,
+		(unsigned long long)stream_stats.callback_us_max,
+		(stream_stats.resubmits > 0)
+			? ((double)stream_stats.resubmit_us_total / stream_stats.resubmits) : 0.0,
+		(unsigned long long)stream_stats.resubmit_us_max);
+
+	hackrf_set_framed_mode(device, 0);
+	hackrf_close(device);
+	return HACKRF_SUCCESS;
+}
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\t[-s sample_rate_hz] # Sample rate in Hz (default %lluMHz).\n", DEFAULT_SAMPLE_RATE_HZ/FREQ_ONE_MHZ);
+	printf("\t[-d duration_s] # Seconds per setting (default %d).\n", DEFAULT_DURATION_S);
+	printf("\t[-c cost_ns] # Callback cost in ns per byte (default %.1f).\n", DEFAULT_COST_NS_PER_BYTE);
+	printf("\t[-p stall_probability] # Probability of a stall per callback (default %.3f).\n", DEFAULT_STALL_PROBABILITY);
+	printf("\t[-m stall_ms] # Stall duration in ms (default %.1f).\n", DEFAULT_STALL_MS);
+	printf("\t[-r ring_depth] # Ring mode with this many spare buffers (default off).\n");
+	printf("\t[-H] # Board with usb_performance firmware instead of the loopback stand-in.\n");
+}
+
+int main(int argc, char** argv) {
+	int opt;
+	int result;
+	uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+	uint32_t duration_s = DEFAULT_DURATION_S;
+	uint32_t count_index;
+	uint32_t size_index;
+
+	while( (opt = getopt(argc, argv, "s:d:c:p:m:r:H")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'd':
+			result = parse_u32(optarg, &duration_s);
+			break;
+
+		case 'c':
+			result = parse_double(optarg, &cost_ns_per_byte);
+			break;
+
+		case 'p':
+			result = parse_double(optarg, &stall_probability);
+			break;
+
+		case 'm':
+			result = parse_double(optarg, &stall_ms);
+			break;
+
+		case 'r':
+			result = parse_u32(optarg, &ring_depth);
+			break;
+
+		case 'H':
+			open_flags = 0;
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( duration_s == 0 ) {
+		printf("argument error: duration_s shall be greater than 0\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_init();
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	printf("# %s, %u Hz, %u s, %.2f ns/byte, stall %.1f ms with p=%.4f, ring %u\n",
+			(open_flags & HACKRF_OPEN_LOOPBACK) ? "loopback" : "board",
+			sample_rate_hz, duration_s, cost_ns_per_byte, stall_ms, stall_probability, ring_depth);
+	printf("%8s %10s %10s %12s %10s %16s %16s %16s\n",
+			"count", "size", "pool_KiB", "drop_%", "overruns",
+			"callback_max_us", "resubmit_avg_us", "resubmit_max_us");
+
+	for(count_index=0; bench_transfer_counts[count_index] != 0; count_index++)
+	{
+		for(size_index=0; bench_buffer_sizes[size_index] != 0; size_index++)
+		{
+			result = bench_run(bench_transfer_counts[count_index], bench_buffer_sizes[size_index],
+				sample_rate_hz, duration_s);
+			if( result != HACKRF_SUCCESS ) {
+				break;
+			}
+		}
+		if( result != HACKRF_SUCCESS ) {
+			break;
+		}
+	}
+
+	hackrf_exit();
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -20,13 +20,79 @@
  * Boston, MA 02110-1301, USA.
  */
 
+/*
+ * 'g++ -DTEST -o test hackrf.c hackrf_convert.c -lusb-1.0 -lpthread' checks
+ * board enumeration and serial number matching against a stub device list,
+ * and the order register cache writes reach the board in.
+ */
+
 #include "hackrf.h"
+#include "hackrf_convert.h"
+#include "si5351c_fraction.h"
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/timeb.h>
+#endif
 
 #include <libusb.h>
 #include <pthread.h>
 
+#ifdef TEST
+/* Enumeration and requests see the stub boards at the end of this file, not the bus */
+#define libusb_get_device_list test_get_device_list
+#define libusb_free_device_list test_free_device_list
+#define libusb_get_device_descriptor test_get_device_descriptor
+#define libusb_get_bus_number test_get_bus_number
+#define libusb_get_device_address test_get_device_address
+#define libusb_ref_device test_ref_device
+#define libusb_unref_device test_unref_device
+#define libusb_open test_open
+#define libusb_close test_close
+#define libusb_get_string_descriptor_ascii test_get_string_descriptor_ascii
+#define libusb_control_transfer test_control_transfer
+#define libusb_set_configuration test_set_configuration
+#define libusb_claim_interface test_claim_interface
+#define libusb_release_interface test_release_interface
+static ssize_t test_get_device_list(libusb_context* ctx, libusb_device*** list);
+static void test_free_device_list(libusb_device** list, int unref_devices);
+static int test_get_device_descriptor(libusb_device* dev, struct libusb_device_descriptor* desc);
+static uint8_t test_get_bus_number(libusb_device* dev);
+static uint8_t test_get_device_address(libusb_device* dev);
+static libusb_device* test_ref_device(libusb_device* dev);
+static void test_unref_device(libusb_device* dev);
+static int test_open(libusb_device* dev, libusb_device_handle** handle);
+static void test_close(libusb_device_handle* handle);
+static int test_get_string_descriptor_ascii(libusb_device_handle* handle, uint8_t desc_index, unsigned char* data, int length);
+static int test_control_transfer(libusb_device_handle* handle, uint8_t request_type, uint8_t request,
+	uint16_t value, uint16_t index, unsigned char* data, uint16_t length, unsigned int timeout);
+static int test_set_configuration(libusb_device_handle* handle, int configuration);
+static int test_claim_interface(libusb_device_handle* handle, int interface_number);
+static int test_release_interface(libusb_device_handle* handle, int interface_number);
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* usbfs zero-copy buffers, libusb 1.0.21 and later */
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+#define HACKRF_HAVE_DEV_MEM
+#endif
+
+#define HUGEPAGE_SIZE (2*1024*1024)
+
 // TODO: Factor this into a shared #include so that firmware can use
 // the same values.
 typedef enum {
@@ -47,26 +113,178 @@ typedef enum {
 	HACKRF_VENDOR_REQUEST_VERSION_STRING_READ = 15,
 	HACKRF_VENDOR_REQUEST_SET_FREQ = 16,
 	HACKRF_VENDOR_REQUEST_AMP_ENABLE = 17,
-	HACKRF_VENDOR_REQUEST_BOARD_PARTID_SERIALNO_READ = 18
+	HACKRF_VENDOR_REQUEST_BOARD_PARTID_SERIALNO_READ = 18,
+	HACKRF_VENDOR_REQUEST_SET_FRAMED_MODE = 19,
+	HACKRF_VENDOR_REQUEST_BULK_RING_READ = 20,
+	HACKRF_VENDOR_REQUEST_SET_DECIMATION = 21,
+	HACKRF_VENDOR_REQUEST_FREQ_TABLE_WRITE = 22,
+	HACKRF_VENDOR_REQUEST_FREQ_TABLE_SELECT = 23,
+	HACKRF_VENDOR_REQUEST_SET_SWEEP = 24,
+	HACKRF_VENDOR_REQUEST_REGS_WRITE = 25,
+	HACKRF_VENDOR_REQUEST_REGS_READ = 26
 } hackrf_vendor_request;
 
+/* setup.value of REGS_WRITE/REGS_READ, also indexes hackrf_device.regs_cache */
+typedef enum {
+	REGS_CHIP_MAX2837 = 0,
+	REGS_CHIP_SI5351C = 1,
+	REGS_CHIP_RFFC5071 = 2,
+	REGS_CHIP_COUNT = 3,
+} regs_chip_t;
+
+/* Sets of chips for regs_cache_flush() and regs_cache_forget() */
+#define REGS_MASK_MAX2837 (1 << REGS_CHIP_MAX2837)
+#define REGS_MASK_SI5351C (1 << REGS_CHIP_SI5351C)
+#define REGS_MASK_RFFC5071 (1 << REGS_CHIP_RFFC5071)
+#define REGS_MASK_ALL ((1 << REGS_CHIP_COUNT) - 1)
+
+/* Host copy of a register file, see hackrf_set_register_cache() */
+typedef struct {
+	uint16_t value[HACKRF_SI5351C_NUM_REGS];
+	bool valid[HACKRF_SI5351C_NUM_REGS];
+	bool dirty[HACKRF_SI5351C_NUM_REGS]; /* Written here, not on the chip yet */
+} regs_cache_t;
+
 typedef enum {
 	HACKRF_TRANSCEIVER_MODE_OFF = 0,
 	HACKRF_TRANSCEIVER_MODE_RECEIVE = 1,
 	HACKRF_TRANSCEIVER_MODE_TRANSMIT = 2,
 } hackrf_transceiver_mode;
 
+/* Single-producer/single-consumer ring of buffers, lock-free.
+ * head is only written by the producer, tail only by the consumer. */
+typedef struct {
+	uint8_t* buffer;
+	int valid_length;
+	uint64_t sample_count; /* Framed RX only */
+	uint32_t dropped_samples;
+} hackrf_ring_entry;
+
+typedef struct {
+	hackrf_ring_entry* entries;
+	uint32_t mask;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+} hackrf_ring;
+
+/* Weight of each new RX buffer in the DC and IQ imbalance estimates */
+#define IQ_CORRECTION_ALPHA (0.1)
+/* RX buffers past those in flight at a retune that can still hold samples
+ * from before it, firmware buffer and synthesizer settling */
+#define IQ_RETUNE_STALE_EXTRA (1)
+
+/* HACKRF_OPEN_LOOPBACK device buffer, the firmware's 64KiB usb_bulk_buffer */
+#define LOOPBACK_BUFFER_SAMPLES (65536 / 2)
+/* Bulk and async control transfers in flight at once */
+#define LOOPBACK_QUEUE_SIZE (HACKRF_TRANSFER_COUNT_MAX + 64)
+
+/* Smoothed estimates for one tuning frequency */
+typedef struct {
+	bool used;
+	uint64_t freq_hz; /* 0 when not known */
+	uint64_t blocks;
+	uint32_t last_use; /* For replacement, iq_clock value */
+	double dc_i, dc_q;
+	double ii, qq, iq; /* Covariance around DC */
+} iq_estimate_t;
+
 struct hackrf_device {
+	libusb_context* usb_context; /* Shared one from hackrf_init() unless HACKRF_OPEN_OWN_CONTEXT */
+	bool own_usb_context;
 	libusb_device_handle* usb_device;
 	struct libusb_transfer** transfers;
+	/* All sample buffers, transfers swap them in ring mode */
+	uint8_t** buffers;
+	bool* buffer_lent; /* Retained by the application, see hackrf_release_buffer() */
+	uint32_t buffer_count;
+	enum hackrf_buffer_alloc buffer_alloc; /* Requested, first mode tried */
+	enum hackrf_buffer_alloc buffer_alloc_used;
+	uint8_t* buffer_region; /* Huge page mapping holding all buffers */
+	size_t buffer_region_size;
 	hackrf_sample_block_cb_fn callback;
 	volatile bool transfer_thread_started; /* volatile shared between threads (read only) */
 	pthread_t transfer_thread;
 	uint32_t transfer_count;
 	uint32_t buffer_size;
 	volatile bool streaming; /* volatile shared between threads (read only) */
+	volatile bool do_exit; /* Set on error or stop, only stops this device */
+	volatile int transfers_active; /* Submitted and not completed yet */
+	int event_thread_cpu; /* -1 when not pinned */
 	void* rx_ctx;
 	void* tx_ctx;
+	/* Ring mode, see hackrf_set_ring_mode() */
+	uint32_t ring_depth;
+	bool ring_tx;
+	hackrf_ring ring_full; /* Buffers holding samples */
+	hackrf_ring ring_free; /* Buffers to be filled */
+	hackrf_ring_stats ring_stats;
+	hackrf_stream_stats stream_stats; /* Updated with atomics from any thread */
+	/* Framed RX, see hackrf_set_framed_mode(), parsed in the event thread */
+	bool framed;
+	bool frame_sync; /* next_sample_count is known */
+	hackrf_frame_stats frame_stats;
+	/* Sweep, see hackrf_set_sweep(). Headers are left for hackrf_sweep_demux() */
+	bool sweep;
+	/* Register cache, application thread only */
+	bool regs_cache_enabled;
+	regs_cache_t regs_cache[REGS_CHIP_COUNT];
+	/* Set through this handle, see hackrf_get_output_sample_rate() */
+	uint32_t sample_rate_hz;
+	uint32_t decimation;
+	volatile bool ring_thread_started;
+	pthread_t ring_thread;
+	pthread_mutex_t ring_mutex;
+	pthread_cond_t ring_cond;
+	volatile bool ring_sleeping; /* Consumer waits on ring_cond */
+	/* Sync mode, caller is the ring consumer, see hackrf_read_sync() */
+	bool sync_mode;
+	uint32_t sync_saved_ring_depth; /* Caller's ring depth, restored when sync mode ends */
+	hackrf_ring_entry sync_entry; /* Buffer partially read/written */
+	bool sync_entry_valid;
+	uint32_t sync_offset;
+	/* Buffer lending, lend_pool and parked are protected by lend_mutex */
+	uint32_t lend_depth;
+	uint8_t** lend_pool; /* Spare buffers */
+	uint32_t lend_pool_count;
+	struct libusb_transfer** parked; /* Transfers waiting for a spare buffer */
+	uint32_t parked_count;
+	pthread_mutex_t lend_mutex;
+	/* Control requests, see hackrf_set_control_timeout() and hackrf_control_wait() */
+	uint32_t control_timeout_ms; /* 0 waits forever */
+	struct control_async* controls; /* Async requests not completed yet, protected by control_mutex */
+	pthread_mutex_t control_mutex;
+	pthread_cond_t control_cond;
+	/* RX DC and IQ imbalance correction, see hackrf_set_iq_correction().
+	 * iq_cache, iq_current, iq_previous, iq_stale and iq_clock are protected
+	 * by iq_mutex. */
+	volatile bool iq_correction;
+	iq_estimate_t iq_cache[HACKRF_IQ_CORRECTION_CACHE_SIZE];
+	uint32_t iq_current; /* Entry of the frequency tuned */
+	uint32_t iq_previous; /* Entry tuned before, corrects the iq_stale buffers */
+	uint32_t iq_stale; /* RX buffers still to come from before the last retune */
+	uint32_t iq_clock;
+	pthread_mutex_t iq_mutex;
+	/* Copy of the firmware table, hackrf_set_freq_index() frequencies */
+	uint64_t freq_table[HACKRF_FREQ_TABLE_MAX];
+	uint32_t freq_table_count;
+	/* HACKRF_OPEN_LOOPBACK stand-in for the board, see loopback_handle_events().
+	 * The loopback_* fields below are protected by loopback_mutex. */
+	bool loopback;
+	pthread_mutex_t loopback_mutex;
+	pthread_cond_t loopback_cond; /* Signalled on submit and cancel */
+	struct libusb_transfer* loopback_queue[LOOPBACK_QUEUE_SIZE]; /* Submitted, oldest first */
+	uint32_t loopback_queue_head;
+	uint32_t loopback_queue_count;
+	uint32_t loopback_queue_special; /* Control or cancelled, given back at once */
+	uint64_t loopback_queue_samples; /* Room in the bulk transfers queued */
+	bool loopback_running; /* Transceiver mode is not off */
+	bool loopback_framed;
+	uint32_t loopback_rate_hz;
+	uint64_t loopback_start_us; /* Clock of loopback_made */
+	uint64_t loopback_made; /* Samples made since loopback_start_us */
+	uint64_t loopback_buffered; /* Samples made and not given back yet */
+	uint64_t loopback_sample_count; /* Count of the oldest buffered sample */
+	bool loopback_overrun; /* Flags the next frame header */
 };
 
 typedef struct {
@@ -93,888 +311,4010 @@ static const max2837_ft_t max2837_ft[] = {
 	{ 0        }
 };
 
-volatile bool do_exit = false;
-
 static const uint16_t hackrf_usb_vid = 0x1d50;
 static const uint16_t hackrf_usb_pid = 0x604b;
 
 static libusb_context* g_libusb_context = NULL;
 
-static void request_exit(void)
+/* Serial numbers of boards seen by hackrf_device_list(), by bus/address */
+typedef struct {
+	uint8_t bus_number;
+	uint8_t device_address;
+	char serial_number[HACKRF_SERIAL_NUMBER_LENGTH + 1];
+} serial_cache_entry_t;
+
+#define SERIAL_CACHE_SIZE (32)
+static serial_cache_entry_t serial_cache[SERIAL_CACHE_SIZE];
+static uint32_t serial_cache_count = 0;
+static pthread_mutex_t serial_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define SERIAL_PROBE_TIMEOUT_MS (1000)
+
+static void request_exit(hackrf_device* device)
 {
-	do_exit = true;
+	device->do_exit = true;
 }
 
-static int cancel_transfers(hackrf_device* device)
+static uint64_t monotonic_us(void)
 {
-	uint32_t transfer_index;
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000
+		+ (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
 
-	if( device->transfers != NULL )
+static void timeout_us_to_abstime(const uint64_t timeout_us, struct timespec* const abstime)
+{
+#ifdef _WIN32
+	struct _timeb now;
+	_ftime(&now);
+	abstime->tv_sec = now.time;
+	abstime->tv_nsec = now.millitm * 1000000L;
+#else
+	clock_gettime(CLOCK_REALTIME, abstime);
+#endif
+	abstime->tv_sec += timeout_us / 1000000;
+	abstime->tv_nsec += (long)(timeout_us % 1000000) * 1000L;
+	if( abstime->tv_nsec >= 1000000000L )
 	{
-		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
-		{
-			if( device->transfers[transfer_index] != NULL )
-			{
-				libusb_cancel_transfer(device->transfers[transfer_index]);
-			}
-		}
-		return HACKRF_SUCCESS;
-	} else {
-		return HACKRF_ERROR_OTHER;
+		abstime->tv_sec++;
+		abstime->tv_nsec -= 1000000000L;
 	}
 }
 
-static int free_transfers(hackrf_device* device)
-{
-	uint32_t transfer_index;
+/* HACKRF_OPEN_LOOPBACK stand-in for the board. Samples are made at the
+ * output sample rate and stream into the submitted transfers in order,
+ * each one is given back once full. What they can't take goes into a
+ * device buffer the size of the firmware's. When that fills up the oldest
+ * samples are lost and the framed sample count skips them, as on the board. TX transfers are taken at the
+ * same rate. Transfers complete from loopback_handle_events(), in the
+ * thread that would run libusb events. */
 
-	if( device->transfers != NULL )
+/* Samples a transfer takes, framed RX blocks start with a header */
+static uint32_t loopback_samples(hackrf_device* device, const struct libusb_transfer* const usb_transfer)
+{
+	if( device->loopback_framed && ((usb_transfer->endpoint & LIBUSB_ENDPOINT_IN) != 0) )
 	{
-		// libusb_close() should free all transfers referenced from this array.
-		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
-		{
-			if( device->transfers[transfer_index] != NULL )
-			{
-				libusb_free_transfer(device->transfers[transfer_index]);
-				device->transfers[transfer_index] = NULL;
-			}
-		}
-		free(device->transfers);
-		device->transfers = NULL;
+		return (usb_transfer->length / HACKRF_FRAME_BLOCK_SIZE)
+			* ((HACKRF_FRAME_BLOCK_SIZE - HACKRF_FRAME_HEADER_SIZE) / 2);
 	}
-	return HACKRF_SUCCESS;
+	return usb_transfer->length / 2;
 }
 
-static int allocate_transfers(hackrf_device* const device)
+static void loopback_write_le32(uint8_t* const p, const uint32_t value)
 {
-	if( device->transfers == NULL )
-	{
-		device->transfers = (libusb_transfer**) calloc(device->transfer_count, sizeof(struct libusb_transfer));
-		if( device->transfers == NULL )
-		{
-			return HACKRF_ERROR_NO_MEM;
-		}
+	p[0] = value & 0xff;
+	p[1] = (value >> 8) & 0xff;
+	p[2] = (value >> 16) & 0xff;
+	p[3] = value >> 24;
+}
 
-		for(uint32_t transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
-		{
-			device->transfers[transfer_index] = libusb_alloc_transfer(0);
-			if( device->transfers[transfer_index] == NULL )
-			{
-				return HACKRF_ERROR_LIBUSB;
-			}
+/* Samples made since the last call go into the device buffer */
+static void loopback_advance(hackrf_device* device, const uint64_t now_us)
+{
+	const uint64_t elapsed_us = now_us - device->loopback_start_us;
+	const uint64_t room = device->loopback_queue_samples + LOOPBACK_BUFFER_SAMPLES;
+	uint64_t made;
 
-			libusb_fill_bulk_transfer(
-				device->transfers[transfer_index],
-				device->usb_device,
-				0,
-				(unsigned char*)malloc(device->buffer_size),
-				device->buffer_size,
-				NULL,
-				device,
-				0
-			);
+	if( device->loopback_running == false )
+	{
+		return;
+	}
 
-			if( device->transfers[transfer_index]->buffer == NULL )
-			{
-				return HACKRF_ERROR_NO_MEM;
-			}
-		}
-		return HACKRF_SUCCESS;
-	} else {
-		return HACKRF_ERROR_BUSY;
+	made = (elapsed_us / 1000000) * device->loopback_rate_hz
+		+ (elapsed_us % 1000000) * device->loopback_rate_hz / 1000000;
+	device->loopback_buffered += made - device->loopback_made;
+	device->loopback_made = made;
+
+	if( device->loopback_buffered > room )
+	{
+		/* Nowhere to send them, the oldest ones are overwritten */
+		device->loopback_sample_count += device->loopback_buffered - room;
+		device->loopback_buffered = room;
+		device->loopback_overrun = true;
 	}
 }
 
-static int prepare_transfers(
-	hackrf_device* device,
-	const uint_fast8_t endpoint_address,
-	libusb_transfer_cb_fn callback)
+/* Moves buffered samples into an RX transfer, or takes a TX one */
+static void loopback_fill(hackrf_device* device, struct libusb_transfer* usb_transfer)
 {
-	int error;
-	if( device->transfers != NULL )
+	const uint32_t samples = loopback_samples(device, usb_transfer);
+	int offset;
+
+	if( (usb_transfer->endpoint & LIBUSB_ENDPOINT_IN) != 0 )
 	{
-		for(uint32_t transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
+		memset(usb_transfer->buffer, 0, usb_transfer->length);
+		if( device->loopback_framed )
 		{
-			device->transfers[transfer_index]->endpoint = endpoint_address;
-			device->transfers[transfer_index]->callback = callback;
-
-			error = libusb_submit_transfer(device->transfers[transfer_index]);
-			if( error != 0 )
+			for(offset=0; offset<usb_transfer->length; offset+=HACKRF_FRAME_BLOCK_SIZE)
 			{
-				return HACKRF_ERROR_LIBUSB;
+				uint8_t* const header = &usb_transfer->buffer[offset];
+				loopback_write_le32(&header[0], HACKRF_FRAME_MAGIC);
+				loopback_write_le32(&header[4], device->loopback_overrun ? HACKRF_FRAME_FLAG_OVERRUN : 0);
+				loopback_write_le32(&header[8], (uint32_t)device->loopback_sample_count);
+				loopback_write_le32(&header[12], (uint32_t)(device->loopback_sample_count >> 32));
+				device->loopback_overrun = false;
+				device->loopback_sample_count += (HACKRF_FRAME_BLOCK_SIZE - HACKRF_FRAME_HEADER_SIZE) / 2;
 			}
+		} else {
+			device->loopback_sample_count += samples;
 		}
-		return HACKRF_SUCCESS;
-	} else {
-		// This shouldn't happen.
-		return HACKRF_ERROR_OTHER;
 	}
+
+	device->loopback_buffered -= samples;
+	usb_transfer->actual_length = usb_transfer->length;
+	usb_transfer->status = LIBUSB_TRANSFER_COMPLETED;
 }
 
-#ifdef __cplusplus
-extern "C"
+static struct libusb_transfer* loopback_remove(hackrf_device* device, const uint32_t position)
 {
-#endif
+	struct libusb_transfer* const usb_transfer =
+		device->loopback_queue[(device->loopback_queue_head + position) % LOOPBACK_QUEUE_SIZE];
+	uint32_t index;
 
-int ADDCALL hackrf_init(void)
-{
-	const int libusb_error = libusb_init(&g_libusb_context);
-	if( libusb_error != 0 )
+	for(index=position; index>0; index--)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		device->loopback_queue[(device->loopback_queue_head + index) % LOOPBACK_QUEUE_SIZE] =
+			device->loopback_queue[(device->loopback_queue_head + index - 1) % LOOPBACK_QUEUE_SIZE];
 	}
-}
-
-int ADDCALL hackrf_exit(void)
-{
-	if( g_libusb_context != NULL )
+	device->loopback_queue_head = (device->loopback_queue_head + 1) % LOOPBACK_QUEUE_SIZE;
+	device->loopback_queue_count--;
+	if( (usb_transfer->type != LIBUSB_TRANSFER_TYPE_CONTROL) && (usb_transfer->status != LIBUSB_TRANSFER_CANCELLED) )
 	{
-		libusb_exit(g_libusb_context);
-		g_libusb_context = NULL;
+		device->loopback_queue_samples -= loopback_samples(device, usb_transfer);
 	}
-
-	return HACKRF_SUCCESS;
+	return usb_transfer;
 }
 
-int ADDCALL hackrf_open(hackrf_device** device)
+/* Next transfer to give back, or NULL and how long until one is due */
+static struct libusb_transfer* loopback_next(hackrf_device* device, uint64_t* const wait_us)
 {
-	int result;
-	
-	if( device == NULL )
+	struct libusb_transfer* usb_transfer;
+	uint32_t position;
+	uint32_t samples;
+
+	for(position=0; (device->loopback_queue_special > 0) && (position<device->loopback_queue_count); position++)
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
+		usb_transfer = device->loopback_queue[(device->loopback_queue_head + position) % LOOPBACK_QUEUE_SIZE];
+		if( usb_transfer->status == LIBUSB_TRANSFER_CANCELLED )
+		{
+			device->loopback_queue_special--;
+			usb_transfer->actual_length = 0;
+			return loopback_remove(device, position);
+		}
+		if( usb_transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL )
+		{
+			device->loopback_queue_special--;
+			usb_transfer->actual_length = usb_transfer->length - LIBUSB_CONTROL_SETUP_SIZE;
+			return loopback_remove(device, position);
+		}
 	}
 
-	// TODO: Do proper scanning of available devices, searching for
-	// unit serial number (if specified?).
-	libusb_device_handle* usb_device = libusb_open_device_with_vid_pid(g_libusb_context, hackrf_usb_vid, hackrf_usb_pid);
-	if( usb_device == NULL )
+	*wait_us = 1000000;
+	if( (device->loopback_queue_count == 0) || (device->loopback_running == false) )
 	{
-		return HACKRF_ERROR_NOT_FOUND;
+		return NULL;
 	}
 
-	//int speed = libusb_get_device_speed(usb_device);
-	// TODO: Error or warning if not high speed USB?
-
-	result = libusb_set_configuration(usb_device, 1);
-	if( result != 0 )
+	usb_transfer = device->loopback_queue[device->loopback_queue_head];
+	samples = loopback_samples(device, usb_transfer);
+	if( device->loopback_buffered >= samples )
 	{
-		libusb_close(usb_device);
-		return HACKRF_ERROR_LIBUSB;
+		loopback_fill(device, usb_transfer);
+		return loopback_remove(device, 0);
 	}
+	*wait_us = (uint64_t)(samples - device->loopback_buffered) * 1000000 / device->loopback_rate_hz + 1;
+	return NULL;
+}
 
-	result = libusb_claim_interface(usb_device, 0);
-	if( result != 0 )
+static int loopback_submit(hackrf_device* device, struct libusb_transfer* usb_transfer)
+{
+	pthread_mutex_lock(&device->loopback_mutex);
+	if( device->loopback_queue_count == LOOPBACK_QUEUE_SIZE )
 	{
-		libusb_close(usb_device);
-		return HACKRF_ERROR_LIBUSB;
+		pthread_mutex_unlock(&device->loopback_mutex);
+		return LIBUSB_ERROR_BUSY;
 	}
-
-	hackrf_device* lib_device = NULL;
-	lib_device = (hackrf_device*)malloc(sizeof(*lib_device));
-	if( lib_device == NULL )
+	/* Status is only read back once given back, marks cancellation meanwhile */
+	usb_transfer->status = LIBUSB_TRANSFER_COMPLETED;
+	device->loopback_queue[(device->loopback_queue_head + device->loopback_queue_count) % LOOPBACK_QUEUE_SIZE] = usb_transfer;
+	device->loopback_queue_count++;
+	if( usb_transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL )
 	{
-		libusb_release_interface(usb_device, 0);
-		libusb_close(usb_device);
-		return HACKRF_ERROR_NO_MEM;
+		device->loopback_queue_special++;
+	} else {
+		device->loopback_queue_samples += loopback_samples(device, usb_transfer);
 	}
+	pthread_cond_signal(&device->loopback_cond);
+	pthread_mutex_unlock(&device->loopback_mutex);
+	return 0;
+}
 
-	lib_device->usb_device = usb_device;
-	lib_device->transfers = NULL;
-	lib_device->callback = NULL;
-	lib_device->transfer_thread_started = false;
-	/*
-	lib_device->transfer_count = 1024;
-	lib_device->buffer_size = 16384;
-	*/
-	lib_device->transfer_count = 4;
-	lib_device->buffer_size = 262144; /* 1048576; */
-	lib_device->streaming = false;
-	do_exit = false;
+static void loopback_cancel(hackrf_device* device, struct libusb_transfer* usb_transfer)
+{
+	uint32_t position;
 
-	result = allocate_transfers(lib_device);
-	if( result != 0 )
+	pthread_mutex_lock(&device->loopback_mutex);
+	for(position=0; position<device->loopback_queue_count; position++)
 	{
-		free(lib_device);
-		libusb_release_interface(usb_device, 0);
-		libusb_close(usb_device);
-		return HACKRF_ERROR_NO_MEM;
+		if( (device->loopback_queue[(device->loopback_queue_head + position) % LOOPBACK_QUEUE_SIZE] == usb_transfer) &&
+			(usb_transfer->status != LIBUSB_TRANSFER_CANCELLED) )
+		{
+			if( usb_transfer->type != LIBUSB_TRANSFER_TYPE_CONTROL )
+			{
+				device->loopback_queue_special++;
+				device->loopback_queue_samples -= loopback_samples(device, usb_transfer);
+			}
+			usb_transfer->status = LIBUSB_TRANSFER_CANCELLED;
+			pthread_cond_signal(&device->loopback_cond);
+			break;
+		}
 	}
-
-	*device = lib_device;
-
-	return HACKRF_SUCCESS;
+	pthread_mutex_unlock(&device->loopback_mutex);
 }
 
-int ADDCALL hackrf_set_transceiver_mode(hackrf_device* device, hackrf_transceiver_mode value)
+/* Gives back the transfers due, or waits up to timeout for one */
+static int loopback_handle_events(hackrf_device* device, const struct timeval* const timeout)
 {
-	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SET_TRANSCEIVER_MODE,
-		value,
-		0,
-		NULL,
-		0,
-		0
-	);
-
-	if( result != 0 )
+	const uint64_t deadline_us = monotonic_us() + (uint64_t)timeout->tv_sec * 1000000 + timeout->tv_usec;
+	struct libusb_transfer* usb_transfer;
+	struct timespec abstime;
+	uint64_t now_us;
+	uint64_t wait_us;
+	bool handled = false;
+
+	pthread_mutex_lock(&device->loopback_mutex);
+	for(;;)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		now_us = monotonic_us();
+		loopback_advance(device, now_us);
+		usb_transfer = loopback_next(device, &wait_us);
+		if( usb_transfer != NULL )
+		{
+			/* The callback submits again */
+			pthread_mutex_unlock(&device->loopback_mutex);
+			usb_transfer->callback(usb_transfer);
+			pthread_mutex_lock(&device->loopback_mutex);
+			handled = true;
+			if( now_us < deadline_us )
+			{
+				continue;
+			}
+		}
+		if( handled || (now_us >= deadline_us) )
+		{
+			break;
+		}
+		if( wait_us > (deadline_us - now_us) )
+		{
+			wait_us = deadline_us - now_us;
+		}
+		timeout_us_to_abstime(wait_us, &abstime);
+		pthread_cond_timedwait(&device->loopback_cond, &device->loopback_mutex, &abstime);
 	}
+	pthread_mutex_unlock(&device->loopback_mutex);
+	return 0;
 }
 
-int ADDCALL hackrf_max2837_read(hackrf_device* device, uint8_t register_number, uint16_t* value)
+/* The board side of the requests the stand-in acts on */
+static int loopback_control(hackrf_device* device, const uint8_t request_type, const uint8_t request,
+	const uint16_t value, unsigned char* data, const uint16_t length)
 {
-	int result;
+	if( (request_type & LIBUSB_ENDPOINT_IN) != 0 )
+	{
+		memset(data, 0, length);
+	}
 
-	if( register_number >= 32 )
+	pthread_mutex_lock(&device->loopback_mutex);
+	switch( request )
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
+	case HACKRF_VENDOR_REQUEST_SET_TRANSCEIVER_MODE:
+		/* Firmware restarts the sample count and empties its buffer */
+		device->loopback_running = (value != HACKRF_TRANSCEIVER_MODE_OFF) &&
+			((device->sample_rate_hz / device->decimation) > 0);
+		device->loopback_rate_hz = device->sample_rate_hz / device->decimation;
+		device->loopback_start_us = monotonic_us();
+		device->loopback_made = 0;
+		device->loopback_buffered = 0;
+		device->loopback_sample_count = 0;
+		device->loopback_overrun = false;
+		break;
+
+	case HACKRF_VENDOR_REQUEST_SET_FRAMED_MODE:
+		device->loopback_framed = (value != 0);
+		break;
+
+	default:
+		break;
 	}
+	pthread_mutex_unlock(&device->loopback_mutex);
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_MAX2837_READ,
-		0,
-		register_number,
-		(unsigned char*)value,
-		2,
-		0
-	);
+	return length;
+}
 
-	if( result < 2 )
+/* libusb, or the HACKRF_OPEN_LOOPBACK stand-in */
+static int usb_submit_transfer(hackrf_device* device, struct libusb_transfer* usb_transfer)
+{
+	if( device->loopback )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		return loopback_submit(device, usb_transfer);
 	}
+	return libusb_submit_transfer(usb_transfer);
 }
 
-int ADDCALL hackrf_max2837_write(hackrf_device* device, uint8_t register_number, uint16_t value)
+static void usb_cancel_transfer(hackrf_device* device, struct libusb_transfer* usb_transfer)
 {
-	int result;
-	
-	if( register_number >= 32 )
+	if( device->loopback )
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
+		loopback_cancel(device, usb_transfer);
+	} else {
+		libusb_cancel_transfer(usb_transfer);
 	}
-	if( value >= 0x400 )
+}
+
+static int usb_handle_events(hackrf_device* device, struct timeval* timeout)
+{
+	if( device->loopback )
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
+		return loopback_handle_events(device, timeout);
 	}
+	return libusb_handle_events_timeout(device->usb_context, timeout);
+}
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_MAX2837_WRITE,
-		value,
-		register_number,
-		NULL,
-		0,
-		0
-	);
+static int usb_control_transfer(hackrf_device* device, const uint8_t request_type, const uint8_t request,
+	const uint16_t value, const uint16_t index, unsigned char* data, const uint16_t length,
+	const unsigned int timeout)
+{
+	if( device->loopback )
+	{
+		return loopback_control(device, request_type, request, value, data, length);
+	}
+	return libusb_control_transfer(device->usb_device, request_type, request, value, index,
+		data, length, timeout);
+}
 
-	if( result != 0 )
+static int submit_transfer(hackrf_device* device, struct libusb_transfer* usb_transfer)
+{
+	const int error = usb_submit_transfer(device, usb_transfer);
+	if( error == 0 )
 	{
-		return HACKRF_ERROR_LIBUSB;
+		__sync_fetch_and_add(&device->transfers_active, 1);
 	} else {
-		return HACKRF_SUCCESS;
+		__sync_fetch_and_add(&device->stream_stats.resubmit_failures, 1);
 	}
+	return error;
 }
 
-int ADDCALL hackrf_si5351c_read(hackrf_device* device, uint16_t register_number, uint16_t* value)
+static void stream_stats_max(uint64_t* const max, const uint64_t value)
 {
-	uint8_t temp_value;
-	int result;
-	
-	if( register_number >= 256 )
+	uint64_t current = *max;
+	while( value > current )
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
+		const uint64_t previous = __sync_val_compare_and_swap(max, current, value);
+		if( previous == current )
+		{
+			break;
+		}
+		current = previous;
 	}
+}
 
-	temp_value = 0;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SI5351C_READ,
-		0,
-		register_number,
-		(unsigned char*)&temp_value,
-		1,
-		0
-	);
-
-	if( result < 1 )
+static void ring_stats_max(uint32_t* const max, const uint32_t value)
+{
+	uint32_t current = *max;
+	while( value > current )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		*value = temp_value;
-		return HACKRF_SUCCESS;
+		const uint32_t previous = __sync_val_compare_and_swap(max, current, value);
+		if( previous == current )
+		{
+			break;
+		}
+		current = previous;
 	}
 }
 
-int ADDCALL hackrf_si5351c_write(hackrf_device* device, uint16_t register_number, uint16_t value)
+static void stream_stats_completion(hackrf_device* device, const struct libusb_transfer* const usb_transfer)
 {
-	int result;
-	
-	if( register_number >= 256 )
+	hackrf_stream_stats* const stats = &device->stream_stats;
+	uint32_t status = (uint32_t)usb_transfer->status;
+
+	if( status >= HACKRF_STREAM_STATS_STATUS_COUNT )
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
-	}
-	if( value >= 256 ) {
-		return HACKRF_ERROR_INVALID_PARAM;
+		status = HACKRF_STREAM_STATS_STATUS_COUNT - 1;
 	}
+	__sync_fetch_and_add(&stats->status[status], 1);
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SI5351C_WRITE,
-		value,
-		register_number,
-		NULL,
-		0,
-		0
-	);
-
-	if( result != 0 )
+	if( usb_transfer->status == LIBUSB_TRANSFER_COMPLETED )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		__sync_fetch_and_add(&stats->transfers, 1);
+		__sync_fetch_and_add(&stats->bytes, (uint64_t)usb_transfer->actual_length);
+		if( usb_transfer->actual_length < usb_transfer->length )
+		{
+			__sync_fetch_and_add(&stats->short_transfers, 1);
+		}
 	}
 }
 
-int ADDCALL hackrf_sample_rate_set(hackrf_device* device, const uint32_t sampling_rate_hz)
+static void stream_stats_callback(hackrf_device* device, const uint64_t duration_us)
 {
-	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SAMPLE_RATE_SET,
-		sampling_rate_hz & 0xffff,
-		sampling_rate_hz >> 16,
-		NULL,
-		0,
-		0
-	);
+	hackrf_stream_stats* const stats = &device->stream_stats;
+	uint32_t bin = 0;
 
-	if( result != 0 )
+	while( (bin < (HACKRF_STREAM_STATS_HISTOGRAM_BINS - 1)) && ((duration_us >> bin) != 0) )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		bin++;
 	}
+	__sync_fetch_and_add(&stats->callback_us[bin], 1);
+	stream_stats_max(&stats->callback_us_max, duration_us);
 }
 
-int ADDCALL hackrf_baseband_filter_bandwidth_set(hackrf_device* device, const uint32_t bandwidth_hz)
+static uint32_t frame_read_le32(const uint8_t* const p)
 {
-	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_BASEBAND_FILTER_BANDWIDTH_SET,
-		bandwidth_hz & 0xffff,
-		bandwidth_hz >> 16,
-		NULL,
-		0,
-		0
-	);
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
-	if( result != 0 )
+/* Framed RX: check and remove the header of each 16KiB block in place.
+ * Returns the number of sample bytes left at the start of buffer. */
+static int frame_strip(hackrf_device* device, uint8_t* const buffer, const int length,
+	uint64_t* const sample_count, uint32_t* const dropped_samples)
+{
+	hackrf_frame_stats* const stats = &device->frame_stats;
+	int offset;
+	int out = 0;
+	uint64_t dropped = 0;
+	bool first = true;
+
+	*sample_count = stats->next_sample_count;
+
+	for(offset=0; (offset + HACKRF_FRAME_HEADER_SIZE) <= length; offset += HACKRF_FRAME_BLOCK_SIZE)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		const uint8_t* const header = &buffer[offset];
+		const int block_length = ((length - offset) < HACKRF_FRAME_BLOCK_SIZE) ? (length - offset) : HACKRF_FRAME_BLOCK_SIZE;
+		const int sample_bytes = block_length - HACKRF_FRAME_HEADER_SIZE;
+		uint64_t block_sample_count;
+
+		if( frame_read_le32(&header[0]) != HACKRF_FRAME_MAGIC )
+		{
+			/* Stale block sent before the first header, or framing lost */
+			__sync_fetch_and_add(&stats->bad_headers, 1);
+			continue;
+		}
+
+		block_sample_count = (uint64_t)frame_read_le32(&header[8]) | ((uint64_t)frame_read_le32(&header[12]) << 32);
+		__sync_fetch_and_add(&stats->blocks, 1);
+		if( frame_read_le32(&header[4]) & HACKRF_FRAME_FLAG_OVERRUN )
+		{
+			__sync_fetch_and_add(&stats->overruns, 1);
+		}
+		/* A count going backwards means the firmware restarted, resync */
+		if( device->frame_sync && (block_sample_count > stats->next_sample_count) )
+		{
+			dropped += block_sample_count - stats->next_sample_count;
+		}
+		device->frame_sync = true;
+		if( first )
+		{
+			*sample_count = block_sample_count;
+			first = false;
+		}
+
+		memmove(&buffer[out], &header[HACKRF_FRAME_HEADER_SIZE], sample_bytes);
+		out += sample_bytes;
+		/* Single writer, atomic for hackrf_get_frame_stats() on 32-bit hosts */
+		__sync_lock_test_and_set(&stats->next_sample_count, block_sample_count + (sample_bytes / 2));
 	}
+
+	__sync_fetch_and_add(&stats->dropped_samples, dropped);
+	*dropped_samples = (dropped > 0xffffffff) ? 0xffffffff : (uint32_t)dropped;
+	return out;
 }
 
+static uint64_t frame_read_le64(const uint8_t* const p)
+{
+	return (uint64_t)frame_read_le32(&p[0]) | ((uint64_t)frame_read_le32(&p[4]) << 32);
+}
 
-int ADDCALL hackrf_rffc5071_read(hackrf_device* device, uint8_t register_number, uint16_t* value)
+int ADDCALL hackrf_sweep_demux(hackrf_transfer* transfer, hackrf_sweep_block* blocks, const int max_blocks)
 {
-	int result;
-	
-	if( register_number >= 31 )
+	hackrf_device* const device = transfer->device;
+	hackrf_frame_stats* const stats = &device->frame_stats;
+	int offset;
+	int count = 0;
+
+	if( (blocks == NULL) || (max_blocks <= 0) )
 	{
 		return HACKRF_ERROR_INVALID_PARAM;
 	}
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_RFFC5071_READ,
-		0,
-		register_number,
-		(unsigned char*)value,
-		2,
-		0
-	);
-
-	if( result < 2 )
+	for(offset=0; ((offset + HACKRF_FRAME_HEADER_SIZE) <= transfer->valid_length) && (count < max_blocks);
+		offset += HACKRF_FRAME_BLOCK_SIZE)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		uint8_t* const header = &transfer->buffer[offset];
+		const int block_length = ((transfer->valid_length - offset) < HACKRF_FRAME_BLOCK_SIZE) ?
+			(transfer->valid_length - offset) : HACKRF_FRAME_BLOCK_SIZE;
+		hackrf_sweep_block* const block = &blocks[count];
+
+		if( frame_read_le32(&header[0]) != HACKRF_FRAME_MAGIC )
+		{
+			__sync_fetch_and_add(&stats->bad_headers, 1);
+			continue;
+		}
+
+		block->flags = frame_read_le32(&header[4]);
+		block->sample_count = frame_read_le64(&header[8]);
+		block->freq_hz = frame_read_le64(&header[16]);
+		block->samples = &header[HACKRF_FRAME_HEADER_SIZE];
+		block->sample_bytes = block_length - HACKRF_FRAME_HEADER_SIZE;
+
+		__sync_fetch_and_add(&stats->blocks, 1);
+		if( block->flags & HACKRF_FRAME_FLAG_OVERRUN )
+		{
+			__sync_fetch_and_add(&stats->overruns, 1);
+		}
+		/* The firmware drops the blocks around each retune on purpose */
+		if( device->frame_sync && ((block->flags & HACKRF_FRAME_FLAG_SWEEP_STEP) == 0) &&
+			(block->sample_count > stats->next_sample_count) )
+		{
+			__sync_fetch_and_add(&stats->dropped_samples, block->sample_count - stats->next_sample_count);
+		}
+		device->frame_sync = true;
+		__sync_lock_test_and_set(&stats->next_sample_count, block->sample_count + (block->sample_bytes / 2));
+		count++;
 	}
+	return count;
 }
 
-int ADDCALL hackrf_rffc5071_write(hackrf_device* device, uint8_t register_number, uint16_t value)
+static void stream_stats_resubmit(hackrf_device* device, const uint64_t completion_us)
 {
-	int result;
-	
-	if( register_number >= 31 )
-	{
-		return HACKRF_ERROR_INVALID_PARAM;
-	}
+	hackrf_stream_stats* const stats = &device->stream_stats;
+	const uint64_t latency_us = monotonic_us() - completion_us;
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_RFFC5071_WRITE,
-		value,
-		register_number,
-		NULL,
-		0,
-		0
-	);
+	__sync_fetch_and_add(&stats->resubmits, 1);
+	__sync_fetch_and_add(&stats->resubmit_us_total, latency_us);
+	stream_stats_max(&stats->resubmit_us_max, latency_us);
+}
 
-	if( result != 0 )
+static uint8_t* allocate_buffer(hackrf_device* device)
+{
+	switch(device->buffer_alloc_used)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+	case HACKRF_BUFFER_ALLOC_DEV_MEM:
+#ifdef HACKRF_HAVE_DEV_MEM
+		/* NULL when usbfs has no zero-copy support or its memory limit is hit */
+		if( device->loopback )
+		{
+			return NULL;
+		}
+		return libusb_dev_mem_alloc(device->usb_device, device->buffer_size);
+#else
+		return NULL;
+#endif
+
+	case HACKRF_BUFFER_ALLOC_LOCKED:
+	case HACKRF_BUFFER_ALLOC_ALIGNED:
+#ifndef _WIN32
+		{
+			void* buffer = NULL;
+			if( posix_memalign(&buffer, sysconf(_SC_PAGESIZE), device->buffer_size) != 0 )
+			{
+				return NULL;
+			}
+			if( (device->buffer_alloc_used == HACKRF_BUFFER_ALLOC_LOCKED) &&
+				(mlock(buffer, device->buffer_size) != 0) )
+			{
+				/* Usually RLIMIT_MEMLOCK */
+				free(buffer);
+				return NULL;
+			}
+			return (uint8_t*)buffer;
+		}
+#else
+		return NULL;
+#endif
+
+	default:
+		return (uint8_t*)malloc(device->buffer_size);
 	}
 }
 
-int ADDCALL hackrf_spiflash_erase(hackrf_device* device)
+static void free_buffers(hackrf_device* device)
 {
-	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SPIFLASH_ERASE,
-		0,
-		0,
-		NULL,
-		0,
-		0
-	);
+	if( device->buffers == NULL )
+	{
+		return;
+	}
 
-	if (result != 0)
+	if( device->buffer_alloc_used == HACKRF_BUFFER_ALLOC_HUGEPAGE )
 	{
-		return HACKRF_ERROR_LIBUSB;
+#ifndef _WIN32
+		if( device->buffer_region != NULL )
+		{
+			munmap(device->buffer_region, device->buffer_region_size);
+		}
+#endif
+		device->buffer_region = NULL;
+		device->buffer_region_size = 0;
 	} else {
-		return HACKRF_SUCCESS;
+		for(uint32_t buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+		{
+			uint8_t* const buffer = device->buffers[buffer_index];
+			if( buffer == NULL )
+			{
+				continue;
+			}
+
+			switch(device->buffer_alloc_used)
+			{
+			case HACKRF_BUFFER_ALLOC_DEV_MEM:
+#ifdef HACKRF_HAVE_DEV_MEM
+				libusb_dev_mem_free(device->usb_device, buffer, device->buffer_size);
+#endif
+				break;
+
+			case HACKRF_BUFFER_ALLOC_LOCKED:
+#ifndef _WIN32
+				munlock(buffer, device->buffer_size);
+#endif
+				free(buffer);
+				break;
+
+			default:
+				free(buffer);
+				break;
+			}
+		}
 	}
+
+	memset(device->buffers, 0, device->buffer_count * sizeof(uint8_t*));
 }
 
-int ADDCALL hackrf_spiflash_write(hackrf_device* device, const uint32_t address,
-		const uint16_t length, unsigned char* const data)
+static int allocate_buffers_mode(hackrf_device* device)
 {
-	int result;
-	
-	if (address > 0x0FFFFF)
+	if( device->buffer_alloc_used == HACKRF_BUFFER_ALLOC_HUGEPAGE )
 	{
-		return HACKRF_ERROR_INVALID_PARAM;
+#if !defined(_WIN32) && defined(MAP_HUGETLB)
+		/* One mapping carved into buffers, a huge page per buffer would waste most of it */
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_POPULATE
+		flags |= MAP_POPULATE;
+#endif
+		const size_t size = (size_t)device->buffer_count * device->buffer_size;
+		device->buffer_region_size = ((size + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE) * HUGEPAGE_SIZE;
+		void* const region = mmap(NULL, device->buffer_region_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if( region == MAP_FAILED )
+		{
+			/* No huge pages reserved (vm.nr_hugepages) */
+			device->buffer_region_size = 0;
+			return HACKRF_ERROR_NO_MEM;
+		}
+		/* Huge pages are never swapped, no mlock() needed */
+		device->buffer_region = (uint8_t*)region;
+		for(uint32_t buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+		{
+			device->buffers[buffer_index] = &device->buffer_region[(size_t)buffer_index * device->buffer_size];
+		}
+		return HACKRF_SUCCESS;
+#else
+		return HACKRF_ERROR_NO_MEM;
+#endif
 	}
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SPIFLASH_WRITE,
-		address >> 16,
-		address & 0xFFFF,
-		data,
-		length,
-		0
-	);
+	for(uint32_t buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+	{
+		device->buffers[buffer_index] = allocate_buffer(device);
+		if( device->buffers[buffer_index] == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+	}
+	return HACKRF_SUCCESS;
+}
 
-	if (result < length)
+/* Try the requested mode, then each simpler one down to malloc() */
+static int allocate_buffers(hackrf_device* device)
+{
+	int mode;
+
+	for(mode=device->buffer_alloc; mode>=HACKRF_BUFFER_ALLOC_MALLOC; mode--)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		device->buffer_alloc_used = (enum hackrf_buffer_alloc)mode;
+		if( allocate_buffers_mode(device) == HACKRF_SUCCESS )
+		{
+			return HACKRF_SUCCESS;
+		}
+		free_buffers(device);
 	}
+	return HACKRF_ERROR_NO_MEM;
 }
 
-int ADDCALL hackrf_spiflash_read(hackrf_device* device, const uint32_t address,
-		const uint16_t length, unsigned char* data)
+static int set_thread_affinity(pthread_t thread, const int cpu)
 {
-	int result;
-	
-	if (address > 0x0FFFFF)
+#ifdef __linux__
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if( cpu < 0 )
+	{
+		/* Any CPU */
+		for(int cpu_index=0; cpu_index<CPU_SETSIZE; cpu_index++)
+		{
+			CPU_SET(cpu_index, &cpu_set);
+		}
+	} else {
+		CPU_SET(cpu, &cpu_set);
+	}
+	if( pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) != 0 )
 	{
 		return HACKRF_ERROR_INVALID_PARAM;
 	}
+	return HACKRF_SUCCESS;
+#else
+	(void)thread;
+	(void)cpu;
+	return HACKRF_ERROR_OTHER;
+#endif
+}
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SPIFLASH_READ,
-		address >> 16,
-		address & 0xFFFF,
-		data,
-		length,
-		0
-	);
+static int cancel_transfers(hackrf_device* device)
+{
+	uint32_t transfer_index;
 
-	if (result < length)
+	if( device->transfers != NULL )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
+		{
+			if( device->transfers[transfer_index] != NULL )
+			{
+				usb_cancel_transfer(device, device->transfers[transfer_index]);
+			}
+		}
 		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_OTHER;
 	}
 }
 
-int ADDCALL hackrf_cpld_write(hackrf_device* device, const uint16_t length,
-		unsigned char* const data, const uint16_t total_length)
+static int free_transfers(hackrf_device* device)
 {
-	int result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_CPLD_WRITE,
+	uint32_t transfer_index;
+
+	if( device->transfers != NULL )
+	{
+		// libusb_close() should free all transfers referenced from this array.
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
+		{
+			if( device->transfers[transfer_index] != NULL )
+			{
+				device->transfers[transfer_index]->buffer = NULL;
+				libusb_free_transfer(device->transfers[transfer_index]);
+				device->transfers[transfer_index] = NULL;
+			}
+		}
+		free(device->transfers);
+		device->transfers = NULL;
+	}
+
+	/* Buffers are not flagged LIBUSB_TRANSFER_FREE_BUFFER */
+	if( device->buffers != NULL )
+	{
+		free_buffers(device);
+		free(device->buffers);
+		device->buffers = NULL;
+		device->buffer_count = 0;
+	}
+	free(device->buffer_lent);
+	device->buffer_lent = NULL;
+	free(device->lend_pool);
+	device->lend_pool = NULL;
+	device->lend_pool_count = 0;
+	free(device->parked);
+	device->parked = NULL;
+	device->parked_count = 0;
+
+	free(device->ring_full.entries);
+	device->ring_full.entries = NULL;
+	free(device->ring_free.entries);
+	device->ring_free.entries = NULL;
+
+	return HACKRF_SUCCESS;
+}
+
+static int allocate_ring(hackrf_ring* const ring, const uint32_t count)
+{
+	uint32_t size = 1;
+
+	/* Power of 2 so head/tail wrap with a mask */
+	while( size < count )
+	{
+		size <<= 1;
+	}
+
+	ring->entries = (hackrf_ring_entry*)calloc(size, sizeof(hackrf_ring_entry));
+	if( ring->entries == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	return HACKRF_SUCCESS;
+}
+
+static uint32_t ring_level(const hackrf_ring* const ring)
+{
+	return ring->head - ring->tail;
+}
+
+static bool ring_push(hackrf_ring* const ring, const hackrf_ring_entry* const entry)
+{
+	const uint32_t head = ring->head;
+
+	if( (head - ring->tail) > ring->mask )
+	{
+		return false;
+	}
+	ring->entries[head & ring->mask] = *entry;
+	/* Entry must be visible before the consumer sees the new head */
+	__sync_synchronize();
+	ring->head = head + 1;
+	return true;
+}
+
+static bool ring_pop(hackrf_ring* const ring, hackrf_ring_entry* const entry)
+{
+	const uint32_t tail = ring->tail;
+
+	if( ring->head == tail )
+	{
+		return false;
+	}
+	__sync_synchronize();
+	*entry = ring->entries[tail & ring->mask];
+	/* Entry must be read before the producer may overwrite it */
+	__sync_synchronize();
+	ring->tail = tail + 1;
+	return true;
+}
+
+static int buffer_find(hackrf_device* device, const uint8_t* const buffer)
+{
+	for(uint32_t buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+	{
+		if( device->buffers[buffer_index] == buffer )
+		{
+			return (int)buffer_index;
+		}
+	}
+	return -1;
+}
+
+static bool buffers_lent(hackrf_device* device)
+{
+	for(uint32_t buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+	{
+		if( device->buffer_lent[buffer_index] != false )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Mark buffer as owned by the application */
+static void buffer_lend(hackrf_device* device, const uint8_t* const buffer)
+{
+	const int buffer_index = buffer_find(device, buffer);
+
+	if( buffer_index >= 0 )
+	{
+		pthread_mutex_lock(&device->lend_mutex);
+		device->buffer_lent[buffer_index] = true;
+		pthread_mutex_unlock(&device->lend_mutex);
+	}
+}
+
+static uint8_t* lend_pool_pop(hackrf_device* device)
+{
+	uint8_t* buffer = NULL;
+
+	pthread_mutex_lock(&device->lend_mutex);
+	if( device->lend_pool_count > 0 )
+	{
+		buffer = device->lend_pool[--device->lend_pool_count];
+	}
+	pthread_mutex_unlock(&device->lend_mutex);
+
+	return buffer;
+}
+
+static int allocate_transfers(hackrf_device* const device)
+{
+	if( device->transfers == NULL )
+	{
+		device->transfers = (libusb_transfer**) calloc(device->transfer_count, sizeof(struct libusb_transfer*));
+		if( device->transfers == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+
+		/* One buffer per transfer plus the ring mode and lending spares */
+		device->buffer_count = device->transfer_count + device->ring_depth + device->lend_depth;
+		device->buffers = (uint8_t**) calloc(device->buffer_count, sizeof(uint8_t*));
+		device->buffer_lent = (bool*) calloc(device->buffer_count, sizeof(bool));
+		device->lend_pool = (uint8_t**) calloc(device->buffer_count, sizeof(uint8_t*));
+		device->parked = (libusb_transfer**) calloc(device->transfer_count, sizeof(struct libusb_transfer*));
+		if( (device->buffers == NULL) || (device->buffer_lent == NULL) ||
+			(device->lend_pool == NULL) || (device->parked == NULL) )
+		{
+			free_transfers(device);
+			return HACKRF_ERROR_NO_MEM;
+		}
+
+		if( allocate_buffers(device) != HACKRF_SUCCESS )
+		{
+			free_transfers(device);
+			return HACKRF_ERROR_NO_MEM;
+		}
+
+		if( device->ring_depth > 0 )
+		{
+			if( (allocate_ring(&device->ring_full, device->buffer_count) != HACKRF_SUCCESS) ||
+				(allocate_ring(&device->ring_free, device->buffer_count) != HACKRF_SUCCESS) )
+			{
+				free_transfers(device);
+				return HACKRF_ERROR_NO_MEM;
+			}
+		}
+
+		for(uint32_t transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
+		{
+			device->transfers[transfer_index] = libusb_alloc_transfer(0);
+			if( device->transfers[transfer_index] == NULL )
+			{
+				free_transfers(device);
+				return HACKRF_ERROR_LIBUSB;
+			}
+
+			libusb_fill_bulk_transfer(
+				device->transfers[transfer_index],
+				device->usb_device,
+				0,
+				device->buffers[transfer_index],
+				device->buffer_size,
+				NULL,
+				device,
+				0
+			);
+		}
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_BUSY;
+	}
+}
+
+static int prepare_transfers(
+	hackrf_device* device,
+	const uint_fast8_t endpoint_address,
+	libusb_transfer_cb_fn callback)
+{
+	int error;
+	uint32_t buffer_index;
+	uint32_t available;
+	if( device->transfers != NULL )
+	{
+		/* Buffers still retained by the application are skipped */
+		available = 0;
+		for(buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+		{
+			if( device->buffer_lent[buffer_index] == false )
+			{
+				available++;
+			}
+		}
+		if( available < device->transfer_count )
+		{
+			return HACKRF_ERROR_BUSY;
+		}
+
+		device->ring_full.head = device->ring_full.tail = 0;
+		device->ring_free.head = device->ring_free.tail = 0;
+		memset(&device->ring_stats, 0, sizeof(device->ring_stats));
+		device->ring_stats.depth = device->ring_depth;
+		/* Event thread is not running, nothing else writes the counters */
+		memset(&device->stream_stats, 0, sizeof(device->stream_stats));
+		memset(&device->frame_stats, 0, sizeof(device->frame_stats));
+		device->frame_sync = false;
+		device->lend_pool_count = 0;
+		device->parked_count = 0;
+
+		/* Transfers first, then ring mode spares, rest is the lending pool */
+		uint32_t transfer_index = 0;
+		uint32_t ring_count = 0;
+		for(buffer_index=0; buffer_index<device->buffer_count; buffer_index++)
+		{
+			uint8_t* const buffer = device->buffers[buffer_index];
+
+			if( device->buffer_lent[buffer_index] != false )
+			{
+				continue;
+			}
+
+			if( transfer_index < device->transfer_count )
+			{
+				device->transfers[transfer_index++]->buffer = buffer;
+			} else if( ring_count < device->ring_depth ) {
+				hackrf_ring_entry entry;
+				entry.buffer = buffer;
+				entry.valid_length = 0;
+				entry.sample_count = 0;
+				entry.dropped_samples = 0;
+				ring_push(&device->ring_free, &entry);
+				ring_count++;
+			} else {
+				device->lend_pool[device->lend_pool_count++] = buffer;
+			}
+		}
+
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
+		{
+			device->transfers[transfer_index]->endpoint = endpoint_address;
+			device->transfers[transfer_index]->callback = callback;
+
+			error = submit_transfer(device, device->transfers[transfer_index]);
+			if( error != 0 )
+			{
+				return HACKRF_ERROR_LIBUSB;
+			}
+		}
+		return HACKRF_SUCCESS;
+	} else {
+		// This shouldn't happen.
+		return HACKRF_ERROR_OTHER;
+	}
+}
+
+static bool serial_cache_lookup(const uint8_t bus_number, const uint8_t device_address, char* const serial_number)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&serial_cache_mutex);
+	for(uint32_t i=0; i<serial_cache_count; i++)
+	{
+		if( (serial_cache[i].bus_number == bus_number) &&
+			(serial_cache[i].device_address == device_address) )
+		{
+			memcpy(serial_number, serial_cache[i].serial_number, sizeof(serial_cache[i].serial_number));
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&serial_cache_mutex);
+
+	return found;
+}
+
+/* Cache is replaced by each listing, so unplugged boards drop out */
+static void serial_cache_update(const hackrf_device_list_t* const list)
+{
+	pthread_mutex_lock(&serial_cache_mutex);
+	serial_cache_count = 0;
+	for(int i=0; (i<list->device_count) && (serial_cache_count<SERIAL_CACHE_SIZE); i++)
+	{
+		const hackrf_device_info* const info = &list->devices[i];
+		if( info->serial_number[0] != '\0' )
+		{
+			serial_cache[serial_cache_count].bus_number = info->bus_number;
+			serial_cache[serial_cache_count].device_address = info->device_address;
+			memcpy(serial_cache[serial_cache_count].serial_number, info->serial_number, sizeof(info->serial_number));
+			serial_cache_count++;
+		}
+	}
+	pthread_mutex_unlock(&serial_cache_mutex);
+}
+
+static void serial_number_read(libusb_device* usb_device, const uint8_t string_index, char* const serial_number)
+{
+	libusb_device_handle* usb_device_handle;
+	read_partid_serialno_t read_partid_serialno;
+	int result;
+
+	serial_number[0] = '\0';
+	if( libusb_open(usb_device, &usb_device_handle) != 0 )
+	{
+		/* In use by another process or no permission */
+		return;
+	}
+
+	if( string_index != 0 )
+	{
+		result = libusb_get_string_descriptor_ascii(usb_device_handle, string_index,
+			(unsigned char*)serial_number, HACKRF_SERIAL_NUMBER_LENGTH + 1);
+		if( result < 0 )
+		{
+			serial_number[0] = '\0';
+		}
+	} else {
+		/* Firmware without iSerialNumber */
+		result = libusb_control_transfer(
+			usb_device_handle,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			HACKRF_VENDOR_REQUEST_BOARD_PARTID_SERIALNO_READ,
+			0,
+			0,
+			(unsigned char*)&read_partid_serialno,
+			sizeof(read_partid_serialno),
+			SERIAL_PROBE_TIMEOUT_MS
+		);
+		if( result == (int)sizeof(read_partid_serialno) )
+		{
+			snprintf(serial_number, HACKRF_SERIAL_NUMBER_LENGTH + 1, "%08x%08x%08x%08x",
+				read_partid_serialno.serial_no[0], read_partid_serialno.serial_no[1],
+				read_partid_serialno.serial_no[2], read_partid_serialno.serial_no[3]);
+		}
+	}
+
+	libusb_close(usb_device_handle);
+}
+
+/* Case insensitive suffix match, so the last digits on a label are enough */
+static bool serial_number_match(const char* const serial_number, const char* const wanted)
+{
+	const size_t length = strlen(serial_number);
+	const size_t wanted_length = strlen(wanted);
+
+	if( (wanted_length == 0) || (wanted_length > length) )
+	{
+		return false;
+	}
+	for(size_t i=0; i<wanted_length; i++)
+	{
+		if( tolower((unsigned char)serial_number[length - wanted_length + i]) != tolower((unsigned char)wanted[i]) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Index of the one board matching wanted, a suffix two boards share picks
+ * neither (HACKRF_ERROR_INVALID_PARAM) rather than whichever enumerates first */
+static int serial_number_find(const hackrf_device_list_t* const list, const char* const wanted, int* const idx)
+{
+	int matches = 0;
+
+	for(int i=0; i<list->device_count; i++)
+	{
+		if( serial_number_match(list->devices[i].serial_number, wanted) )
+		{
+			*idx = i;
+			matches++;
+		}
+	}
+
+	if( matches == 0 )
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	} else if( matches > 1 ) {
+		return HACKRF_ERROR_INVALID_PARAM;
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+/* Failed libusb_control_transfer() result, timeouts as the async requests report them */
+static int control_error(const int result)
+{
+	if( result == LIBUSB_ERROR_TIMEOUT )
+	{
+		return HACKRF_ERROR_TIMEOUT;
+	} else {
+		return HACKRF_ERROR_LIBUSB;
+	}
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_init(void)
+{
+	const int libusb_error = libusb_init(&g_libusb_context);
+	if( libusb_error != 0 )
+	{
+		return HACKRF_ERROR_LIBUSB;
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_exit(void)
+{
+	if( g_libusb_context != NULL )
+	{
+		libusb_exit(g_libusb_context);
+		g_libusb_context = NULL;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+static int hackrf_open_setup(libusb_device_handle* usb_device, libusb_context* usb_context,
+							const uint32_t flags, hackrf_device** device);
+
+hackrf_device_list_t* ADDCALL hackrf_device_list()
+{
+	libusb_device** usb_devices;
+	struct libusb_device_descriptor descriptor;
+	hackrf_device_list_t* list;
+	ssize_t usb_device_count;
+
+	usb_device_count = libusb_get_device_list(g_libusb_context, &usb_devices);
+	if( usb_device_count < 0 )
+	{
+		return NULL;
+	}
+
+	list = (hackrf_device_list_t*)calloc(1, sizeof(*list));
+	if( list != NULL )
+	{
+		list->devices = (hackrf_device_info*)calloc((usb_device_count > 0) ? usb_device_count : 1, sizeof(hackrf_device_info));
+		if( list->devices == NULL )
+		{
+			free(list);
+			list = NULL;
+		}
+	}
+	if( list == NULL )
+	{
+		libusb_free_device_list(usb_devices, 1);
+		return NULL;
+	}
+
+	for(ssize_t i=0; i<usb_device_count; i++)
+	{
+		libusb_device* const usb_device = usb_devices[i];
+		hackrf_device_info* const info = &list->devices[list->device_count];
+
+		if( (libusb_get_device_descriptor(usb_device, &descriptor) != 0) ||
+			(descriptor.idVendor != hackrf_usb_vid) ||
+			(descriptor.idProduct != hackrf_usb_pid) )
+		{
+			continue;
+		}
+
+		info->bus_number = libusb_get_bus_number(usb_device);
+		info->device_address = libusb_get_device_address(usb_device);
+		if( serial_cache_lookup(info->bus_number, info->device_address, info->serial_number) == false )
+		{
+			serial_number_read(usb_device, descriptor.iSerialNumber, info->serial_number);
+		}
+		info->usb_device = libusb_ref_device(usb_device);
+		list->device_count++;
+	}
+
+	libusb_free_device_list(usb_devices, 1);
+	serial_cache_update(list);
+
+	return list;
+}
+
+void ADDCALL hackrf_device_list_free(hackrf_device_list_t* list)
+{
+	if( list != NULL )
+	{
+		for(int i=0; i<list->device_count; i++)
+		{
+			libusb_unref_device((libusb_device*)list->devices[i].usb_device);
+		}
+		free(list->devices);
+		free(list);
+	}
+}
+
+int ADDCALL hackrf_device_list_open(hackrf_device_list_t* list, int idx, hackrf_device** device)
+{
+	libusb_device_handle* usb_device;
+
+	if( (list == NULL) || (device == NULL) || (idx < 0) || (idx >= list->device_count) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( libusb_open((libusb_device*)list->devices[idx].usb_device, &usb_device) != 0 )
+	{
+		return HACKRF_ERROR_LIBUSB;
+	}
+
+	return hackrf_open_setup(usb_device, g_libusb_context, 0, device);
+}
+
+int ADDCALL hackrf_open_by_serial(const char* const serial_number, hackrf_device** device)
+{
+	hackrf_device_list_t* list;
+	int idx;
+	int result;
+
+	if( device == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (serial_number == NULL) || (serial_number[0] == '\0') )
+	{
+		return hackrf_open(device);
+	}
+
+	list = hackrf_device_list();
+	if( list == NULL )
+	{
+		return HACKRF_ERROR_LIBUSB;
+	}
+
+	result = serial_number_find(list, serial_number, &idx);
+	if( result == HACKRF_SUCCESS )
+	{
+		result = hackrf_device_list_open(list, idx, device);
+	}
+
+	hackrf_device_list_free(list);
+	return result;
+}
+
+int ADDCALL hackrf_open(hackrf_device** device)
+{
+	return hackrf_open_ex(device, 0);
+}
+
+int ADDCALL hackrf_open_ex(hackrf_device** device, const uint32_t flags)
+{
+	libusb_context* usb_context = g_libusb_context;
+	
+	if( device == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( flags & HACKRF_OPEN_LOOPBACK )
+	{
+		/* No libusb at all, the stand-in handles its own events */
+		return hackrf_open_setup(NULL, NULL, HACKRF_OPEN_LOOPBACK, device);
+	}
+
+	if( flags & HACKRF_OPEN_OWN_CONTEXT )
+	{
+		/* Events of this device are then handled apart from all others */
+		if( libusb_init(&usb_context) != 0 )
+		{
+			return HACKRF_ERROR_LIBUSB;
+		}
+	}
+
+	libusb_device_handle* usb_device = libusb_open_device_with_vid_pid(usb_context, hackrf_usb_vid, hackrf_usb_pid);
+	if( usb_device == NULL )
+	{
+		if( flags & HACKRF_OPEN_OWN_CONTEXT )
+		{
+			libusb_exit(usb_context);
+		}
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+
+	return hackrf_open_setup(usb_device, usb_context, flags, device);
+}
+
+/* Takes ownership of usb_device (and usb_context with HACKRF_OPEN_OWN_CONTEXT),
+ * both NULL with HACKRF_OPEN_LOOPBACK */
+static int hackrf_open_setup(libusb_device_handle* usb_device, libusb_context* usb_context,
+							const uint32_t flags, hackrf_device** device)
+{
+	int result = 0;
+
+	//int speed = libusb_get_device_speed(usb_device);
+	// TODO: Error or warning if not high speed USB?
+
+	if( usb_device != NULL )
+	{
+		result = libusb_set_configuration(usb_device, 1);
+		if( result == 0 )
+		{
+			result = libusb_claim_interface(usb_device, 0);
+		}
+	}
+	if( result != 0 )
+	{
+		libusb_close(usb_device);
+		if( flags & HACKRF_OPEN_OWN_CONTEXT )
+		{
+			libusb_exit(usb_context);
+		}
+		return HACKRF_ERROR_LIBUSB;
+	}
+
+	hackrf_device* lib_device = NULL;
+	lib_device = (hackrf_device*)malloc(sizeof(*lib_device));
+	if( lib_device == NULL )
+	{
+		if( usb_device != NULL )
+		{
+			libusb_release_interface(usb_device, 0);
+			libusb_close(usb_device);
+		}
+		if( flags & HACKRF_OPEN_OWN_CONTEXT )
+		{
+			libusb_exit(usb_context);
+		}
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	lib_device->usb_context = usb_context;
+	lib_device->own_usb_context = ((flags & HACKRF_OPEN_OWN_CONTEXT) != 0);
+	lib_device->usb_device = usb_device;
+	lib_device->transfers = NULL;
+	lib_device->buffers = NULL;
+	lib_device->buffer_lent = NULL;
+	lib_device->buffer_count = 0;
+	lib_device->buffer_alloc = HACKRF_BUFFER_ALLOC_MALLOC;
+	lib_device->buffer_alloc_used = HACKRF_BUFFER_ALLOC_MALLOC;
+	lib_device->buffer_region = NULL;
+	lib_device->buffer_region_size = 0;
+	lib_device->callback = NULL;
+	lib_device->transfer_thread_started = false;
+	/* Transfers are allocated on first start, see hackrf_set_transfer_params() */
+	lib_device->transfer_count = HACKRF_TRANSFER_COUNT_DEFAULT;
+	lib_device->buffer_size = HACKRF_TRANSFER_BUFFER_SIZE_DEFAULT;
+	lib_device->streaming = false;
+	lib_device->ring_depth = 0;
+	lib_device->ring_tx = false;
+	memset(&lib_device->ring_full, 0, sizeof(lib_device->ring_full));
+	memset(&lib_device->ring_free, 0, sizeof(lib_device->ring_free));
+	memset(&lib_device->ring_stats, 0, sizeof(lib_device->ring_stats));
+	memset(&lib_device->stream_stats, 0, sizeof(lib_device->stream_stats));
+	lib_device->framed = false;
+	lib_device->frame_sync = false;
+	memset(&lib_device->frame_stats, 0, sizeof(lib_device->frame_stats));
+	lib_device->sweep = false;
+	lib_device->regs_cache_enabled = false;
+	memset(lib_device->regs_cache, 0, sizeof(lib_device->regs_cache));
+	lib_device->sample_rate_hz = HACKRF_SAMPLE_RATE_DEFAULT_HZ;
+	lib_device->decimation = 1;
+	lib_device->ring_thread_started = false;
+	lib_device->ring_sleeping = false;
+	lib_device->sync_mode = false;
+	lib_device->sync_entry_valid = false;
+	lib_device->sync_offset = 0;
+	lib_device->lend_depth = 0;
+	lib_device->lend_pool = NULL;
+	lib_device->lend_pool_count = 0;
+	lib_device->parked = NULL;
+	lib_device->parked_count = 0;
+	pthread_mutex_init(&lib_device->lend_mutex, NULL);
+	pthread_mutex_init(&lib_device->ring_mutex, NULL);
+	pthread_cond_init(&lib_device->ring_cond, NULL);
+	lib_device->control_timeout_ms = 0;
+	lib_device->controls = NULL;
+	pthread_mutex_init(&lib_device->control_mutex, NULL);
+	pthread_cond_init(&lib_device->control_cond, NULL);
+	lib_device->iq_correction = false;
+	memset(lib_device->iq_cache, 0, sizeof(lib_device->iq_cache));
+	lib_device->iq_cache[0].used = true;
+	lib_device->iq_current = 0;
+	lib_device->iq_previous = 0;
+	lib_device->iq_stale = 0;
+	lib_device->iq_clock = 0;
+	pthread_mutex_init(&lib_device->iq_mutex, NULL);
+	lib_device->freq_table_count = 0;
+	lib_device->do_exit = false;
+	lib_device->transfers_active = 0;
+	lib_device->event_thread_cpu = -1;
+	lib_device->loopback = ((flags & HACKRF_OPEN_LOOPBACK) != 0);
+	pthread_mutex_init(&lib_device->loopback_mutex, NULL);
+	pthread_cond_init(&lib_device->loopback_cond, NULL);
+	lib_device->loopback_queue_head = 0;
+	lib_device->loopback_queue_count = 0;
+	lib_device->loopback_queue_special = 0;
+	lib_device->loopback_queue_samples = 0;
+	lib_device->loopback_running = false;
+	lib_device->loopback_framed = false;
+	lib_device->loopback_rate_hz = 0;
+	lib_device->loopback_start_us = 0;
+	lib_device->loopback_made = 0;
+	lib_device->loopback_buffered = 0;
+	lib_device->loopback_sample_count = 0;
+	lib_device->loopback_overrun = false;
+
+	*device = lib_device;
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_event_thread_affinity(hackrf_device* device, const int cpu)
+{
+	int result;
+
+#ifdef __linux__
+	if( cpu >= CPU_SETSIZE )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+#endif
+
+	if( device->transfer_thread_started != false )
+	{
+		/* Move the running thread, else applied on next start */
+		result = set_thread_affinity(device->transfer_thread, cpu);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+	} else {
+#ifndef __linux__
+		return HACKRF_ERROR_OTHER;
+#endif
+	}
+
+	device->event_thread_cpu = (cpu < 0) ? -1 : cpu;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_transfer_params(hackrf_device* device, const uint32_t transfer_count, const uint32_t buffer_size)
+{
+	if( (transfer_count == 0) || (transfer_count > HACKRF_TRANSFER_COUNT_MAX) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (buffer_size == 0) || (buffer_size > HACKRF_TRANSFER_BUFFER_SIZE_MAX) ||
+		((buffer_size % HACKRF_TRANSFER_BUFFER_SIZE_GRANULARITY) != 0) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (device->transfer_thread_started != false) || buffers_lent(device) )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( (transfer_count != device->transfer_count) || (buffer_size != device->buffer_size) )
+	{
+		/* Release the old pool, a new one is allocated on next start */
+		free_transfers(device);
+		device->transfer_count = transfer_count;
+		device->buffer_size = buffer_size;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_get_transfer_params(hackrf_device* device, uint32_t* transfer_count, uint32_t* buffer_size)
+{
+	if( (transfer_count == NULL) || (buffer_size == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	*transfer_count = device->transfer_count;
+	*buffer_size = device->buffer_size;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_ring_mode(hackrf_device* device, const uint32_t ring_depth)
+{
+	if( ring_depth > HACKRF_RING_DEPTH_MAX )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (device->transfer_thread_started != false) || buffers_lent(device) )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( ring_depth != device->ring_depth )
+	{
+		/* Spare buffers are part of the pool, reallocate on next start */
+		free_transfers(device);
+		device->ring_depth = ring_depth;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_lend_pool(hackrf_device* device, const uint32_t lend_depth)
+{
+	if( lend_depth > HACKRF_LEND_DEPTH_MAX )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (device->transfer_thread_started != false) || buffers_lent(device) )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( lend_depth != device->lend_depth )
+	{
+		free_transfers(device);
+		device->lend_depth = lend_depth;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_release_buffer(hackrf_device* device, uint8_t* buffer)
+{
+	struct libusb_transfer* usb_transfer = NULL;
+	const int buffer_index = (buffer != NULL) ? buffer_find(device, buffer) : -1;
+
+	if( buffer_index < 0 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&device->lend_mutex);
+	if( device->buffer_lent[buffer_index] == false )
+	{
+		pthread_mutex_unlock(&device->lend_mutex);
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	device->buffer_lent[buffer_index] = false;
+
+	/* Submitted under lend_mutex: kill_transfer_thread() sets do_exit under
+	 * it too, so the transfer is either in flight before the stop cancels
+	 * and reaps, or stays parked. */
+	if( (device->parked_count > 0) && (device->streaming) && (device->do_exit == false) )
+	{
+		/* A transfer ran out of spare buffers, restart it with this one */
+		usb_transfer = device->parked[--device->parked_count];
+		usb_transfer->buffer = buffer;
+		if( submit_transfer(device, usb_transfer) < 0 )
+		{
+			request_exit(device);
+			pthread_mutex_unlock(&device->lend_mutex);
+			return HACKRF_ERROR_LIBUSB;
+		}
+	} else {
+		device->lend_pool[device->lend_pool_count++] = buffer;
+	}
+	pthread_mutex_unlock(&device->lend_mutex);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_buffer_alloc(hackrf_device* device, const enum hackrf_buffer_alloc buffer_alloc)
+{
+	if( (buffer_alloc < HACKRF_BUFFER_ALLOC_MALLOC) || (buffer_alloc > HACKRF_BUFFER_ALLOC_DEV_MEM) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (device->transfer_thread_started != false) || buffers_lent(device) )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( buffer_alloc != device->buffer_alloc )
+	{
+		free_transfers(device);
+		device->buffer_alloc = buffer_alloc;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_get_buffer_alloc(hackrf_device* device, enum hackrf_buffer_alloc* buffer_alloc)
+{
+	if( buffer_alloc == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( device->buffers == NULL )
+	{
+		/* Not allocated before first start */
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	*buffer_alloc = device->buffer_alloc_used;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_get_ring_stats(hackrf_device* device, hackrf_ring_stats* stats)
+{
+	if( stats == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	/* Updated from the USB event and ring threads while streaming */
+	stats->depth = device->ring_depth;
+	stats->high_water = __sync_fetch_and_add(&device->ring_stats.high_water, 0);
+	stats->delivered = __sync_fetch_and_add(&device->ring_stats.delivered, 0);
+	stats->dropped = __sync_fetch_and_add(&device->ring_stats.dropped, 0);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_get_stream_stats(hackrf_device* device, hackrf_stream_stats* stats)
+{
+	hackrf_stream_stats* const counters = &device->stream_stats;
+	uint32_t i;
+
+	if( stats == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/* Atomic reads, 64-bit loads may tear on 32-bit hosts otherwise */
+	stats->transfers = __sync_fetch_and_add(&counters->transfers, 0);
+	stats->bytes = __sync_fetch_and_add(&counters->bytes, 0);
+	stats->short_transfers = __sync_fetch_and_add(&counters->short_transfers, 0);
+	for(i=0; i<HACKRF_STREAM_STATS_STATUS_COUNT; i++)
+	{
+		stats->status[i] = __sync_fetch_and_add(&counters->status[i], 0);
+	}
+	for(i=0; i<HACKRF_STREAM_STATS_HISTOGRAM_BINS; i++)
+	{
+		stats->callback_us[i] = __sync_fetch_and_add(&counters->callback_us[i], 0);
+	}
+	stats->callback_us_max = __sync_fetch_and_add(&counters->callback_us_max, 0);
+	stats->resubmits = __sync_fetch_and_add(&counters->resubmits, 0);
+	stats->resubmit_us_total = __sync_fetch_and_add(&counters->resubmit_us_total, 0);
+	stats->resubmit_us_max = __sync_fetch_and_add(&counters->resubmit_us_max, 0);
+	stats->resubmit_failures = __sync_fetch_and_add(&counters->resubmit_failures, 0);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_framed_mode(hackrf_device* device, const uint8_t value)
+{
+	int result;
+
+	if( value > 1 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( device->transfer_thread_started != false )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SET_FRAMED_MODE,
+		value,
+		0,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if (result != 0)
+	{
+		return control_error(result);
+	} else {
+		device->framed = (value != 0);
+		return HACKRF_SUCCESS;
+	}
+}
+
+typedef struct {
+	uint32_t start_mhz;
+	uint32_t stop_mhz;
+	uint32_t step_hz;
+	uint16_t dwell_blocks;
+	uint16_t settle_blocks;
+} set_sweep_params_t;
+
+int ADDCALL hackrf_set_sweep(hackrf_device* device, const uint32_t start_mhz, const uint32_t stop_mhz,
+	const uint32_t step_hz, const uint16_t dwell_blocks, const uint16_t settle_blocks)
+{
+	set_sweep_params_t set_sweep_params;
+	uint8_t length;
+	int result;
+
+	if( (dwell_blocks != 0) && ((start_mhz > stop_mhz) || (step_hz == 0)) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( device->transfer_thread_started != false )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( dwell_blocks != 0 )
+	{
+		result = hackrf_set_framed_mode(device, 1);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+	}
+
+	set_sweep_params.start_mhz = start_mhz;
+	set_sweep_params.stop_mhz = stop_mhz;
+	set_sweep_params.step_hz = step_hz;
+	set_sweep_params.dwell_blocks = dwell_blocks;
+	set_sweep_params.settle_blocks = settle_blocks;
+	length = sizeof(set_sweep_params_t);
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SET_SWEEP,
+		0,
+		0,
+		(unsigned char*)&set_sweep_params,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length)
+	{
+		return control_error(result);
+	} else {
+		device->sweep = (dwell_blocks != 0);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_get_frame_stats(hackrf_device* device, hackrf_frame_stats* stats)
+{
+	hackrf_frame_stats* const counters = &device->frame_stats;
+
+	if( stats == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	stats->blocks = __sync_fetch_and_add(&counters->blocks, 0);
+	stats->overruns = __sync_fetch_and_add(&counters->overruns, 0);
+	stats->dropped_samples = __sync_fetch_and_add(&counters->dropped_samples, 0);
+	stats->bad_headers = __sync_fetch_and_add(&counters->bad_headers, 0);
+	stats->next_sample_count = __sync_fetch_and_add(&counters->next_sample_count, 0);
+	return HACKRF_SUCCESS;
+}
+
+static int regs_read(hackrf_device* device, const regs_chip_t chip, const uint32_t num_regs,
+	const uint16_t first, const uint16_t count, uint16_t* values);
+static int regs_write(hackrf_device* device, const regs_chip_t chip, const uint32_t num_regs,
+	const hackrf_register_write* regs, const uint32_t count);
+
+static uint32_t regs_num(const regs_chip_t chip)
+{
+	switch(chip)
+	{
+	case REGS_CHIP_MAX2837:
+		return HACKRF_MAX2837_NUM_REGS;
+	case REGS_CHIP_SI5351C:
+		return HACKRF_SI5351C_NUM_REGS;
+	default:
+		return HACKRF_RFFC5071_NUM_REGS;
+	}
+}
+
+/* Status and self clearing registers, always go to the chip */
+static bool regs_volatile(const regs_chip_t chip, const uint32_t register_number)
+{
+	return (chip == REGS_CHIP_SI5351C) &&
+		((register_number == 0) || (register_number == 1) || (register_number == 177));
+}
+
+/* Sends the pending writes of chips. Called before any request that makes
+ * the firmware reprogram them, so the writes land in program order and
+ * don't overwrite what the firmware sets. */
+static int regs_cache_flush(hackrf_device* device, const uint32_t chips)
+{
+	hackrf_register_write regs[HACKRF_SI5351C_NUM_REGS];
+	uint32_t chip;
+	uint32_t count;
+	uint32_t i;
+	int result;
+
+	for(chip = 0; chip < REGS_CHIP_COUNT; chip++)
+	{
+		regs_cache_t* const cache = &device->regs_cache[chip];
+
+		if( (chips & (1 << chip)) == 0 )
+		{
+			continue;
+		}
+
+		count = 0;
+		for(i = 0; i < regs_num((regs_chip_t)chip); i++)
+		{
+			if( cache->dirty[i] )
+			{
+				regs[count].register_number = (uint16_t)i;
+				regs[count].value = cache->value[i];
+				count++;
+			}
+		}
+		if( count == 0 )
+		{
+			continue;
+		}
+
+		/* Clears the dirty flags as the registers go out */
+		result = regs_write(device, (regs_chip_t)chip, regs_num((regs_chip_t)chip), regs, count);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+	}
+	return HACKRF_SUCCESS;
+}
+
+/* The firmware changed registers of chips by itself, after regs_cache_flush() */
+static void regs_cache_forget(hackrf_device* device, const uint32_t chips)
+{
+	uint32_t chip;
+
+	for(chip = 0; chip < REGS_CHIP_COUNT; chip++)
+	{
+		if( chips & (1 << chip) )
+		{
+			memset(&device->regs_cache[chip], 0, sizeof(regs_cache_t));
+		}
+	}
+}
+
+/* True if value was served from the cache. A miss loads the whole register
+ * file in one transfer. */
+static bool regs_cache_read(hackrf_device* device, const regs_chip_t chip,
+	const uint32_t register_number, uint16_t* value)
+{
+	regs_cache_t* const cache = &device->regs_cache[chip];
+	uint16_t values[HACKRF_SI5351C_NUM_REGS];
+	uint32_t i;
+
+	if( (device->regs_cache_enabled == false) || regs_volatile(chip, register_number) )
+	{
+		return false;
+	}
+	if( cache->valid[register_number] == false )
+	{
+		if( regs_read(device, chip, regs_num(chip), 0, (uint16_t)regs_num(chip), values) != HACKRF_SUCCESS )
+		{
+			/* Firmware without REGS_READ, caller reads the register alone */
+			return false;
+		}
+		for(i = 0; i < regs_num(chip); i++)
+		{
+			if( cache->dirty[i] == false )
+			{
+				cache->value[i] = values[i];
+				cache->valid[i] = true;
+			}
+		}
+	}
+	*value = cache->value[register_number];
+	return true;
+}
+
+/* Value read from or written to the chip */
+static void regs_cache_store(hackrf_device* device, const regs_chip_t chip,
+	const uint32_t register_number, const uint16_t value)
+{
+	regs_cache_t* const cache = &device->regs_cache[chip];
+
+	if( device->regs_cache_enabled && !regs_volatile(chip, register_number) )
+	{
+		cache->value[register_number] = value;
+		cache->valid[register_number] = true;
+		cache->dirty[register_number] = false;
+	}
+}
+
+/* True if the write was deferred to hackrf_register_cache_flush() */
+static bool regs_cache_write(hackrf_device* device, const regs_chip_t chip,
+	const uint32_t register_number, const uint16_t value)
+{
+	regs_cache_t* const cache = &device->regs_cache[chip];
+
+	if( (device->regs_cache_enabled == false) || regs_volatile(chip, register_number) )
+	{
+		return false;
+	}
+	cache->value[register_number] = value;
+	cache->valid[register_number] = true;
+	cache->dirty[register_number] = true;
+	return true;
+}
+
+int ADDCALL hackrf_register_cache_flush(hackrf_device* device)
+{
+	return regs_cache_flush(device, REGS_MASK_ALL);
+}
+
+int ADDCALL hackrf_register_cache_invalidate(hackrf_device* device)
+{
+	/* Pending writes must not be lost, nothing is dropped if they fail */
+	const int result = regs_cache_flush(device, REGS_MASK_ALL);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	regs_cache_forget(device, REGS_MASK_ALL);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_register_cache(hackrf_device* device, const uint8_t value)
+{
+	int result;
+
+	if( value > 1 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = hackrf_register_cache_invalidate(device);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	device->regs_cache_enabled = (value != 0);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_transceiver_mode(hackrf_device* device, hackrf_transceiver_mode value)
+{
+	int result;
+
+	/* Pending writes go out before the firmware reprograms the chips */
+	result = regs_cache_flush(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SET_TRANSCEIVER_MODE,
+		value,
+		0,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if( result != 0 )
+	{
+		return control_error(result);
+	} else {
+		/* Chips started, stopped or switched over */
+		regs_cache_forget(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_max2837_read(hackrf_device* device, uint8_t register_number, uint16_t* value)
+{
+	int result;
+
+	if( register_number >= 32 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( regs_cache_read(device, REGS_CHIP_MAX2837, register_number, value) )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_MAX2837_READ,
+		0,
+		register_number,
+		(unsigned char*)value,
+		2,
+		device->control_timeout_ms
+	);
+
+	if( result < 2 )
+	{
+		return control_error(result);
+	} else {
+		regs_cache_store(device, REGS_CHIP_MAX2837, register_number, *value);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_max2837_write(hackrf_device* device, uint8_t register_number, uint16_t value)
+{
+	int result;
+	
+	if( register_number >= 32 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( value >= 0x400 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( regs_cache_write(device, REGS_CHIP_MAX2837, register_number, value) )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_MAX2837_WRITE,
+		value,
+		register_number,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if( result != 0 )
+	{
+		return control_error(result);
+	} else {
+		regs_cache_store(device, REGS_CHIP_MAX2837, register_number, value);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_si5351c_read(hackrf_device* device, uint16_t register_number, uint16_t* value)
+{
+	uint8_t temp_value;
+	int result;
+	
+	if( register_number >= 256 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( regs_cache_read(device, REGS_CHIP_SI5351C, register_number, value) )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	temp_value = 0;
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SI5351C_READ,
+		0,
+		register_number,
+		(unsigned char*)&temp_value,
+		1,
+		device->control_timeout_ms
+	);
+
+	if( result < 1 )
+	{
+		return control_error(result);
+	} else {
+		*value = temp_value;
+		regs_cache_store(device, REGS_CHIP_SI5351C, register_number, *value);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_si5351c_write(hackrf_device* device, uint16_t register_number, uint16_t value)
+{
+	int result;
+	
+	if( register_number >= 256 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( value >= 256 ) {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( regs_cache_write(device, REGS_CHIP_SI5351C, register_number, value) )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SI5351C_WRITE,
+		value,
+		register_number,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if( result != 0 )
+	{
+		return control_error(result);
+	} else {
+		regs_cache_store(device, REGS_CHIP_SI5351C, register_number, value);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_sample_rate_set(hackrf_device* device, const uint32_t sampling_rate_hz)
+{
+	int result;
+
+	/* Pending writes go out before the firmware reprograms the chips */
+	result = regs_cache_flush(device, REGS_MASK_SI5351C);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SAMPLE_RATE_SET,
+		sampling_rate_hz & 0xffff,
+		sampling_rate_hz >> 16,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if( result != 0 )
+	{
+		return control_error(result);
+	} else {
+		device->sample_rate_hz = sampling_rate_hz;
+		regs_cache_forget(device, REGS_MASK_SI5351C);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_baseband_filter_bandwidth_set(hackrf_device* device, const uint32_t bandwidth_hz)
+{
+	int result;
+
+	/* Pending writes go out before the firmware reprograms the chips */
+	result = regs_cache_flush(device, REGS_MASK_MAX2837);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_BASEBAND_FILTER_BANDWIDTH_SET,
+		bandwidth_hz & 0xffff,
+		bandwidth_hz >> 16,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if( result != 0 )
+	{
+		return control_error(result);
+	} else {
+		regs_cache_forget(device, REGS_MASK_MAX2837);
+		return HACKRF_SUCCESS;
+	}
+}
+
+
+int ADDCALL hackrf_rffc5071_read(hackrf_device* device, uint8_t register_number, uint16_t* value)
+{
+	int result;
+	
+	if( register_number >= 31 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( regs_cache_read(device, REGS_CHIP_RFFC5071, register_number, value) )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_RFFC5071_READ,
+		0,
+		register_number,
+		(unsigned char*)value,
+		2,
+		device->control_timeout_ms
+	);
+
+	if( result < 2 )
+	{
+		return control_error(result);
+	} else {
+		regs_cache_store(device, REGS_CHIP_RFFC5071, register_number, *value);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_rffc5071_write(hackrf_device* device, uint8_t register_number, uint16_t value)
+{
+	int result;
+	
+	if( register_number >= 31 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( regs_cache_write(device, REGS_CHIP_RFFC5071, register_number, value) )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_RFFC5071_WRITE,
+		value,
+		register_number,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if( result != 0 )
+	{
+		return control_error(result);
+	} else {
+		regs_cache_store(device, REGS_CHIP_RFFC5071, register_number, value);
+		return HACKRF_SUCCESS;
+	}
+}
+
+/* Firmware buffer: 128 pairs written or 256 registers read per request */
+#define REGS_WRITE_BATCH_MAX (128)
+#define REGS_READ_BATCH_MAX (256)
+
+static int regs_write(hackrf_device* device, const regs_chip_t chip, const uint32_t num_regs,
+	const hackrf_register_write* regs, const uint32_t count)
+{
+	unsigned char data[REGS_WRITE_BATCH_MAX * 4];
+	uint32_t first;
+	uint32_t chunk;
+	uint32_t i;
+	uint16_t length;
+	int result;
+
+	if( (regs == NULL) && (count != 0) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	for(i = 0; i < count; i++)
+	{
+		if( regs[i].register_number >= num_regs )
+		{
+			return HACKRF_ERROR_INVALID_PARAM;
+		}
+	}
+
+	for(first = 0; first < count; first += chunk)
+	{
+		chunk = count - first;
+		if( chunk > REGS_WRITE_BATCH_MAX )
+		{
+			chunk = REGS_WRITE_BATCH_MAX;
+		}
+		for(i = 0; i < chunk; i++)
+		{
+			data[i * 4 + 0] = regs[first + i].register_number & 0xff;
+			data[i * 4 + 1] = regs[first + i].register_number >> 8;
+			data[i * 4 + 2] = regs[first + i].value & 0xff;
+			data[i * 4 + 3] = regs[first + i].value >> 8;
+		}
+		length = (uint16_t)(chunk * 4);
+
+		result = usb_control_transfer(
+			device,
+			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			HACKRF_VENDOR_REQUEST_REGS_WRITE,
+			chip,
+			0,
+			data,
+			length,
+			device->control_timeout_ms
+		);
+
+		if( result < length )
+		{
+			return control_error(result);
+		}
+		for(i = 0; i < chunk; i++)
+		{
+			regs_cache_store(device, chip, regs[first + i].register_number, regs[first + i].value);
+		}
+	}
+	return HACKRF_SUCCESS;
+}
+
+static int regs_read(hackrf_device* device, const regs_chip_t chip, const uint32_t num_regs,
+	const uint16_t first, const uint16_t count, uint16_t* values)
+{
+	unsigned char data[REGS_READ_BATCH_MAX * 2];
+	uint32_t done;
+	uint32_t chunk;
+	uint32_t i;
+	uint16_t length;
+	int result;
+
+	if( (values == NULL) || (((uint32_t)first + count) > num_regs) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	for(done = 0; done < count; done += chunk)
+	{
+		chunk = count - done;
+		if( chunk > REGS_READ_BATCH_MAX )
+		{
+			chunk = REGS_READ_BATCH_MAX;
+		}
+		length = (uint16_t)(chunk * 2);
+
+		result = usb_control_transfer(
+			device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			HACKRF_VENDOR_REQUEST_REGS_READ,
+			chip,
+			(uint16_t)(first + done),
+			data,
+			length,
+			device->control_timeout_ms
+		);
+
+		if( result < length )
+		{
+			return control_error(result);
+		}
+		for(i = 0; i < chunk; i++)
+		{
+			values[done + i] = (uint16_t)(data[i * 2] | (data[i * 2 + 1] << 8));
+		}
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_max2837_write_regs(hackrf_device* device, const hackrf_register_write* regs, const uint32_t count)
+{
+	return regs_write(device, REGS_CHIP_MAX2837, HACKRF_MAX2837_NUM_REGS, regs, count);
+}
+
+int ADDCALL hackrf_max2837_read_regs(hackrf_device* device, const uint16_t first, const uint16_t count, uint16_t* values)
+{
+	return regs_read(device, REGS_CHIP_MAX2837, HACKRF_MAX2837_NUM_REGS, first, count, values);
+}
+
+int ADDCALL hackrf_si5351c_write_regs(hackrf_device* device, const hackrf_register_write* regs, const uint32_t count)
+{
+	return regs_write(device, REGS_CHIP_SI5351C, HACKRF_SI5351C_NUM_REGS, regs, count);
+}
+
+int ADDCALL hackrf_si5351c_read_regs(hackrf_device* device, const uint16_t first, const uint16_t count, uint16_t* values)
+{
+	return regs_read(device, REGS_CHIP_SI5351C, HACKRF_SI5351C_NUM_REGS, first, count, values);
+}
+
+int ADDCALL hackrf_rffc5071_write_regs(hackrf_device* device, const hackrf_register_write* regs, const uint32_t count)
+{
+	return regs_write(device, REGS_CHIP_RFFC5071, HACKRF_RFFC5071_NUM_REGS, regs, count);
+}
+
+int ADDCALL hackrf_rffc5071_read_regs(hackrf_device* device, const uint16_t first, const uint16_t count, uint16_t* values)
+{
+	return regs_read(device, REGS_CHIP_RFFC5071, HACKRF_RFFC5071_NUM_REGS, first, count, values);
+}
+
+int ADDCALL hackrf_spiflash_erase(hackrf_device* device)
+{
+	int result;
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_ERASE,
+		0,
+		0,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if (result != 0)
+	{
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_spiflash_write(hackrf_device* device, const uint32_t address,
+		const uint16_t length, unsigned char* const data)
+{
+	int result;
+	
+	if (address > 0x0FFFFF)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_WRITE,
+		address >> 16,
+		address & 0xFFFF,
+		data,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length)
+	{
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_spiflash_read(hackrf_device* device, const uint32_t address,
+		const uint16_t length, unsigned char* data)
+{
+	int result;
+	
+	if (address > 0x0FFFFF)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_READ,
+		address >> 16,
+		address & 0xFFFF,
+		data,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length)
+	{
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_cpld_write(hackrf_device* device, const uint16_t length,
+		unsigned char* const data, const uint16_t total_length)
+{
+	int result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_CPLD_WRITE,
 		total_length,
 		0,
-		data,
-		length,
-		0
+		data,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length) {
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_board_id_read(hackrf_device* device, uint8_t* value)
+{
+	int result;
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_BOARD_ID_READ,
+		0,
+		0,
+		value,
+		1,
+		device->control_timeout_ms
+	);
+
+	if (result < 1)
+	{
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_version_string_read(hackrf_device* device, char* version,
+		uint8_t length)
+{
+	int result;
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_VERSION_STRING_READ,
+		0,
+		0,
+		(unsigned char*)version,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < 0)
+	{
+		return control_error(result);
+	} else {
+		version[result] = '\0';
+		return HACKRF_SUCCESS;
+	}
+}
+
+/* Switch the DC and IQ imbalance estimates to those of freq_hz, kept from
+ * the last time it was tuned or fresh ones. Call once the firmware has
+ * retuned: the transfers in flight then were (partly) captured before, they
+ * are corrected with the old estimates and do not update the new ones. */
+static void iq_retune(hackrf_device* device, const uint64_t freq_hz)
+{
+	iq_estimate_t* entry;
+	uint32_t slot = HACKRF_IQ_CORRECTION_CACHE_SIZE;
+	uint32_t i;
+
+	pthread_mutex_lock(&device->iq_mutex);
+	for(i = 0; i < HACKRF_IQ_CORRECTION_CACHE_SIZE; i++)
+	{
+		if( device->iq_cache[i].used && (device->iq_cache[i].freq_hz == freq_hz) )
+		{
+			slot = i;
+			break;
+		}
+	}
+	if( slot == HACKRF_IQ_CORRECTION_CACHE_SIZE )
+	{
+		/* Free entry or the least recently used one */
+		slot = 0;
+		for(i = 0; i < HACKRF_IQ_CORRECTION_CACHE_SIZE; i++)
+		{
+			if( device->iq_cache[i].used == false )
+			{
+				slot = i;
+				break;
+			}
+			if( device->iq_cache[i].last_use < device->iq_cache[slot].last_use )
+			{
+				slot = i;
+			}
+		}
+		entry = &device->iq_cache[slot];
+		memset(entry, 0, sizeof(iq_estimate_t));
+		entry->used = true;
+		entry->freq_hz = freq_hz;
+	}
+	device->iq_cache[slot].last_use = ++device->iq_clock;
+	if( slot != device->iq_current )
+	{
+		/* A replaced entry was reset above, it corrects nothing then */
+		device->iq_previous = device->iq_current;
+		device->iq_stale = (device->transfers_active > 0) ?
+			(uint32_t)device->transfers_active + IQ_RETUNE_STALE_EXTRA : 0;
+	}
+	device->iq_current = slot;
+	pthread_mutex_unlock(&device->iq_mutex);
+}
+
+/* 0 (unknown) for indexes past the table uploaded through this handle */
+static uint64_t freq_table_lookup(hackrf_device* device, const uint8_t index)
+{
+	return (index < device->freq_table_count) ? device->freq_table[index] : 0;
+}
+
+/* Q is made orthogonal to I, then scaled to the I power:
+ * q' = c2 * ((q - dc_q) - c1 * (i - dc_i)), c1 = E[iq] / E[ii],
+ * c2 = sqrt(E[ii] / E[(q - c1 * i)^2]). */
+static void iq_matrix(const iq_estimate_t* const estimate, hackrf_iq_matrix* const matrix)
+{
+	double c1 = 0.0;
+	double c2 = 1.0;
+	double qq;
+
+	if( estimate->ii > 0.0 )
+	{
+		c1 = estimate->iq / estimate->ii;
+		qq = estimate->qq - c1 * estimate->iq;
+		if( qq > 0.0 )
+		{
+			c2 = sqrt(estimate->ii / qq);
+		}
+	}
+
+	matrix->ii = 1.0f;
+	matrix->iq = 0.0f;
+	matrix->off_i = (float)-estimate->dc_i;
+	matrix->qi = (float)(-c2 * c1);
+	matrix->qq = (float)c2;
+	matrix->off_q = (float)(-c2 * (estimate->dc_q - c1 * estimate->dc_i));
+}
+
+/* RX buffer in place, in the event thread. Estimates come from the
+ * uncorrected samples. */
+static void iq_correct(hackrf_device* device, uint8_t* const buffer, const int length)
+{
+	const uint32_t count = (uint32_t)length / 2;
+	hackrf_iq_moments moments;
+	hackrf_iq_matrix matrix;
+	iq_estimate_t* estimate;
+	double mean_i, mean_q;
+	double alpha;
+
+	if( count == 0 )
+	{
+		return;
+	}
+
+	memset(&moments, 0, sizeof(moments));
+	hackrf_convert_cs8_moments((const int8_t*)buffer, count, &moments);
+	mean_i = (double)moments.sum_i / count;
+	mean_q = (double)moments.sum_q / count;
+
+	pthread_mutex_lock(&device->iq_mutex);
+	if( device->iq_stale > 0 )
+	{
+		/* From before the retune, see iq_retune() */
+		device->iq_stale--;
+		estimate = &device->iq_cache[device->iq_previous];
+	} else {
+		estimate = &device->iq_cache[device->iq_current];
+		alpha = (estimate->blocks == 0) ? 1.0 : IQ_CORRECTION_ALPHA;
+		estimate->dc_i += alpha * (mean_i - estimate->dc_i);
+		estimate->dc_q += alpha * (mean_q - estimate->dc_q);
+		estimate->ii += alpha * ((double)moments.sum_ii / count - mean_i * mean_i - estimate->ii);
+		estimate->qq += alpha * ((double)moments.sum_qq / count - mean_q * mean_q - estimate->qq);
+		estimate->iq += alpha * ((double)moments.sum_iq / count - mean_i * mean_q - estimate->iq);
+		estimate->blocks++;
+		estimate->last_use = ++device->iq_clock;
+	}
+	iq_matrix(estimate, &matrix);
+	pthread_mutex_unlock(&device->iq_mutex);
+
+	hackrf_convert_cs8_iq_correct((const int8_t*)buffer, (int8_t*)buffer, count, &matrix);
+}
+
+int ADDCALL hackrf_set_iq_correction(hackrf_device* device, const uint8_t value)
+{
+	if( value > 1 )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	device->iq_correction = (value != 0);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_get_iq_correction(hackrf_device* device, hackrf_iq_correction* value)
+{
+	const iq_estimate_t* estimate;
+
+	if( value == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&device->iq_mutex);
+	estimate = &device->iq_cache[device->iq_current];
+	memset(value, 0, sizeof(hackrf_iq_correction));
+	value->freq_hz = estimate->freq_hz;
+	value->blocks = estimate->blocks;
+	value->dc_i = (float)estimate->dc_i;
+	value->dc_q = (float)estimate->dc_q;
+	value->gain = 1.0f;
+	if( (estimate->ii > 0.0) && (estimate->qq > 0.0) )
+	{
+		value->gain = (float)sqrt(estimate->qq / estimate->ii);
+		value->phase_deg = (float)(asin(estimate->iq / sqrt(estimate->ii * estimate->qq)) * (180.0 / 3.14159265358979323846));
+	}
+	pthread_mutex_unlock(&device->iq_mutex);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_iq_correction_reset(hackrf_device* device)
+{
+	uint64_t freq_hz;
+
+	pthread_mutex_lock(&device->iq_mutex);
+	freq_hz = device->iq_cache[device->iq_current].freq_hz;
+	memset(device->iq_cache, 0, sizeof(device->iq_cache));
+	device->iq_cache[0].used = true;
+	device->iq_cache[0].freq_hz = freq_hz;
+	device->iq_current = 0;
+	device->iq_previous = 0;
+	device->iq_stale = 0;
+	device->iq_clock = 0;
+	pthread_mutex_unlock(&device->iq_mutex);
+
+	return HACKRF_SUCCESS;
+}
+
+typedef struct {
+	uint32_t freq_mhz; /* From 30 to 6000MHz */
+	uint32_t freq_hz; /* From 0 to 999999Hz */
+	/* Final Freq = freq_mhz+freq_hz */
+} set_freq_params_t;
+#define FREQ_ONE_MHZ	(1000*1000ull)
+
+int ADDCALL hackrf_set_freq(hackrf_device* device, const uint64_t freq_hz)
+{
+	uint32_t l_freq_mhz;
+	uint32_t l_freq_hz;
+	set_freq_params_t set_freq_params;
+	uint8_t length;
+	int result;
+	
+	/* Convert Freq Hz 64bits to Freq MHz (32bits) & Freq Hz (32bits) */
+	l_freq_mhz = (uint32_t)(freq_hz / FREQ_ONE_MHZ);
+	l_freq_hz = (uint32_t)(freq_hz - (((uint64_t)l_freq_mhz) * FREQ_ONE_MHZ));
+	set_freq_params.freq_mhz = l_freq_mhz;
+	set_freq_params.freq_hz = l_freq_hz;
+	length = sizeof(set_freq_params_t);
+
+	/* Pending writes go out before the firmware reprograms the chips */
+	result = regs_cache_flush(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SET_FREQ,
+		0,
+		0,
+		(unsigned char*)&set_freq_params,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length)
+	{
+		return control_error(result);
+	} else {
+		regs_cache_forget(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+		iq_retune(device, freq_hz);
+		return HACKRF_SUCCESS;
+	}
+}
+
+/* Entries per FREQ_TABLE_WRITE request, the firmware buffer size */
+#define FREQ_TABLE_WRITE_MAX (32)
+
+int ADDCALL hackrf_set_freq_table(hackrf_device* device, const uint64_t* freqs_hz, const uint32_t count)
+{
+	set_freq_params_t params[FREQ_TABLE_WRITE_MAX];
+	uint32_t first;
+	uint32_t chunk;
+	uint32_t i;
+	uint16_t length;
+	int result;
+
+	if( (freqs_hz == NULL) || (count == 0) || (count > HACKRF_FREQ_TABLE_MAX) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	for(first = 0; first < count; first += chunk)
+	{
+		chunk = count - first;
+		if( chunk > FREQ_TABLE_WRITE_MAX )
+		{
+			chunk = FREQ_TABLE_WRITE_MAX;
+		}
+		for(i = 0; i < chunk; i++)
+		{
+			params[i].freq_mhz = (uint32_t)(freqs_hz[first + i] / FREQ_ONE_MHZ);
+			params[i].freq_hz = (uint32_t)(freqs_hz[first + i] - (((uint64_t)params[i].freq_mhz) * FREQ_ONE_MHZ));
+		}
+		length = (uint16_t)(chunk * sizeof(set_freq_params_t));
+
+		result = usb_control_transfer(
+			device,
+			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			HACKRF_VENDOR_REQUEST_FREQ_TABLE_WRITE,
+			0,
+			(uint16_t)first,
+			(unsigned char*)params,
+			length,
+			device->control_timeout_ms
+		);
+
+		if (result < length)
+		{
+			return control_error(result);
+		}
+	}
+
+	memcpy(device->freq_table, freqs_hz, count * sizeof(uint64_t));
+	device->freq_table_count = count;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_freq_index(hackrf_device* device, const uint8_t index)
+{
+	int result;
+
+	/* Pending writes go out before the firmware reprograms the chips */
+	result = regs_cache_flush(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_FREQ_TABLE_SELECT,
+		0,
+		index,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if (result != 0)
+	{
+		return control_error(result);
+	} else {
+		regs_cache_forget(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+		iq_retune(device, freq_table_lookup(device, index));
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_set_amp_enable(hackrf_device* device, const uint8_t value)
+{
+	int result;
+
+	/* Pending writes go out before the firmware reprograms the chips */
+	result = regs_cache_flush(device, REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_AMP_ENABLE,
+		value,
+		0,
+		NULL,
+		0,
+		device->control_timeout_ms
+	);
+
+	if (result != 0)
+	{
+		return control_error(result);
+	} else {
+		regs_cache_forget(device, REGS_MASK_RFFC5071);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_board_partid_serialno_read(hackrf_device* device, read_partid_serialno_t* read_partid_serialno)
+{
+	uint8_t length;
+	int result;
+	
+	length = sizeof(read_partid_serialno_t);
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_BOARD_PARTID_SERIALNO_READ,
+		0,
+		0,
+		(unsigned char*)read_partid_serialno,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length)
+	{
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_bulk_ring_read(hackrf_device* device, hackrf_bulk_ring* value)
+{
+	uint8_t length;
+	int result;
+
+	length = sizeof(hackrf_bulk_ring);
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_BULK_RING_READ,
+		0,
+		0,
+		(unsigned char*)value,
+		length,
+		device->control_timeout_ms
+	);
+
+	if (result < length)
+	{
+		return control_error(result);
+	} else {
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_set_decimation(hackrf_device* device, const uint32_t factor)
+{
+	int result;
+
+	if( (factor == 0) || (factor > HACKRF_DECIMATION_MAX) || ((factor & (factor - 1)) != 0) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( device->transfer_thread_started != false )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	result = usb_control_transfer(
+		device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SET_DECIMATION,
+		(uint16_t)factor,
+		0,
+		NULL,
+		0,
+		device->control_timeout_ms
 	);
 
-	if (result < length) {
-		return HACKRF_ERROR_LIBUSB;
+	if (result != 0)
+	{
+		return control_error(result);
+	} else {
+		device->decimation = factor;
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_get_output_sample_rate(hackrf_device* device, uint32_t* rate_hz)
+{
+	if( rate_hz == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	*rate_hz = device->sample_rate_hz / device->decimation;
+	return HACKRF_SUCCESS;
+}
+
+static void ring_wakeup(hackrf_device* device)
+{
+	pthread_mutex_lock(&device->ring_mutex);
+	pthread_cond_signal(&device->ring_cond);
+	pthread_mutex_unlock(&device->ring_mutex);
+}
+
+/* Called by the producer after each push to the consumer thread input ring */
+static void ring_notify(hackrf_device* device)
+{
+	/* Pairs with the barrier in ring_wait(), one side sees the other */
+	__sync_synchronize();
+	if( device->ring_sleeping != false )
+	{
+		ring_wakeup(device);
+	}
+}
+
+static void timeout_to_abstime(const uint32_t timeout_ms, struct timespec* const abstime)
+{
+	timeout_us_to_abstime((uint64_t)timeout_ms * 1000, abstime);
+}
+
+/* Wait until ring is not empty or streaming stops, abstime NULL waits forever */
+static int ring_wait(hackrf_device* device, const hackrf_ring* const ring, const struct timespec* const abstime)
+{
+	int result = HACKRF_SUCCESS;
+
+	pthread_mutex_lock(&device->ring_mutex);
+	device->ring_sleeping = true;
+	__sync_synchronize();
+	while( (ring_level(ring) == 0) && (device->streaming) && (device->do_exit == false) )
+	{
+		if( abstime == NULL )
+		{
+			pthread_cond_wait(&device->ring_cond, &device->ring_mutex);
+		} else if( pthread_cond_timedwait(&device->ring_cond, &device->ring_mutex, abstime) == ETIMEDOUT ) {
+			result = HACKRF_ERROR_TIMEOUT;
+			break;
+		}
+	}
+	device->ring_sleeping = false;
+	pthread_mutex_unlock(&device->ring_mutex);
+
+	return result;
+}
+
+static void* transfer_threadproc(void* arg)
+{
+	hackrf_device* device = (hackrf_device*)arg;
+	int error;
+	struct timeval timeout = { 0, 500000 };
+
+	while( (device->streaming) && (device->do_exit == false) )
+	{
+		error = usb_handle_events(device, &timeout);
+		if( error != 0 )
+		{
+			device->streaming = false;
+		}
+	}
+
+	if( device->ring_depth > 0 )
+	{
+		/* Consumer thread may be waiting for a buffer that will never come */
+		ring_wakeup(device);
+	}
+
+	return NULL;
+}
+
+/* Ring mode consumer, runs the sample callback out of the libusb event thread.
+ * RX: takes filled buffers from ring_full, returns them to ring_free.
+ * TX: takes empty buffers from ring_free, hands them filled to ring_full. */
+static void* ring_threadproc(void* arg)
+{
+	hackrf_device* device = (hackrf_device*)arg;
+	hackrf_ring* const input = device->ring_tx ? &device->ring_free : &device->ring_full;
+	hackrf_ring* const output = device->ring_tx ? &device->ring_full : &device->ring_free;
+	hackrf_ring_entry entry;
+	hackrf_transfer transfer;
+	uint32_t level;
+
+	while( (device->streaming) && (device->do_exit == false) )
+	{
+		if( ring_pop(input, &entry) == false )
+		{
+			ring_wait(device, input, NULL);
+			continue;
+		}
+
+		transfer.device = device;
+		transfer.buffer = entry.buffer;
+		transfer.buffer_length = device->buffer_size;
+		transfer.valid_length = device->ring_tx ? (int)device->buffer_size : entry.valid_length;
+		transfer.rx_ctx = device->rx_ctx;
+		transfer.tx_ctx = device->tx_ctx;
+		transfer.sample_count = entry.sample_count;
+		transfer.dropped_samples = entry.dropped_samples;
+
+		const uint64_t callback_start_us = monotonic_us();
+		const int callback_result = device->callback(&transfer);
+		stream_stats_callback(device, monotonic_us() - callback_start_us);
+		__sync_fetch_and_add(&device->ring_stats.delivered, 1);
+
+		if( (callback_result == HACKRF_TRANSFER_RETAIN) && (device->ring_tx == false) )
+		{
+			/* Comes back through the lending pool on release */
+			buffer_lend(device, entry.buffer);
+			continue;
+		} else if( callback_result != HACKRF_TRANSFER_CONTINUE ) {
+			request_exit(device);
+			break;
+		}
+
+		entry.valid_length = transfer.valid_length;
+		/* Cannot fail, both rings hold every buffer */
+		ring_push(output, &entry);
+
+		if( device->ring_tx )
+		{
+			level = ring_level(output);
+			ring_stats_max(&device->ring_stats.high_water, level);
+		}
+	}
+
+	return NULL;
+}
+
+static void hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
+{
+	hackrf_device* device = (hackrf_device*)usb_transfer->user_data;
+	const uint64_t completion_us = monotonic_us();
+
+	__sync_fetch_and_sub(&device->transfers_active, 1);
+	stream_stats_completion(device, usb_transfer);
+
+	if( (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED) && (device->do_exit == false) )
+	{
+		hackrf_transfer transfer = {
+			transfer.device = device,
+			transfer.buffer = usb_transfer->buffer,
+			transfer.buffer_length = usb_transfer->length,
+			transfer.valid_length = usb_transfer->actual_length,
+			transfer.rx_ctx = device->rx_ctx,
+			transfer.tx_ctx = device->tx_ctx,
+			transfer.sample_count = 0,
+			transfer.dropped_samples = 0
+		};
+
+		if( device->framed && (device->sweep == false) && (device->ring_tx == false) )
+		{
+			transfer.valid_length = frame_strip(device, transfer.buffer, transfer.valid_length,
+				&transfer.sample_count, &transfer.dropped_samples);
+		}
+		if( device->iq_correction && (device->sweep == false) && (device->ring_tx == false) )
+		{
+			iq_correct(device, transfer.buffer, transfer.valid_length);
+		}
+
+		const uint64_t callback_start_us = monotonic_us();
+		const int callback_result = device->callback(&transfer);
+		stream_stats_callback(device, monotonic_us() - callback_start_us);
+
+		if( (callback_result == HACKRF_TRANSFER_RETAIN) && (device->ring_tx == false) )
+		{
+			/* Application keeps the buffer, continue into a spare one */
+			buffer_lend(device, usb_transfer->buffer);
+			pthread_mutex_lock(&device->lend_mutex);
+			if( device->lend_pool_count > 0 )
+			{
+				usb_transfer->buffer = device->lend_pool[--device->lend_pool_count];
+			} else {
+				/* Resubmitted by hackrf_release_buffer() */
+				device->parked[device->parked_count++] = usb_transfer;
+				usb_transfer = NULL;
+			}
+			pthread_mutex_unlock(&device->lend_mutex);
+
+			if( usb_transfer == NULL )
+			{
+				return;
+			}
+		} else if( callback_result != HACKRF_TRANSFER_CONTINUE ) {
+			request_exit(device);
+			return;
+		}
+
+		if( submit_transfer(device, usb_transfer) < 0)
+		{
+			request_exit(device);
+		} else {
+			stream_stats_resubmit(device, completion_us);
+		}
+	} else {
+		/* Other cases LIBUSB_TRANSFER_NO_DEVICE
+		LIBUSB_TRANSFER_ERROR, LIBUSB_TRANSFER_TIMED_OUT
+		LIBUSB_TRANSFER_STALL,	LIBUSB_TRANSFER_OVERFLOW
+		LIBUSB_TRANSFER_CANCELLED ...
+		*/
+		request_exit(device); /* Fatal error stop transfer */
+	}
+}
+
+/* Ring mode: the completed transfer is resubmitted at once with a spare
+ * buffer, the sample callback runs later from ring_threadproc(). */
+static void hackrf_libusb_transfer_ring_callback(struct libusb_transfer* usb_transfer)
+{
+	hackrf_device* device = (hackrf_device*)usb_transfer->user_data;
+	hackrf_ring_entry spare;
+	hackrf_ring_entry done;
+	uint32_t level;
+	const uint64_t completion_us = monotonic_us();
+
+	__sync_fetch_and_sub(&device->transfers_active, 1);
+	stream_stats_completion(device, usb_transfer);
+
+	if( (usb_transfer->status != LIBUSB_TRANSFER_COMPLETED) || (device->do_exit != false) )
+	{
+		request_exit(device); /* Fatal error stop transfer */
+		return;
+	}
+
+	if( device->ring_tx == false )
+	{
+		/* RX: queue samples for the consumer, continue into a spare buffer */
+		bool have_spare = ring_pop(&device->ring_free, &spare);
+		if( have_spare == false )
+		{
+			/* Buffers released by the application */
+			spare.buffer = lend_pool_pop(device);
+			have_spare = (spare.buffer != NULL);
+		}
+		if( have_spare )
+		{
+			done.buffer = usb_transfer->buffer;
+			done.valid_length = usb_transfer->actual_length;
+			done.sample_count = 0;
+			done.dropped_samples = 0;
+			if( device->framed && (device->sweep == false) )
+			{
+				done.valid_length = frame_strip(device, done.buffer, done.valid_length,
+					&done.sample_count, &done.dropped_samples);
+			}
+			if( device->iq_correction && (device->sweep == false) )
+			{
+				iq_correct(device, done.buffer, done.valid_length);
+			}
+			ring_push(&device->ring_full, &done);
+			usb_transfer->buffer = spare.buffer;
+
+			level = ring_level(&device->ring_full);
+			ring_stats_max(&device->ring_stats.high_water, level);
+			ring_notify(device);
+		} else {
+			/* Consumer is ring_depth buffers behind, samples are lost */
+			__sync_fetch_and_add(&device->ring_stats.dropped, 1);
+		}
+	} else {
+		/* TX: send the next filled buffer, recycle the one just sent */
+		if( ring_pop(&device->ring_full, &spare) )
+		{
+			done.buffer = usb_transfer->buffer;
+			done.valid_length = 0;
+			done.sample_count = 0;
+			done.dropped_samples = 0;
+			ring_push(&device->ring_free, &done);
+			usb_transfer->buffer = spare.buffer;
+			ring_notify(device);
+		} else {
+			/* Underrun, send silence rather than stale samples */
+			memset(usb_transfer->buffer, 0, usb_transfer->length);
+			__sync_fetch_and_add(&device->ring_stats.dropped, 1);
+		}
+	}
+
+	if( submit_transfer(device, usb_transfer) < 0)
+	{
+		request_exit(device);
+	} else {
+		stream_stats_resubmit(device, completion_us);
+	}
+}
+
+/* Run the event loop until cancelled transfers are given back by libusb,
+ * they cannot be submitted again (next start) or freed before. */
+static void reap_transfers(hackrf_device* device)
+{
+	struct timeval timeout = { 0, 100000 };
+	int tries;
+
+	for(tries=0; (tries<10) && (device->transfers_active > 0); tries++)
+	{
+		usb_handle_events(device, &timeout);
+	}
+}
+
+/* Gives back the ring depth start_sync() may have set */
+static void sync_mode_end(hackrf_device* device)
+{
+	if( device->sync_mode != false )
+	{
+		device->sync_mode = false;
+		device->sync_entry_valid = false;
+		hackrf_set_ring_mode(device, device->sync_saved_ring_depth);
+	}
+}
+
+static int kill_transfer_thread(hackrf_device* device)
+{
+	void* value;
+	int result;
+	
+	/* No hackrf_release_buffer() resubmit after this, see there */
+	pthread_mutex_lock(&device->lend_mutex);
+	request_exit(device);
+	pthread_mutex_unlock(&device->lend_mutex);
+
+	if( device->transfer_thread_started != false )
+	{
+		value = NULL;
+		result = pthread_join(device->transfer_thread, &value);
+		if( result != 0 )
+		{
+			return HACKRF_ERROR_THREAD;
+		}
+		device->transfer_thread_started = false;
+
+		/* Cancel all transfers */
+		cancel_transfers(device);
+		reap_transfers(device);
+	}
+
+	if( device->ring_thread_started != false )
+	{
+		ring_wakeup(device);
+		value = NULL;
+		result = pthread_join(device->ring_thread, &value);
+		if( result != 0 )
+		{
+			return HACKRF_ERROR_THREAD;
+		}
+		device->ring_thread_started = false;
+	}
+
+	sync_mode_end(device);
+
+	return HACKRF_SUCCESS;
+}
+
+static int create_transfer_thread(hackrf_device* device,
+									const uint8_t endpoint_address,
+									hackrf_sample_block_cb_fn callback)
+{
+	int result;
+	
+	if( device->transfer_thread_started == false )
+	{
+		device->streaming = false;
+		device->do_exit = false;
+
+		if( device->transfers == NULL )
+		{
+			result = allocate_transfers(device);
+			if( result != HACKRF_SUCCESS )
+			{
+				return result;
+			}
+		}
+
+		device->ring_tx = ((endpoint_address & LIBUSB_ENDPOINT_IN) == 0);
+		result = prepare_transfers(
+			device, endpoint_address,
+			(device->ring_depth > 0)
+				? (libusb_transfer_cb_fn)hackrf_libusb_transfer_ring_callback
+				: (libusb_transfer_cb_fn)hackrf_libusb_transfer_callback
+		);
+
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+
+		device->streaming = true;
+		device->callback = callback;
+		result = pthread_create(&device->transfer_thread, 0, transfer_threadproc, device);
+		if( result == 0 )
+		{
+			device->transfer_thread_started = true;
+		}else {
+			return HACKRF_ERROR_THREAD;
+		}
+
+		if( device->event_thread_cpu >= 0 )
+		{
+			/* Best effort, CPU was checked by hackrf_set_event_thread_affinity() */
+			set_thread_affinity(device->transfer_thread, device->event_thread_cpu);
+		}
+
+		/* Without callback (sync mode) the caller consumes the rings */
+		if( (device->ring_depth > 0) && (callback != NULL) )
+		{
+			result = pthread_create(&device->ring_thread, 0, ring_threadproc, device);
+			if( result == 0 )
+			{
+				device->ring_thread_started = true;
+			}else {
+				kill_transfer_thread(device);
+				return HACKRF_ERROR_THREAD;
+			}
+		}
+	} else {
+		return HACKRF_ERROR_BUSY;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_is_streaming(hackrf_device* device)
+{
+	/* return hackrf is streaming only when streaming, transfer_thread_started are true and do_exit equal false */
+	
+	if( (device->transfer_thread_started == true) &&
+		(device->streaming == true) && 
+		(device->do_exit == false) )
+	{
+		return HACKRF_TRUE;
 	} else {
-		return HACKRF_SUCCESS;
+	
+		if(device->transfer_thread_started == false)
+		{
+			return HACKRF_ERROR_STREAMING_THREAD_ERR;
+		}
+
+		if(device->streaming == false)
+		{
+			return HACKRF_ERROR_STREAMING_STOPPED;
+		}
+
+		return HACKRF_ERROR_STREAMING_EXIT_CALLED;
 	}
 }
 
-int ADDCALL hackrf_board_id_read(hackrf_device* device, uint8_t* value)
+int ADDCALL hackrf_start_rx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx)
 {
 	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_BOARD_ID_READ,
-		0,
-		0,
-		value,
-		1,
-		0
-	);
+	const uint8_t endpoint_address = LIBUSB_ENDPOINT_IN | 1;
+	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_RECEIVE);
+	if( result == HACKRF_SUCCESS )
+	{
+		device->rx_ctx = rx_ctx;
+		result = create_transfer_thread(device, endpoint_address, callback);
+	}
+	return result;
+}
 
-	if (result < 1)
+int ADDCALL hackrf_stop_rx(hackrf_device* device)
+{
+	int result1, result2;
+	result1 = kill_transfer_thread(device);
+	result2 = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_OFF);
+	if (result2 != HACKRF_SUCCESS)
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		return result2;
 	}
+	return result1;
 }
 
-int ADDCALL hackrf_version_string_read(hackrf_device* device, char* version,
-		uint8_t length)
+int ADDCALL hackrf_start_tx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* tx_ctx)
 {
 	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_VERSION_STRING_READ,
-		0,
-		0,
-		(unsigned char*)version,
-		length,
-		0
-	);
-
-	if (result < 0)
+	const uint8_t endpoint_address = LIBUSB_ENDPOINT_OUT | 2;
+	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_TRANSMIT);
+	if( result == HACKRF_SUCCESS )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		version[result] = '\0';
-		return HACKRF_SUCCESS;
+		device->tx_ctx = tx_ctx;
+		result = create_transfer_thread(device, endpoint_address, callback);
 	}
+	return result;
 }
 
-typedef struct {
-	uint32_t freq_mhz; /* From 30 to 6000MHz */
-	uint32_t freq_hz; /* From 0 to 999999Hz */
-	/* Final Freq = freq_mhz+freq_hz */
-} set_freq_params_t;
-#define FREQ_ONE_MHZ	(1000*1000ull)
+int ADDCALL hackrf_stop_tx(hackrf_device* device)
+{
+	int result1, result2;
+	result1 = kill_transfer_thread(device);
+	result2 = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_OFF);
+	if (result2 != HACKRF_SUCCESS)
+	{
+		return result2;
+	}
+	return result1;
+}
 
-int ADDCALL hackrf_set_freq(hackrf_device* device, const uint64_t freq_hz)
+static int start_sync(hackrf_device* device, const uint8_t endpoint_address)
 {
-	uint32_t l_freq_mhz;
-	uint32_t l_freq_hz;
-	set_freq_params_t set_freq_params;
-	uint8_t length;
 	int result;
-	
-	/* Convert Freq Hz 64bits to Freq MHz (32bits) & Freq Hz (32bits) */
-	l_freq_mhz = (uint32_t)(freq_hz / FREQ_ONE_MHZ);
-	l_freq_hz = (uint32_t)(freq_hz - (((uint64_t)l_freq_mhz) * FREQ_ONE_MHZ));
-	set_freq_params.freq_mhz = l_freq_mhz;
-	set_freq_params.freq_hz = l_freq_hz;
-	length = sizeof(set_freq_params_t);
 
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_SET_FREQ,
-		0,
-		0,
-		(unsigned char*)&set_freq_params,
-		length,
-		0
-	);
+	if( device->transfer_thread_started != false )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+	device->sync_saved_ring_depth = device->ring_depth;
+	if( device->ring_depth == 0 )
+	{
+		result = hackrf_set_ring_mode(device, HACKRF_SYNC_RING_DEPTH_DEFAULT);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+	}
 
-	if (result < length)
+	device->sync_mode = true;
+	device->sync_entry_valid = false;
+	device->sync_offset = 0;
+	result = create_transfer_thread(device, endpoint_address, NULL);
+	if( result != HACKRF_SUCCESS )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		sync_mode_end(device);
 	}
+	return result;
 }
 
-int ADDCALL hackrf_set_amp_enable(hackrf_device* device, const uint8_t value)
+int ADDCALL hackrf_start_rx_sync(hackrf_device* device)
 {
 	int result;
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_AMP_ENABLE,
-		value,
-		0,
-		NULL,
-		0,
-		0
-	);
+	const uint8_t endpoint_address = LIBUSB_ENDPOINT_IN | 1;
+	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_RECEIVE);
+	if( result == HACKRF_SUCCESS )
+	{
+		result = start_sync(device, endpoint_address);
+	}
+	return result;
+}
 
-	if (result != 0)
+int ADDCALL hackrf_start_tx_sync(hackrf_device* device)
+{
+	int result;
+	const uint8_t endpoint_address = LIBUSB_ENDPOINT_OUT | 2;
+	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_TRANSMIT);
+	if( result == HACKRF_SUCCESS )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		result = start_sync(device, endpoint_address);
 	}
+	return result;
 }
 
-int ADDCALL hackrf_board_partid_serialno_read(hackrf_device* device, read_partid_serialno_t* read_partid_serialno)
+/* Get the next buffer from ring into device->sync_entry, waiting for it if needed */
+static int sync_entry_get(hackrf_device* device, hackrf_ring* const ring,
+						const struct timespec* const abstime)
 {
-	uint8_t length;
 	int result;
-	
-	length = sizeof(read_partid_serialno_t);
-	result = libusb_control_transfer(
-		device->usb_device,
-		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
-		HACKRF_VENDOR_REQUEST_BOARD_PARTID_SERIALNO_READ,
-		0,
-		0,
-		(unsigned char*)read_partid_serialno,
-		length,
-		0
-	);
 
-	if (result < length)
+	while( ring_pop(ring, &device->sync_entry) == false )
 	{
-		return HACKRF_ERROR_LIBUSB;
-	} else {
-		return HACKRF_SUCCESS;
+		if( (device->streaming == false) || (device->do_exit != false) )
+		{
+			return HACKRF_ERROR_STREAMING_STOPPED;
+		}
+		result = ring_wait(device, ring, abstime);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
 	}
+	device->sync_entry_valid = true;
+	device->sync_offset = 0;
+	return HACKRF_SUCCESS;
 }
 
-static void* transfer_threadproc(void* arg)
+int ADDCALL hackrf_read_sync(hackrf_device* device, uint8_t* buffer, const uint32_t length,
+							uint32_t* transferred, const uint32_t timeout_ms)
 {
-	hackrf_device* device = (hackrf_device*)arg;
-	int error;
-	struct timeval timeout = { 0, 500000 };
+	struct timespec abstime;
+	uint32_t done = 0;
+	uint32_t chunk;
+	int result = HACKRF_SUCCESS;
 
-	while( (device->streaming) && (do_exit == false) )
+	if( buffer == NULL )
 	{
-		error = libusb_handle_events_timeout(g_libusb_context, &timeout);
-		if( error != 0 )
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (device->sync_mode == false) || (device->ring_tx != false) )
+	{
+		return HACKRF_ERROR_STREAMING_THREAD_ERR;
+	}
+
+	if( timeout_ms != 0 )
+	{
+		timeout_to_abstime(timeout_ms, &abstime);
+	}
+
+	while( done < length )
+	{
+		if( device->sync_entry_valid == false )
 		{
-			device->streaming = false;
+			result = sync_entry_get(device, &device->ring_full, (timeout_ms != 0) ? &abstime : NULL);
+			if( result != HACKRF_SUCCESS )
+			{
+				break;
+			}
+		}
+
+		/* Single copy from the USB buffer to the caller */
+		chunk = device->sync_entry.valid_length - device->sync_offset;
+		if( chunk > (length - done) )
+		{
+			chunk = length - done;
+		}
+		memcpy(&buffer[done], &device->sync_entry.buffer[device->sync_offset], chunk);
+		done += chunk;
+		device->sync_offset += chunk;
+
+		if( device->sync_offset == (uint32_t)device->sync_entry.valid_length )
+		{
+			ring_push(&device->ring_free, &device->sync_entry);
+			device->sync_entry_valid = false;
+			__sync_fetch_and_add(&device->ring_stats.delivered, 1);
 		}
 	}
 
-	return NULL;
+	if( transferred != NULL )
+	{
+		*transferred = done;
+	}
+	return result;
 }
 
-static void hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
+int ADDCALL hackrf_write_sync(hackrf_device* device, const uint8_t* buffer, const uint32_t length,
+							uint32_t* transferred, const uint32_t timeout_ms)
 {
-	hackrf_device* device = (hackrf_device*)usb_transfer->user_data;
+	struct timespec abstime;
+	uint32_t done = 0;
+	uint32_t chunk;
+	uint32_t level;
+	int result = HACKRF_SUCCESS;
 
-	if(usb_transfer->status == LIBUSB_TRANSFER_COMPLETED)
+	if( buffer == NULL )
 	{
-		hackrf_transfer transfer = {
-			transfer.device = device,
-			transfer.buffer = usb_transfer->buffer,
-			transfer.buffer_length = usb_transfer->length,
-			transfer.valid_length = usb_transfer->actual_length,
-			transfer.rx_ctx = device->rx_ctx,
-			transfer.tx_ctx = device->tx_ctx
-		};
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( (device->sync_mode == false) || (device->ring_tx == false) )
+	{
+		return HACKRF_ERROR_STREAMING_THREAD_ERR;
+	}
+
+	if( timeout_ms != 0 )
+	{
+		timeout_to_abstime(timeout_ms, &abstime);
+	}
 
-		if( device->callback(&transfer) == 0 )
+	while( done < length )
+	{
+		if( device->sync_entry_valid == false )
 		{
-			if( libusb_submit_transfer(usb_transfer) < 0)
+			result = sync_entry_get(device, &device->ring_free, (timeout_ms != 0) ? &abstime : NULL);
+			if( result != HACKRF_SUCCESS )
 			{
-				request_exit();
-			}else {
-				return;
+				break;
 			}
-		}else {
-			request_exit();
 		}
-	} else {
-		/* Other cases LIBUSB_TRANSFER_NO_DEVICE
-		LIBUSB_TRANSFER_ERROR, LIBUSB_TRANSFER_TIMED_OUT
-		LIBUSB_TRANSFER_STALL,	LIBUSB_TRANSFER_OVERFLOW
-		LIBUSB_TRANSFER_CANCELLED ...
-		*/
-		request_exit(); /* Fatal error stop transfer */
+
+		chunk = device->buffer_size - device->sync_offset;
+		if( chunk > (length - done) )
+		{
+			chunk = length - done;
+		}
+		memcpy(&device->sync_entry.buffer[device->sync_offset], &buffer[done], chunk);
+		done += chunk;
+		device->sync_offset += chunk;
+
+		/* Only whole buffers are queued for USB */
+		if( device->sync_offset == device->buffer_size )
+		{
+			device->sync_entry.valid_length = device->buffer_size;
+			ring_push(&device->ring_full, &device->sync_entry);
+			device->sync_entry_valid = false;
+			__sync_fetch_and_add(&device->ring_stats.delivered, 1);
+
+			level = ring_level(&device->ring_full);
+			ring_stats_max(&device->ring_stats.high_water, level);
+		}
+	}
+
+	if( transferred != NULL )
+	{
+		*transferred = done;
 	}
+	return result;
 }
 
-static int kill_transfer_thread(hackrf_device* device)
+int ADDCALL hackrf_set_control_timeout(hackrf_device* device, const uint32_t timeout_ms)
 {
-	void* value;
+	device->control_timeout_ms = timeout_ms;
+	return HACKRF_SUCCESS;
+}
+
+/* Largest data stage sent by the async requests, set_freq_params_t */
+#define CONTROL_ASYNC_DATA_MAX (8)
+/* hackrf_close() wait for async requests, then again once they are cancelled */
+#define CONTROL_CLOSE_TIMEOUT_MS (1000)
+
+typedef struct control_async {
+	hackrf_device* device;
+	struct libusb_transfer* usb_transfer;
+	struct control_async* next; /* In device->controls */
+	bool retune; /* iq_retune() to freq_hz once the firmware acknowledged */
+	uint64_t freq_hz;
+	hackrf_control_cb_fn callback;
+	void* ctx;
+	uint16_t length; /* Data stage */
+	unsigned char buffer[LIBUSB_CONTROL_SETUP_SIZE + CONTROL_ASYNC_DATA_MAX];
+} control_async_t;
+
+/* Runs in whichever thread handles libusb events */
+static void control_async_callback(struct libusb_transfer* usb_transfer)
+{
+	control_async_t* const request = (control_async_t*)usb_transfer->user_data;
+	hackrf_device* const device = request->device;
+	control_async_t** link;
 	int result;
-	
-	request_exit();
 
-	if( device->transfer_thread_started != false )
+	if( (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED) &&
+		(usb_transfer->actual_length >= request->length) )
 	{
-		value = NULL;
-		result = pthread_join(device->transfer_thread, &value);
-		if( result != 0 )
+		result = HACKRF_SUCCESS;
+	} else if( usb_transfer->status == LIBUSB_TRANSFER_TIMED_OUT ) {
+		result = HACKRF_ERROR_TIMEOUT;
+	} else {
+		result = HACKRF_ERROR_LIBUSB;
+	}
+
+	if( (result == HACKRF_SUCCESS) && request->retune )
+	{
+		iq_retune(device, request->freq_hz);
+	}
+	if( request->callback != NULL )
+	{
+		request->callback(device, result, request->ctx);
+	}
+
+	pthread_mutex_lock(&device->control_mutex);
+	for(link=&device->controls; *link!=NULL; link=&(*link)->next)
+	{
+		if( *link == request )
 		{
-			return HACKRF_ERROR_THREAD;
+			*link = request->next;
+			break;
 		}
-		device->transfer_thread_started = false;
-
-		/* Cancel all transfers */
-		cancel_transfers(device);
 	}
+	pthread_cond_broadcast(&device->control_cond);
+	pthread_mutex_unlock(&device->control_mutex);
 
-	return HACKRF_SUCCESS;
+	free(request);
+	libusb_free_transfer(usb_transfer);
 }
 
-static int create_transfer_thread(hackrf_device* device,
-									const uint8_t endpoint_address,
-									hackrf_sample_block_cb_fn callback)
+/* Vendor OUT request completed by the event loop, like the bulk transfers.
+ * retune switches the IQ estimates to freq_hz when it completes. */
+static int control_submit(hackrf_device* device, const uint8_t request_code,
+	const uint16_t value, const uint16_t index,
+	const void* data, const uint16_t length,
+	const bool retune, const uint64_t freq_hz,
+	hackrf_control_cb_fn callback, void* ctx)
 {
-	int result;
-	
-	if( device->transfer_thread_started == false )
-	{
-		device->streaming = false;
-
-		result = prepare_transfers(
-			device, endpoint_address,
-			(libusb_transfer_cb_fn)hackrf_libusb_transfer_callback
-		);
+	struct libusb_transfer* usb_transfer;
+	control_async_t* request;
 
-		if( result != HACKRF_SUCCESS )
-		{
-			return result;
-		}
+	usb_transfer = libusb_alloc_transfer(0);
+	request = (control_async_t*)malloc(sizeof(control_async_t));
+	if( (usb_transfer == NULL) || (request == NULL) )
+	{
+		libusb_free_transfer(usb_transfer);
+		free(request);
+		return HACKRF_ERROR_NO_MEM;
+	}
 
-		device->streaming = true;
-		device->callback = callback;
-		result = pthread_create(&device->transfer_thread, 0, transfer_threadproc, device);
-		if( result == 0 )
-		{
-			device->transfer_thread_started = true;
-		}else {
-			return HACKRF_ERROR_THREAD;
-		}
-	} else {
-		return HACKRF_ERROR_BUSY;
+	request->device = device;
+	request->usb_transfer = usb_transfer;
+	request->retune = retune;
+	request->freq_hz = freq_hz;
+	request->callback = callback;
+	request->ctx = ctx;
+	request->length = length;
+	libusb_fill_control_setup(request->buffer,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		request_code, value, index, length);
+	if( length > 0 )
+	{
+		memcpy(&request->buffer[LIBUSB_CONTROL_SETUP_SIZE], data, length);
 	}
+	libusb_fill_control_transfer(usb_transfer, device->usb_device, request->buffer,
+		(libusb_transfer_cb_fn)control_async_callback, request, device->control_timeout_ms);
 
+	/* Listed before it can complete, the callback unlists it */
+	pthread_mutex_lock(&device->control_mutex);
+	if( usb_submit_transfer(device, usb_transfer) != 0 )
+	{
+		pthread_mutex_unlock(&device->control_mutex);
+		free(request);
+		libusb_free_transfer(usb_transfer);
+		return HACKRF_ERROR_LIBUSB;
+	}
+	request->next = device->controls;
+	device->controls = request;
+	pthread_mutex_unlock(&device->control_mutex);
 	return HACKRF_SUCCESS;
 }
 
-int ADDCALL hackrf_is_streaming(hackrf_device* device)
+/* Completes the async requests in flight with HACKRF_ERROR_LIBUSB, once
+ * the event loop runs */
+static void control_cancel(hackrf_device* device)
 {
-	/* return hackrf is streaming only when streaming, transfer_thread_started are true and do_exit equal false */
-	
-	if( (device->transfer_thread_started == true) &&
-		(device->streaming == true) && 
-		(do_exit == false) )
+	control_async_t* request;
+
+	pthread_mutex_lock(&device->control_mutex);
+	for(request=device->controls; request!=NULL; request=request->next)
 	{
-		return HACKRF_TRUE;
-	} else {
-	
-		if(device->transfer_thread_started == false)
-		{
-			return HACKRF_ERROR_STREAMING_THREAD_ERR;
-		}
+		usb_cancel_transfer(device, request->usb_transfer);
+	}
+	pthread_mutex_unlock(&device->control_mutex);
+}
 
-		if(device->streaming == false)
-		{
-			return HACKRF_ERROR_STREAMING_STOPPED;
-		}
+int ADDCALL hackrf_set_freq_async(hackrf_device* device, const uint64_t freq_hz,
+	hackrf_control_cb_fn callback, void* ctx)
+{
+	set_freq_params_t set_freq_params;
+	int result;
 
-		return HACKRF_ERROR_STREAMING_EXIT_CALLED;
+	set_freq_params.freq_mhz = (uint32_t)(freq_hz / FREQ_ONE_MHZ);
+	set_freq_params.freq_hz = (uint32_t)(freq_hz - (((uint64_t)set_freq_params.freq_mhz) * FREQ_ONE_MHZ));
+
+	/* Cache is application thread only, flush and forget before the firmware retunes */
+	result = regs_cache_flush(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
 	}
+	regs_cache_forget(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	return control_submit(device, HACKRF_VENDOR_REQUEST_SET_FREQ, 0, 0,
+		&set_freq_params, sizeof(set_freq_params_t), true, freq_hz, callback, ctx);
 }
 
-int ADDCALL hackrf_start_rx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx)
+int ADDCALL hackrf_set_freq_index_async(hackrf_device* device, const uint8_t index,
+	hackrf_control_cb_fn callback, void* ctx)
 {
 	int result;
-	const uint8_t endpoint_address = LIBUSB_ENDPOINT_IN | 1;
-	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_RECEIVE);
-	if( result == HACKRF_SUCCESS )
+
+	result = regs_cache_flush(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
 	{
-		device->rx_ctx = rx_ctx;
-		result = create_transfer_thread(device, endpoint_address, callback);
+		return result;
 	}
-	return result;
+	regs_cache_forget(device, REGS_MASK_MAX2837 | REGS_MASK_RFFC5071);
+	return control_submit(device, HACKRF_VENDOR_REQUEST_FREQ_TABLE_SELECT, 0, index,
+		NULL, 0, true, freq_table_lookup(device, index), callback, ctx);
 }
 
-int ADDCALL hackrf_stop_rx(hackrf_device* device)
+int ADDCALL hackrf_set_amp_enable_async(hackrf_device* device, const uint8_t value,
+	hackrf_control_cb_fn callback, void* ctx)
 {
-	int result1, result2;
-	result1 = kill_transfer_thread(device);
-	result2 = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_OFF);
-	if (result2 != HACKRF_SUCCESS)
+	int result;
+
+	result = regs_cache_flush(device, REGS_MASK_RFFC5071);
+	if( result != HACKRF_SUCCESS )
 	{
-		return result2;
+		return result;
 	}
-	return result1;
+	regs_cache_forget(device, REGS_MASK_RFFC5071);
+	return control_submit(device, HACKRF_VENDOR_REQUEST_AMP_ENABLE, value, 0,
+		NULL, 0, false, 0, callback, ctx);
 }
 
-int ADDCALL hackrf_start_tx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* tx_ctx)
+int ADDCALL hackrf_baseband_filter_bandwidth_set_async(hackrf_device* device, const uint32_t bandwidth_hz,
+	hackrf_control_cb_fn callback, void* ctx)
 {
 	int result;
-	const uint8_t endpoint_address = LIBUSB_ENDPOINT_OUT | 2;
-	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_TRANSMIT);
-	if( result == HACKRF_SUCCESS )
+
+	result = regs_cache_flush(device, REGS_MASK_MAX2837);
+	if( result != HACKRF_SUCCESS )
 	{
-		device->tx_ctx = tx_ctx;
-		result = create_transfer_thread(device, endpoint_address, callback);
+		return result;
 	}
-	return result;
+	regs_cache_forget(device, REGS_MASK_MAX2837);
+	return control_submit(device, HACKRF_VENDOR_REQUEST_BASEBAND_FILTER_BANDWIDTH_SET,
+		bandwidth_hz & 0xffff, bandwidth_hz >> 16, NULL, 0, false, 0, callback, ctx);
 }
 
-int ADDCALL hackrf_stop_tx(hackrf_device* device)
+static bool abstime_passed(const struct timespec* const abstime)
 {
-	int result1, result2;
-	result1 = kill_transfer_thread(device);
-	result2 = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_OFF);
-	if (result2 != HACKRF_SUCCESS)
+	struct timespec now;
+
+	timeout_to_abstime(0, &now);
+	return (now.tv_sec > abstime->tv_sec) ||
+		((now.tv_sec == abstime->tv_sec) && (now.tv_nsec >= abstime->tv_nsec));
+}
+
+int ADDCALL hackrf_control_wait(hackrf_device* device, const uint32_t timeout_ms)
+{
+	struct timespec deadline;
+	struct timespec slice;
+	struct timeval timeout = { 0, 100000 };
+	int result = HACKRF_SUCCESS;
+
+	timeout_to_abstime(timeout_ms, &deadline);
+
+	pthread_mutex_lock(&device->control_mutex);
+	while( device->controls != NULL )
 	{
-		return result2;
+		if( (timeout_ms != 0) && abstime_passed(&deadline) )
+		{
+			result = HACKRF_ERROR_TIMEOUT;
+			break;
+		}
+
+		if( (device->transfer_thread_started) && (device->streaming) && (device->do_exit == false) )
+		{
+			/* Completed by the streaming event thread, recheck in case it stops */
+			timeout_to_abstime(100, &slice);
+			pthread_cond_timedwait(&device->control_cond, &device->control_mutex, &slice);
+		} else {
+			/* Nobody else runs the event loop */
+			pthread_mutex_unlock(&device->control_mutex);
+			usb_handle_events(device, &timeout);
+			pthread_mutex_lock(&device->control_mutex);
+		}
 	}
-	return result1;
+	pthread_mutex_unlock(&device->control_mutex);
+
+	return result;
 }
 
 int ADDCALL hackrf_close(hackrf_device* device)
@@ -988,6 +4328,22 @@ int ADDCALL hackrf_close(hackrf_device* device)
 	{
 		result1 = hackrf_stop_rx(device);
 		result2 = hackrf_stop_tx(device);
+		/* Async control requests still reference the device. Let them
+		 * finish, but a board that stopped answering would hold them forever */
+		if( hackrf_control_wait(device, CONTROL_CLOSE_TIMEOUT_MS) != HACKRF_SUCCESS )
+		{
+			control_cancel(device);
+			if( hackrf_control_wait(device, CONTROL_CLOSE_TIMEOUT_MS) != HACKRF_SUCCESS )
+			{
+				/* Their callbacks may still run, leave the device to them */
+				return HACKRF_ERROR_TIMEOUT;
+			}
+		}
+		if( device->buffer_alloc_used == HACKRF_BUFFER_ALLOC_DEV_MEM )
+		{
+			/* usbfs buffers are released through the device handle */
+			free_buffers(device);
+		}
 		if( device->usb_device != NULL )
 		{
 			libusb_release_interface(device->usb_device, 0);
@@ -997,6 +4353,21 @@ int ADDCALL hackrf_close(hackrf_device* device)
 
 		free_transfers(device);
 
+		if( device->own_usb_context )
+		{
+			libusb_exit(device->usb_context);
+			device->usb_context = NULL;
+		}
+
+		pthread_cond_destroy(&device->ring_cond);
+		pthread_mutex_destroy(&device->ring_mutex);
+		pthread_mutex_destroy(&device->lend_mutex);
+		pthread_cond_destroy(&device->control_cond);
+		pthread_mutex_destroy(&device->control_mutex);
+		pthread_mutex_destroy(&device->iq_mutex);
+		pthread_cond_destroy(&device->loopback_cond);
+		pthread_mutex_destroy(&device->loopback_mutex);
+
 		free(device);
 	}
 
@@ -1026,6 +4397,9 @@ const char* ADDCALL hackrf_error_name(enum hackrf_error errcode)
 	case HACKRF_ERROR_BUSY:
 		return "HACKRF_ERROR_BUSY";
 
+	case HACKRF_ERROR_TIMEOUT:
+		return "HACKRF_ERROR_TIMEOUT";
+
 	case HACKRF_ERROR_NO_MEM:
 		return "HACKRF_ERROR_NO_MEM";
 
@@ -1070,6 +4444,30 @@ const char* ADDCALL hackrf_board_id_name(enum hackrf_board_id board_id)
 	}
 }
 
+const char* ADDCALL hackrf_buffer_alloc_name(enum hackrf_buffer_alloc buffer_alloc)
+{
+	switch(buffer_alloc)
+	{
+	case HACKRF_BUFFER_ALLOC_MALLOC:
+		return "malloc";
+
+	case HACKRF_BUFFER_ALLOC_ALIGNED:
+		return "page aligned";
+
+	case HACKRF_BUFFER_ALLOC_LOCKED:
+		return "page aligned, locked";
+
+	case HACKRF_BUFFER_ALLOC_HUGEPAGE:
+		return "huge pages";
+
+	case HACKRF_BUFFER_ALLOC_DEV_MEM:
+		return "usbfs zero-copy";
+
+	default:
+		return "unknown";
+	}
+}
+
 /* Return final bw round down and less than expected bw. */
 uint32_t ADDCALL hackrf_compute_baseband_filter_bw_round_down_lt(const uint32_t bandwidth_hz)
 {
@@ -1113,7 +4511,378 @@ uint32_t ADDCALL hackrf_compute_baseband_filter_bw(const uint32_t bandwidth_hz)
 	return p->bandwidth_hz;
 }
 
+/* Si5351 MultiSynth 0 divides 800MHz PLLA down to twice the sample rate,
+ * si5351c_ms_fraction() is the search the firmware runs */
+static uint64_t gcd_u64(uint64_t a, uint64_t b)
+{
+	while( b != 0 )
+	{
+		const uint64_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+int ADDCALL hackrf_compute_sample_rate(const uint32_t sample_rate_hz, uint64_t* numerator, uint32_t* denominator)
+{
+	const uint32_t f_out_hz = sample_rate_hz * 2;
+	uint32_t a, b, c;
+	uint64_t num, den, g;
+
+	if( (numerator == NULL) || (denominator == NULL) ||
+	    (sample_rate_hz < HACKRF_SAMPLE_RATE_MIN_HZ) || (sample_rate_hz > HACKRF_SAMPLE_RATE_MAX_HZ) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	si5351c_ms_fraction(SI5351C_PLLA_HZ, f_out_hz, &a, &b, &c);
+
+	/* PLLA / (a + b / c) / 2 */
+	num = (uint64_t)(SI5351C_PLLA_HZ / 2) * c;
+	den = ((uint64_t)a * c) + b;
+	g = gcd_u64(num, den);
+	*numerator = num / g;
+	*denominator = (uint32_t)(den / g);
+	return HACKRF_SUCCESS;
+}
+
 #ifdef __cplusplus
 } // __cplusplus defined.
 #endif
 
+#ifdef TEST
+typedef struct {
+	uint16_t vid;
+	uint16_t pid;
+	uint8_t bus_number;
+	uint8_t device_address;
+	uint8_t iserial; /* 0 is firmware answering only the vendor request */
+	const char* serial_number;
+	int refs;
+} test_board_t;
+
+static test_board_t test_boards[] = {
+	{ 0x1d50, 0x604b, 1, 4, 3, "0000000000000000457863c8234b2e4f", 0 },
+	{ 0x1d50, 0x604b, 1, 5, 0, "00000000000000004578ddcc23be1e4f", 0 },
+	{ 0x1d6b, 0x0002, 2, 1, 3, "0000:00:14.0", 0 },
+	{ 0x1d50, 0x604b, 2, 3, 3, "0000000000000000a06063c8202a6f5f", 0 },
+};
+#define TEST_BOARD_COUNT (sizeof(test_boards)/sizeof(test_boards[0]))
+
+static libusb_device* test_devices[TEST_BOARD_COUNT + 1];
+static unsigned int test_open_count = 0;
+
+static ssize_t test_get_device_list(libusb_context* ctx, libusb_device*** list)
+{
+	(void)ctx;
+	for(size_t i=0; i<TEST_BOARD_COUNT; i++)
+	{
+		test_boards[i].refs++;
+		test_devices[i] = (libusb_device*)&test_boards[i];
+	}
+	test_devices[TEST_BOARD_COUNT] = NULL;
+	*list = test_devices;
+	return TEST_BOARD_COUNT;
+}
+
+static void test_free_device_list(libusb_device** list, int unref_devices)
+{
+	for(size_t i=0; (list[i] != NULL) && unref_devices; i++)
+	{
+		test_unref_device(list[i]);
+	}
+}
+
+static int test_get_device_descriptor(libusb_device* dev, struct libusb_device_descriptor* desc)
+{
+	const test_board_t* const board = (const test_board_t*)dev;
+	memset(desc, 0, sizeof(*desc));
+	desc->idVendor = board->vid;
+	desc->idProduct = board->pid;
+	desc->iSerialNumber = board->iserial;
+	return 0;
+}
+
+static uint8_t test_get_bus_number(libusb_device* dev)
+{
+	return ((const test_board_t*)dev)->bus_number;
+}
+
+static uint8_t test_get_device_address(libusb_device* dev)
+{
+	return ((const test_board_t*)dev)->device_address;
+}
+
+static libusb_device* test_ref_device(libusb_device* dev)
+{
+	((test_board_t*)dev)->refs++;
+	return dev;
+}
+
+static void test_unref_device(libusb_device* dev)
+{
+	((test_board_t*)dev)->refs--;
+}
+
+static int test_open(libusb_device* dev, libusb_device_handle** handle)
+{
+	test_open_count++;
+	*handle = (libusb_device_handle*)dev;
+	return 0;
+}
+
+static void test_close(libusb_device_handle* handle)
+{
+	(void)handle;
+}
+
+static int test_set_configuration(libusb_device_handle* handle, int configuration)
+{
+	(void)handle;
+	(void)configuration;
+	return 0;
+}
+
+static int test_claim_interface(libusb_device_handle* handle, int interface_number)
+{
+	(void)handle;
+	(void)interface_number;
+	return 0;
+}
+
+static int test_release_interface(libusb_device_handle* handle, int interface_number)
+{
+	(void)handle;
+	(void)interface_number;
+	return 0;
+}
+
+static int test_get_string_descriptor_ascii(libusb_device_handle* handle, uint8_t desc_index, unsigned char* data, int length)
+{
+	const test_board_t* const board = (const test_board_t*)handle;
+	(void)desc_index;
+	snprintf((char*)data, length, "%s", board->serial_number);
+	return strlen((char*)data);
+}
+
+/* Other requests sent to an open stub board, oldest first */
+typedef struct {
+	uint8_t request;
+	uint16_t value;
+} test_request_t;
+
+#define TEST_REQUESTS_MAX (16)
+static test_request_t test_requests[TEST_REQUESTS_MAX];
+static unsigned int test_request_count = 0;
+
+/* Vendor request serial as the firmware sends it, four words of hex. Other
+ * requests are logged and succeed, reads return zeros. */
+static int test_control_transfer(libusb_device_handle* handle, uint8_t request_type, uint8_t request,
+	uint16_t value, uint16_t index, unsigned char* data, uint16_t length, unsigned int timeout)
+{
+	const test_board_t* const board = (const test_board_t*)handle;
+	read_partid_serialno_t read_partid_serialno;
+	(void)index;
+	(void)timeout;
+
+	if( request != HACKRF_VENDOR_REQUEST_BOARD_PARTID_SERIALNO_READ )
+	{
+		if( test_request_count < TEST_REQUESTS_MAX )
+		{
+			test_requests[test_request_count].request = request;
+			test_requests[test_request_count].value = value;
+			test_request_count++;
+		}
+		if( (request_type & LIBUSB_ENDPOINT_IN) != 0 )
+		{
+			memset(data, 0, length);
+		}
+		return length;
+	}
+	if( length != sizeof(read_partid_serialno) )
+	{
+		return LIBUSB_ERROR_PIPE;
+	}
+	memset(&read_partid_serialno, 0, sizeof(read_partid_serialno));
+	for(int i=0; i<4; i++)
+	{
+		char word[9];
+		memcpy(word, &board->serial_number[i * 8], 8);
+		word[8] = '\0';
+		read_partid_serialno.serial_no[i] = strtoul(word, NULL, 16);
+	}
+	memcpy(data, &read_partid_serialno, sizeof(read_partid_serialno));
+	return sizeof(read_partid_serialno);
+}
+
+typedef struct {
+	const char* wanted;
+	int result;
+	int idx; /* Into the hackrf_device_list(), which skips the other board */
+} serial_test_t;
+
+static const serial_test_t serial_tests[] = {
+	{ "0000000000000000457863c8234b2e4f", HACKRF_SUCCESS, 0 },
+	{ "234b2e4f", HACKRF_SUCCESS, 0 },
+	{ "234B2E4F", HACKRF_SUCCESS, 0 },
+	{ "be1e4f", HACKRF_SUCCESS, 1 },
+	{ "6f5f", HACKRF_SUCCESS, 2 },
+	{ "e4f", HACKRF_ERROR_INVALID_PARAM, 0 },
+	{ "4f", HACKRF_ERROR_INVALID_PARAM, 0 },
+	{ "deadbeef", HACKRF_ERROR_NOT_FOUND, 0 },
+	{ "14.0", HACKRF_ERROR_NOT_FOUND, 0 },
+	{ "00000000000000000000457863c8234b2e4f", HACKRF_ERROR_NOT_FOUND, 0 },
+};
+
+/* Requests logged since the last call match expected */
+static bool test_requests_check(const char* const name, const test_request_t* const expected, const unsigned int count)
+{
+	bool ok = (test_request_count == count);
+	unsigned int i;
+
+	for(i=0; ok && (i<count); i++)
+	{
+		ok = (test_requests[i].request == expected[i].request) && (test_requests[i].value == expected[i].value);
+	}
+	printf("%s:", name);
+	for(i=0; i<test_request_count; i++)
+	{
+		printf(" %u/%u", test_requests[i].request, test_requests[i].value);
+	}
+	printf(" %s\n", ok ? "ok" : "FAIL");
+	test_request_count = 0;
+	return ok;
+}
+
+int main(int ac, char **av)
+{
+	static const char* const listed[] = {
+		"0000000000000000457863c8234b2e4f",
+		"00000000000000004578ddcc23be1e4f",
+		"0000000000000000a06063c8202a6f5f",
+	};
+	hackrf_device_list_t* list;
+	hackrf_device* device;
+	unsigned int failures = 0;
+	unsigned int probes;
+	size_t i;
+	bool ok;
+
+	(void)ac;
+	(void)av;
+
+	list = hackrf_device_list();
+	if( list == NULL )
+	{
+		printf("hackrf_device_list() failed\n");
+		return 1;
+	}
+	probes = test_open_count;
+	ok = (list->device_count == 3) && (probes == 3);
+	for(i=0; ok && (i<3); i++)
+	{
+		ok = (strcmp(list->devices[i].serial_number, listed[i]) == 0);
+	}
+	printf("list: %d boards, %u probes %s\n", list->device_count, probes, ok ? "ok" : "FAIL");
+	if( !ok )
+	{
+		failures++;
+	}
+
+	for(i=0; i<sizeof(serial_tests)/sizeof(serial_tests[0]); i++)
+	{
+		const serial_test_t* const t = &serial_tests[i];
+		int idx = -1;
+		const int result = serial_number_find(list, t->wanted, &idx);
+
+		ok = (result == t->result) && ((result != HACKRF_SUCCESS) || (idx == t->idx));
+		printf("%36s: %s %d %s\n", t->wanted, hackrf_error_name((enum hackrf_error)result),
+			(result == HACKRF_SUCCESS) ? idx : -1, ok ? "ok" : "FAIL");
+		if( !ok )
+		{
+			failures++;
+		}
+	}
+	hackrf_device_list_free(list);
+
+	/* Listing again reads serials from the cache, not the boards */
+	list = hackrf_device_list();
+	ok = (list != NULL) && (list->device_count == 3) && (test_open_count == probes) &&
+		(strcmp(list->devices[1].serial_number, listed[1]) == 0);
+	printf("cached list: %u probes %s\n", test_open_count - probes, ok ? "ok" : "FAIL");
+	if( !ok )
+	{
+		failures++;
+	}
+	hackrf_device_list_free(list);
+
+	/* Neither opens a board */
+	device = NULL;
+	ok = (hackrf_open_by_serial("e4f", &device) == HACKRF_ERROR_INVALID_PARAM) &&
+		(hackrf_open_by_serial("deadbeef", &device) == HACKRF_ERROR_NOT_FOUND) &&
+		(device == NULL) && (test_open_count == probes);
+	printf("open by serial: %s\n", ok ? "ok" : "FAIL");
+	if( !ok )
+	{
+		failures++;
+	}
+
+	/* A deferred write made before a retune lands before it, not after */
+	{
+		static const test_request_t write_then_retune[] = {
+			{ HACKRF_VENDOR_REQUEST_REGS_WRITE, REGS_CHIP_MAX2837 },
+			{ HACKRF_VENDOR_REQUEST_SET_FREQ, 0 },
+		};
+		static const test_request_t write_flushed[] = {
+			{ HACKRF_VENDOR_REQUEST_REGS_WRITE, REGS_CHIP_RFFC5071 },
+		};
+		uint16_t value = 0;
+
+		list = hackrf_device_list();
+		ok = (list != NULL) && (hackrf_device_list_open(list, 0, &device) == HACKRF_SUCCESS);
+		hackrf_device_list_free(list);
+		if( ok )
+		{
+			hackrf_set_register_cache(device, 1);
+			test_request_count = 0;
+
+			ok = (hackrf_max2837_write(device, 5, 0x123) == HACKRF_SUCCESS) && (test_request_count == 0);
+			ok = ok && (hackrf_set_freq(device, 915000000ull) == HACKRF_SUCCESS);
+			ok = ok && (hackrf_register_cache_flush(device) == HACKRF_SUCCESS);
+			ok = test_requests_check("write, set_freq, flush", write_then_retune, 2) && ok;
+
+			/* The firmware's value is read back, not the one written before */
+			ok = (hackrf_max2837_read(device, 5, &value) == HACKRF_SUCCESS) && (value == 0) && ok;
+			test_request_count = 0;
+
+			ok = (hackrf_rffc5071_write(device, 8, 0x4321) == HACKRF_SUCCESS) && ok;
+			ok = (hackrf_register_cache_invalidate(device) == HACKRF_SUCCESS) && ok;
+			ok = test_requests_check("write, invalidate", write_flushed, 1) && ok;
+
+			ok = (hackrf_rffc5071_write(device, 8, 0x4321) == HACKRF_SUCCESS) && ok;
+			ok = (hackrf_set_register_cache(device, 1) == HACKRF_SUCCESS) && ok;
+			ok = test_requests_check("write, cache on again", write_flushed, 1) && ok;
+
+			hackrf_close(device);
+		}
+		printf("register cache order: %s\n", ok ? "ok" : "FAIL");
+		if( !ok )
+		{
+			failures++;
+		}
+	}
+
+	for(i=0; i<TEST_BOARD_COUNT; i++)
+	{
+		if( test_boards[i].refs != 0 )
+		{
+			printf("board %u: %d refs left FAIL\n", (unsigned int)i, test_boards[i].refs);
+			failures++;
+		}
+	}
+
+	printf("%u failures\n", failures);
+	return (failures == 0) ? 0 : 1;
+}
+#endif //TEST
@@ -53,6 +53,7 @@ enum hackrf_error {
 	HACKRF_ERROR_INVALID_PARAM = -2,
 	HACKRF_ERROR_NOT_FOUND = -5,
 	HACKRF_ERROR_BUSY = -6,
+	HACKRF_ERROR_TIMEOUT = -7,
 	HACKRF_ERROR_NO_MEM = -11,
 	HACKRF_ERROR_LIBUSB = -1000,
 	HACKRF_ERROR_THREAD = -1001,
@@ -68,6 +69,44 @@ enum hackrf_board_id {
 	BOARD_ID_INVALID = 0xFF,
 };
 
+/* Bulk transfer pool defaults, see hackrf_set_transfer_params(). */
+#define HACKRF_TRANSFER_COUNT_DEFAULT (4)
+#define HACKRF_TRANSFER_COUNT_MAX (1024)
+#define HACKRF_TRANSFER_BUFFER_SIZE_DEFAULT (262144)
+/* Firmware streams in 16KiB bulk TDs, transfer size must be a multiple of it */
+#define HACKRF_TRANSFER_BUFFER_SIZE_GRANULARITY (16384)
+#define HACKRF_TRANSFER_BUFFER_SIZE_MAX (16777216)
+/* Spare buffers for ring mode, see hackrf_set_ring_mode(). */
+#define HACKRF_RING_DEPTH_MAX (1024)
+/* Ring depth used by sync mode when ring mode was not set */
+#define HACKRF_SYNC_RING_DEPTH_DEFAULT (16)
+/* Spare buffers for lending, see hackrf_set_lend_pool(). */
+#define HACKRF_LEND_DEPTH_MAX (1024)
+
+/* Sample callback return values, any other value stops streaming */
+#define HACKRF_TRANSFER_CONTINUE (0)
+/* RX only: application keeps transfer->buffer until hackrf_release_buffer() */
+#define HACKRF_TRANSFER_RETAIN (1)
+
+/* Transfer buffer allocation, see hackrf_set_buffer_alloc().
+ * When a mode fails the next lower one is tried, down to malloc. */
+enum hackrf_buffer_alloc {
+	HACKRF_BUFFER_ALLOC_MALLOC = 0, /* Default */
+	HACKRF_BUFFER_ALLOC_ALIGNED = 1, /* posix_memalign() on page boundary */
+	HACKRF_BUFFER_ALLOC_LOCKED = 2, /* Page aligned and mlock()ed */
+	HACKRF_BUFFER_ALLOC_HUGEPAGE = 3, /* mmap(MAP_HUGETLB), needs vm.nr_hugepages */
+	HACKRF_BUFFER_ALLOC_DEV_MEM = 4, /* libusb_dev_mem_alloc(), usbfs zero-copy */
+};
+
+/* hackrf_open_ex() flags */
+/* Own libusb context, events are then handled apart from other devices */
+#define HACKRF_OPEN_OWN_CONTEXT (1 << 0)
+/* No board: a stand-in streams at hackrf_get_output_sample_rate() through
+ * the same transfer, ring and callback path, with a device buffer that
+ * overruns like the firmware's. Framed RX works, control requests do
+ * nothing and reads return zeros. For benchmarks and tests. */
+#define HACKRF_OPEN_LOOPBACK (1 << 1)
+
 typedef struct hackrf_device hackrf_device;
 
 typedef struct {
@@ -77,6 +116,11 @@ typedef struct {
 	int valid_length;
 	void* rx_ctx;
 	void* tx_ctx;
+	/* Framed RX only, see hackrf_set_framed_mode(). Samples are contiguous
+	 * unless dropped_samples is not 0, then the gap was before buffer or,
+	 * rarely, at a 16KiB block boundary inside it. */
+	uint64_t sample_count; /* Firmware count of the first sample in buffer */
+	uint32_t dropped_samples; /* Lost since the previous buffer */
 } hackrf_transfer;
 
 typedef struct {
@@ -84,7 +128,114 @@ typedef struct {
 	uint32_t serial_no[4];
 } read_partid_serialno_t;
 
+/* Register files, see hackrf_max2837_read_regs() and friends */
+#define HACKRF_MAX2837_NUM_REGS (32)
+#define HACKRF_SI5351C_NUM_REGS (256)
+#define HACKRF_RFFC5071_NUM_REGS (31)
+
+typedef struct {
+	uint16_t register_number;
+	uint16_t value;
+} hackrf_register_write;
+
+/* Firmware USB bulk ring, counters since the last RX/TX start */
+typedef struct {
+	uint8_t depth; /* 16KiB blocks in the ring */
+	uint8_t in_flight_max; /* Most blocks queued to the USB controller at once */
+	uint16_t reserved;
+	uint32_t ring_full; /* Blocks that found the ring full, each an overrun (RX) or underrun (TX) */
+} hackrf_bulk_ring;
+
+typedef struct {
+	uint32_t depth; /* Spare buffers, 0 when ring mode is off */
+	uint32_t high_water; /* Max buffers queued between USB and the sample callback */
+	uint64_t delivered; /* Buffers passed to the sample callback */
+	uint64_t dropped; /* RX: buffers overwritten, TX: buffers of silence sent */
+} hackrf_ring_stats;
+
+/* Firmware sample rate before hackrf_sample_rate_set() */
+#define HACKRF_SAMPLE_RATE_DEFAULT_HZ (10000000)
+/* hackrf_sample_rate_set() range, Jellybean only takes 5, 10 and 20MHz */
+#define HACKRF_SAMPLE_RATE_MIN_HZ (2000000)
+#define HACKRF_SAMPLE_RATE_MAX_HZ (20000000)
+/* Largest hackrf_set_decimation() factor */
+#define HACKRF_DECIMATION_MAX (32)
+/* Entries in the firmware frequency table, see hackrf_set_freq_table() */
+#define HACKRF_FREQ_TABLE_MAX (256)
+
+/* Frequencies whose DC and IQ imbalance estimates are kept, see
+ * hackrf_set_iq_correction() */
+#define HACKRF_IQ_CORRECTION_CACHE_SIZE (64)
+
+/* Estimates for the frequency tuned, see hackrf_get_iq_correction() */
+typedef struct {
+	uint64_t freq_hz; /* 0 when not tuned through this handle */
+	uint64_t blocks; /* RX buffers the estimates are based on */
+	float dc_i, dc_q; /* cs8 units */
+	float gain; /* Q amplitude over I */
+	float phase_deg; /* Q error from quadrature */
+} hackrf_iq_correction;
+
+/* Framed RX stream: every 16KiB block from the firmware starts with a header */
+#define HACKRF_FRAME_BLOCK_SIZE (16384)
+#define HACKRF_FRAME_HEADER_SIZE (32)
+#define HACKRF_FRAME_MAGIC (0x31465248) /* "HRF1" */
+#define HACKRF_FRAME_FLAG_OVERRUN (1 << 0)
+#define HACKRF_FRAME_FLAG_SWEEP_STEP (1 << 1) /* First block of a sweep step, the gap before it is expected */
+
+typedef struct {
+	uint64_t blocks; /* Blocks with a valid header */
+	uint64_t overruns; /* Blocks flagged by the firmware, the block before was lost or damaged */
+	uint64_t dropped_samples; /* From gaps in the firmware sample count */
+	uint64_t bad_headers; /* Blocks discarded, magic not found */
+	uint64_t next_sample_count; /* Firmware count of the next sample expected */
+} hackrf_frame_stats;
+
+/* One 16KiB block of a sweep, see hackrf_sweep_demux() */
+typedef struct {
+	uint64_t freq_hz; /* Tuned frequency the block was captured at */
+	uint64_t sample_count; /* Firmware count of the first sample */
+	uint32_t flags; /* HACKRF_FRAME_FLAG_* */
+	uint8_t* samples; /* Interleaved int8 IQ, inside the transfer buffer */
+	int sample_bytes;
+} hackrf_sweep_block;
+
+/* One bin per libusb_transfer_status value, last one counts unknown values */
+#define HACKRF_STREAM_STATS_STATUS_COUNT (8)
+/* Bin 0 counts durations < 1us, bin n [2^(n-1), 2^n) us, last bin is open ended */
+#define HACKRF_STREAM_STATS_HISTOGRAM_BINS (16)
+
+typedef struct {
+	uint64_t transfers; /* Completed transfers */
+	uint64_t bytes; /* actual_length of completed transfers */
+	uint64_t short_transfers; /* Completed with actual_length < length */
+	uint64_t status[HACKRF_STREAM_STATS_STATUS_COUNT]; /* Completions by libusb_transfer_status */
+	uint64_t callback_us[HACKRF_STREAM_STATS_HISTOGRAM_BINS]; /* Sample callback duration */
+	uint64_t callback_us_max;
+	uint64_t resubmits; /* Transfers resubmitted from their completion callback */
+	uint64_t resubmit_us_total; /* Completion callback entry to resubmit */
+	uint64_t resubmit_us_max;
+	uint64_t resubmit_failures;
+} hackrf_stream_stats;
+
+/* Serial number as 32 hex digits, same order as read_partid_serialno_t.serial_no */
+#define HACKRF_SERIAL_NUMBER_LENGTH (32)
+
+typedef struct {
+	char serial_number[HACKRF_SERIAL_NUMBER_LENGTH + 1]; /* "" when it could not be read */
+	uint8_t bus_number;
+	uint8_t device_address;
+	void* usb_device; /* libusb_device*, referenced until hackrf_device_list_free() */
+} hackrf_device_info;
+
+typedef struct {
+	hackrf_device_info* devices;
+	int device_count;
+} hackrf_device_list_t;
+
 typedef int (*hackrf_sample_block_cb_fn)(hackrf_transfer* transfer);
+/* Completion of an async control request, result is a hackrf_error */
+typedef void (*hackrf_control_cb_fn)(hackrf_device* device, int result, void* ctx);
 
 #ifdef __cplusplus
 extern "C"
@@ -95,7 +246,72 @@ extern ADDAPI int ADDCALL hackrf_init();
 extern ADDAPI int ADDCALL hackrf_exit();
  
 extern ADDAPI int ADDCALL hackrf_open(hackrf_device** device);
+extern ADDAPI int ADDCALL hackrf_open_ex(hackrf_device** device, const uint32_t flags);
+
+/* All attached boards with their serial numbers. Serial numbers come from
+ * the USB string descriptor, or a vendor request with older firmware, and
+ * are cached per bus/address so listing again does not probe the boards. */
+extern ADDAPI hackrf_device_list_t* ADDCALL hackrf_device_list();
+extern ADDAPI void ADDCALL hackrf_device_list_free(hackrf_device_list_t* list);
+extern ADDAPI int ADDCALL hackrf_device_list_open(hackrf_device_list_t* list, int idx, hackrf_device** device);
+/* Matches when serial_number is a (case insensitive) suffix of the board
+ * serial number, NULL or "" opens the first board like hackrf_open().
+ * A suffix matching more than one board is HACKRF_ERROR_INVALID_PARAM. */
+extern ADDAPI int ADDCALL hackrf_open_by_serial(const char* const serial_number, hackrf_device** device);
 extern ADDAPI int ADDCALL hackrf_close(hackrf_device* device);
+
+/* Pin the device event thread (libusb event handling, inline callbacks) to
+ * cpu, -1 unpins. Linux only, HACKRF_ERROR_OTHER elsewhere. */
+extern ADDAPI int ADDCALL hackrf_set_event_thread_affinity(hackrf_device* device, const int cpu);
+
+/* Number of libusb bulk transfers kept in flight and size of each one.
+ * Only allowed when not streaming, takes effect on next hackrf_start_rx/tx(). */
+extern ADDAPI int ADDCALL hackrf_set_transfer_params(hackrf_device* device, const uint32_t transfer_count, const uint32_t buffer_size);
+extern ADDAPI int ADDCALL hackrf_get_transfer_params(hackrf_device* device, uint32_t* transfer_count, uint32_t* buffer_size);
+
+/* With ring_depth > 0 completed transfers are resubmitted at once with one of
+ * ring_depth spare buffers and the sample callback runs on a separate thread,
+ * so a slow callback no longer stalls USB. 0 (default) calls it inline.
+ * Only allowed when not streaming. */
+extern ADDAPI int ADDCALL hackrf_set_ring_mode(hackrf_device* device, const uint32_t ring_depth);
+extern ADDAPI int ADDCALL hackrf_get_ring_stats(hackrf_device* device, hackrf_ring_stats* stats);
+
+/* Counters since the last hackrf_start_rx/tx(), safe to read while streaming.
+ * Each counter is read atomically, the set is not a single snapshot. */
+extern ADDAPI int ADDCALL hackrf_get_stream_stats(hackrf_device* device, hackrf_stream_stats* stats);
+
+/* Framed RX stream, needs firmware support (HACKRF_ERROR_LIBUSB otherwise).
+ * Headers are checked and stripped before the sample callback, which gets
+ * a firmware sample count with each buffer. Only allowed when not streaming. */
+extern ADDAPI int ADDCALL hackrf_set_framed_mode(hackrf_device* device, const uint8_t value);
+extern ADDAPI int ADDCALL hackrf_get_frame_stats(hackrf_device* device, hackrf_frame_stats* stats);
+
+/* Sweep from the next hackrf_start_rx(): the firmware tunes from start_mhz to
+ * stop_mhz by step_hz and over again, sending dwell_blocks 16KiB blocks at
+ * each step. Blocks captured while retuning, and settle_blocks more, are
+ * dropped. Turns framed mode on, dwell_blocks 0 turns sweeping off. No
+ * onboard decimation. Only allowed when not streaming, needs firmware
+ * support (HACKRF_ERROR_LIBUSB otherwise).
+ * The sample callback then gets buffers with the headers still in place,
+ * hackrf_sweep_demux() splits them into blocks. */
+extern ADDAPI int ADDCALL hackrf_set_sweep(hackrf_device* device, const uint32_t start_mhz, const uint32_t stop_mhz,
+	const uint32_t step_hz, const uint16_t dwell_blocks, const uint16_t settle_blocks);
+/* From the sample callback, fills up to max_blocks and returns how many.
+ * Blocks point into transfer->buffer. Updates hackrf_get_frame_stats(). */
+extern ADDAPI int ADDCALL hackrf_sweep_demux(hackrf_transfer* transfer, hackrf_sweep_block* blocks, const int max_blocks);
+
+/* Only allowed when not streaming, buffers are allocated on next start.
+ * hackrf_get_buffer_alloc() reports the mode actually used (HACKRF_ERROR_NOT_FOUND before). */
+extern ADDAPI int ADDCALL hackrf_set_buffer_alloc(hackrf_device* device, const enum hackrf_buffer_alloc buffer_alloc);
+extern ADDAPI int ADDCALL hackrf_get_buffer_alloc(hackrf_device* device, enum hackrf_buffer_alloc* buffer_alloc);
+
+/* Spare buffers streamed into while the application retains buffers
+ * (callback returned HACKRF_TRANSFER_RETAIN). When none is left the transfer
+ * waits for the next hackrf_release_buffer(). Retained buffers stay valid
+ * across stop/start until hackrf_close(); pool changes return
+ * HACKRF_ERROR_BUSY while any is retained. */
+extern ADDAPI int ADDCALL hackrf_set_lend_pool(hackrf_device* device, const uint32_t lend_depth);
+extern ADDAPI int ADDCALL hackrf_release_buffer(hackrf_device* device, uint8_t* buffer);
  
 extern ADDAPI int ADDCALL hackrf_start_rx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx);
 extern ADDAPI int ADDCALL hackrf_stop_rx(hackrf_device* device);
@@ -103,6 +319,15 @@ extern ADDAPI int ADDCALL hackrf_stop_rx(hackrf_device* device);
 extern ADDAPI int ADDCALL hackrf_start_tx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* tx_ctx);
 extern ADDAPI int ADDCALL hackrf_stop_tx(hackrf_device* device);
 
+/* Blocking API, samples are queued in ring mode buffers and copied once into
+ * the caller buffer. Stop with hackrf_stop_rx/tx(). timeout_ms 0 waits forever.
+ * On HACKRF_ERROR_TIMEOUT or streaming end, transferred holds the partial count. */
+extern ADDAPI int ADDCALL hackrf_start_rx_sync(hackrf_device* device);
+extern ADDAPI int ADDCALL hackrf_read_sync(hackrf_device* device, uint8_t* buffer, const uint32_t length, uint32_t* transferred, const uint32_t timeout_ms);
+extern ADDAPI int ADDCALL hackrf_start_tx_sync(hackrf_device* device);
+/* Data goes out in whole transfer buffers, a partially filled one is kept for the next call */
+extern ADDAPI int ADDCALL hackrf_write_sync(hackrf_device* device, const uint8_t* buffer, const uint32_t length, uint32_t* transferred, const uint32_t timeout_ms);
+
 /* return HACKRF_TRUE if success */
 extern ADDAPI int ADDCALL hackrf_is_streaming(hackrf_device* device);
  
@@ -117,6 +342,36 @@ extern ADDAPI int ADDCALL hackrf_baseband_filter_bandwidth_set(hackrf_device* de
  
 extern ADDAPI int ADDCALL hackrf_rffc5071_read(hackrf_device* device, uint8_t register_number, uint16_t* value);
 extern ADDAPI int ADDCALL hackrf_rffc5071_write(hackrf_device* device, uint8_t register_number, uint16_t value);
+
+/* Batched register access, one control transfer per 128 writes or 256 reads
+ * instead of one per register. Writes happen in array order; if any value is
+ * out of range the firmware writes none of that batch. Needs firmware
+ * support, HACKRF_ERROR_LIBUSB otherwise. */
+extern ADDAPI int ADDCALL hackrf_max2837_write_regs(hackrf_device* device, const hackrf_register_write* regs, const uint32_t count);
+extern ADDAPI int ADDCALL hackrf_max2837_read_regs(hackrf_device* device, const uint16_t first, const uint16_t count, uint16_t* values);
+extern ADDAPI int ADDCALL hackrf_si5351c_write_regs(hackrf_device* device, const hackrf_register_write* regs, const uint32_t count);
+extern ADDAPI int ADDCALL hackrf_si5351c_read_regs(hackrf_device* device, const uint16_t first, const uint16_t count, uint16_t* values);
+extern ADDAPI int ADDCALL hackrf_rffc5071_write_regs(hackrf_device* device, const hackrf_register_write* regs, const uint32_t count);
+extern ADDAPI int ADDCALL hackrf_rffc5071_read_regs(hackrf_device* device, const uint16_t first, const uint16_t count, uint16_t* values);
+
+/* Optional host copy of the MAX2837, Si5351C and RFFC5071 registers, off by
+ * default. While on, the single register reads are served from the copy (a
+ * miss loads the whole chip in one transfer) and the single register writes
+ * only update it until hackrf_register_cache_flush(), which sends each chip's
+ * pending writes as one batch in register number order: flush in between
+ * writes whose order matters. Si5351C status registers 0, 1 and 177 are never
+ * cached. Tuning, sample rate, filter, amp and transceiver mode calls first
+ * flush the pending writes of the chips the firmware reprograms, so they
+ * land before the request as written, then drop those chips' registers;
+ * other firmware side effects (sweep mode, USB reset) are not tracked,
+ * invalidate by hand. Turning the cache on or off flushes it. hackrf_close()
+ * doesn't, apart from the MAX2837 and RFFC5071 writes flushed by its
+ * transceiver mode change. Not thread safe. */
+extern ADDAPI int ADDCALL hackrf_set_register_cache(hackrf_device* device, const uint8_t value);
+extern ADDAPI int ADDCALL hackrf_register_cache_flush(hackrf_device* device);
+/* Flushes pending writes, then drops cached values. Nothing is dropped when
+ * the flush fails. */
+extern ADDAPI int ADDCALL hackrf_register_cache_invalidate(hackrf_device* device);
  
 extern ADDAPI int ADDCALL hackrf_spiflash_erase(hackrf_device* device);
 extern ADDAPI int ADDCALL hackrf_spiflash_write(hackrf_device* device, const uint32_t address, const uint16_t length, unsigned char* const data);
@@ -129,18 +384,78 @@ extern ADDAPI int ADDCALL hackrf_board_id_read(hackrf_device* device, uint8_t* v
 extern ADDAPI int ADDCALL hackrf_version_string_read(hackrf_device* device, char* version, uint8_t length);
 
 extern ADDAPI int ADDCALL hackrf_set_freq(hackrf_device* device, const uint64_t freq_hz);
+/* Upload up to HACKRF_FREQ_TABLE_MAX frequencies, replacing the table. The
+ * firmware works out the synthesizer settings for all of them here, so
+ * hackrf_set_freq_index() is only register writes (microseconds instead of
+ * milliseconds) and can be used while streaming. Same range as
+ * hackrf_set_freq(). Needs firmware support, HACKRF_ERROR_LIBUSB otherwise. */
+extern ADDAPI int ADDCALL hackrf_set_freq_table(hackrf_device* device, const uint64_t* freqs_hz, const uint32_t count);
+extern ADDAPI int ADDCALL hackrf_set_freq_index(hackrf_device* device, const uint8_t index);
 
 extern ADDAPI int ADDCALL hackrf_set_amp_enable(hackrf_device* device, const uint8_t value);
 
+/* RX DC offset and IQ imbalance correction, off by default. Each buffer is
+ * corrected in place before the sample callback, with estimates smoothed
+ * over the previous buffers (each new one weighs 0.1). Estimates are kept
+ * per frequency for the last HACKRF_IQ_CORRECTION_CACHE_SIZE frequencies
+ * tuned through this handle and reused when coming back to one. Buffers
+ * already in flight when a retune completes are corrected with the previous
+ * frequency's estimates and don't update the new ones. Not applied
+ * in sweep mode. Samples are still cs8, corrections below one LSB are lost. */
+extern ADDAPI int ADDCALL hackrf_set_iq_correction(hackrf_device* device, const uint8_t value);
+extern ADDAPI int ADDCALL hackrf_get_iq_correction(hackrf_device* device, hackrf_iq_correction* value);
+/* Forget all estimates, e.g. after a gain or temperature change */
+extern ADDAPI int ADDCALL hackrf_iq_correction_reset(hackrf_device* device);
+
+/* Timeout of every control request, 0 (default) waits forever. A request that
+ * times out returns HACKRF_ERROR_TIMEOUT, the async ones through their
+ * hackrf_control_cb_fn. */
+extern ADDAPI int ADDCALL hackrf_set_control_timeout(hackrf_device* device, const uint32_t timeout_ms);
+
+/* Async variants, they return once the request is queued and several can be
+ * in flight. The callback (may be NULL) runs in the thread handling libusb
+ * events: the streaming thread while streaming, hackrf_control_wait()
+ * otherwise. It must not call back into libhackrf. Requests complete in
+ * submission order. */
+extern ADDAPI int ADDCALL hackrf_set_freq_async(hackrf_device* device, const uint64_t freq_hz,
+	hackrf_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL hackrf_set_freq_index_async(hackrf_device* device, const uint8_t index,
+	hackrf_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL hackrf_set_amp_enable_async(hackrf_device* device, const uint8_t value,
+	hackrf_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL hackrf_baseband_filter_bandwidth_set_async(hackrf_device* device, const uint32_t bandwidth_hz,
+	hackrf_control_cb_fn callback, void* ctx);
+/* Wait until all async requests of device completed, timeout_ms 0 waits
+ * forever (HACKRF_ERROR_TIMEOUT otherwise). hackrf_close() waits a second,
+ * then cancels the requests still in flight (their callbacks get
+ * HACKRF_ERROR_LIBUSB) and waits another second. If that times out too it
+ * returns HACKRF_ERROR_TIMEOUT without freeing the device. */
+extern ADDAPI int ADDCALL hackrf_control_wait(hackrf_device* device, const uint32_t timeout_ms);
+
 extern ADDAPI int ADDCALL hackrf_board_partid_serialno_read(hackrf_device* device, read_partid_serialno_t* read_partid_serialno);
+/* Needs firmware support, HACKRF_ERROR_LIBUSB otherwise. Still valid after stop. */
+extern ADDAPI int ADDCALL hackrf_bulk_ring_read(hackrf_device* device, hackrf_bulk_ring* value);
+
+/* Onboard RX decimation by a power of two up to HACKRF_DECIMATION_MAX, 1 is
+ * off. Needs firmware support (HACKRF_ERROR_LIBUSB otherwise), only allowed
+ * when not streaming. TX is never decimated. */
+extern ADDAPI int ADDCALL hackrf_set_decimation(hackrf_device* device, const uint32_t factor);
+/* Rate of the samples the host receives: sample rate over decimation, as set
+ * through this handle (firmware defaults before) */
+extern ADDAPI int ADDCALL hackrf_get_output_sample_rate(hackrf_device* device, uint32_t* rate_hz);
 
 extern ADDAPI const char* ADDCALL hackrf_error_name(enum hackrf_error errcode);
 extern ADDAPI const char* ADDCALL hackrf_board_id_name(enum hackrf_board_id board_id);
+extern ADDAPI const char* ADDCALL hackrf_buffer_alloc_name(enum hackrf_buffer_alloc buffer_alloc);
 
 /* Compute nearest freq for bw filter (manual filter) */
 extern ADDAPI uint32_t ADDCALL hackrf_compute_baseband_filter_bw_round_down_lt(const uint32_t bandwidth_hz);
 /* Compute best default value depending on sample rate (auto filter) */
 extern ADDAPI uint32_t ADDCALL hackrf_compute_baseband_filter_bw(const uint32_t bandwidth_hz);
+/* Exact rate the firmware clocks for sample_rate_hz, as numerator / denominator
+ * Hz in lowest terms. Rates the clock divider cannot hit exactly are off by
+ * less than a part per billion. */
+extern ADDAPI int ADDCALL hackrf_compute_sample_rate(const uint32_t sample_rate_hz, uint64_t* numerator, uint32_t* denominator);
 
 #ifdef __cplusplus
 } // __cplusplus defined.
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hackrf_channelizer.h"
+#include "hackrf_convert.h"
+#include "hackrf_fft.h"
+#include "hackrf_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* With M channels, prototype h of length L = M * P and an output every D
+ * input samples, channel c at input index n is
+ *   y_c[n] = sum_j h[j] x[n - j] e^(-j2pi c (n - j) / M)
+ *          = IFFT(u)[c], u[m] = v[(m + n) mod M],
+ *   v[m] = sum_k h[kM + m] x[n - kM - m]
+ * i.e. P multiplies per branch and one M point FFT per output instead of L
+ * multiplies per channel. Outputs are at n = D - 1, 2D - 1, ... counting
+ * from the first sample after create or reset, with zero history.
+ *
+ * Each block is done in two parallel steps: the output steps are split
+ * among the threads for the filter and FFT, then each thread gathers and
+ * delivers the outputs of its own group of channels. */
+
+#define CHANNELIZER_KAISER_BETA (7.0)
+
+typedef struct {
+	hackrf_channel_cb_fn callback;
+	void* ctx;
+} channel_t;
+
+typedef struct {
+	float* w; /* Branch sums, reversed: w[j] = v[M - 1 - j] */
+	float* u; /* FFT input */
+	float* gather; /* One channel of the block */
+	int result;
+} channelizer_worker_t;
+
+struct hackrf_channelizer {
+	uint32_t channels;
+	uint32_t decimation;
+	uint32_t taps; /* L */
+	uint32_t threads;
+	float* taps_reversed; /* hr[kM + j] = h[kM + M - 1 - j] */
+	hackrf_fft_plan* plan;
+	channel_t* channel;
+
+	/* L - 1 samples of history, then the block */
+	float* buffer;
+	uint32_t buffer_capacity; /* Block samples */
+	/* One row of channels per output step */
+	float* matrix;
+	uint32_t matrix_capacity; /* Steps */
+
+	/* State between blocks */
+	uint32_t phase; /* Input samples since the last output, 0 .. D - 1 */
+	uint32_t rotation; /* Input index of the next output mod M */
+	uint64_t output_count;
+
+	/* Current block */
+	uint32_t first; /* Buffer index of the first output */
+	uint32_t first_rotation;
+	uint32_t steps;
+
+	hackrf_pool* pool;
+	channelizer_worker_t* worker;
+};
+
+static double bessel_i0(const double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	uint32_t k;
+
+	for(k = 1; k < 64; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if( term < sum * 1e-12 )
+		{
+			break;
+		}
+	}
+	return sum;
+}
+
+static int design_prototype(const uint32_t channels, const uint32_t taps, float* h)
+{
+	const double pi = 3.14159265358979323846;
+	const double center = (taps - 1) / 2.0;
+	const double cutoff = 0.5 / channels;
+	const double i0_beta = bessel_i0(CHANNELIZER_KAISER_BETA);
+	double sum = 0.0;
+	double t;
+	double r;
+	double* tmp;
+	uint32_t i;
+
+	tmp = (double*)malloc(taps * sizeof(double));
+	if( tmp == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	for(i = 0; i < taps; i++)
+	{
+		t = i - center;
+		if( t == 0.0 )
+		{
+			tmp[i] = 2.0 * cutoff;
+		} else {
+			tmp[i] = sin(2.0 * pi * cutoff * t) / (pi * t);
+		}
+		r = (center > 0.0) ? (t / center) : 0.0;
+		tmp[i] *= bessel_i0(CHANNELIZER_KAISER_BETA * sqrt(1.0 - r * r)) / i0_beta;
+		sum += tmp[i];
+	}
+	for(i = 0; i < taps; i++)
+	{
+		h[i] = (float)(tmp[i] / sum);
+	}
+	free(tmp);
+	return HACKRF_SUCCESS;
+}
+
+static void filter_steps(hackrf_channelizer* ch, channelizer_worker_t* worker,
+	const uint32_t step_begin, const uint32_t step_end)
+{
+	const uint32_t M = ch->channels;
+	const uint32_t P = ch->taps / M;
+	const float* hr;
+	const float* x;
+	float* w = worker->w;
+	float* u = worker->u;
+	uint32_t step;
+	uint32_t newest;
+	uint32_t rotation;
+	uint32_t k;
+	uint32_t j;
+	uint32_t m;
+
+	for(step = step_begin; step < step_end; step++)
+	{
+		newest = ch->first + step * ch->decimation;
+		rotation = (uint32_t)((ch->first_rotation + (uint64_t)step * ch->decimation) % M);
+
+		/* Branch k covers x[newest - kM - M + 1 .. newest - kM] */
+		memset(w, 0, M * 2 * sizeof(float));
+		for(k = 0; k < P; k++)
+		{
+			hr = &ch->taps_reversed[k * M];
+			x = &ch->buffer[(newest - k * M - (M - 1)) * 2];
+			for(j = 0; j < M; j++)
+			{
+				w[j * 2] += hr[j] * x[j * 2];
+				w[j * 2 + 1] += hr[j] * x[j * 2 + 1];
+			}
+		}
+
+		/* u[m] = v[(m + rotation) mod M] = w[M - 1 - ((m + rotation) mod M)] */
+		for(m = 0; m < M; m++)
+		{
+			j = m + rotation;
+			if( j >= M )
+			{
+				j -= M;
+			}
+			j = M - 1 - j;
+			u[m * 2] = w[j * 2];
+			u[m * 2 + 1] = w[j * 2 + 1];
+		}
+
+		hackrf_fft_execute(ch->plan, u, &ch->matrix[(size_t)step * M * 2]);
+	}
+}
+
+static int deliver_channels(hackrf_channelizer* ch, channelizer_worker_t* worker,
+	const uint32_t channel_begin, const uint32_t channel_end)
+{
+	const uint32_t M = ch->channels;
+	hackrf_channel_block block;
+	const float* src;
+	uint32_t channel;
+	uint32_t step;
+
+	block.channelizer = ch;
+	block.samples = worker->gather;
+	block.count = ch->steps;
+	block.sample_count = ch->output_count;
+
+	for(channel = channel_begin; channel < channel_end; channel++)
+	{
+		if( ch->channel[channel].callback == NULL )
+		{
+			continue;
+		}
+
+		src = &ch->matrix[channel * 2];
+		for(step = 0; step < ch->steps; step++)
+		{
+			worker->gather[step * 2] = src[0];
+			worker->gather[step * 2 + 1] = src[1];
+			src += M * 2;
+		}
+
+		block.channel = channel;
+		block.ctx = ch->channel[channel].ctx;
+		if( ch->channel[channel].callback(&block) != 0 )
+		{
+			return HACKRF_ERROR_OTHER;
+		}
+	}
+	return HACKRF_SUCCESS;
+}
+
+static void filter_job(void* ctx, const uint32_t index, const uint32_t workers)
+{
+	hackrf_channelizer* ch = (hackrf_channelizer*)ctx;
+
+	filter_steps(ch, &ch->worker[index], (uint32_t)((uint64_t)ch->steps * index / workers),
+		(uint32_t)((uint64_t)ch->steps * (index + 1) / workers));
+}
+
+static void deliver_job(void* ctx, const uint32_t index, const uint32_t workers)
+{
+	hackrf_channelizer* ch = (hackrf_channelizer*)ctx;
+
+	ch->worker[index].result = deliver_channels(ch, &ch->worker[index],
+		(uint32_t)((uint64_t)ch->channels * index / workers),
+		(uint32_t)((uint64_t)ch->channels * (index + 1) / workers));
+}
+
+/* Room for count new samples after the history, and their outputs */
+static int reserve(hackrf_channelizer* ch, const uint32_t count)
+{
+	const uint32_t history = ch->taps - 1;
+	const uint32_t steps = count / ch->decimation + 1;
+	float* buffer;
+	float* matrix;
+	float* gather;
+	uint32_t i;
+
+	if( count > ch->buffer_capacity )
+	{
+		buffer = (float*)realloc(ch->buffer, ((size_t)history + count) * 2 * sizeof(float));
+		if( buffer == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		ch->buffer = buffer;
+		ch->buffer_capacity = count;
+	}
+
+	if( steps > ch->matrix_capacity )
+	{
+		matrix = (float*)realloc(ch->matrix, (size_t)steps * ch->channels * 2 * sizeof(float));
+		if( matrix == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		ch->matrix = matrix;
+		for(i = 0; i < ch->threads; i++)
+		{
+			gather = (float*)realloc(ch->worker[i].gather, (size_t)steps * 2 * sizeof(float));
+			if( gather == NULL )
+			{
+				return HACKRF_ERROR_NO_MEM;
+			}
+			ch->worker[i].gather = gather;
+		}
+		ch->matrix_capacity = steps;
+	}
+	return HACKRF_SUCCESS;
+}
+
+/* The block is at buffer + (taps - 1) * 2 */
+static int process_buffer(hackrf_channelizer* ch, const uint32_t count)
+{
+	const uint32_t history = ch->taps - 1;
+	const uint32_t first = ch->decimation - 1 - ch->phase;
+	int result = HACKRF_SUCCESS;
+	uint32_t i;
+
+	if( count > first )
+	{
+		ch->first = history + first;
+		ch->first_rotation = ch->rotation;
+		ch->steps = (count - 1 - first) / ch->decimation + 1;
+
+		hackrf_pool_run(ch->pool, filter_job, ch);
+		hackrf_pool_run(ch->pool, deliver_job, ch);
+		for(i = 0; i < ch->threads; i++)
+		{
+			if( ch->worker[i].result != HACKRF_SUCCESS )
+			{
+				result = ch->worker[i].result;
+			}
+		}
+
+		ch->output_count += ch->steps;
+		ch->rotation = (uint32_t)((ch->rotation + (uint64_t)ch->steps * ch->decimation) % ch->channels);
+	}
+	ch->phase = (uint32_t)((ch->phase + (uint64_t)count) % ch->decimation);
+
+	memmove(ch->buffer, &ch->buffer[(size_t)count * 2], (size_t)history * 2 * sizeof(float));
+	return result;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_channelizer_prototype(const uint32_t channels, const uint32_t taps_per_channel,
+	float* taps)
+{
+	if( (channels == 0) || (channels > HACKRF_CHANNELIZER_CHANNELS_MAX) ||
+		(taps_per_channel == 0) || (taps == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return design_prototype(channels, channels * taps_per_channel, taps);
+}
+
+int ADDCALL hackrf_channelizer_create(const hackrf_channelizer_params* params,
+	hackrf_channelizer** channelizer)
+{
+	hackrf_channelizer* ch;
+	uint32_t M;
+	uint32_t P;
+	uint32_t i;
+	uint32_t j;
+	float* h;
+	int result;
+
+	if( (params == NULL) || (channelizer == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	M = params->channels;
+	P = (params->taps_per_channel == 0) ? HACKRF_CHANNELIZER_TAPS_PER_CHANNEL_DEFAULT : params->taps_per_channel;
+	if( (M < 2) || (M > HACKRF_CHANNELIZER_CHANNELS_MAX) || (params->decimation == 0) ||
+		((M % params->decimation) != 0) || (P > 1024) ||
+		(params->threads > HACKRF_CHANNELIZER_THREADS_MAX) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	ch = (hackrf_channelizer*)calloc(1, sizeof(hackrf_channelizer));
+	if( ch == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	ch->channels = M;
+	ch->decimation = params->decimation;
+	ch->taps = M * P;
+	ch->rotation = (ch->decimation - 1) % M;
+	ch->threads = (params->threads == 0) ? 1 : params->threads;
+	if( ch->threads > M )
+	{
+		ch->threads = M;
+	}
+
+	ch->taps_reversed = (float*)malloc(ch->taps * sizeof(float));
+	ch->channel = (channel_t*)calloc(M, sizeof(channel_t));
+	ch->buffer = (float*)calloc((size_t)(ch->taps - 1) * 2, sizeof(float));
+	ch->worker = (channelizer_worker_t*)calloc(ch->threads, sizeof(channelizer_worker_t));
+	h = (float*)malloc(ch->taps * sizeof(float));
+	if( (ch->taps_reversed == NULL) || (ch->channel == NULL) || (ch->buffer == NULL) ||
+		(ch->worker == NULL) || (h == NULL) ||
+		(design_prototype(M, ch->taps, h) != HACKRF_SUCCESS) )
+	{
+		free(h);
+		free(ch->taps_reversed);
+		free(ch->channel);
+		free(ch->buffer);
+		free(ch->worker);
+		free(ch);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	for(i = 0; i < P; i++)
+	{
+		for(j = 0; j < M; j++)
+		{
+			ch->taps_reversed[i * M + j] = h[i * M + M - 1 - j];
+		}
+	}
+	free(h);
+
+	for(i = 0; i < ch->threads; i++)
+	{
+		ch->worker[i].w = (float*)malloc((size_t)M * 2 * sizeof(float));
+		ch->worker[i].u = (float*)malloc((size_t)M * 2 * sizeof(float));
+		if( (ch->worker[i].w == NULL) || (ch->worker[i].u == NULL) )
+		{
+			hackrf_channelizer_destroy(ch);
+			return HACKRF_ERROR_NO_MEM;
+		}
+	}
+
+	result = hackrf_fft_create(M, 1, &ch->plan);
+	if( result == HACKRF_SUCCESS )
+	{
+		result = hackrf_pool_create(ch->threads, &ch->pool);
+	}
+	if( result != HACKRF_SUCCESS )
+	{
+		hackrf_channelizer_destroy(ch);
+		return result;
+	}
+
+	*channelizer = ch;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_channelizer_set_callback(hackrf_channelizer* channelizer,
+	const uint32_t channel, hackrf_channel_cb_fn callback, void* ctx)
+{
+	if( (channelizer == NULL) || (channel >= channelizer->channels) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	channelizer->channel[channel].callback = callback;
+	channelizer->channel[channel].ctx = ctx;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_channelizer_process(hackrf_channelizer* channelizer,
+	const hackrf_transfer* transfer)
+{
+	uint32_t count;
+	int result;
+
+	if( (channelizer == NULL) || (transfer == NULL) || (transfer->valid_length < 0) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	count = (uint32_t)transfer->valid_length / 2;
+
+	result = reserve(channelizer, count);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	hackrf_convert_cs8_to_cf32((const int8_t*)transfer->buffer,
+		&channelizer->buffer[(size_t)(channelizer->taps - 1) * 2], count, 1.0f / 128, NULL);
+	return process_buffer(channelizer, count);
+}
+
+int ADDCALL hackrf_channelizer_process_cf32(hackrf_channelizer* channelizer,
+	const float* samples, const uint32_t count)
+{
+	int result;
+
+	if( (channelizer == NULL) || ((samples == NULL) && (count > 0)) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = reserve(channelizer, count);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	memcpy(&channelizer->buffer[(size_t)(channelizer->taps - 1) * 2], samples, (size_t)count * 2 * sizeof(float));
+	return process_buffer(channelizer, count);
+}
+
+int ADDCALL hackrf_channelizer_reset(hackrf_channelizer* channelizer)
+{
+	if( channelizer == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	memset(channelizer->buffer, 0, (size_t)(channelizer->taps - 1) * 2 * sizeof(float));
+	channelizer->phase = 0;
+	channelizer->rotation = (channelizer->decimation - 1) % channelizer->channels;
+	channelizer->output_count = 0;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_channelizer_destroy(hackrf_channelizer* channelizer)
+{
+	uint32_t i;
+
+	if( channelizer == NULL )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	hackrf_pool_destroy(channelizer->pool);
+	for(i = 0; i < channelizer->threads; i++)
+	{
+		free(channelizer->worker[i].w);
+		free(channelizer->worker[i].u);
+		free(channelizer->worker[i].gather);
+	}
+	hackrf_fft_destroy(channelizer->plan);
+	free(channelizer->worker);
+	free(channelizer->matrix);
+	free(channelizer->buffer);
+	free(channelizer->channel);
+	free(channelizer->taps_reversed);
+	free(channelizer);
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
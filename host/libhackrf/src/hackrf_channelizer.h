@@ -0,0 +1,95 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __HACKRF_CHANNELIZER_H__
+#define __HACKRF_CHANNELIZER_H__
+
+#include "hackrf.h"
+
+/* Polyphase filter bank channelizer, part of libhackrf_dsp. Splits the
+ * sample rate fs into channels evenly spaced channels of fs / channels,
+ * channel c centered on c * fs / channels (c >= channels / 2 are the
+ * negative frequencies). Each channel is mixed to 0Hz, low pass filtered
+ * (-6dB at +-fs / (2 * channels)) and decimated by decimation: decimation ==
+ * channels is critically sampled, channels / 2 is 2x oversampled and keeps
+ * whole channels free of aliasing. Output is interleaved float I/Q with the
+ * input amplitude (cs8 input is scaled by 1/128). */
+
+#define HACKRF_CHANNELIZER_CHANNELS_MAX (65536)
+#define HACKRF_CHANNELIZER_TAPS_PER_CHANNEL_DEFAULT (12)
+#define HACKRF_CHANNELIZER_THREADS_MAX (64)
+
+typedef struct hackrf_channelizer hackrf_channelizer;
+
+typedef struct {
+	uint32_t channels; /* FFT size */
+	uint32_t decimation; /* Divides channels */
+	uint32_t taps_per_channel; /* Prototype filter length / channels, 0 for default */
+	uint32_t threads; /* Workers including the caller, 0 or 1 for none */
+} hackrf_channelizer_params;
+
+typedef struct {
+	hackrf_channelizer* channelizer;
+	uint32_t channel;
+	const float* samples; /* Valid during the callback only */
+	uint32_t count; /* I/Q samples */
+	uint64_t sample_count; /* Index of samples[0] in the channel stream */
+	void* ctx;
+} hackrf_channel_block;
+
+/* Called for each enabled channel once per processed input block, from the
+ * caller or a worker thread: channels of one group always run in the same
+ * thread, different groups concurrently. Non zero stops the block, see
+ * hackrf_channelizer_process(). */
+typedef int (*hackrf_channel_cb_fn)(const hackrf_channel_block* block);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern ADDAPI int ADDCALL hackrf_channelizer_create(const hackrf_channelizer_params* params,
+	hackrf_channelizer** channelizer);
+/* Only channels with a callback are delivered, NULL disables. Not while a
+ * block is being processed. */
+extern ADDAPI int ADDCALL hackrf_channelizer_set_callback(hackrf_channelizer* channelizer,
+	const uint32_t channel, hackrf_channel_cb_fn callback, void* ctx);
+/* Any block length, e.g. straight from the hackrf_start_rx() callback.
+ * Returns once all callbacks returned, HACKRF_ERROR_OTHER if one asked to
+ * stop (channel outputs of that block may be missing). */
+extern ADDAPI int ADDCALL hackrf_channelizer_process(hackrf_channelizer* channelizer,
+	const hackrf_transfer* transfer);
+extern ADDAPI int ADDCALL hackrf_channelizer_process_cf32(hackrf_channelizer* channelizer,
+	const float* samples, const uint32_t count);
+/* Clears the filter history and sample counts */
+extern ADDAPI int ADDCALL hackrf_channelizer_reset(hackrf_channelizer* channelizer);
+extern ADDAPI int ADDCALL hackrf_channelizer_destroy(hackrf_channelizer* channelizer);
+
+/* Prototype low pass the channelizer uses, for comparisons: taps =
+ * channels * taps_per_channel, DC gain 1. */
+extern ADDAPI int ADDCALL hackrf_channelizer_prototype(const uint32_t channels, const uint32_t taps_per_channel,
+	float* taps);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_CHANNELIZER_H__
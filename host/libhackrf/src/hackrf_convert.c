@@ -0,0 +1,959 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hackrf_convert.h"
+
+#include <stddef.h>
+#include <math.h>
+
+/* SIMD kernels are built with per function target attributes, no special
+ * compiler flags needed, and picked at run time. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONVERT_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/* vcvtnq_s32_f32 (round to nearest even) is AArch64 only */
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+/* Interleaved kernels take n = 2 * count values, I at even indexes. SIMD
+ * loops handle whole vectors and leave the (even sized) tail to scalar. */
+typedef struct {
+	void (*cs8_to_cf32)(const int8_t* src, float* dst, const uint32_t n,
+		const float scale, const float off_i, const float off_q);
+	void (*cs8_to_planar_f32)(const int8_t* src, float* dst_i, float* dst_q, const uint32_t count,
+		const float scale, const float off_i, const float off_q);
+	void (*cs8_to_cs16)(const int8_t* src, int16_t* dst, const uint32_t n,
+		const int16_t dc_i, const int16_t dc_q);
+	void (*cf32_to_cs8)(const float* src, int8_t* dst, const uint32_t n, const float scale);
+	void (*cs16_to_cs8)(const int16_t* src, int8_t* dst, const uint32_t n);
+	void (*cs8_iq_correct)(const int8_t* src, int8_t* dst, const uint32_t n, const hackrf_iq_matrix* m);
+	/* Adds sum_i, sum_q, sum_ii, sum_qq, sum_iq to sums */
+	void (*cs8_moments)(const int8_t* src, const uint32_t count, int64_t* sums);
+} convert_kernels_t;
+
+/* Moments are summed in 32 bit lanes, flushed before they can overflow */
+#define MOMENTS_CHUNK_ITERATIONS (16384)
+
+/* Scalar, reference for the others: scale then subtract the scaled offset,
+ * the same two roundings as the vector code. */
+
+static int16_t saturate_s16(const int32_t value)
+{
+	if( value > 32767 )
+	{
+		return 32767;
+	} else if( value < -32768 ) {
+		return -32768;
+	}
+	return (int16_t)value;
+}
+
+static void cs8_to_cf32_scalar(const int8_t* src, float* dst, const uint32_t n,
+	const float scale, const float off_i, const float off_q)
+{
+	uint32_t i;
+
+	for(i = 0; i < n; i += 2)
+	{
+		dst[i + 0] = (float)src[i + 0] * scale - off_i;
+		dst[i + 1] = (float)src[i + 1] * scale - off_q;
+	}
+}
+
+static void cs8_to_planar_f32_scalar(const int8_t* src, float* dst_i, float* dst_q, const uint32_t count,
+	const float scale, const float off_i, const float off_q)
+{
+	uint32_t j;
+
+	for(j = 0; j < count; j++)
+	{
+		dst_i[j] = (float)src[2 * j + 0] * scale - off_i;
+		dst_q[j] = (float)src[2 * j + 1] * scale - off_q;
+	}
+}
+
+static void cs8_to_cs16_scalar(const int8_t* src, int16_t* dst, const uint32_t n,
+	const int16_t dc_i, const int16_t dc_q)
+{
+	uint32_t i;
+
+	for(i = 0; i < n; i += 2)
+	{
+		dst[i + 0] = saturate_s16((int32_t)src[i + 0] * 256 - dc_i);
+		dst[i + 1] = saturate_s16((int32_t)src[i + 1] * 256 - dc_q);
+	}
+}
+
+static int8_t round_s8(float value)
+{
+	if( value != value )
+	{
+		/* NaN, 0 as the vector kernels give */
+		return 0;
+	} else if( value > 127.0f )
+	{
+		value = 127.0f;
+	} else if( value < -128.0f ) {
+		value = -128.0f;
+	}
+	return (int8_t)lrintf(value);
+}
+
+static void cf32_to_cs8_scalar(const float* src, int8_t* dst, const uint32_t n, const float scale)
+{
+	uint32_t i;
+
+	for(i = 0; i < n; i++)
+	{
+		dst[i] = round_s8(src[i] * scale);
+	}
+}
+
+static void cs16_to_cs8_scalar(const int16_t* src, int8_t* dst, const uint32_t n)
+{
+	uint32_t i;
+
+	for(i = 0; i < n; i++)
+	{
+		/* Arithmetic shift, the saturated add keeps 32767 at 127 */
+		dst[i] = (int8_t)(saturate_s16((int32_t)src[i] + 128) >> 8);
+	}
+}
+
+static void cs8_iq_correct_scalar(const int8_t* src, int8_t* dst, const uint32_t n, const hackrf_iq_matrix* m)
+{
+	float in_i, in_q;
+	uint32_t i;
+
+	for(i = 0; i < n; i += 2)
+	{
+		in_i = (float)src[i + 0];
+		in_q = (float)src[i + 1];
+		dst[i + 0] = round_s8(in_i * m->ii + in_q * m->iq + m->off_i);
+		dst[i + 1] = round_s8(in_q * m->qq + in_i * m->qi + m->off_q);
+	}
+}
+
+static void cs8_moments_scalar(const int8_t* src, const uint32_t count, int64_t* sums)
+{
+	int32_t in_i, in_q;
+	uint32_t j;
+
+	for(j = 0; j < count; j++)
+	{
+		in_i = src[2 * j + 0];
+		in_q = src[2 * j + 1];
+		sums[0] += in_i;
+		sums[1] += in_q;
+		sums[2] += in_i * in_i;
+		sums[3] += in_q * in_q;
+		sums[4] += in_i * in_q;
+	}
+}
+
+#ifdef CONVERT_X86
+
+TARGET_SSE2
+static void cs8_to_cf32_sse2(const int8_t* src, float* dst, const uint32_t n,
+	const float scale, const float off_i, const float off_q)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 off = _mm_setr_ps(off_i, off_q, off_i, off_q);
+	__m128i v, lo, hi;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		/* Sign extend by placing each byte in the top of a wider lane */
+		v = _mm_loadu_si128((const __m128i*)&src[i]);
+		lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+		_mm_storeu_ps(&dst[i + 0], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), s), off));
+		_mm_storeu_ps(&dst[i + 4], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), s), off));
+		_mm_storeu_ps(&dst[i + 8], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), s), off));
+		_mm_storeu_ps(&dst[i + 12], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), s), off));
+	}
+	cs8_to_cf32_scalar(&src[i], &dst[i], n - i, scale, off_i, off_q);
+}
+
+TARGET_SSE2
+static void cs8_to_planar_f32_sse2(const int8_t* src, float* dst_i, float* dst_q, const uint32_t count,
+	const float scale, const float off_i, const float off_q)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 oi = _mm_set1_ps(off_i);
+	const __m128 oq = _mm_set1_ps(off_q);
+	__m128i v, i16, q16;
+	uint32_t j;
+
+	for(j = 0; j + 8 <= count; j += 8)
+	{
+		/* Each 16 bit lane holds one I/Q pair, I in the low byte */
+		v = _mm_loadu_si128((const __m128i*)&src[2 * j]);
+		i16 = _mm_srai_epi16(_mm_slli_epi16(v, 8), 8);
+		q16 = _mm_srai_epi16(v, 8);
+		_mm_storeu_ps(&dst_i[j + 0], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(i16, i16), 16)), s), oi));
+		_mm_storeu_ps(&dst_i[j + 4], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(i16, i16), 16)), s), oi));
+		_mm_storeu_ps(&dst_q[j + 0], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(q16, q16), 16)), s), oq));
+		_mm_storeu_ps(&dst_q[j + 4], _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(q16, q16), 16)), s), oq));
+	}
+	cs8_to_planar_f32_scalar(&src[2 * j], &dst_i[j], &dst_q[j], count - j, scale, off_i, off_q);
+}
+
+TARGET_SSE2
+static void cs8_to_cs16_sse2(const int8_t* src, int16_t* dst, const uint32_t n,
+	const int16_t dc_i, const int16_t dc_q)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i dc = _mm_setr_epi16(dc_i, dc_q, dc_i, dc_q, dc_i, dc_q, dc_i, dc_q);
+	__m128i v;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		/* Byte in the high half of the lane is the value times 256 */
+		v = _mm_loadu_si128((const __m128i*)&src[i]);
+		_mm_storeu_si128((__m128i*)&dst[i + 0], _mm_subs_epi16(_mm_unpacklo_epi8(zero, v), dc));
+		_mm_storeu_si128((__m128i*)&dst[i + 8], _mm_subs_epi16(_mm_unpackhi_epi8(zero, v), dc));
+	}
+	cs8_to_cs16_scalar(&src[i], &dst[i], n - i, dc_i, dc_q);
+}
+
+/* Clamp first, out of range conversions give INT32_MIN. NaN lanes are
+ * zeroed, the NEON conversion and round_s8() give 0 for them too. */
+TARGET_SSE2
+static __m128i f32_to_s32_clamped_sse2(const __m128 x, const __m128 min, const __m128 max)
+{
+	return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_and_ps(x, _mm_cmpord_ps(x, x)), min), max));
+}
+
+TARGET_SSE2
+static void cf32_to_cs8_sse2(const float* src, int8_t* dst, const uint32_t n, const float scale)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 min = _mm_set1_ps(-128.0f);
+	const __m128 max = _mm_set1_ps(127.0f);
+	__m128i a, b, c, d;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		a = f32_to_s32_clamped_sse2(_mm_mul_ps(_mm_loadu_ps(&src[i + 0]), s), min, max);
+		b = f32_to_s32_clamped_sse2(_mm_mul_ps(_mm_loadu_ps(&src[i + 4]), s), min, max);
+		c = f32_to_s32_clamped_sse2(_mm_mul_ps(_mm_loadu_ps(&src[i + 8]), s), min, max);
+		d = f32_to_s32_clamped_sse2(_mm_mul_ps(_mm_loadu_ps(&src[i + 12]), s), min, max);
+		_mm_storeu_si128((__m128i*)&dst[i], _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+	cf32_to_cs8_scalar(&src[i], &dst[i], n - i, scale);
+}
+
+TARGET_SSE2
+static void cs16_to_cs8_sse2(const int16_t* src, int8_t* dst, const uint32_t n)
+{
+	const __m128i half = _mm_set1_epi16(128);
+	__m128i a, b;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		a = _mm_srai_epi16(_mm_adds_epi16(_mm_loadu_si128((const __m128i*)&src[i + 0]), half), 8);
+		b = _mm_srai_epi16(_mm_adds_epi16(_mm_loadu_si128((const __m128i*)&src[i + 8]), half), 8);
+		_mm_storeu_si128((__m128i*)&dst[i], _mm_packs_epi16(a, b));
+	}
+	cs16_to_cs8_scalar(&src[i], &dst[i], n - i);
+}
+
+TARGET_AVX2
+static void cs8_to_cf32_avx2(const int8_t* src, float* dst, const uint32_t n,
+	const float scale, const float off_i, const float off_q)
+{
+	const __m256 s = _mm256_set1_ps(scale);
+	const __m256 off = _mm256_setr_ps(off_i, off_q, off_i, off_q, off_i, off_q, off_i, off_q);
+	__m256i v;
+	uint32_t i;
+
+	for(i = 0; i + 8 <= n; i += 8)
+	{
+		v = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)&src[i]));
+		_mm256_storeu_ps(&dst[i], _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(v), s), off));
+	}
+	cs8_to_cf32_scalar(&src[i], &dst[i], n - i, scale, off_i, off_q);
+}
+
+TARGET_AVX2
+static void cs8_to_planar_f32_avx2(const int8_t* src, float* dst_i, float* dst_q, const uint32_t count,
+	const float scale, const float off_i, const float off_q)
+{
+	const __m256 s = _mm256_set1_ps(scale);
+	const __m256 oi = _mm256_set1_ps(off_i);
+	const __m256 oq = _mm256_set1_ps(off_q);
+	__m256i v, i16, q16;
+	uint32_t j;
+
+	for(j = 0; j + 16 <= count; j += 16)
+	{
+		v = _mm256_loadu_si256((const __m256i*)&src[2 * j]);
+		i16 = _mm256_srai_epi16(_mm256_slli_epi16(v, 8), 8);
+		q16 = _mm256_srai_epi16(v, 8);
+		_mm256_storeu_ps(&dst_i[j + 0], _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(i16))), s), oi));
+		_mm256_storeu_ps(&dst_i[j + 8], _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(i16, 1))), s), oi));
+		_mm256_storeu_ps(&dst_q[j + 0], _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(q16))), s), oq));
+		_mm256_storeu_ps(&dst_q[j + 8], _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(q16, 1))), s), oq));
+	}
+	cs8_to_planar_f32_scalar(&src[2 * j], &dst_i[j], &dst_q[j], count - j, scale, off_i, off_q);
+}
+
+TARGET_AVX2
+static void cs8_to_cs16_avx2(const int8_t* src, int16_t* dst, const uint32_t n,
+	const int16_t dc_i, const int16_t dc_q)
+{
+	const __m256i dc = _mm256_setr_epi16(dc_i, dc_q, dc_i, dc_q, dc_i, dc_q, dc_i, dc_q,
+		dc_i, dc_q, dc_i, dc_q, dc_i, dc_q, dc_i, dc_q);
+	__m256i v;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		v = _mm256_slli_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)&src[i])), 8);
+		_mm256_storeu_si256((__m256i*)&dst[i], _mm256_subs_epi16(v, dc));
+	}
+	cs8_to_cs16_scalar(&src[i], &dst[i], n - i, dc_i, dc_q);
+}
+
+/* As f32_to_s32_clamped_sse2() */
+TARGET_AVX2
+static __m256i f32_to_s32_clamped_avx2(const __m256 x, const __m256 min, const __m256 max)
+{
+	return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q)), min), max));
+}
+
+TARGET_AVX2
+static void cf32_to_cs8_avx2(const float* src, int8_t* dst, const uint32_t n, const float scale)
+{
+	const __m256 s = _mm256_set1_ps(scale);
+	const __m256 min = _mm256_set1_ps(-128.0f);
+	const __m256 max = _mm256_set1_ps(127.0f);
+	/* Packs work within 128 bit lanes, put the dwords back in order */
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i a, b, c, d, v;
+	uint32_t i;
+
+	for(i = 0; i + 32 <= n; i += 32)
+	{
+		a = f32_to_s32_clamped_avx2(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 0]), s), min, max);
+		b = f32_to_s32_clamped_avx2(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 8]), s), min, max);
+		c = f32_to_s32_clamped_avx2(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 16]), s), min, max);
+		d = f32_to_s32_clamped_avx2(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 24]), s), min, max);
+		v = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+		_mm256_storeu_si256((__m256i*)&dst[i], _mm256_permutevar8x32_epi32(v, order));
+	}
+	cf32_to_cs8_scalar(&src[i], &dst[i], n - i, scale);
+}
+
+TARGET_AVX2
+static void cs16_to_cs8_avx2(const int16_t* src, int8_t* dst, const uint32_t n)
+{
+	const __m256i half = _mm256_set1_epi16(128);
+	__m256i a, b;
+	uint32_t i;
+
+	for(i = 0; i + 32 <= n; i += 32)
+	{
+		a = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)&src[i + 0]), half), 8);
+		b = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)&src[i + 16]), half), 8);
+		/* Packs work within 128 bit lanes, put the qwords back in order */
+		_mm256_storeu_si256((__m256i*)&dst[i], _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8));
+	}
+	cs16_to_cs8_scalar(&src[i], &dst[i], n - i);
+}
+
+TARGET_SSE2
+static int64_t hsum_sse2(const __m128i v)
+{
+	int32_t lanes[4];
+
+	_mm_storeu_si128((__m128i*)lanes, v);
+	return (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+/* Interleaved I/Q in, each output lane mixes with its pair partner */
+TARGET_SSE2
+static __m128i iq_correct_sse2(const __m128i v32, const __m128 a, const __m128 b, const __m128 off,
+	const __m128 min, const __m128 max)
+{
+	const __m128 x = _mm_cvtepi32_ps(v32);
+	const __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, a),
+		_mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)), b)), off);
+	return f32_to_s32_clamped_sse2(y, min, max);
+}
+
+TARGET_SSE2
+static void cs8_iq_correct_sse2(const int8_t* src, int8_t* dst, const uint32_t n, const hackrf_iq_matrix* m)
+{
+	const __m128 a = _mm_setr_ps(m->ii, m->qq, m->ii, m->qq);
+	const __m128 b = _mm_setr_ps(m->iq, m->qi, m->iq, m->qi);
+	const __m128 off = _mm_setr_ps(m->off_i, m->off_q, m->off_i, m->off_q);
+	const __m128 min = _mm_set1_ps(-128.0f);
+	const __m128 max = _mm_set1_ps(127.0f);
+	__m128i v, lo, hi, w, x, y, z;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		v = _mm_loadu_si128((const __m128i*)&src[i]);
+		lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+		w = iq_correct_sse2(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), a, b, off, min, max);
+		x = iq_correct_sse2(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), a, b, off, min, max);
+		y = iq_correct_sse2(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), a, b, off, min, max);
+		z = iq_correct_sse2(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), a, b, off, min, max);
+		_mm_storeu_si128((__m128i*)&dst[i], _mm_packs_epi16(_mm_packs_epi32(w, x), _mm_packs_epi32(y, z)));
+	}
+	cs8_iq_correct_scalar(&src[i], &dst[i], n - i, m);
+}
+
+TARGET_SSE2
+static void cs8_moments_sse2(const int8_t* src, const uint32_t count, int64_t* sums)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i v, i16, q16, si, sq, sii, sqq, siq;
+	uint32_t j = 0;
+	uint32_t iterations;
+
+	while( j + 8 <= count )
+	{
+		si = sq = sii = sqq = siq = _mm_setzero_si128();
+		for(iterations = 0; (iterations < MOMENTS_CHUNK_ITERATIONS) && (j + 8 <= count); iterations++, j += 8)
+		{
+			v = _mm_loadu_si128((const __m128i*)&src[2 * j]);
+			i16 = _mm_srai_epi16(_mm_slli_epi16(v, 8), 8);
+			q16 = _mm_srai_epi16(v, 8);
+			si = _mm_add_epi32(si, _mm_madd_epi16(i16, ones));
+			sq = _mm_add_epi32(sq, _mm_madd_epi16(q16, ones));
+			sii = _mm_add_epi32(sii, _mm_madd_epi16(i16, i16));
+			sqq = _mm_add_epi32(sqq, _mm_madd_epi16(q16, q16));
+			siq = _mm_add_epi32(siq, _mm_madd_epi16(i16, q16));
+		}
+		sums[0] += hsum_sse2(si);
+		sums[1] += hsum_sse2(sq);
+		sums[2] += hsum_sse2(sii);
+		sums[3] += hsum_sse2(sqq);
+		sums[4] += hsum_sse2(siq);
+	}
+	cs8_moments_scalar(&src[2 * j], count - j, sums);
+}
+
+TARGET_AVX2
+static int64_t hsum_avx2(const __m256i v)
+{
+	int32_t lanes[8];
+	int64_t sum = 0;
+	int k;
+
+	_mm256_storeu_si256((__m256i*)lanes, v);
+	for(k = 0; k < 8; k++)
+	{
+		sum += lanes[k];
+	}
+	return sum;
+}
+
+TARGET_AVX2
+static __m256i iq_correct_avx2(const __m128i v8, const __m256 a, const __m256 b, const __m256 off,
+	const __m256 min, const __m256 max)
+{
+	const __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v8));
+	const __m256 y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, a),
+		_mm256_mul_ps(_mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)), b)), off);
+	return f32_to_s32_clamped_avx2(y, min, max);
+}
+
+TARGET_AVX2
+static void cs8_iq_correct_avx2(const int8_t* src, int8_t* dst, const uint32_t n, const hackrf_iq_matrix* m)
+{
+	const __m256 a = _mm256_setr_ps(m->ii, m->qq, m->ii, m->qq, m->ii, m->qq, m->ii, m->qq);
+	const __m256 b = _mm256_setr_ps(m->iq, m->qi, m->iq, m->qi, m->iq, m->qi, m->iq, m->qi);
+	const __m256 off = _mm256_setr_ps(m->off_i, m->off_q, m->off_i, m->off_q,
+		m->off_i, m->off_q, m->off_i, m->off_q);
+	const __m256 min = _mm256_set1_ps(-128.0f);
+	const __m256 max = _mm256_set1_ps(127.0f);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i w, x, y, z, v;
+	uint32_t i;
+
+	for(i = 0; i + 32 <= n; i += 32)
+	{
+		w = iq_correct_avx2(_mm_loadl_epi64((const __m128i*)&src[i + 0]), a, b, off, min, max);
+		x = iq_correct_avx2(_mm_loadl_epi64((const __m128i*)&src[i + 8]), a, b, off, min, max);
+		y = iq_correct_avx2(_mm_loadl_epi64((const __m128i*)&src[i + 16]), a, b, off, min, max);
+		z = iq_correct_avx2(_mm_loadl_epi64((const __m128i*)&src[i + 24]), a, b, off, min, max);
+		v = _mm256_packs_epi16(_mm256_packs_epi32(w, x), _mm256_packs_epi32(y, z));
+		_mm256_storeu_si256((__m256i*)&dst[i], _mm256_permutevar8x32_epi32(v, order));
+	}
+	cs8_iq_correct_scalar(&src[i], &dst[i], n - i, m);
+}
+
+TARGET_AVX2
+static void cs8_moments_avx2(const int8_t* src, const uint32_t count, int64_t* sums)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i v, i16, q16, si, sq, sii, sqq, siq;
+	uint32_t j = 0;
+	uint32_t iterations;
+
+	while( j + 16 <= count )
+	{
+		si = sq = sii = sqq = siq = _mm256_setzero_si256();
+		for(iterations = 0; (iterations < MOMENTS_CHUNK_ITERATIONS) && (j + 16 <= count); iterations++, j += 16)
+		{
+			v = _mm256_loadu_si256((const __m256i*)&src[2 * j]);
+			i16 = _mm256_srai_epi16(_mm256_slli_epi16(v, 8), 8);
+			q16 = _mm256_srai_epi16(v, 8);
+			si = _mm256_add_epi32(si, _mm256_madd_epi16(i16, ones));
+			sq = _mm256_add_epi32(sq, _mm256_madd_epi16(q16, ones));
+			sii = _mm256_add_epi32(sii, _mm256_madd_epi16(i16, i16));
+			sqq = _mm256_add_epi32(sqq, _mm256_madd_epi16(q16, q16));
+			siq = _mm256_add_epi32(siq, _mm256_madd_epi16(i16, q16));
+		}
+		sums[0] += hsum_avx2(si);
+		sums[1] += hsum_avx2(sq);
+		sums[2] += hsum_avx2(sii);
+		sums[3] += hsum_avx2(sqq);
+		sums[4] += hsum_avx2(siq);
+	}
+	cs8_moments_scalar(&src[2 * j], count - j, sums);
+}
+
+#endif /* CONVERT_X86 */
+
+#ifdef CONVERT_NEON
+
+static void store_s16x8_f32(const int16x8_t v, float* dst, const float32x4_t s, const float32x4_t off)
+{
+	vst1q_f32(&dst[0], vsubq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), s), off));
+	vst1q_f32(&dst[4], vsubq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), s), off));
+}
+
+static void cs8_to_cf32_neon(const int8_t* src, float* dst, const uint32_t n,
+	const float scale, const float off_i, const float off_q)
+{
+	const float off_iq[4] = { off_i, off_q, off_i, off_q };
+	const float32x4_t s = vdupq_n_f32(scale);
+	const float32x4_t off = vld1q_f32(off_iq);
+	int8x16_t v;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		v = vld1q_s8(&src[i]);
+		store_s16x8_f32(vmovl_s8(vget_low_s8(v)), &dst[i + 0], s, off);
+		store_s16x8_f32(vmovl_s8(vget_high_s8(v)), &dst[i + 8], s, off);
+	}
+	cs8_to_cf32_scalar(&src[i], &dst[i], n - i, scale, off_i, off_q);
+}
+
+static void cs8_to_planar_f32_neon(const int8_t* src, float* dst_i, float* dst_q, const uint32_t count,
+	const float scale, const float off_i, const float off_q)
+{
+	const float32x4_t s = vdupq_n_f32(scale);
+	const float32x4_t oi = vdupq_n_f32(off_i);
+	const float32x4_t oq = vdupq_n_f32(off_q);
+	int8x16x2_t v;
+	uint32_t j;
+
+	for(j = 0; j + 16 <= count; j += 16)
+	{
+		/* De-interleaving load, val[0] is I */
+		v = vld2q_s8(&src[2 * j]);
+		store_s16x8_f32(vmovl_s8(vget_low_s8(v.val[0])), &dst_i[j + 0], s, oi);
+		store_s16x8_f32(vmovl_s8(vget_high_s8(v.val[0])), &dst_i[j + 8], s, oi);
+		store_s16x8_f32(vmovl_s8(vget_low_s8(v.val[1])), &dst_q[j + 0], s, oq);
+		store_s16x8_f32(vmovl_s8(vget_high_s8(v.val[1])), &dst_q[j + 8], s, oq);
+	}
+	cs8_to_planar_f32_scalar(&src[2 * j], &dst_i[j], &dst_q[j], count - j, scale, off_i, off_q);
+}
+
+static void cs8_to_cs16_neon(const int8_t* src, int16_t* dst, const uint32_t n,
+	const int16_t dc_i, const int16_t dc_q)
+{
+	const int16_t dc_iq[8] = { dc_i, dc_q, dc_i, dc_q, dc_i, dc_q, dc_i, dc_q };
+	const int16x8_t dc = vld1q_s16(dc_iq);
+	int8x16_t v;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		v = vld1q_s8(&src[i]);
+		vst1q_s16(&dst[i + 0], vqsubq_s16(vshll_n_s8(vget_low_s8(v), 8), dc));
+		vst1q_s16(&dst[i + 8], vqsubq_s16(vshll_n_s8(vget_high_s8(v), 8), dc));
+	}
+	cs8_to_cs16_scalar(&src[i], &dst[i], n - i, dc_i, dc_q);
+}
+
+/* vmaxq/vminq keep NaN and the conversion turns it into 0, as round_s8() */
+static int32x4_t f32_to_s32_clamped(const float* src, const float32x4_t s,
+	const float32x4_t min, const float32x4_t max)
+{
+	return vcvtnq_s32_f32(vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(src), s), min), max));
+}
+
+static void cf32_to_cs8_neon(const float* src, int8_t* dst, const uint32_t n, const float scale)
+{
+	const float32x4_t s = vdupq_n_f32(scale);
+	const float32x4_t min = vdupq_n_f32(-128.0f);
+	const float32x4_t max = vdupq_n_f32(127.0f);
+	int16x8_t lo, hi;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		lo = vcombine_s16(vqmovn_s32(f32_to_s32_clamped(&src[i + 0], s, min, max)),
+			vqmovn_s32(f32_to_s32_clamped(&src[i + 4], s, min, max)));
+		hi = vcombine_s16(vqmovn_s32(f32_to_s32_clamped(&src[i + 8], s, min, max)),
+			vqmovn_s32(f32_to_s32_clamped(&src[i + 12], s, min, max)));
+		vst1q_s8(&dst[i], vcombine_s8(vqmovn_s16(lo), vqmovn_s16(hi)));
+	}
+	cf32_to_cs8_scalar(&src[i], &dst[i], n - i, scale);
+}
+
+static void cs16_to_cs8_neon(const int16_t* src, int8_t* dst, const uint32_t n)
+{
+	const int16x8_t half = vdupq_n_s16(128);
+	int16x8_t a, b;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		a = vshrq_n_s16(vqaddq_s16(vld1q_s16(&src[i + 0]), half), 8);
+		b = vshrq_n_s16(vqaddq_s16(vld1q_s16(&src[i + 8]), half), 8);
+		vst1q_s8(&dst[i], vcombine_s8(vmovn_s16(a), vmovn_s16(b)));
+	}
+	cs16_to_cs8_scalar(&src[i], &dst[i], n - i);
+}
+
+static int32x4_t iq_correct_neon(const int16x4_t v16, const float32x4_t a, const float32x4_t b,
+	const float32x4_t off, const float32x4_t min, const float32x4_t max)
+{
+	const float32x4_t x = vcvtq_f32_s32(vmovl_s16(v16));
+	const float32x4_t y = vaddq_f32(vaddq_f32(vmulq_f32(x, a), vmulq_f32(vrev64q_f32(x), b)), off);
+	return vcvtnq_s32_f32(vminq_f32(vmaxq_f32(y, min), max));
+}
+
+static void cs8_iq_correct_neon(const int8_t* src, int8_t* dst, const uint32_t n, const hackrf_iq_matrix* m)
+{
+	const float a_v[4] = { m->ii, m->qq, m->ii, m->qq };
+	const float b_v[4] = { m->iq, m->qi, m->iq, m->qi };
+	const float off_v[4] = { m->off_i, m->off_q, m->off_i, m->off_q };
+	const float32x4_t a = vld1q_f32(a_v);
+	const float32x4_t b = vld1q_f32(b_v);
+	const float32x4_t off = vld1q_f32(off_v);
+	const float32x4_t min = vdupq_n_f32(-128.0f);
+	const float32x4_t max = vdupq_n_f32(127.0f);
+	int8x16_t v;
+	int16x8_t lo, hi, w, x;
+	uint32_t i;
+
+	for(i = 0; i + 16 <= n; i += 16)
+	{
+		v = vld1q_s8(&src[i]);
+		lo = vmovl_s8(vget_low_s8(v));
+		hi = vmovl_s8(vget_high_s8(v));
+		w = vcombine_s16(vqmovn_s32(iq_correct_neon(vget_low_s16(lo), a, b, off, min, max)),
+			vqmovn_s32(iq_correct_neon(vget_high_s16(lo), a, b, off, min, max)));
+		x = vcombine_s16(vqmovn_s32(iq_correct_neon(vget_low_s16(hi), a, b, off, min, max)),
+			vqmovn_s32(iq_correct_neon(vget_high_s16(hi), a, b, off, min, max)));
+		vst1q_s8(&dst[i], vcombine_s8(vqmovn_s16(w), vqmovn_s16(x)));
+	}
+	cs8_iq_correct_scalar(&src[i], &dst[i], n - i, m);
+}
+
+static int32x4_t square_add_neon(const int32x4_t acc, const int8x16_t x, const int8x16_t y)
+{
+	/* 8 bit products fit in 16 bits, pairs are added into 32 bit lanes */
+	return vpadalq_s16(vpadalq_s16(acc, vmull_s8(vget_low_s8(x), vget_low_s8(y))),
+		vmull_s8(vget_high_s8(x), vget_high_s8(y)));
+}
+
+static void cs8_moments_neon(const int8_t* src, const uint32_t count, int64_t* sums)
+{
+	int8x16x2_t v;
+	int32x4_t si, sq, sii, sqq, siq;
+	uint32_t j = 0;
+	uint32_t iterations;
+
+	while( j + 16 <= count )
+	{
+		si = sq = sii = sqq = siq = vdupq_n_s32(0);
+		for(iterations = 0; (iterations < MOMENTS_CHUNK_ITERATIONS) && (j + 16 <= count); iterations++, j += 16)
+		{
+			v = vld2q_s8(&src[2 * j]);
+			si = vpadalq_s16(si, vpaddlq_s8(v.val[0]));
+			sq = vpadalq_s16(sq, vpaddlq_s8(v.val[1]));
+			sii = square_add_neon(sii, v.val[0], v.val[0]);
+			sqq = square_add_neon(sqq, v.val[1], v.val[1]);
+			siq = square_add_neon(siq, v.val[0], v.val[1]);
+		}
+		/* Lanes may hold up to 2^30, widen before adding them up */
+		sums[0] += vaddvq_s64(vpaddlq_s32(si));
+		sums[1] += vaddvq_s64(vpaddlq_s32(sq));
+		sums[2] += vaddvq_s64(vpaddlq_s32(sii));
+		sums[3] += vaddvq_s64(vpaddlq_s32(sqq));
+		sums[4] += vaddvq_s64(vpaddlq_s32(siq));
+	}
+	cs8_moments_scalar(&src[2 * j], count - j, sums);
+}
+
+#endif /* CONVERT_NEON */
+
+/* Indexed by enum hackrf_convert_kernel, kernels not built in fall back to
+ * scalar and are reported unsupported. */
+static const convert_kernels_t convert_kernels[] = {
+	{ cs8_to_cf32_scalar, cs8_to_planar_f32_scalar, cs8_to_cs16_scalar, cf32_to_cs8_scalar, cs16_to_cs8_scalar,
+		cs8_iq_correct_scalar, cs8_moments_scalar },
+#ifdef CONVERT_X86
+	{ cs8_to_cf32_sse2, cs8_to_planar_f32_sse2, cs8_to_cs16_sse2, cf32_to_cs8_sse2, cs16_to_cs8_sse2,
+		cs8_iq_correct_sse2, cs8_moments_sse2 },
+	{ cs8_to_cf32_avx2, cs8_to_planar_f32_avx2, cs8_to_cs16_avx2, cf32_to_cs8_avx2, cs16_to_cs8_avx2,
+		cs8_iq_correct_avx2, cs8_moments_avx2 },
+#else
+	{ cs8_to_cf32_scalar, cs8_to_planar_f32_scalar, cs8_to_cs16_scalar, cf32_to_cs8_scalar, cs16_to_cs8_scalar,
+		cs8_iq_correct_scalar, cs8_moments_scalar },
+	{ cs8_to_cf32_scalar, cs8_to_planar_f32_scalar, cs8_to_cs16_scalar, cf32_to_cs8_scalar, cs16_to_cs8_scalar,
+		cs8_iq_correct_scalar, cs8_moments_scalar },
+#endif
+#ifdef CONVERT_NEON
+	{ cs8_to_cf32_neon, cs8_to_planar_f32_neon, cs8_to_cs16_neon, cf32_to_cs8_neon, cs16_to_cs8_neon,
+		cs8_iq_correct_neon, cs8_moments_neon },
+#else
+	{ cs8_to_cf32_scalar, cs8_to_planar_f32_scalar, cs8_to_cs16_scalar, cf32_to_cs8_scalar, cs16_to_cs8_scalar,
+		cs8_iq_correct_scalar, cs8_moments_scalar },
+#endif
+};
+
+#define CONVERT_KERNEL_COUNT (sizeof(convert_kernels) / sizeof(convert_kernels[0]))
+
+static bool kernel_supported(const enum hackrf_convert_kernel kernel)
+{
+	switch( kernel )
+	{
+	case HACKRF_CONVERT_SCALAR:
+		return true;
+
+#ifdef CONVERT_X86
+	case HACKRF_CONVERT_SSE2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2");
+
+	case HACKRF_CONVERT_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+
+#ifdef CONVERT_NEON
+	case HACKRF_CONVERT_NEON:
+		return true;
+#endif
+
+	default:
+		return false;
+	}
+}
+
+/* Chosen on first use. Racing first calls pick the same kernel, a plain
+ * pointer store is fine. */
+static volatile int kernel_index = -1;
+
+static const convert_kernels_t* kernels(void)
+{
+	int index = kernel_index;
+	int i;
+
+	if( index < 0 )
+	{
+		index = HACKRF_CONVERT_SCALAR;
+		for(i = (int)CONVERT_KERNEL_COUNT - 1; i > HACKRF_CONVERT_SCALAR; i--)
+		{
+			if( kernel_supported((enum hackrf_convert_kernel)i) )
+			{
+				index = i;
+				break;
+			}
+		}
+		kernel_index = index;
+	}
+	return &convert_kernels[index];
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_convert_set_kernel(const enum hackrf_convert_kernel kernel)
+{
+	if( ((uint32_t)kernel >= CONVERT_KERNEL_COUNT) || !kernel_supported(kernel) )
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	kernel_index = kernel;
+	return HACKRF_SUCCESS;
+}
+
+enum hackrf_convert_kernel ADDCALL hackrf_convert_get_kernel(void)
+{
+	return (enum hackrf_convert_kernel)(kernels() - convert_kernels);
+}
+
+const char* ADDCALL hackrf_convert_kernel_name(const enum hackrf_convert_kernel kernel)
+{
+	switch( kernel )
+	{
+	case HACKRF_CONVERT_SCALAR:
+		return "scalar";
+
+	case HACKRF_CONVERT_SSE2:
+		return "SSE2";
+
+	case HACKRF_CONVERT_AVX2:
+		return "AVX2";
+
+	case HACKRF_CONVERT_NEON:
+		return "NEON";
+
+	default:
+		return "unknown kernel";
+	}
+}
+
+int ADDCALL hackrf_convert_cs8_to_cf32(const int8_t* src, float* dst, const uint32_t count,
+	const float scale, const float* dc)
+{
+	if( (src == NULL) || (dst == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( dc != NULL )
+	{
+		kernels()->cs8_to_cf32(src, dst, 2 * count, scale, dc[0] * scale, dc[1] * scale);
+	} else {
+		kernels()->cs8_to_cf32(src, dst, 2 * count, scale, 0.0f, 0.0f);
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_convert_cs8_to_planar_f32(const int8_t* src, float* dst_i, float* dst_q,
+	const uint32_t count, const float scale, const float* dc)
+{
+	if( (src == NULL) || (dst_i == NULL) || (dst_q == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( dc != NULL )
+	{
+		kernels()->cs8_to_planar_f32(src, dst_i, dst_q, count, scale, dc[0] * scale, dc[1] * scale);
+	} else {
+		kernels()->cs8_to_planar_f32(src, dst_i, dst_q, count, scale, 0.0f, 0.0f);
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_convert_cs8_to_cs16(const int8_t* src, int16_t* dst, const uint32_t count,
+	const int16_t* dc)
+{
+	if( (src == NULL) || (dst == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if( dc != NULL )
+	{
+		kernels()->cs8_to_cs16(src, dst, 2 * count, dc[0], dc[1]);
+	} else {
+		kernels()->cs8_to_cs16(src, dst, 2 * count, 0, 0);
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_convert_cf32_to_cs8(const float* src, int8_t* dst, const uint32_t count,
+	const float scale)
+{
+	if( (src == NULL) || (dst == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	kernels()->cf32_to_cs8(src, dst, 2 * count, scale);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_convert_cs16_to_cs8(const int16_t* src, int8_t* dst, const uint32_t count)
+{
+	if( (src == NULL) || (dst == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	kernels()->cs16_to_cs8(src, dst, 2 * count);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_convert_cs8_iq_correct(const int8_t* src, int8_t* dst, const uint32_t count,
+	const hackrf_iq_matrix* matrix)
+{
+	if( (src == NULL) || (dst == NULL) || (matrix == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	kernels()->cs8_iq_correct(src, dst, 2 * count, matrix);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_convert_cs8_moments(const int8_t* src, const uint32_t count,
+	hackrf_iq_moments* moments)
+{
+	int64_t sums[5] = { 0, 0, 0, 0, 0 };
+
+	if( (src == NULL) || (moments == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	kernels()->cs8_moments(src, count, sums);
+	moments->sum_i += sums[0];
+	moments->sum_q += sums[1];
+	moments->sum_ii += sums[2];
+	moments->sum_qq += sums[3];
+	moments->sum_iq += sums[4];
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
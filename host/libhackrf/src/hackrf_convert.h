@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __HACKRF_CONVERT_H__
+#define __HACKRF_CONVERT_H__
+
+#include "hackrf.h"
+
+/* Sample format conversion between the interleaved signed 8 bit I/Q of
+ * hackrf_transfer.buffer (cs8) and float (cf32), 16 bit (cs16) or planar
+ * float I/Q. count is in I/Q samples, src and dst need not be aligned and
+ * must not overlap. All kernels give bit identical results: float to 8 bit
+ * rounds to nearest even, saturates and turns NaN into 0. */
+
+/* Kernel used by the conversions, the best one the CPU supports by default */
+enum hackrf_convert_kernel {
+	HACKRF_CONVERT_SCALAR = 0,
+	HACKRF_CONVERT_SSE2 = 1,
+	HACKRF_CONVERT_AVX2 = 2,
+	HACKRF_CONVERT_NEON = 3,
+};
+
+/* Linear I/Q correction, see hackrf_convert_cs8_iq_correct() */
+typedef struct {
+	float ii, iq; /* out_i = ii * in_i + iq * in_q + off_i */
+	float qi, qq; /* out_q = qi * in_i + qq * in_q + off_q */
+	float off_i, off_q;
+} hackrf_iq_matrix;
+
+/* Sums over a block, see hackrf_convert_cs8_moments() */
+typedef struct {
+	int64_t sum_i, sum_q;
+	int64_t sum_ii, sum_qq, sum_iq;
+} hackrf_iq_moments;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Process wide, for benchmarks and comparisons. HACKRF_ERROR_NOT_FOUND if
+ * kernel is not built in or not supported by this CPU. */
+extern ADDAPI int ADDCALL hackrf_convert_set_kernel(const enum hackrf_convert_kernel kernel);
+extern ADDAPI enum hackrf_convert_kernel ADDCALL hackrf_convert_get_kernel(void);
+extern ADDAPI const char* ADDCALL hackrf_convert_kernel_name(const enum hackrf_convert_kernel kernel);
+
+/* RX. dc (NULL for none) is the I and Q offset in cs8 units, subtracted
+ * before scaling: out = (in - dc) * scale. 1.0f / 128 gives [-1, 1). */
+extern ADDAPI int ADDCALL hackrf_convert_cs8_to_cf32(const int8_t* src, float* dst, const uint32_t count,
+	const float scale, const float* dc);
+extern ADDAPI int ADDCALL hackrf_convert_cs8_to_planar_f32(const int8_t* src, float* dst_i, float* dst_q,
+	const uint32_t count, const float scale, const float* dc);
+/* out = in * 256 - dc, saturated. dc is in cs16 units for sub LSB offsets. */
+extern ADDAPI int ADDCALL hackrf_convert_cs8_to_cs16(const int8_t* src, int16_t* dst, const uint32_t count,
+	const int16_t* dc);
+
+/* TX, rounded to nearest and saturated to [-128, 127]. Ties go to even for
+ * cf32 and up for cs16. */
+extern ADDAPI int ADDCALL hackrf_convert_cf32_to_cs8(const float* src, int8_t* dst, const uint32_t count,
+	const float scale);
+extern ADDAPI int ADDCALL hackrf_convert_cs16_to_cs8(const int16_t* src, int8_t* dst, const uint32_t count);
+
+/* DC offset and IQ imbalance correction in cs8, rounded and saturated like
+ * hackrf_convert_cf32_to_cs8(). src may be dst. */
+extern ADDAPI int ADDCALL hackrf_convert_cs8_iq_correct(const int8_t* src, int8_t* dst, const uint32_t count,
+	const hackrf_iq_matrix* matrix);
+/* Adds the first and second order sums of count samples to moments */
+extern ADDAPI int ADDCALL hackrf_convert_cs8_moments(const int8_t* src, const uint32_t count,
+	hackrf_iq_moments* moments);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_CONVERT_H__
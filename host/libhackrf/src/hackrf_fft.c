@@ -0,0 +1,369 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hackrf_fft.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Built with FFTW when CMake finds it, the plan is then made by FFTW and
+ * the built in transform is only a fallback. */
+#ifdef HAVE_FFTW3F
+#include <fftw3.h>
+#include <pthread.h>
+
+/* FFTW planning is not thread safe, execution is */
+static pthread_mutex_t fftw_plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Recursive mixed radix decimation in time: the input is split into p
+ * interleaved sub-sequences of size m, each transformed in place in the
+ * output, then combined by radix p butterflies. Each level works on a
+ * contiguous part of the output, so most passes stay in cache. */
+
+#define FFT_FACTORS_MAX (32)
+/* Generic butterflies up to this radix use a stack scratch buffer */
+#define FFT_SCRATCH_STACK (32)
+
+typedef struct {
+	float re;
+	float im;
+} fft_complex_t;
+
+struct hackrf_fft_plan {
+	uint32_t size;
+	bool inverse;
+	/* p0, m0, p1, m1, ..., m of the last pass is 1 */
+	uint32_t factors[2 * FFT_FACTORS_MAX];
+	uint32_t max_factor;
+	fft_complex_t* twiddles; /* e^(-+j2pi k/size) */
+#ifdef HAVE_FFTW3F
+	fftwf_plan fftw;
+#endif
+};
+
+static fft_complex_t c_mul(const fft_complex_t a, const fft_complex_t b)
+{
+	fft_complex_t r;
+	r.re = a.re * b.re - a.im * b.im;
+	r.im = a.re * b.im + a.im * b.re;
+	return r;
+}
+
+static void butterfly_2(fft_complex_t* out, const uint32_t fstride,
+	const hackrf_fft_plan* plan, const uint32_t m)
+{
+	fft_complex_t* out2 = out + m;
+	fft_complex_t t;
+	uint32_t k;
+
+	for(k = 0; k < m; k++)
+	{
+		t = c_mul(out2[k], plan->twiddles[k * fstride]);
+		out2[k].re = out[k].re - t.re;
+		out2[k].im = out[k].im - t.im;
+		out[k].re += t.re;
+		out[k].im += t.im;
+	}
+}
+
+static void butterfly_4(fft_complex_t* out, const uint32_t fstride,
+	const hackrf_fft_plan* plan, const uint32_t m)
+{
+	fft_complex_t s0, s1, s2, s3, s4, s5;
+	uint32_t k;
+
+	for(k = 0; k < m; k++)
+	{
+		s0 = c_mul(out[k + m], plan->twiddles[k * fstride]);
+		s1 = c_mul(out[k + 2 * m], plan->twiddles[2 * k * fstride]);
+		s2 = c_mul(out[k + 3 * m], plan->twiddles[3 * k * fstride]);
+
+		s5.re = out[k].re - s1.re;
+		s5.im = out[k].im - s1.im;
+		out[k].re += s1.re;
+		out[k].im += s1.im;
+		s3.re = s0.re + s2.re;
+		s3.im = s0.im + s2.im;
+		s4.re = s0.re - s2.re;
+		s4.im = s0.im - s2.im;
+
+		out[k + 2 * m].re = out[k].re - s3.re;
+		out[k + 2 * m].im = out[k].im - s3.im;
+		out[k].re += s3.re;
+		out[k].im += s3.im;
+
+		/* s4 times -j (forward) or +j (inverse) */
+		if( plan->inverse )
+		{
+			out[k + m].re = s5.re - s4.im;
+			out[k + m].im = s5.im + s4.re;
+			out[k + 3 * m].re = s5.re + s4.im;
+			out[k + 3 * m].im = s5.im - s4.re;
+		} else {
+			out[k + m].re = s5.re + s4.im;
+			out[k + m].im = s5.im - s4.re;
+			out[k + 3 * m].re = s5.re - s4.im;
+			out[k + 3 * m].im = s5.im + s4.re;
+		}
+	}
+}
+
+static void butterfly_generic(fft_complex_t* out, const uint32_t fstride,
+	const hackrf_fft_plan* plan, const uint32_t m, const uint32_t p, fft_complex_t* scratch)
+{
+	fft_complex_t t;
+	uint32_t u, k, q, q1;
+	uint32_t twiddle;
+
+	for(u = 0; u < m; u++)
+	{
+		for(q1 = 0, k = u; q1 < p; q1++, k += m)
+		{
+			scratch[q1] = out[k];
+		}
+
+		for(q1 = 0, k = u; q1 < p; q1++, k += m)
+		{
+			twiddle = 0;
+			out[k] = scratch[0];
+			for(q = 1; q < p; q++)
+			{
+				twiddle += fstride * k;
+				if( twiddle >= plan->size )
+				{
+					twiddle -= plan->size;
+				}
+				t = c_mul(scratch[q], plan->twiddles[twiddle]);
+				out[k].re += t.re;
+				out[k].im += t.im;
+			}
+		}
+	}
+}
+
+static void fft_work(fft_complex_t* out, const fft_complex_t* in, const uint32_t fstride,
+	const uint32_t* factors, const hackrf_fft_plan* plan, fft_complex_t* scratch)
+{
+	const uint32_t p = factors[0];
+	const uint32_t m = factors[1];
+	uint32_t q;
+
+	if( m == 1 )
+	{
+		for(q = 0; q < p; q++)
+		{
+			out[q] = in[q * fstride];
+		}
+	} else {
+		for(q = 0; q < p; q++)
+		{
+			fft_work(&out[q * m], &in[q * fstride], fstride * p, factors + 2, plan, scratch);
+		}
+	}
+
+	switch( p )
+	{
+	case 2:
+		butterfly_2(out, fstride, plan, m);
+		break;
+
+	case 4:
+		butterfly_4(out, fstride, plan, m);
+		break;
+
+	default:
+		butterfly_generic(out, fstride, plan, m, p, scratch);
+		break;
+	}
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_fft_create(const uint32_t size, const uint8_t inverse, hackrf_fft_plan** plan)
+{
+	hackrf_fft_plan* new_plan;
+	const double sign = inverse ? 1.0 : -1.0;
+	uint32_t n;
+	uint32_t p;
+	uint32_t i;
+	double phase;
+
+	if( (plan == NULL) || (size == 0) || (size > HACKRF_FFT_SIZE_MAX) || (inverse > 1) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	new_plan = (hackrf_fft_plan*)calloc(1, sizeof(hackrf_fft_plan));
+	if( new_plan == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	new_plan->twiddles = (fft_complex_t*)malloc(size * sizeof(fft_complex_t));
+	if( new_plan->twiddles == NULL )
+	{
+		free(new_plan);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	new_plan->size = size;
+	new_plan->inverse = (inverse != 0);
+
+	for(i = 0; i < size; i++)
+	{
+		phase = sign * 2.0 * 3.14159265358979323846 * i / size;
+		new_plan->twiddles[i].re = (float)cos(phase);
+		new_plan->twiddles[i].im = (float)sin(phase);
+	}
+
+	/* Radix 4 first, then 2, then odd factors. Size 1 is a single pass of
+	 * radix 1, a copy. */
+	n = size;
+	p = 4;
+	i = 0;
+	new_plan->max_factor = 1;
+	do {
+		while( (n % p) != 0 )
+		{
+			switch( p )
+			{
+			case 4:
+				p = 2;
+				break;
+
+			case 2:
+				p = 3;
+				break;
+
+			default:
+				p += 2;
+				break;
+			}
+			if( p * p > n )
+			{
+				/* n is prime */
+				p = n;
+			}
+		}
+		n /= p;
+		new_plan->factors[i++] = p;
+		new_plan->factors[i++] = n;
+		if( p > new_plan->max_factor )
+		{
+			new_plan->max_factor = p;
+		}
+	} while( n > 1 );
+
+#ifdef HAVE_FFTW3F
+	{
+		/* Planned on scratch arrays, unaligned so any in and out will do */
+		fftwf_complex* in = (fftwf_complex*)fftwf_malloc(size * sizeof(fftwf_complex));
+		fftwf_complex* out = (fftwf_complex*)fftwf_malloc(size * sizeof(fftwf_complex));
+		if( (in != NULL) && (out != NULL) )
+		{
+			pthread_mutex_lock(&fftw_plan_mutex);
+			new_plan->fftw = fftwf_plan_dft_1d((int)size, in, out,
+				inverse ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+			pthread_mutex_unlock(&fftw_plan_mutex);
+		}
+		fftwf_free(in);
+		fftwf_free(out);
+	}
+#endif
+
+	*plan = new_plan;
+	return HACKRF_SUCCESS;
+}
+
+uint32_t ADDCALL hackrf_fft_size(const hackrf_fft_plan* plan)
+{
+	return plan->size;
+}
+
+const char* ADDCALL hackrf_fft_backend_name(void)
+{
+#ifdef HAVE_FFTW3F
+	return "FFTW";
+#else
+	return "built in";
+#endif
+}
+
+int ADDCALL hackrf_fft_execute(const hackrf_fft_plan* plan, const float* in, float* out)
+{
+	fft_complex_t stack_scratch[FFT_SCRATCH_STACK];
+	fft_complex_t* scratch = stack_scratch;
+
+	if( (plan == NULL) || (in == NULL) || (out == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+#ifdef HAVE_FFTW3F
+	if( plan->fftw != NULL )
+	{
+		fftwf_execute_dft(plan->fftw, (fftwf_complex*)in, (fftwf_complex*)out);
+		return HACKRF_SUCCESS;
+	}
+#endif
+
+	if( plan->max_factor > FFT_SCRATCH_STACK )
+	{
+		scratch = (fft_complex_t*)malloc(plan->max_factor * sizeof(fft_complex_t));
+		if( scratch == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+	}
+
+	fft_work((fft_complex_t*)out, (const fft_complex_t*)in, 1, plan->factors, plan, scratch);
+
+	if( scratch != stack_scratch )
+	{
+		free(scratch);
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_fft_destroy(hackrf_fft_plan* plan)
+{
+	if( plan != NULL )
+	{
+#ifdef HAVE_FFTW3F
+		if( plan->fftw != NULL )
+		{
+			pthread_mutex_lock(&fftw_plan_mutex);
+			fftwf_destroy_plan(plan->fftw);
+			pthread_mutex_unlock(&fftw_plan_mutex);
+		}
+#endif
+		free(plan->twiddles);
+		free(plan);
+	}
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __HACKRF_FFT_H__
+#define __HACKRF_FFT_H__
+
+#include "hackrf.h"
+
+/* Complex FFT of any size, part of libhackrf_dsp, done by FFTW when it was
+ * found at build time. Built in, each prime factor p of the size costs
+ * about p operations per sample and pass, sizes with small factors are
+ * fastest. Samples are interleaved float I/Q. Unnormalized:
+ * forward then inverse scales by size. */
+
+#define HACKRF_FFT_SIZE_MAX (1 << 20)
+
+typedef struct hackrf_fft_plan hackrf_fft_plan;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* inverse 0: X[k] = sum x[n] e^(-j2pi kn/N), 1: e^(+j2pi kn/N) */
+extern ADDAPI int ADDCALL hackrf_fft_create(const uint32_t size, const uint8_t inverse, hackrf_fft_plan** plan);
+extern ADDAPI uint32_t ADDCALL hackrf_fft_size(const hackrf_fft_plan* plan);
+/* "FFTW" if libhackrf_dsp was built with it, else "built in" */
+extern ADDAPI const char* ADDCALL hackrf_fft_backend_name(void);
+/* in and out hold size I/Q samples and must not overlap. A plan can be used
+ * by several threads at once. */
+extern ADDAPI int ADDCALL hackrf_fft_execute(const hackrf_fft_plan* plan, const float* in, float* out);
+extern ADDAPI int ADDCALL hackrf_fft_destroy(hackrf_fft_plan* plan);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_FFT_H__
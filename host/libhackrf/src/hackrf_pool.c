@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hackrf_pool.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef struct {
+	hackrf_pool* pool;
+	uint32_t index;
+	pthread_t thread;
+} pool_thread_t;
+
+struct hackrf_pool {
+	uint32_t workers;
+	uint32_t started; /* Threads running, workers 1 .. started */
+	pool_thread_t* thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t start_cond;
+	pthread_cond_t done_cond;
+	/* A new job is a new generation, NULL job is exit */
+	uint32_t generation;
+	uint32_t pending;
+	hackrf_pool_job_fn job;
+	void* ctx;
+};
+
+static void* pool_threadproc(void* arg)
+{
+	pool_thread_t* thread = (pool_thread_t*)arg;
+	hackrf_pool* pool = thread->pool;
+	uint32_t generation = 0;
+	hackrf_pool_job_fn job;
+	void* ctx;
+
+	while( true )
+	{
+		pthread_mutex_lock(&pool->mutex);
+		while( pool->generation == generation )
+		{
+			pthread_cond_wait(&pool->start_cond, &pool->mutex);
+		}
+		generation = pool->generation;
+		job = pool->job;
+		ctx = pool->ctx;
+		pthread_mutex_unlock(&pool->mutex);
+
+		if( job == NULL )
+		{
+			break;
+		}
+		job(ctx, thread->index, pool->workers);
+
+		pthread_mutex_lock(&pool->mutex);
+		pool->pending--;
+		if( pool->pending == 0 )
+		{
+			pthread_cond_signal(&pool->done_cond);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+	}
+	return NULL;
+}
+
+static void pool_start(hackrf_pool* pool, hackrf_pool_job_fn job, void* ctx)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->job = job;
+	pool->ctx = ctx;
+	pool->pending = pool->started;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start_cond);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+int hackrf_pool_create(const uint32_t workers, hackrf_pool** pool)
+{
+	hackrf_pool* new_pool;
+	uint32_t i;
+
+	if( pool == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	new_pool = (hackrf_pool*)calloc(1, sizeof(hackrf_pool));
+	if( new_pool == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	new_pool->workers = (workers == 0) ? 1 : workers;
+	new_pool->thread = (pool_thread_t*)calloc(new_pool->workers, sizeof(pool_thread_t));
+	if( new_pool->thread == NULL )
+	{
+		free(new_pool);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	pthread_mutex_init(&new_pool->mutex, NULL);
+	pthread_cond_init(&new_pool->start_cond, NULL);
+	pthread_cond_init(&new_pool->done_cond, NULL);
+
+	for(i = 1; i < new_pool->workers; i++)
+	{
+		new_pool->thread[i].pool = new_pool;
+		new_pool->thread[i].index = i;
+		if( pthread_create(&new_pool->thread[i].thread, 0, pool_threadproc, &new_pool->thread[i]) != 0 )
+		{
+			hackrf_pool_destroy(new_pool);
+			return HACKRF_ERROR_THREAD;
+		}
+		new_pool->started = i;
+	}
+
+	*pool = new_pool;
+	return HACKRF_SUCCESS;
+}
+
+uint32_t hackrf_pool_workers(const hackrf_pool* pool)
+{
+	return pool->workers;
+}
+
+void hackrf_pool_run(hackrf_pool* pool, hackrf_pool_job_fn job, void* ctx)
+{
+	if( pool->started > 0 )
+	{
+		pool_start(pool, job, ctx);
+	}
+
+	job(ctx, 0, pool->workers);
+
+	if( pool->started > 0 )
+	{
+		pthread_mutex_lock(&pool->mutex);
+		while( pool->pending > 0 )
+		{
+			pthread_cond_wait(&pool->done_cond, &pool->mutex);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
+
+void hackrf_pool_destroy(hackrf_pool* pool)
+{
+	uint32_t i;
+
+	if( pool == NULL )
+	{
+		return;
+	}
+
+	if( pool->started > 0 )
+	{
+		pool_start(pool, NULL, NULL);
+	}
+	for(i = 1; i <= pool->started; i++)
+	{
+		pthread_join(pool->thread[i].thread, NULL);
+	}
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->start_cond);
+	pthread_cond_destroy(&pool->done_cond);
+	free(pool->thread);
+	free(pool);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __HACKRF_POOL_H__
+#define __HACKRF_POOL_H__
+
+#include "hackrf.h"
+
+/* Worker threads for libhackrf_dsp, internal, not installed. The thread
+ * calling hackrf_pool_run() is worker 0 and takes part in every job. */
+
+typedef struct hackrf_pool hackrf_pool;
+
+/* Runs on every worker, index in 0 .. workers - 1 */
+typedef void (*hackrf_pool_job_fn)(void* ctx, const uint32_t index, const uint32_t workers);
+
+/* workers 0 or 1: no threads, jobs run in the caller */
+int hackrf_pool_create(const uint32_t workers, hackrf_pool** pool);
+uint32_t hackrf_pool_workers(const hackrf_pool* pool);
+/* Returns once job returned on all workers. Not reentrant. */
+void hackrf_pool_run(hackrf_pool* pool, hackrf_pool_job_fn job, void* ctx);
+void hackrf_pool_destroy(hackrf_pool* pool);
+
+#endif//__HACKRF_POOL_H__
@@ -0,0 +1,656 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hackrf_resampler.h"
+#include "hackrf_convert.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Same run time kernel selection as hackrf_convert.c */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESAMPLER_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+/* Every filter is a dot product of TAPS_ALIGN aligned length between
+ * interleaved I/Q samples and taps stored reversed (oldest sample first)
+ * and doubled (each tap twice, for I and Q). Leading taps are zero padding,
+ * matched by zeroed history, so no kernel has a tail. Kernels sum in a
+ * different order and agree to float rounding only. */
+#define TAPS_ALIGN (8)
+
+#define KAISER_BETA (8.0)
+/* Stopband attenuation for KAISER_BETA, for the length estimate */
+#define KAISER_ATTENUATION_DB (80.0)
+/* Passband of the output rate kept by default */
+#define PASSBAND (0.8)
+
+typedef void (*dot_cf32_fn)(const float* x, const float* taps, const uint32_t n, float* acc);
+
+struct hackrf_resampler {
+	uint32_t interpolation; /* L */
+	uint32_t decimation; /* M */
+	uint32_t taps_per_phase; /* Padded to TAPS_ALIGN */
+	float* taps; /* L phases of 2 * taps_per_phase */
+	/* taps_per_phase - 1 samples of history, then the block */
+	float* buffer;
+	uint32_t buffer_capacity;
+	/* Interpolated index of the next output, relative to the block start */
+	uint64_t next;
+};
+
+typedef struct {
+	uint32_t taps; /* Odd phase taps, padded to TAPS_ALIGN */
+	uint32_t center; /* Even phase delay */
+	float* odd_taps;
+	/* taps - 1 samples of history then the block, for each phase */
+	float* even;
+	float* odd;
+	uint32_t even_capacity;
+	uint32_t odd_capacity;
+	bool pending; /* Even sample of an incomplete pair */
+	float pending_iq[2];
+} halfband_stage_t;
+
+struct hackrf_halfband {
+	uint32_t stages;
+	halfband_stage_t stage[HACKRF_HALFBAND_STAGES_MAX];
+};
+
+static void dot_cf32_scalar(const float* x, const float* taps, const uint32_t n, float* acc)
+{
+	float re = 0.0f;
+	float im = 0.0f;
+	uint32_t i;
+
+	for(i = 0; i < n; i += 2)
+	{
+		re += taps[i] * x[i];
+		im += taps[i + 1] * x[i + 1];
+	}
+	acc[0] = re;
+	acc[1] = im;
+}
+
+#ifdef RESAMPLER_X86
+
+TARGET_SSE2
+static void dot_cf32_sse2(const float* x, const float* taps, const uint32_t n, float* acc)
+{
+	__m128 a0 = _mm_setzero_ps();
+	__m128 a1 = _mm_setzero_ps();
+	float lanes[4];
+	uint32_t i;
+
+	for(i = 0; i < n; i += 8)
+	{
+		a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(&x[i]), _mm_loadu_ps(&taps[i])));
+		a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(&x[i + 4]), _mm_loadu_ps(&taps[i + 4])));
+	}
+	_mm_storeu_ps(lanes, _mm_add_ps(a0, a1));
+	acc[0] = lanes[0] + lanes[2];
+	acc[1] = lanes[1] + lanes[3];
+}
+
+TARGET_AVX2
+static void dot_cf32_avx2(const float* x, const float* taps, const uint32_t n, float* acc)
+{
+	__m256 a0 = _mm256_setzero_ps();
+	__m256 a1 = _mm256_setzero_ps();
+	__m128 a;
+	float lanes[4];
+	uint32_t i;
+
+	for(i = 0; i < n; i += 16)
+	{
+		a0 = _mm256_add_ps(a0, _mm256_mul_ps(_mm256_loadu_ps(&x[i]), _mm256_loadu_ps(&taps[i])));
+		a1 = _mm256_add_ps(a1, _mm256_mul_ps(_mm256_loadu_ps(&x[i + 8]), _mm256_loadu_ps(&taps[i + 8])));
+	}
+	a0 = _mm256_add_ps(a0, a1);
+	a = _mm_add_ps(_mm256_castps256_ps128(a0), _mm256_extractf128_ps(a0, 1));
+	_mm_storeu_ps(lanes, a);
+	acc[0] = lanes[0] + lanes[2];
+	acc[1] = lanes[1] + lanes[3];
+}
+
+#endif /* RESAMPLER_X86 */
+
+#ifdef RESAMPLER_NEON
+
+static void dot_cf32_neon(const float* x, const float* taps, const uint32_t n, float* acc)
+{
+	float32x4_t a0 = vdupq_n_f32(0.0f);
+	float32x4_t a1 = vdupq_n_f32(0.0f);
+	float32x2_t a;
+	uint32_t i;
+
+	for(i = 0; i < n; i += 8)
+	{
+		a0 = vmlaq_f32(a0, vld1q_f32(&x[i]), vld1q_f32(&taps[i]));
+		a1 = vmlaq_f32(a1, vld1q_f32(&x[i + 4]), vld1q_f32(&taps[i + 4]));
+	}
+	a0 = vaddq_f32(a0, a1);
+	a = vadd_f32(vget_low_f32(a0), vget_high_f32(a0));
+	acc[0] = vget_lane_f32(a, 0);
+	acc[1] = vget_lane_f32(a, 1);
+}
+
+#endif /* RESAMPLER_NEON */
+
+/* Follows hackrf_convert_set_kernel() */
+static dot_cf32_fn dot_kernel(void)
+{
+	switch( hackrf_convert_get_kernel() )
+	{
+#ifdef RESAMPLER_X86
+	case HACKRF_CONVERT_SSE2:
+		return dot_cf32_sse2;
+
+	case HACKRF_CONVERT_AVX2:
+		return dot_cf32_avx2;
+#endif
+
+#ifdef RESAMPLER_NEON
+	case HACKRF_CONVERT_NEON:
+		return dot_cf32_neon;
+#endif
+
+	default:
+		return dot_cf32_scalar;
+	}
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	uint32_t t;
+
+	while( b != 0 )
+	{
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static double bessel_i0(const double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	uint32_t k;
+
+	for(k = 1; k < 64; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if( term < sum * 1e-12 )
+		{
+			break;
+		}
+	}
+	return sum;
+}
+
+/* Kaiser length for a transition width relative to the sample rate */
+static uint32_t kaiser_length(const double transition)
+{
+	return (uint32_t)ceil((KAISER_ATTENUATION_DB - 8.0) /
+		(2.285 * 2.0 * 3.14159265358979323846 * transition)) + 1;
+}
+
+/* Windowed sinc, -6dB at cutoff (relative to the sample rate), summing to
+ * gain */
+static void design_lowpass(double* h, const uint32_t taps, const double cutoff, const double gain)
+{
+	const double pi = 3.14159265358979323846;
+	const double center = (taps - 1) / 2.0;
+	const double i0_beta = bessel_i0(KAISER_BETA);
+	double sum = 0.0;
+	double t;
+	double r;
+	uint32_t i;
+
+	for(i = 0; i < taps; i++)
+	{
+		t = i - center;
+		if( t == 0.0 )
+		{
+			h[i] = 2.0 * cutoff;
+		} else {
+			h[i] = sin(2.0 * pi * cutoff * t) / (pi * t);
+		}
+		r = (center > 0.0) ? (t / center) : 0.0;
+		h[i] *= bessel_i0(KAISER_BETA * sqrt(1.0 - r * r)) / i0_beta;
+		sum += h[i];
+	}
+	for(i = 0; i < taps; i++)
+	{
+		h[i] *= gain / sum;
+	}
+}
+
+static uint32_t align_taps(const uint32_t taps)
+{
+	return (taps + TAPS_ALIGN - 1) / TAPS_ALIGN * TAPS_ALIGN;
+}
+
+/* Grows a history + block buffer of samples to fit count block samples */
+static int reserve_buffer(float** buffer, uint32_t* capacity, const uint32_t history, const uint32_t count)
+{
+	float* grown;
+
+	if( count > *capacity )
+	{
+		grown = (float*)realloc(*buffer, ((size_t)history + count) * 2 * sizeof(float));
+		if( grown == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		*buffer = grown;
+		*capacity = count;
+	}
+	return HACKRF_SUCCESS;
+}
+
+static int stage_init(halfband_stage_t* stage, const double passband)
+{
+	/* Passband to passband, stopband from 0.5 - passband: aliases fold onto
+	 * the stopband only. Taps 4k + 3 so both ends are non zero. */
+	uint32_t length = kaiser_length(0.5 - 2.0 * passband);
+	double* h;
+	uint32_t i;
+	uint32_t j;
+
+	length = (length < 7) ? 7 : length;
+	length = length / 4 * 4 + 3;
+	h = (double*)malloc(length * sizeof(double));
+	if( h == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	design_lowpass(h, length, 0.25, 1.0);
+
+	/* Output m uses x[2m + 1] back to x[2m + 2 - length]. Even h[i] meet
+	 * odd samples x[2m + 1 - i] = odd[m - i / 2], the center meets even
+	 * sample x[2m - 2k] = even[m - k], the other odd h[i] are zero. */
+	stage->center = (length - 3) / 4;
+	stage->taps = align_taps((length + 1) / 2);
+	stage->odd_taps = (float*)calloc((size_t)stage->taps * 2, sizeof(float));
+	stage->even = (float*)calloc((size_t)(stage->taps - 1) * 2, sizeof(float));
+	stage->odd = (float*)calloc((size_t)(stage->taps - 1) * 2, sizeof(float));
+	if( (stage->odd_taps == NULL) || (stage->even == NULL) || (stage->odd == NULL) )
+	{
+		free(h);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	/* Non zero taps sum to 0.5, the center is 0.5 */
+	for(i = 0, j = stage->taps - 1; i < length; i += 2, j--)
+	{
+		stage->odd_taps[j * 2] = (float)(h[i] * 0.5 / (1.0 - h[length / 2]));
+		stage->odd_taps[j * 2 + 1] = stage->odd_taps[j * 2];
+	}
+	free(h);
+	return HACKRF_SUCCESS;
+}
+
+static void stage_free(halfband_stage_t* stage)
+{
+	free(stage->odd_taps);
+	free(stage->even);
+	free(stage->odd);
+}
+
+static int stage_process(halfband_stage_t* stage, const dot_cf32_fn dot, const float* in, const uint32_t count,
+	float* out, uint32_t* out_count)
+{
+	const uint32_t history = stage->taps - 1;
+	const uint32_t total = count + (stage->pending ? 1 : 0);
+	const uint32_t pairs = total / 2;
+	float* even;
+	float* odd;
+	float acc[2];
+	uint32_t i;
+	uint32_t m;
+	int result;
+
+	result = reserve_buffer(&stage->even, &stage->even_capacity, history, pairs);
+	if( result == HACKRF_SUCCESS )
+	{
+		result = reserve_buffer(&stage->odd, &stage->odd_capacity, history, pairs);
+	}
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+
+	/* Split all of in before writing out, which may be in */
+	even = &stage->even[history * 2];
+	odd = &stage->odd[history * 2];
+	i = 0;
+	for(m = 0; m < pairs; m++)
+	{
+		if( (m == 0) && stage->pending )
+		{
+			even[0] = stage->pending_iq[0];
+			even[1] = stage->pending_iq[1];
+		} else {
+			even[m * 2] = in[i * 2];
+			even[m * 2 + 1] = in[i * 2 + 1];
+			i++;
+		}
+		odd[m * 2] = in[i * 2];
+		odd[m * 2 + 1] = in[i * 2 + 1];
+		i++;
+	}
+	/* An odd total leaves the last sample, the old one if count is 0 */
+	stage->pending = ((total % 2) != 0);
+	if( stage->pending && (count > 0) )
+	{
+		stage->pending_iq[0] = in[(count - 1) * 2];
+		stage->pending_iq[1] = in[(count - 1) * 2 + 1];
+	}
+
+	/* history > center */
+	even = &stage->even[(history - stage->center) * 2];
+	for(m = 0; m < pairs; m++)
+	{
+		dot(&stage->odd[m * 2], stage->odd_taps, stage->taps * 2, acc);
+		out[m * 2] = acc[0] + 0.5f * even[m * 2];
+		out[m * 2 + 1] = acc[1] + 0.5f * even[m * 2 + 1];
+	}
+
+	memmove(stage->even, &stage->even[(size_t)pairs * 2], (size_t)history * 2 * sizeof(float));
+	memmove(stage->odd, &stage->odd[(size_t)pairs * 2], (size_t)history * 2 * sizeof(float));
+	*out_count = pairs;
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_resampler_create(const uint32_t interpolation, const uint32_t decimation,
+	const uint32_t taps_per_phase, hackrf_resampler** resampler)
+{
+	hackrf_resampler* r;
+	uint32_t divisor;
+	uint32_t L;
+	uint32_t M;
+	uint32_t taps;
+	uint32_t length;
+	uint32_t p;
+	uint32_t j;
+	double transition;
+	double cutoff;
+	double* h;
+
+	if( (interpolation == 0) || (decimation == 0) || (resampler == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	divisor = gcd(interpolation, decimation);
+	L = interpolation / divisor;
+	M = decimation / divisor;
+	if( (L > HACKRF_RESAMPLER_RATIO_MAX) || (M > HACKRF_RESAMPLER_RATIO_MAX) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/* At the interpolated rate the lower Nyquist frequency is 0.5 / max(L, M).
+	 * The stopband starts there, the transition below it is what the
+	 * length allows. */
+	taps = taps_per_phase;
+	if( taps == 0 )
+	{
+		length = kaiser_length((1.0 - PASSBAND) * 0.5 / ((L > M) ? L : M));
+		taps = (length + L - 1) / L;
+	}
+	if( ((uint64_t)L * taps > HACKRF_RESAMPLER_TAPS_MAX) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	length = L * taps;
+	transition = (KAISER_ATTENUATION_DB - 8.0) /
+		(2.285 * 2.0 * 3.14159265358979323846 * ((length > 1) ? (length - 1) : 1));
+	cutoff = 0.5 / ((L > M) ? L : M) - transition / 2.0;
+	if( cutoff < 0.25 / ((L > M) ? L : M) )
+	{
+		/* Too short for a clean stopband, keep half the band */
+		cutoff = 0.25 / ((L > M) ? L : M);
+	}
+
+	r = (hackrf_resampler*)calloc(1, sizeof(hackrf_resampler));
+	if( r == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	r->interpolation = L;
+	r->decimation = M;
+	r->taps_per_phase = align_taps(taps);
+	r->taps = (float*)calloc((size_t)L * r->taps_per_phase * 2, sizeof(float));
+	r->buffer = (float*)calloc((size_t)(r->taps_per_phase - 1) * 2, sizeof(float));
+	h = (double*)malloc(length * sizeof(double));
+	if( (r->taps == NULL) || (r->buffer == NULL) || (h == NULL) )
+	{
+		free(h);
+		hackrf_resampler_destroy(r);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	/* Phase p, tap j meets x[base - j]: stored at taps_per_phase - 1 - j */
+	design_lowpass(h, length, cutoff, L);
+	for(p = 0; p < L; p++)
+	{
+		for(j = 0; j < taps; j++)
+		{
+			r->taps[((size_t)p * r->taps_per_phase + r->taps_per_phase - 1 - j) * 2] = (float)h[j * L + p];
+			r->taps[((size_t)p * r->taps_per_phase + r->taps_per_phase - 1 - j) * 2 + 1] = (float)h[j * L + p];
+		}
+	}
+	free(h);
+
+	*resampler = r;
+	return HACKRF_SUCCESS;
+}
+
+uint32_t ADDCALL hackrf_resampler_taps_per_phase(const hackrf_resampler* resampler)
+{
+	return resampler->taps_per_phase;
+}
+
+uint32_t ADDCALL hackrf_resampler_output_max(const hackrf_resampler* resampler, const uint32_t count)
+{
+	return (uint32_t)((uint64_t)count * resampler->interpolation / resampler->decimation + 1);
+}
+
+int ADDCALL hackrf_resampler_process(hackrf_resampler* resampler, const float* in,
+	const uint32_t count, float* out, uint32_t* out_count)
+{
+	uint32_t history;
+	uint32_t L;
+	uint64_t end;
+	dot_cf32_fn dot;
+	uint32_t base;
+	uint32_t n = 0;
+	int result;
+
+	if( (resampler == NULL) || ((in == NULL) && (count > 0)) || (out == NULL) || (out_count == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	history = resampler->taps_per_phase - 1;
+	L = resampler->interpolation;
+	end = (uint64_t)count * L;
+	result = reserve_buffer(&resampler->buffer, &resampler->buffer_capacity, history, count);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	memcpy(&resampler->buffer[(size_t)history * 2], in, (size_t)count * 2 * sizeof(float));
+
+	/* Output at interpolated index t is phase t mod L of the filter ending at
+	 * input t / L */
+	dot = dot_kernel();
+	while( resampler->next < end )
+	{
+		base = (uint32_t)(resampler->next / L);
+		dot(&resampler->buffer[(size_t)base * 2],
+			&resampler->taps[(size_t)(resampler->next % L) * resampler->taps_per_phase * 2],
+			resampler->taps_per_phase * 2, &out[(size_t)n * 2]);
+		n++;
+		resampler->next += resampler->decimation;
+	}
+	resampler->next -= end;
+
+	memmove(resampler->buffer, &resampler->buffer[(size_t)count * 2], (size_t)history * 2 * sizeof(float));
+	*out_count = n;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_resampler_reset(hackrf_resampler* resampler)
+{
+	if( resampler == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	memset(resampler->buffer, 0, (size_t)(resampler->taps_per_phase - 1) * 2 * sizeof(float));
+	resampler->next = 0;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_resampler_destroy(hackrf_resampler* resampler)
+{
+	if( resampler != NULL )
+	{
+		free(resampler->taps);
+		free(resampler->buffer);
+		free(resampler);
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_halfband_create(const uint32_t stages, hackrf_halfband** halfband)
+{
+	hackrf_halfband* hb;
+	uint32_t s;
+	int result;
+
+	if( (stages == 0) || (stages > HACKRF_HALFBAND_STAGES_MAX) || (halfband == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	hb = (hackrf_halfband*)calloc(1, sizeof(hackrf_halfband));
+	if( hb == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	hb->stages = stages;
+
+	/* The final passband relative to the input rate of stage s */
+	for(s = 0; s < stages; s++)
+	{
+		result = stage_init(&hb->stage[s], PASSBAND * 0.5 / (1 << (stages - s)));
+		if( result != HACKRF_SUCCESS )
+		{
+			hackrf_halfband_destroy(hb);
+			return result;
+		}
+	}
+
+	*halfband = hb;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_halfband_process(hackrf_halfband* halfband, const float* in,
+	const uint32_t count, float* out, uint32_t* out_count)
+{
+	const dot_cf32_fn dot = dot_kernel();
+	uint32_t n = count;
+	uint32_t s;
+	int result;
+
+	if( (halfband == NULL) || ((in == NULL) && (count > 0)) || (out == NULL) || (out_count == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/* Stage 0 reads in, the others work in place in out */
+	for(s = 0; s < halfband->stages; s++)
+	{
+		result = stage_process(&halfband->stage[s], dot, (s == 0) ? in : out, n, out, &n);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+	}
+	*out_count = n;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_halfband_reset(hackrf_halfband* halfband)
+{
+	halfband_stage_t* stage;
+	uint32_t s;
+
+	if( halfband == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	for(s = 0; s < halfband->stages; s++)
+	{
+		stage = &halfband->stage[s];
+		memset(stage->even, 0, (size_t)(stage->taps - 1) * 2 * sizeof(float));
+		memset(stage->odd, 0, (size_t)(stage->taps - 1) * 2 * sizeof(float));
+		stage->pending = false;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_halfband_destroy(hackrf_halfband* halfband)
+{
+	uint32_t s;
+
+	if( halfband != NULL )
+	{
+		for(s = 0; s < halfband->stages; s++)
+		{
+			stage_free(&halfband->stage[s]);
+		}
+		free(halfband);
+	}
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
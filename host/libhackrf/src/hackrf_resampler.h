@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __HACKRF_RESAMPLER_H__
+#define __HACKRF_RESAMPLER_H__
+
+#include "hackrf.h"
+
+/* Sample rate conversion, part of libhackrf_dsp. Streams of interleaved
+ * float I/Q, e.g. from hackrf_convert_cs8_to_cf32(), any block length.
+ * Filters are Kaiser windowed, about 80dB stopband starting at the output
+ * Nyquist frequency so nothing aliases, with unity gain.
+ *
+ * For large ratios run the half-band decimator first and resample the rest
+ * of the way: 20Msps to 2.4Msps is 2 half-band stages then 12/25,
+ * 10Msps to 48ksps is 5 stages then 96/625. The FIR dot products use the
+ * SIMD kernel picked by hackrf_convert_set_kernel(). */
+
+#define HACKRF_RESAMPLER_RATIO_MAX (65536)
+#define HACKRF_RESAMPLER_TAPS_MAX (1 << 22)
+#define HACKRF_HALFBAND_STAGES_MAX (16)
+
+typedef struct hackrf_resampler hackrf_resampler;
+typedef struct hackrf_halfband hackrf_halfband;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Output rate = input rate * interpolation / decimation, reduced, so the
+ * rates themselves can be passed: (2400000, 5000000) is 12/25. Each phase
+ * of the polyphase filter has taps_per_phase taps, 0 for a passband of 80%
+ * of the lower rate; fewer narrow the passband. */
+extern ADDAPI int ADDCALL hackrf_resampler_create(const uint32_t interpolation, const uint32_t decimation,
+	const uint32_t taps_per_phase, hackrf_resampler** resampler);
+extern ADDAPI uint32_t ADDCALL hackrf_resampler_taps_per_phase(const hackrf_resampler* resampler);
+/* Most output samples count input samples can give */
+extern ADDAPI uint32_t ADDCALL hackrf_resampler_output_max(const hackrf_resampler* resampler, const uint32_t count);
+/* out may be in (in place) if it has room for hackrf_resampler_output_max() */
+extern ADDAPI int ADDCALL hackrf_resampler_process(hackrf_resampler* resampler, const float* in,
+	const uint32_t count, float* out, uint32_t* out_count);
+/* Clears the filter history */
+extern ADDAPI int ADDCALL hackrf_resampler_reset(hackrf_resampler* resampler);
+extern ADDAPI int ADDCALL hackrf_resampler_destroy(hackrf_resampler* resampler);
+
+/* Decimation by 2^stages, passband 80% of the output rate. Each stage only
+ * computes the output samples and half its taps are zero, early stages
+ * are shorter since only the final band has to be protected. */
+extern ADDAPI int ADDCALL hackrf_halfband_create(const uint32_t stages, hackrf_halfband** halfband);
+/* out may be in. Gives at most (count + 2^stages - 1) >> stages samples,
+ * odd samples left over are kept for the next block. */
+extern ADDAPI int ADDCALL hackrf_halfband_process(hackrf_halfband* halfband, const float* in,
+	const uint32_t count, float* out, uint32_t* out_count);
+extern ADDAPI int ADDCALL hackrf_halfband_reset(hackrf_halfband* halfband);
+extern ADDAPI int ADDCALL hackrf_halfband_destroy(hackrf_halfband* halfband);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_RESAMPLER_H__
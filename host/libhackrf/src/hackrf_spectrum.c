@@ -0,0 +1,437 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "hackrf_spectrum.h"
+#include "hackrf_convert.h"
+#include "hackrf_fft.h"
+#include "hackrf_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Each block is done in two parallel steps: the whole segments in the
+ * buffer are split among the workers, each windowing, transforming and
+ * squaring its own into a row of powers. Then the bins are split, each
+ * worker adds its columns of all rows to the running average in order
+ * and writes the frames completed on the way. The caller then hands the
+ * frames out. */
+
+typedef struct {
+	float* in; /* Windowed segment */
+	float* out; /* Its transform */
+} spectrum_worker_t;
+
+struct hackrf_spectrum {
+	uint32_t fft_size;
+	uint32_t hop; /* fft_size - overlap */
+	uint32_t averages;
+	enum hackrf_spectrum_window window_type;
+	float* window;
+	double scale; /* 1 / (sum of the window)^2, full scale tone */
+	double enbw;
+	hackrf_fft_plan* plan;
+	hackrf_pool* pool;
+	uint32_t workers;
+	spectrum_worker_t* worker;
+	hackrf_spectrum_cb_fn callback;
+	void* ctx;
+
+	/* Samples of the next segment onwards, then the block */
+	float* buffer;
+	uint32_t buffered;
+	uint32_t buffer_capacity;
+
+	/* Current block */
+	uint32_t segments;
+	float* power; /* One row of fft_size per segment */
+	uint32_t power_capacity; /* Rows */
+	float* frames; /* One row of fft_size dB per frame completed */
+	uint32_t frames_capacity; /* Rows */
+
+	/* Frame being averaged */
+	double* sum;
+	uint32_t sum_count; /* Segments in sum */
+	uint64_t frame_index;
+};
+
+static double window_value(const enum hackrf_spectrum_window window, const uint32_t i, const uint32_t n)
+{
+	/* Periodic, for spectral analysis */
+	const double x = 2.0 * 3.14159265358979323846 * i / n;
+
+	switch( window )
+	{
+	case HACKRF_SPECTRUM_WINDOW_HANN:
+		return 0.5 - 0.5 * cos(x);
+
+	case HACKRF_SPECTRUM_WINDOW_BLACKMAN_HARRIS:
+		return 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2.0 * x) - 0.01168 * cos(3.0 * x);
+
+	case HACKRF_SPECTRUM_WINDOW_FLAT_TOP:
+		return 0.21557895 - 0.41663158 * cos(x) + 0.277263158 * cos(2.0 * x)
+			- 0.083578947 * cos(3.0 * x) + 0.006947368 * cos(4.0 * x);
+
+	default:
+		return 1.0;
+	}
+}
+
+static void transform_job(void* ctx, const uint32_t index, const uint32_t workers)
+{
+	hackrf_spectrum* sp = (hackrf_spectrum*)ctx;
+	const uint32_t N = sp->fft_size;
+	const uint32_t first = (uint32_t)((uint64_t)sp->segments * index / workers);
+	const uint32_t end = (uint32_t)((uint64_t)sp->segments * (index + 1) / workers);
+	float* in = sp->worker[index].in;
+	float* out = sp->worker[index].out;
+	const float* x;
+	float* power;
+	uint32_t segment;
+	uint32_t i;
+
+	for(segment = first; segment < end; segment++)
+	{
+		x = &sp->buffer[(size_t)segment * sp->hop * 2];
+		for(i = 0; i < N; i++)
+		{
+			in[i * 2] = x[i * 2] * sp->window[i];
+			in[i * 2 + 1] = x[i * 2 + 1] * sp->window[i];
+		}
+		hackrf_fft_execute(sp->plan, in, out);
+
+		power = &sp->power[(size_t)segment * N];
+		for(i = 0; i < N; i++)
+		{
+			power[i] = out[i * 2] * out[i * 2] + out[i * 2 + 1] * out[i * 2 + 1];
+		}
+	}
+}
+
+static void average_job(void* ctx, const uint32_t index, const uint32_t workers)
+{
+	hackrf_spectrum* sp = (hackrf_spectrum*)ctx;
+	const uint32_t N = sp->fft_size;
+	const uint32_t first = (uint32_t)((uint64_t)N * index / workers);
+	const uint32_t end = (uint32_t)((uint64_t)N * (index + 1) / workers);
+	const double scale = sp->scale / sp->averages;
+	uint32_t count = sp->sum_count;
+	const float* power;
+	float* frame = sp->frames;
+	uint32_t segment;
+	uint32_t bin;
+
+	for(segment = 0; segment < sp->segments; segment++)
+	{
+		power = &sp->power[(size_t)segment * N];
+		for(bin = first; bin < end; bin++)
+		{
+			sp->sum[bin] += power[bin];
+		}
+
+		count++;
+		if( count == sp->averages )
+		{
+			/* DC in the middle, the negative frequencies before it */
+			for(bin = first; bin < end; bin++)
+			{
+				frame[(bin + N / 2) % N] = (float)(10.0 * log10(sp->sum[bin] * scale + 1e-20));
+				sp->sum[bin] = 0.0;
+			}
+			frame += N;
+			count = 0;
+		}
+	}
+}
+
+/* Grows buffer, power and frame rows for count more samples */
+static int reserve(hackrf_spectrum* sp, const uint32_t count)
+{
+	const uint32_t total = sp->buffered + count;
+	const uint32_t segments = (total >= sp->fft_size) ? ((total - sp->fft_size) / sp->hop + 1) : 0;
+	const uint32_t frames = (sp->sum_count + segments) / sp->averages;
+	float* grown;
+
+	if( total > sp->buffer_capacity )
+	{
+		grown = (float*)realloc(sp->buffer, (size_t)total * 2 * sizeof(float));
+		if( grown == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		sp->buffer = grown;
+		sp->buffer_capacity = total;
+	}
+	if( segments > sp->power_capacity )
+	{
+		grown = (float*)realloc(sp->power, (size_t)segments * sp->fft_size * sizeof(float));
+		if( grown == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		sp->power = grown;
+		sp->power_capacity = segments;
+	}
+	if( frames > sp->frames_capacity )
+	{
+		grown = (float*)realloc(sp->frames, (size_t)frames * sp->fft_size * sizeof(float));
+		if( grown == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		sp->frames = grown;
+		sp->frames_capacity = frames;
+	}
+	return HACKRF_SUCCESS;
+}
+
+/* count new samples were appended to the buffer */
+static int process_buffer(hackrf_spectrum* sp, const uint32_t count)
+{
+	const uint32_t total = sp->buffered + count;
+	hackrf_spectrum_frame frame;
+	uint32_t frames;
+	uint32_t consumed;
+	uint32_t i;
+	int result = HACKRF_SUCCESS;
+
+	sp->segments = (total >= sp->fft_size) ? ((total - sp->fft_size) / sp->hop + 1) : 0;
+	if( sp->segments > 0 )
+	{
+		hackrf_pool_run(sp->pool, transform_job, sp);
+		hackrf_pool_run(sp->pool, average_job, sp);
+	}
+	frames = (sp->sum_count + sp->segments) / sp->averages;
+	sp->sum_count = (sp->sum_count + sp->segments) % sp->averages;
+
+	/* The next segment starts after the last one's hop */
+	consumed = sp->segments * sp->hop;
+	sp->buffered = total - consumed;
+	memmove(sp->buffer, &sp->buffer[(size_t)consumed * 2], (size_t)sp->buffered * 2 * sizeof(float));
+
+	frame.spectrum = sp;
+	frame.bins = sp->fft_size;
+	frame.ctx = sp->ctx;
+	for(i = 0; i < frames; i++)
+	{
+		frame.power_db = &sp->frames[(size_t)i * sp->fft_size];
+		frame.frame_index = sp->frame_index;
+		frame.sample_count = sp->frame_index * sp->averages * sp->hop;
+		sp->frame_index++;
+		if( (result == HACKRF_SUCCESS) && (sp->callback(&frame) != 0) )
+		{
+			result = HACKRF_ERROR_OTHER;
+		}
+	}
+	return result;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_spectrum_create(const hackrf_spectrum_params* params,
+	hackrf_spectrum_cb_fn callback, void* ctx, hackrf_spectrum** spectrum)
+{
+	hackrf_spectrum* sp;
+	uint32_t workers;
+	double sum = 0.0;
+	double sum_squares = 0.0;
+	uint32_t i;
+	int result;
+
+	if( (params == NULL) || (callback == NULL) || (spectrum == NULL) ||
+		(params->fft_size < HACKRF_SPECTRUM_FFT_SIZE_MIN) || (params->fft_size > HACKRF_SPECTRUM_FFT_SIZE_MAX) ||
+		(params->overlap >= params->fft_size) || (params->averages == 0) ||
+		((uint32_t)params->window > HACKRF_SPECTRUM_WINDOW_FLAT_TOP) ||
+		(params->threads > HACKRF_SPECTRUM_THREADS_MAX) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	sp = (hackrf_spectrum*)calloc(1, sizeof(hackrf_spectrum));
+	if( sp == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	sp->fft_size = params->fft_size;
+	sp->hop = params->fft_size - params->overlap;
+	sp->averages = params->averages;
+	sp->window_type = params->window;
+	sp->callback = callback;
+	sp->ctx = ctx;
+
+	workers = (params->threads == 0) ? 1 : params->threads;
+	sp->workers = workers;
+	sp->window = (float*)malloc(sp->fft_size * sizeof(float));
+	sp->sum = (double*)calloc(sp->fft_size, sizeof(double));
+	sp->worker = (spectrum_worker_t*)calloc(workers, sizeof(spectrum_worker_t));
+	if( (sp->window == NULL) || (sp->sum == NULL) || (sp->worker == NULL) )
+	{
+		hackrf_spectrum_destroy(sp);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	for(i = 0; i < sp->fft_size; i++)
+	{
+		sp->window[i] = (float)window_value(params->window, i, sp->fft_size);
+		sum += sp->window[i];
+		sum_squares += (double)sp->window[i] * sp->window[i];
+	}
+	sp->scale = 1.0 / (sum * sum);
+	sp->enbw = sp->fft_size * sum_squares / (sum * sum);
+
+	result = hackrf_pool_create(workers, &sp->pool);
+	if( result == HACKRF_SUCCESS )
+	{
+		result = hackrf_fft_create(sp->fft_size, 0, &sp->plan);
+	}
+	for(i = 0; (result == HACKRF_SUCCESS) && (i < workers); i++)
+	{
+		sp->worker[i].in = (float*)malloc((size_t)sp->fft_size * 2 * sizeof(float));
+		sp->worker[i].out = (float*)malloc((size_t)sp->fft_size * 2 * sizeof(float));
+		if( (sp->worker[i].in == NULL) || (sp->worker[i].out == NULL) )
+		{
+			result = HACKRF_ERROR_NO_MEM;
+		}
+	}
+	if( result != HACKRF_SUCCESS )
+	{
+		hackrf_spectrum_destroy(sp);
+		return result;
+	}
+
+	*spectrum = sp;
+	return HACKRF_SUCCESS;
+}
+
+double ADDCALL hackrf_spectrum_enbw(const hackrf_spectrum* spectrum)
+{
+	return spectrum->enbw;
+}
+
+int ADDCALL hackrf_spectrum_process(hackrf_spectrum* spectrum, const hackrf_transfer* transfer)
+{
+	uint32_t count;
+	int result;
+
+	if( (spectrum == NULL) || (transfer == NULL) || (transfer->valid_length < 0) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	count = (uint32_t)transfer->valid_length / 2;
+
+	result = reserve(spectrum, count);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	hackrf_convert_cs8_to_cf32((const int8_t*)transfer->buffer,
+		&spectrum->buffer[(size_t)spectrum->buffered * 2], count, 1.0f / 128, NULL);
+	return process_buffer(spectrum, count);
+}
+
+int ADDCALL hackrf_spectrum_process_cf32(hackrf_spectrum* spectrum,
+	const float* samples, const uint32_t count)
+{
+	int result;
+
+	if( (spectrum == NULL) || ((samples == NULL) && (count > 0)) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = reserve(spectrum, count);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+	memcpy(&spectrum->buffer[(size_t)spectrum->buffered * 2], samples, (size_t)count * 2 * sizeof(float));
+	return process_buffer(spectrum, count);
+}
+
+int ADDCALL hackrf_spectrum_reset(hackrf_spectrum* spectrum)
+{
+	if( spectrum == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	spectrum->buffered = 0;
+	memset(spectrum->sum, 0, spectrum->fft_size * sizeof(double));
+	spectrum->sum_count = 0;
+	spectrum->frame_index = 0;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_spectrum_destroy(hackrf_spectrum* spectrum)
+{
+	uint32_t i;
+
+	if( spectrum == NULL )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	hackrf_pool_destroy(spectrum->pool);
+	if( spectrum->worker != NULL )
+	{
+		for(i = 0; i < spectrum->workers; i++)
+		{
+			free(spectrum->worker[i].in);
+			free(spectrum->worker[i].out);
+		}
+		free(spectrum->worker);
+	}
+	hackrf_fft_destroy(spectrum->plan);
+	free(spectrum->window);
+	free(spectrum->sum);
+	free(spectrum->buffer);
+	free(spectrum->power);
+	free(spectrum->frames);
+	free(spectrum);
+	return HACKRF_SUCCESS;
+}
+
+const char* ADDCALL hackrf_spectrum_window_name(const enum hackrf_spectrum_window window)
+{
+	switch( window )
+	{
+	case HACKRF_SPECTRUM_WINDOW_RECTANGULAR:
+		return "rectangular";
+
+	case HACKRF_SPECTRUM_WINDOW_HANN:
+		return "Hann";
+
+	case HACKRF_SPECTRUM_WINDOW_BLACKMAN_HARRIS:
+		return "Blackman-Harris";
+
+	case HACKRF_SPECTRUM_WINDOW_FLAT_TOP:
+		return "flat top";
+
+	default:
+		return "unknown window";
+	}
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __HACKRF_SPECTRUM_H__
+#define __HACKRF_SPECTRUM_H__
+
+#include "hackrf.h"
+
+/* Welch power spectrum of the RX stream, part of libhackrf_dsp. The stream
+ * is cut into fft_size segments starting every fft_size - overlap samples,
+ * each windowed and transformed, and averages consecutive power spectra
+ * make a frame. A frame covers averages * (fft_size - overlap) + overlap
+ * samples, at 10Msps, 1024 bins, 50% overlap and 977 averages about 20
+ * frames per second. */
+
+#define HACKRF_SPECTRUM_FFT_SIZE_MIN (16)
+#define HACKRF_SPECTRUM_FFT_SIZE_MAX (1 << 20)
+#define HACKRF_SPECTRUM_THREADS_MAX (64)
+
+enum hackrf_spectrum_window {
+	HACKRF_SPECTRUM_WINDOW_RECTANGULAR = 0,
+	HACKRF_SPECTRUM_WINDOW_HANN = 1,
+	HACKRF_SPECTRUM_WINDOW_BLACKMAN_HARRIS = 2, /* 4 term, 92dB sidelobes */
+	HACKRF_SPECTRUM_WINDOW_FLAT_TOP = 3, /* Tone amplitudes within 0.01dB */
+};
+
+typedef struct hackrf_spectrum hackrf_spectrum;
+
+typedef struct {
+	uint32_t fft_size; /* Any size, small prime factors are fastest */
+	enum hackrf_spectrum_window window;
+	uint32_t overlap; /* Samples shared by consecutive segments, < fft_size */
+	uint32_t averages; /* Segments per frame */
+	uint32_t threads; /* Workers including the caller, 0 or 1 for none */
+} hackrf_spectrum_params;
+
+typedef struct {
+	hackrf_spectrum* spectrum;
+	/* fft_size bins in dB relative to a full scale tone, lowest frequency
+	 * first: bin i is (i - fft_size / 2) * sample_rate / fft_size from the
+	 * center. Valid during the callback only. */
+	const float* power_db;
+	uint32_t bins;
+	uint64_t frame_index;
+	uint64_t sample_count; /* Stream index of the first sample of the frame */
+	void* ctx;
+} hackrf_spectrum_frame;
+
+/* Called in order from the thread calling hackrf_spectrum_process(), non
+ * zero stops the block with HACKRF_ERROR_OTHER. */
+typedef int (*hackrf_spectrum_cb_fn)(const hackrf_spectrum_frame* frame);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern ADDAPI int ADDCALL hackrf_spectrum_create(const hackrf_spectrum_params* params,
+	hackrf_spectrum_cb_fn callback, void* ctx, hackrf_spectrum** spectrum);
+/* Equivalent noise bandwidth of the window in bins: noise density in dB
+ * per Hz is a bin minus 10 * log10(enbw * sample_rate / fft_size). */
+extern ADDAPI double ADDCALL hackrf_spectrum_enbw(const hackrf_spectrum* spectrum);
+/* Any block length, e.g. straight from the hackrf_start_rx() callback.
+ * cs8 is scaled by 1/128 first. */
+extern ADDAPI int ADDCALL hackrf_spectrum_process(hackrf_spectrum* spectrum, const hackrf_transfer* transfer);
+extern ADDAPI int ADDCALL hackrf_spectrum_process_cf32(hackrf_spectrum* spectrum,
+	const float* samples, const uint32_t count);
+/* Drops buffered samples and the frame being averaged */
+extern ADDAPI int ADDCALL hackrf_spectrum_reset(hackrf_spectrum* spectrum);
+extern ADDAPI int ADDCALL hackrf_spectrum_destroy(hackrf_spectrum* spectrum);
+
+extern ADDAPI const char* ADDCALL hackrf_spectrum_window_name(const enum hackrf_spectrum_window window);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_SPECTRUM_H__
@@ -32,8 +32,13 @@ def read_max2837_register(register_number):
 def write_max2837_register(register_number, value):
     device.ctrl_transfer(0x40, 2, value, register_number)
 
+def read_max2837_registers(first, count):
+    # REGS_READ, chip 0 is the MAX2837: one transfer for the whole file
+    data = device.ctrl_transfer(0xC0, 26, 0, first, count * 2)
+    return struct.unpack('<%dH' % count, data)
+
 def dump_max2837():
-    for i in range(32):
-        print('%2d: %03x' % (i, read_max2837_register(i)))
+    for i, value in enumerate(read_max2837_registers(0, 32)):
+        print('%2d: %03x' % (i, value))
 
 dump_max2837()